@@ -6,12 +6,15 @@
 /* Network */
 #include <ESP8266WiFi.h>
 #include <ESP8266WebServer.h>
+#include <uri/UriBraces.h>
 #include <WiFiUdp.h>
-#include <WakeOnLan.h>
 #include <WiFiManager.h>
-#include <ESP8266Ping.h>
 
 #define ENABLE_mDNS 1  // Values: 1 to enable, != 1 to disable
+#define ENABLE_WOL_RELAY 1  // Values: 1 to enable, != 1 to disable
+#define ENABLE_UDP_CONTROL 1  // Values: 1 to enable, != 1 to disable
+#define ENABLE_MQTT 1  // Values: 1 to enable, != 1 to disable
+#define ENABLE_ARP_SNOOPING 1  // Values: 1 to enable, != 1 to disable
 
 #if ENABLE_mDNS == 1
 #include <ESP8266mDNS.h>
@@ -21,6 +24,7 @@
 #include <LittleFS.h>
 #include <ArduinoJson.h>
 #include <map>
+#include <unordered_set>
 
 /* OTA */
 #define ENABLE_STANDARD_OTA 1  // Values: 1 to enable, != 1 to disable
@@ -31,6 +35,13 @@
 #endif
 
 #include <AutoOTA.h>
+#include <ESP8266HTTPClient.h>
+#include <Updater.h>
+
+/* Debug */
+#ifndef ENABLE_TRACE
+#define ENABLE_TRACE 0  // Values: 1 to enable, != 1 to disable
+#endif
 
 /* Time */
 #include <GTimer.h>
@@ -39,6 +50,22 @@
 #include "index.h"
 #include "404.h"
 #include "memory.h"
+#include "metrics.h"
+#include "trace.h"
+#include "idle.h"
+#include "station.h"
+#include "update.h"
+#include "magic.h"
+#include "resolver.h"
+#include "probe.h"
+#include "policy.h"
+#include "jobs.h"
+#include "schedule.h"
+#include "relay.h"
+#include "control.h"
+#include "mqtt.h"
+#include "discover.h"
+#include "snoop.h"
 #include "api.h"
 
 #define VERSION "2.3.3"
@@ -47,12 +74,17 @@ AutoOTA ota(VERSION, "StafLoker/EspWOL");
 
 ESP8266WebServer server(80);
 WiFiUDP UDP;
-WakeOnLan wol(UDP);
 WiFiManager wifiManager;
 
 const char* hostsFile = "/hosts.json";
 const char* networkConfigFile = "/networkConfig.json";
 const char* authenticationFile = "/authentication.json";
+const char* schedulesFile = "/schedules.json";
+const char* relayConfigFile = "/relay.json";
+const char* controlConfigFile = "/control.json";
+const char* mqttConfigFile = "/mqtt.json";
+const char* powerConfigFile = "/power.json";
+const char* stationCacheFile = "/station.json";
 
 const char* hostname = "wol";
 const char* SSID = "WOL-ESP8266";
@@ -61,8 +93,14 @@ const char* SSID = "WOL-ESP8266";
 struct Host {
   String name;
   String mac;
+  uint8_t macBytes[6] = {};  // Parsed MAC, kept in sync with mac
   String ip;
   unsigned long periodicPing = 0;
+  std::vector<String> tags;
+  WakeTarget wake;
+  WakePolicy policy;
+  ProbeTarget probe;
+  bool followIp = false;  // ip follows the host to a new DHCP lease, see ENABLE_ARP_SNOOPING
 };
 
 // Structure for Network settings
@@ -81,12 +119,57 @@ struct Authentication {
   String password;
 } authentication;
 
+// Structure for Schedule settings
+struct ScheduleConfig {
+  String timezone = SCHEDULE_DEFAULT_TIMEZONE;  // POSIX TZ string
+  std::map<int, Schedule> rules;
+} scheduleConfig;
+
+// Structure for Wake-on-LAN relay settings
+struct RelayConfig {
+  bool enable = false;
+  bool knownHostsOnly = true;  // Only relay magic packets for the MAC addresses of hosts
+  uint16_t maxPps = RELAY_DEFAULT_MAX_PPS;
+} relayConfig;
+
+// Structure for UDP control settings
+struct ControlConfig {
+  bool enable = false;
+  uint16_t port = CONTROL_DEFAULT_PORT;
+  String key;  // Pre-shared key of the request HMAC, in hex
+} controlConfig;
+
+// Structure for MQTT settings
+struct MqttConfig {
+  bool enable = false;
+  String host;  // Broker IP address or hostname
+  uint16_t port = MQTT_DEFAULT_PORT;
+  String username;
+  String password;
+  String prefix = MQTT_DEFAULT_PREFIX;  // Root of the topics
+  uint16_t keepAlive = MQTT_DEFAULT_KEEP_ALIVE;
+} mqttConfig;
+
+// Structure for power settings
+struct PowerConfig {
+  SleepMode sleep = SleepMode::Modem;
+} powerConfig;
+
+// Last good WiFi connection
+StationCache stationCache;
+
 // Map for storing hosts
 std::map<int, Host> hosts;
 // Map for storing lastPings
 std::map<int, unsigned long> lastPings;
 // Map for storing Timers
 std::map<int, GTimer<millis>> timers;
+// Map for storing the state of the periodic checks
+std::map<int, HostCheck> checks;
+// Map for storing host indexes by tag
+std::map<String, std::vector<int>> tagIndex;
+// Set of the MAC addresses of hosts, see `macKey()`
+std::unordered_set<uint64_t> macIndex;
 
 #if ENABLE_STANDARD_OTA == 1
 // Function to setup OTA
@@ -107,6 +190,36 @@ void updateIPWifiSettings() {
   }
 }
 
+// Function to apply the network settings to the connected station, without a restart
+void applyNetworkSettings() {
+  if (networkConfig.enable) {
+    WiFi.config(networkConfig.ip, networkConfig.gateway, networkConfig.networkMask, networkConfig.dns);
+  } else {
+    WiFi.config(0u, 0u, 0u);  // Back to DHCP
+  }
+  updateIPWifiSettings();
+  // The web server listens on any address: lwIP only drops the connections to the previous one
+  refreshWakeTargets();
+#if ENABLE_mDNS == 1
+  MDNS.announce();
+#endif
+}
+
+// Function to start the services reached through the station, after the configuration portal which listens on port 80
+void startStationServices() {
+#if ENABLE_mDNS == 1
+  // Set up mDNS responder
+  //  the fully-qualified domain name is "wol.local"
+  MDNS.begin(hostname);
+  MDNS.addService("http", "tcp", 80);
+#if ENABLE_STANDARD_OTA == 1
+  MDNS.enableArduino(ArduinoOTA_PORT, true);
+#endif
+#endif
+
+  server.begin();
+}
+
 void setupPeriodicPingToHosts() {
   for (auto& [id, host] : hosts) {
     if (host.periodicPing) {
@@ -115,24 +228,145 @@ void setupPeriodicPingToHosts() {
   }
 }
 
+void rebuildHostIndexes() {
+  tagIndex.clear();
+  macIndex.clear();
+  std::vector<String> addresses;
+  for (auto& [id, host] : hosts) {
+    macIndex.insert(macKey(host.macBytes));
+    addresses.push_back(host.ip);
+    for (const String& tag : host.tags) {
+      tagIndex[tag].push_back(id);
+    }
+  }
+  setResolvedNames(addresses);
+#if ENABLE_ARP_SNOOPING == 1
+  syncSnoopedHosts();
+#endif
+}
+
+// Function to drop the check state of a host, e.g. after its policy changed
+void forgetCheck(int id) {
+  auto it = checks.find(id);
+  if (it != checks.end()) {
+    clearProbe(it->second.probe);
+    checks.erase(it);
+  }
+}
+
+// Function to find a host by its parsed MAC address, -1 if none
+int findHostByMAC(const uint8_t mac[6]) {
+  if (macIndex.find(macKey(mac)) == macIndex.end()) {
+    return -1;
+  }
+  for (const auto& [id, host] : hosts) {
+    if (!memcmp(host.macBytes, mac, 6)) {
+      return id;
+    }
+  }
+  return -1;
+}
+
+// Function to get the last known state of a host: 1 up, 0 down, -1 unknown, with the milliseconds since it was known
+int8_t getHostState(int id, unsigned long& age) {
+#if ENABLE_ARP_SNOOPING == 1
+  if (getLastSeen(hosts[id].macBytes, age) && age < SNOOP_UP_WINDOW) {
+    return 1;
+  }
+#endif
+  auto check = checks.find(id);
+  auto lastPing = lastPings.find(id);
+  if (check == checks.end() || check->second.up < 0 || lastPing == lastPings.end()) {
+    return -1;
+  }
+  age = millis() - lastPing->second;
+  return check->second.up;
+}
+
+// Runs one step of the due checks: probes are asynchronous, so a dead host no longer blocks the loop
 void checkTimers() {
   for (auto& [id, timer] : timers) {
-    if (timer.tick()) {
-      const Host& host = hosts[id];
+    HostCheck& check = checks[id];
+    if (timer.tick() && !check.due) {
+      check.due = true;
+      check.attempts = 0;
+    }
+    if (!check.due) {
+      limitSleep(timer.getLeft());
+      continue;
+    }
+    limitSleep(0);  // Probe or name resolution in progress
+
+    const Host& host = hosts[id];
+    bool alive = false;
+#if ENABLE_ARP_SNOOPING == 1
+    unsigned long lastSeen;
+    if (check.probe < 0 && check.attempts == 0 && getLastSeen(host.macBytes, lastSeen) && lastSeen < SNOOP_UP_WINDOW) {
+      // Seen on the network lately, up without a probe
+      check.due = false;
+      check.up = 1;
+      check.failedWakes = 0;
+      lastPings[id] = millis();
+      continue;
+    }
+#endif
+    if (check.probe < 0) {
       IPAddress ip;
-      ip.fromString(host.ip);
+      ResolveState resolved = resolveHost(host.ip, ip);
+      if (resolved == ResolveState::Pending) {
+        continue;  // Resolved in the background, tried again next loop
+      }
+      if (resolved == ResolveState::Resolved) {
+        check.probe = startProbe(ip, host.probe, host.policy.timeout);  // -1 while all probes are in use, tried again next loop
+        if (check.probe >= 0) {
+          check.attempts++;
+          lastPings[id] = millis();
+        }
+        continue;
+      }
+      // A name that does not resolve, like the mDNS name of a sleeping host, is down without retries
+      recordPing(id, false, 0);
       lastPings[id] = millis();
-      if (!Ping.ping(ip)) {
-        wol.sendMagicPacket(host.mac.c_str());
+    } else {
+      ProbeState state = getProbeState(check.probe);
+      if (state == ProbeState::Pending) {
+        continue;
+      }
+      alive = state == ProbeState::Up;
+      recordPing(id, alive, getProbeTime(check.probe));
+      clearProbe(check.probe);
+      check.probe = -1;
+      if (!alive && check.attempts <= host.policy.retries) {
+        continue;
       }
     }
+
+    check.due = false;
+    check.up = alive;
+    if (alive) {
+      check.failedWakes = 0;
+    } else if (takeAutoWake(host.policy, check, host.periodicPing)) {
+      recordMagicPacket(sendMagicPacket(host.macBytes, host.wake));
+    }
   }
 }
 
+// Function to wrap the handler of a route: timed for the metrics, then followed by the hooks of every request
+ESP8266WebServer::THandlerFunction apiRoute(const char* route, ESP8266WebServer::THandlerFunction handler) {
+  ESP8266WebServer::THandlerFunction instrumented = instrumentRoute(route, handler);
+  return [instrumented]() {
+    instrumented();
+    keepAwake(IDLE_REQUEST_WINDOW);  // The other requests of the page follow
+    confirmNetworkSettings();        // The request may have reached the device on its new address
+  };
+}
+
 // Server setup
 void setup() {
   WiFi.hostname(hostname);
 
+  setupMetrics();
+
 #if ENABLE_STANDARD_OTA == 1
   setupOTA();
 #endif
@@ -141,40 +375,84 @@ void setup() {
   loadNetworkConfig();
   loadAuthentication();
   loadHostsData();
+  rebuildHostIndexes();
+  loadSchedules();
+  loadRelayConfig();
+  loadControlConfig();
+  loadMqttConfig();
+  loadPowerConfig();
 
   updateIPWifiSettings();
 
-  wifiManager.autoConnect(SSID);  // Auto connect
+  if (!connectCachedStation()) {
+    startStationPortal();  // Served from loop() until the station connects
+  }
 
-#if ENABLE_mDNS == 1
-  // Set up mDNS responder
-  //  the fully-qualified domain name is "wol.local"
-  MDNS.begin(hostname);
-  MDNS.addService("http", "tcp", 80);
-#if ENABLE_STANDARD_OTA == 1
-  MDNS.enableArduino(ArduinoOTA_PORT, true);
+  setupWakeTargets();
+  setupSchedules();
+  setupIdle();
+
+#if ENABLE_WOL_RELAY == 1
+  setupRelay();
 #endif
+
+#if ENABLE_UDP_CONTROL == 1
+  setupControl();
+#endif
+
+#if ENABLE_MQTT == 1
+  setupMqtt();
 #endif
 
-  server.on("/", HTTP_GET, handleRoot);
-  server.on("/hosts", HTTP_ANY, handleHosts);
-  server.on("/ping", HTTP_POST, handlePingHost);
-  server.on("/wake", HTTP_POST, handleWakeHost);
-  server.on("/about", HTTP_GET, handleGetAbout);
-  server.on("/networkSettings", HTTP_ANY, handleNetworkSettings);
-  server.on("/authenticationSettings", HTTP_ANY, handleAuthenticationSettings);
-  server.on("/resetWifi", HTTP_POST, handleResetWiFiSettings);
-  server.on("/updateVersion", HTTP_ANY, handleUpdateVersion);
-  server.on("/import", HTTP_POST, handleImportDatabase);
+#if ENABLE_ARP_SNOOPING == 1
+  setupSnooping();
+#endif
+
+  server.on("/", HTTP_GET, apiRoute("/", handleRoot));
+  server.on("/hosts", HTTP_ANY, apiRoute("/hosts", handleHosts));
+  server.on("/ping", HTTP_POST, apiRoute("/ping", handlePingHost));
+  server.on("/wake", HTTP_POST, apiRoute("/wake", handleWakeHost));
+  server.on("/schedules", HTTP_ANY, apiRoute("/schedules", handleSchedules));
+#if ENABLE_WOL_RELAY == 1
+  server.on("/relaySettings", HTTP_ANY, apiRoute("/relaySettings", handleRelaySettings));
+#endif
+#if ENABLE_UDP_CONTROL == 1
+  server.on("/controlSettings", HTTP_ANY, apiRoute("/controlSettings", handleControlSettings));
+#endif
+#if ENABLE_MQTT == 1
+  server.on("/mqttSettings", HTTP_ANY, apiRoute("/mqttSettings", handleMqttSettings));
+#endif
+  server.on("/powerSettings", HTTP_ANY, apiRoute("/powerSettings", handlePowerSettings));
+  server.on("/discover", HTTP_ANY, apiRoute("/discover", handleDiscover));
+  server.on(UriBraces("/jobs/{}"), HTTP_GET, apiRoute("/jobs/{}", handleGetJob));
+  server.on("/about", HTTP_GET, apiRoute("/about", handleGetAbout));
+  server.on("/networkSettings", HTTP_ANY, apiRoute("/networkSettings", handleNetworkSettings));
+  server.on("/authenticationSettings", HTTP_ANY, apiRoute("/authenticationSettings", handleAuthenticationSettings));
+  server.on("/resetWifi", HTTP_POST, apiRoute("/resetWifi", handleResetWiFiSettings));
+  server.on("/updateVersion", HTTP_ANY, apiRoute("/updateVersion", handleUpdateVersion));
+  server.on("/updateVersion/progress", HTTP_GET, apiRoute("/updateVersion/progress", handleUpdateProgress));
+  server.on("/import", HTTP_POST, apiRoute("/import", handleImportDatabase));
+  server.on("/metrics", HTTP_GET, apiRoute("/metrics", handleMetrics));
+#if ENABLE_TRACE == 1
+  server.on("/debug/trace", HTTP_GET, apiRoute("/debug/trace", handleDebugTrace));
+#endif
   server.onNotFound([]() {
     server.send_P(200, "text/html", notFoundHtmlPage);
   });
-  server.begin();
+
+  const char* headerKeys[] = { "If-None-Match" };
+  server.collectHeaders(headerKeys, 1);
 
   setupPeriodicPingToHosts();
+
+  setupStation();
+  if (isStationReady()) {
+    startStationServices();
+  }
 }
 
 void loop() {
+  unsigned long loopStart = micros();
 
 #if ENABLE_STANDARD_OTA == 1
   ArduinoOTA.handle();
@@ -186,7 +464,37 @@ void loop() {
 
   server.handleClient();
 
-  checkTimers();
+  if (handleStation()) {
+    startStationServices();  // The configuration portal is closed
+  }
+
+  handleWakeTargets();
+
+  handleResolver();
+
+#if ENABLE_ARP_SNOOPING == 1
+  handleSnooping();
+#endif
+
+  if (isStationReady()) {
+    checkTimers();
+  }
+
+  checkSchedules();
+
+  handleJobs();
+
+  handleDiscovery();
+
+#if ENABLE_MQTT == 1
+  handleMqtt();
+#endif
+
+  handleUpdateCheck();
+
+  handleUpdateDownload();
+
+  recordLoopDuration(micros() - loopStart);
 
-  delay(1);  // Reduce power consumption by 60% with a delay https://hackaday.com/2022/10/28/esp8266-web-server-saves-60-power-with-a-1-ms-delay/
+  idleSleep();
 }
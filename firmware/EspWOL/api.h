@@ -23,6 +23,25 @@ static void sendJsonResponse(int statusCode, const String &message, bool success
  */
 static void sendJsonResponse(int statusCode, const JsonDocument &doc);
 
+/**
+ * @brief Parses the request body as JSON.
+ * 
+ * @param doc The JSON document to fill.
+ * @return True if the body is valid JSON, otherwise false.
+ */
+static bool parseJsonBody(JsonDocument &doc);
+
+/**
+ * @brief Reads and validates a list of host tags.
+ * 
+ * Duplicated tags are dropped. A missing value gives an empty list.
+ * 
+ * @param value The JSON value holding the tags.
+ * @param tags Reference to a vector to store the tags.
+ * @return true if the value is null or an array of at most `MAX_TAGS_PER_HOST` valid tags.
+ */
+static bool readTags(JsonVariantConst value, std::vector<String> &tags);
+
 /**
  * @brief Validates the host data received in a JSON document.
  * 
@@ -34,9 +53,13 @@ static void sendJsonResponse(int statusCode, const JsonDocument &doc);
  * @param mac Reference to a String variable to store the validated MAC address.
  * @param ip Reference to a String variable to store the validated IP address.
  * @param periodicPing Reference to a long variable to store the validated periodic ping value.
+ * @param tags Reference to a vector to store the validated tags (optional field).
+ * @param wake Reference to a WakeTarget to store the validated wake target (optional field).
+ * @param policy Reference to a WakePolicy to store the validated wake policy (optional field).
+ * @param probe Reference to a ProbeTarget to store the validated probe (optional field).
  * @return True if all validations pass, otherwise false.
  */
-static bool validateHostData(const JsonDocument &doc, String &name, String &mac, String &ip, long &periodicPing);
+static bool validateHostData(const JsonDocument &doc, String &name, String &mac, String &ip, long &periodicPing, std::vector<String> &tags, WakeTarget &wake, WakePolicy &policy, ProbeTarget &probe);
 
 /**
  * @brief Checks if the user is authenticated.
@@ -48,6 +71,17 @@ static bool validateHostData(const JsonDocument &doc, String &name, String &mac,
  */
 static bool isAuthenticated();
 
+/**
+ * @brief Answers a conditional GET when the client copy is up to date.
+ * 
+ * Adds the database version as ETag to the response. If the request has a
+ * matching `If-None-Match` header, a `304 Not Modified` response is sent.
+ * 
+ * @param state State of the response not in the database, added to the ETag.
+ * @return true if the 304 response was sent, false if the resource must be sent.
+ */
+static bool isNotModified(const char *state = nullptr);
+
 /**
  * @brief Handles the root API request ('/').
  * 
@@ -55,12 +89,30 @@ static bool isAuthenticated();
  */
 void handleRoot();
 
+/**
+ * @brief Adds the tags of a host to a JSON object.
+ * 
+ * @param obj The JSON object of the host.
+ * @param tags The tags of the host.
+ */
+static void addTags(JsonObject obj, const std::vector<String> &tags);
+
+/**
+ * @brief Looks up the hosts having a tag in the tag index.
+ * 
+ * @param tag The tag.
+ * @param ids Reference to a vector to store the host indexes.
+ * @return true if at least one host has the tag.
+ */
+static bool findHostsByTag(const String &tag, std::vector<int> &ids);
+
 /**
  * @brief Retrieves a list of all registered hosts.
  * 
- * API Endpoint: GET '/hosts'
+ * API Endpoint: GET '/hosts' and GET '/hosts?tag={tag}'
  * 
- * Generates a JSON response containing all registered hosts, including their names, MAC addresses, and IP addresses.
+ * Generates a JSON response containing all registered hosts (or those having the tag), including their
+ * indexes, names, MAC addresses, IP addresses and tags.
  */
 static void getHostList();
 
@@ -128,16 +180,67 @@ void handleHosts();
  * 
  * If the host index is valid, attempts to send a WOL magic packet.
  * Returns a success or failure message.
+ * 
+ * @param id The index of the host as a string.
+ */
+static void wakeHost(const String &id);
+
+/**
+ * @brief Queues magic packets for a list of hosts.
+ * 
+ * API Endpoint: POST '/wake', POST '/wake?tag={tag}' and POST '/wake?id={index}&verify=true'
+ * 
+ * Takes the hosts having the tag, the host index, or the host indexes (`ids`)
+ * of the JSON body, and the optional `repeat`, `spacing` and `maxPps` options
+ * from the JSON body, and queues a wake job. With `verify` (argument or JSON
+ * body), queues a wake-and-verify job instead, given `timeout` seconds.
+ * Responds right away with the job ID; the packets are sent from `loop()`.
+ */
+static void wakeHosts();
+
+/**
+ * @brief Handles wake requests.
+ * 
+ * - With an `id` argument: wakes one host immediately.
+ * - With a `tag` argument, a JSON body or `id` and `verify` arguments: queues a job.
  */
 void handleWakeHost();
 
+/**
+ * @brief Retrieves the state of a wake or ping job.
+ * 
+ * API Endpoint: GET '/jobs/{id}'
+ */
+void handleGetJob();
+
+/**
+ * @brief Queues a ping to all hosts having a tag.
+ * 
+ * API Endpoint: POST '/ping?tag={tag}'
+ * 
+ * Responds right away with the job ID; the hosts are pinged from `loop()`
+ * and the results are available in GET '/jobs/{id}'.
+ * 
+ * @param tag The tag.
+ */
+static void pingHosts(const String &tag);
+
+/**
+ * @brief Queues a ping job and responds with its ID, or 503 if `JOBS_MAX` jobs are running.
+ * 
+ * @param ids The host indexes.
+ * @param attempts The probes of a host before it counts as down.
+ */
+static void sendPingJob(const std::vector<int> &ids, uint8_t attempts);
+
 /**
  * @brief Pings a specific host to check its availability.
  * 
  * API Endpoint: POST '/ping?id={index}'
  * 
- * Attempts to ping the host at the specified index.
- * Returns a success message if the host responds, or a failure message if it does not.
+ * Queues a ping job probing the host at the specified index (ICMP, TCP or ARP, see `probe` in POST '/hosts')
+ * up to `PING_HOST_ATTEMPTS` times, and responds right away with the job ID; the result is available in
+ * GET '/jobs/{id}'. With a `tag` argument, pings all the hosts having the tag, see `pingHosts()`.
  */
 void handlePingHost();
 
@@ -147,7 +250,8 @@ void handlePingHost();
  * API Endpoint: PUT '/networkSettings'
  * 
  * Parses a JSON request body containing new network settings.
- * Saves the configuration and restarts the ESP device to apply changes.
+ * Applies them without a restart once the response is sent, see `changeNetworkSettings()`:
+ * they are saved by the first request on the new address, or reverted after `STATION_ROLLBACK_TIMEOUT`.
  */
 static void updateNetworkSettings();
 
@@ -198,12 +302,198 @@ void handleNetworkSettings();
  */
 void handleAuthenticationSettings();
 
+/**
+ * @brief Validates the schedule rule received in a JSON document.
+ * 
+ * Requires `cron` and either `host` (an existing host index) or `tag`.
+ * If validation fails, an appropriate JSON error response is sent.
+ * 
+ * @param doc The JSON document containing the rule.
+ * @param schedule Reference to a Schedule to store the validated and compiled rule.
+ * @return True if all validations pass, otherwise false.
+ */
+static bool validateScheduleData(const JsonDocument &doc, Schedule &schedule);
+
+/**
+ * @brief Retrieves the time zone, the clock state and the schedule rules.
+ * 
+ * API Endpoint: GET '/schedules'
+ */
+static void getSchedules();
+
+/**
+ * @brief Adds a schedule rule.
+ * 
+ * API Endpoint: POST '/schedules'
+ */
+static void addSchedule();
+
+/**
+ * @brief Updates a schedule rule.
+ * 
+ * API Endpoint: PUT '/schedules?id={index}'
+ * 
+ * @param id The index of the rule as a string.
+ */
+static void editSchedule(const String &id);
+
+/**
+ * @brief Deletes a schedule rule.
+ * 
+ * API Endpoint: DELETE '/schedules?id={index}'
+ * 
+ * @param id The index of the rule as a string.
+ */
+static void deleteSchedule(const String &id);
+
+/**
+ * @brief Updates the time zone the rules are evaluated in.
+ * 
+ * API Endpoint: PUT '/schedules'
+ */
+static void updateTimezone();
+
+/**
+ * @brief Handles API requests related to scheduled wakes.
+ * 
+ * Determines the HTTP method and processes the request:
+ * - GET: Retrieves the rules.
+ * - POST: Adds a rule.
+ * - PUT: Updates a rule (with `id`) or the time zone (without).
+ * - DELETE: Deletes a rule.
+ */
+void handleSchedules();
+
+#if ENABLE_WOL_RELAY == 1
+/**
+ * @brief Retrieves the relay settings and counters.
+ * 
+ * API Endpoint: GET '/relaySettings'
+ */
+static void getRelaySettings();
+
+/**
+ * @brief Updates the relay settings and opens or closes its listeners.
+ * 
+ * API Endpoint: PUT '/relaySettings'
+ */
+static void updateRelaySettings();
+
+/**
+ * @brief Handles API requests related to the Wake-on-LAN relay.
+ * 
+ * Determines the HTTP method and processes the request:
+ * - GET: Retrieves the settings and counters.
+ * - PUT: Updates the settings.
+ */
+void handleRelaySettings();
+#endif
+
+#if ENABLE_UDP_CONTROL == 1
+/**
+ * @brief Retrieves the UDP control settings and counters, without the key.
+ * 
+ * API Endpoint: GET '/controlSettings'
+ */
+static void getControlSettings();
+
+/**
+ * @brief Updates the UDP control settings and opens, moves or closes its port.
+ * 
+ * API Endpoint: PUT '/controlSettings'
+ */
+static void updateControlSettings();
+
+/**
+ * @brief Handles API requests related to the UDP control port.
+ * 
+ * Determines the HTTP method and processes the request:
+ * - GET: Retrieves the settings and counters.
+ * - PUT: Updates the settings.
+ */
+void handleControlSettings();
+#endif
+
+#if ENABLE_MQTT == 1
+/**
+ * @brief Retrieves the MQTT settings, connection state and counters, without the password.
+ * 
+ * API Endpoint: GET '/mqttSettings'
+ */
+static void getMqttSettings();
+
+/**
+ * @brief Updates the MQTT settings and reconnects to the broker.
+ * 
+ * API Endpoint: PUT '/mqttSettings'
+ */
+static void updateMqttSettings();
+
+/**
+ * @brief Handles API requests related to the MQTT client.
+ * 
+ * Determines the HTTP method and processes the request:
+ * - GET: Retrieves the settings, state and counters.
+ * - PUT: Updates the settings.
+ */
+void handleMqttSettings();
+#endif
+
+/**
+ * @brief Retrieves the sleep mode and the load of the loop.
+ * 
+ * API Endpoint: GET '/powerSettings'
+ */
+static void getPowerSettings();
+
+/**
+ * @brief Updates the sleep mode and applies it to the WiFi radio.
+ * 
+ * API Endpoint: PUT '/powerSettings'
+ */
+static void updatePowerSettings();
+
+/**
+ * @brief Handles API requests related to the power settings.
+ * 
+ * Determines the HTTP method and processes the request:
+ * - GET: Retrieves the sleep mode, duty cycle and wake-ups per second.
+ * - PUT: Updates the sleep mode.
+ */
+void handlePowerSettings();
+
+/**
+ * @brief Starts a sweep of the device network for hosts to add.
+ * 
+ * API Endpoint: POST '/discover'
+ * 
+ * Accepts an optional JSON body with `icmp` to also ping the devices found.
+ * Returns right away, the sweep runs in the background.
+ */
+static void startDiscover();
+
+/**
+ * @brief Retrieves the progress of the sweep and the devices found that are not hosts yet.
+ * 
+ * API Endpoint: GET '/discover'
+ */
+static void getDiscover();
+
+/**
+ * @brief Handles API requests related to the discovery of hosts.
+ * 
+ * Determines the HTTP method and processes the request:
+ * - GET: Retrieves the progress and the devices found.
+ * - POST: Starts a sweep.
+ */
+void handleDiscover();
+
 /**
  * @brief Retrieves system information.
  * 
  * API Endpoint: GET '/about'
  * 
- * Returns device version and hostname in JSON format.
+ * Returns device version, hostname and the cached update status in JSON format.
  */
 void handleGetAbout();
 
@@ -219,25 +509,25 @@ void handleGetAbout();
 static const char *errorToString(AutoOTA::Error error);
 
 /**
- * @brief Checks for available OTA updates.
+ * @brief Adds the state of the cached update information to a JSON document.
  * 
- * @param version Pointer to a String where the new version number will be stored (optional).
- * @param notes Pointer to a String where the release notes will be stored (optional).
- * @param bin Pointer to a String where the binary file path will be stored (optional).
- * @return true if no errors occurred during the update check or if no updates are available.
- * @return false if an error occurred (excluding the "No Updates" error).
+ * Adds `checkedAge` (seconds since the last successful check, -1 if none),
+ * `stale`, `checking` and `error` (message of the last failed check).
+ * Requests a background check when the request has a `refresh` argument.
+ * 
+ * @param doc The JSON document to fill.
  */
-static bool checkUpdate(String *version, String *notes, String *bin);
+static void addUpdateStatus(JsonDocument &doc);
 
 /**
  * @brief Retrieves information about the current and latest available firmware versions.
  * 
  * API Endpoint: GET '/updateVersion'
  * 
- * Checks for available updates and retrieves version information.
- * Returns a JSON response containing:
+ * Returns the cached result of the last update check in a JSON response containing:
  * - The currently installed firmware version.
  * - The latest available firmware version.
+ * - How old the information is.
  */
 static void getInformationToUpdate();
 
@@ -246,8 +536,10 @@ static void getInformationToUpdate();
  * 
  * API Endpoint: POST '/updateVersion'
  * 
- * If an update is available, this function sends a success response, waits briefly, 
- * and then starts the update process.
+ * Uses the cached result of the last update check, and requests a check when
+ * none has succeeded yet. If an update is available, this function starts the
+ * download and sends a success response right away. The download runs in
+ * `loop()`, see `handleUpdateProgress()`.
  */
 static void updateToLastVersion();
 
@@ -260,6 +552,16 @@ static void updateToLastVersion();
  */
 void handleUpdateVersion();
 
+/**
+ * @brief Reports the progress of the running firmware update.
+ * 
+ * API Endpoint: GET '/updateVersion/progress'
+ * 
+ * Returns the stage, the bytes written to flash, the firmware size and the
+ * progress in percent. Contains the error message when the update failed.
+ */
+void handleUpdateProgress();
+
 /**
  * @brief Import host database.
  * 
@@ -267,6 +569,28 @@ void handleUpdateVersion();
  */
 void handleImportDatabase();
 
+/**
+ * @brief Exposes runtime performance counters.
+ * 
+ * API Endpoint: GET '/metrics'
+ * 
+ * Streams loop, request, ping, magic packet, heap, WiFi and flash counters
+ * in Prometheus text format.
+ */
+void handleMetrics();
+
+#if ENABLE_TRACE == 1
+/**
+ * @brief Dumps the request trace ring buffer.
+ * 
+ * API Endpoint: GET '/debug/trace'
+ * 
+ * Returns the most recent spans (auth, parse, validate, flash write, UDP send, ...)
+ * with their duration in CPU cycles. Only compiled when ENABLE_TRACE is 1.
+ */
+void handleDebugTrace();
+#endif
+
 /**
  * @brief Reset WiFi settings.
  * 
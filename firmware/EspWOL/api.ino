@@ -3,18 +3,46 @@
 #include "memory.h"
 
 static void sendJsonResponse(int statusCode, const String &message, bool success) {
+  TRACE_SPAN("respond");
   String jsonResponse;
   jsonResponse = String("{\"success\":") + (success ? "true" : "false") + ",\"message\":\"" + message + "\"}";
   server.send(statusCode, "application/json", jsonResponse);
 }
 
 static void sendJsonResponse(int statusCode, const JsonDocument &doc) {
+  TRACE_SPAN("respond");
   String jsonResponse;
   serializeJson(doc, jsonResponse);
   server.send(statusCode, "application/json", jsonResponse);
 }
 
-static bool validateHostData(const JsonDocument &doc, String &name, String &mac, String &ip, long &periodicPing) {
+static bool parseJsonBody(JsonDocument &doc) {
+  TRACE_SPAN("parse");
+  return !deserializeJson(doc, server.arg("plain"));
+}
+
+static bool readTags(JsonVariantConst value, std::vector<String> &tags) {
+  tags.clear();
+  if (value.isNull()) {
+    return true;
+  }
+  if (!value.is<JsonArrayConst>() || value.size() > MAX_TAGS_PER_HOST) {
+    return false;
+  }
+  for (JsonVariantConst v : value.as<JsonArrayConst>()) {
+    String tag = v.as<String>();
+    if (!v.is<const char *>() || !isValidTag(tag)) {
+      return false;
+    }
+    if (std::find(tags.begin(), tags.end(), tag) == tags.end()) {
+      tags.push_back(tag);
+    }
+  }
+  return true;
+}
+
+static bool validateHostData(const JsonDocument &doc, String &name, String &mac, String &ip, long &periodicPing, std::vector<String> &tags, WakeTarget &wake, WakePolicy &policy, ProbeTarget &probe) {
+  TRACE_SPAN("validate");
   if (!doc.containsKey("name") || !doc.containsKey("mac") || !doc.containsKey("ip") || !doc.containsKey("periodicPing")) {
     sendJsonResponse(400, "Missing required fields", false);
     return false;
@@ -25,7 +53,7 @@ static bool validateHostData(const JsonDocument &doc, String &name, String &mac,
   ip = doc["ip"].as<String>();
   periodicPing = doc["periodicPing"].as<long>();
 
-  if (name.isEmpty() || !isValidMACAddress(mac) || !isValidIPAddress(ip) || !isValidPeriodicPing(periodicPing)) {
+  if (name.isEmpty() || !isValidMACAddress(mac) || !isValidHostAddress(ip) || !isValidPeriodicPing(periodicPing) || !readTags(doc["tags"], tags) || !readWakeTarget(doc["wake"], wake) || !readWakePolicy(doc["policy"], policy) || !readProbeTarget(doc["probe"], probe)) {
     sendJsonResponse(400, "Invalid data format", false);
     return false;
   }
@@ -33,7 +61,22 @@ static bool validateHostData(const JsonDocument &doc, String &name, String &mac,
   return true;
 }
 
+static bool isNotModified(const char *state) {
+  String etag = getDatabaseETag();
+  if (state) {
+    etag = etag.substring(0, etag.length() - 1) + '-' + state + '"';
+  }
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", "no-cache");
+  if (server.header("If-None-Match") == etag) {
+    server.send(304);
+    return true;
+  }
+  return false;
+}
+
 static bool isAuthenticated() {
+  TRACE_SPAN("auth");
   if (authentication.enable && !server.authenticate(authentication.username.c_str(), authentication.password.c_str())) {
     server.requestAuthentication();
     return false;
@@ -43,23 +86,66 @@ static bool isAuthenticated() {
 
 // API: '/'
 void handleRoot() {
+  TRACE_REQUEST("/");
   if (isAuthenticated()) {
+    TRACE_SPAN("respond");
     server.send_P(200, "text/html", indexHtmlPage);
   }
 }
 
-// API: GET '/hosts'
+static void addTags(JsonObject obj, const std::vector<String> &tags) {
+  JsonArray array = obj.createNestedArray("tags");
+  for (const String &tag : tags) {
+    array.add(tag);
+  }
+}
+
+static bool findHostsByTag(const String &tag, std::vector<int> &ids) {
+  auto it = tagIndex.find(tag);
+  if (it == tagIndex.end()) {
+    return false;
+  }
+  ids = it->second;
+  return true;
+}
+
+// API: GET '/hosts' and GET '/hosts?tag={tag}'
 static void getHostList() {
+  TRACE_SPAN("build");
   JsonDocument doc;
   JsonArray array = doc.to<JsonArray>();
-  for (const auto &pair : hosts) {
-    const Host &host = pair.second;
-
+  auto addHostToList = [&array](int id, const Host &host) {
     JsonObject obj = array.createNestedObject();
+    obj["id"] = id;
     obj["name"] = host.name;
     obj["mac"] = host.mac;
     obj["ip"] = host.ip;
     obj["periodicPing"] = host.periodicPing / 1000;
+    addTags(obj, host.tags);
+    if (!host.wake.isDefault()) {
+      writeWakeTarget(obj.createNestedObject("wake"), host.wake);
+    }
+    if (!host.policy.isDefault()) {
+      writeWakePolicy(obj.createNestedObject("policy"), host.policy);
+    }
+    if (!host.probe.isDefault()) {
+      writeProbeTarget(obj.createNestedObject("probe"), host.probe);
+    }
+    if (host.followIp) {
+      obj["followIp"] = true;
+    }
+  };
+
+  if (server.hasArg("tag")) {
+    std::vector<int> ids;
+    findHostsByTag(server.arg("tag"), ids);
+    for (int id : ids) {
+      addHostToList(id, hosts[id]);
+    }
+  } else {
+    for (const auto &pair : hosts) {
+      addHostToList(pair.first, pair.second);
+    }
   }
   sendJsonResponse(200, doc);
 }
@@ -67,18 +153,45 @@ static void getHostList() {
 // API: GET '/hosts?id={index}'
 static void getHost(const String &id) {
   int index = id.toInt();
-  if (index >= 0 && index < hosts.size()) {
+  if (hosts.count(index)) {
     Host &host = hosts[index];
     JsonDocument doc;
     doc["name"] = host.name;
     doc["mac"] = host.mac;
     doc["ip"] = host.ip;
+    if (!isValidIPAddress(host.ip)) {
+      IPAddress ip;
+      if (resolveHost(host.ip, ip) == ResolveState::Resolved) {
+        doc["resolved"] = ip.toString();
+      } else {
+        doc["resolved"] = nullptr;
+      }
+    }
     doc["periodicPing"] = host.periodicPing / 1000;
+    addTags(doc.as<JsonObject>(), host.tags);
+    writeWakeTarget(doc.createNestedObject("wake"), host.wake);
+    writeWakePolicy(doc.createNestedObject("policy"), host.policy);
+    writeProbeTarget(doc.createNestedObject("probe"), host.probe);
+    doc["followIp"] = host.followIp;
     if (lastPings.find(index) != lastPings.end()) {
       doc["lastPing"] = (millis() - lastPings[index]) / 1000;
     } else {
       doc["lastPing"] = -1;
     }
+#if ENABLE_ARP_SNOOPING == 1
+    unsigned long lastSeen;
+    if (getLastSeen(host.macBytes, lastSeen)) {
+      doc["lastSeen"] = lastSeen / 1000;
+    }
+#endif
+    if (unsigned long timeToUp = getLastTimeToUp(index)) {
+      doc["timeToUp"] = timeToUp;
+    }
+    auto check = checks.find(index);
+    if (check != checks.end()) {
+      doc["failedWakes"] = check->second.failedWakes;
+      doc["wakesToday"] = millis() - check->second.dayStartedAt < POLICY_DAY ? check->second.wakesToday : 0;
+    }
     sendJsonResponse(200, doc);
   } else {
     sendJsonResponse(400, "Host not found", false);
@@ -93,27 +206,39 @@ static void addHost() {
   }
 
   JsonDocument doc;
-  if (deserializeJson(doc, server.arg("plain"))) {
+  if (!parseJsonBody(doc)) {
     sendJsonResponse(400, "Invalid JSON", false);
     return;
   }
 
   String name, mac, ip;
   long periodicPing;
-  if (!validateHostData(doc, name, mac, ip, periodicPing)) return;
-
-  Host host = { name, mac, ip, periodicPing * 1000 };
-
-  if (isHostDuplicate(host)) {
+  std::vector<String> tags;
+  WakeTarget wake;
+  WakePolicy policy;
+  ProbeTarget probe;
+  if (!validateHostData(doc, name, mac, ip, periodicPing, tags, wake, policy, probe)) return;
+
+  Host host = { name, mac, {}, ip, (unsigned long)periodicPing * 1000, tags, wake, policy, probe, doc["followIp"] | false };
+  parseMACAddress(host.mac, host.macBytes);
+
+  bool duplicate;
+  {
+    TRACE_SPAN("duplicate check");
+    duplicate = isHostDuplicate(host);
+  }
+  if (duplicate) {
     sendJsonResponse(400, "Duplicate host", false);
     return;
   }
 
-  int id = hosts.size();
+  int id = hosts.empty() ? 0 : hosts.rbegin()->first + 1;  // Never an id in use, even after a delete
   hosts[id] = host;
   if (host.periodicPing) {
     timers[id] = GTimer<millis>(host.periodicPing, true);
   }
+  resolveWakeTarget(id);
+  rebuildHostIndexes();
 
   saveHostsData();
   sendJsonResponse(200, "Host added", true);
@@ -127,26 +252,43 @@ static void editHost(const String &id) {
   }
 
   int index = id.toInt();
-  if (index < 0 || index >= hosts.size()) {
+  if (!hosts.count(index)) {
     sendJsonResponse(400, "Host not found", false);
     return;
   }
 
   JsonDocument doc;
-  if (deserializeJson(doc, server.arg("plain"))) {
+  if (!parseJsonBody(doc)) {
     sendJsonResponse(400, "Invalid JSON", false);
     return;
   }
 
   String name, mac, ip;
   long periodicPing;
-  if (!validateHostData(doc, name, mac, ip, periodicPing)) return;
-
+  std::vector<String> tags;
+  WakeTarget wake;
+  WakePolicy policy;
+  ProbeTarget probe;
+  if (!validateHostData(doc, name, mac, ip, periodicPing, tags, wake, policy, probe)) return;
+
+  releaseWakeTarget(index);
+  forgetCheck(index);
   Host &host = hosts[index];
+  if (mac != host.mac && moveHostSchedules(host.macBytes, &mac)) {
+    saveSchedules();  // Rules follow the host to its new MAC address
+  }
   host.name = name;
   host.mac = mac;
+  parseMACAddress(host.mac, host.macBytes);
   host.ip = ip;
   host.periodicPing = periodicPing * 1000;
+  host.tags = tags;
+  host.wake = wake;
+  host.policy = policy;
+  host.probe = probe;
+  host.followIp = doc["followIp"] | false;
+  resolveWakeTarget(index);
+  rebuildHostIndexes();
 
   if (host.periodicPing) {
     GTimer<millis> &timer = timers[index];
@@ -163,10 +305,18 @@ static void editHost(const String &id) {
 // API: DELETE '/hosts?id={index}'
 static void deleteHost(const String &id) {
   int index = id.toInt();
-  if (index >= 0 && index < hosts.size()) {
+  if (hosts.count(index)) {
+    releaseWakeTarget(index);
+    if (moveHostSchedules(hosts[index].macBytes, nullptr)) {
+      rescheduleAll();
+      saveSchedules();
+    }
     hosts.erase(index);
     timers.erase(index);
+    forgetCheck(index);
     lastPings.erase(index);
+    forgetHostMetrics(index);
+    rebuildHostIndexes();
     saveHostsData();
     sendJsonResponse(200, "Host deleted", true);
   } else {
@@ -175,10 +325,13 @@ static void deleteHost(const String &id) {
 }
 
 void handleHosts() {
+  TRACE_REQUEST("/hosts");
   if (isAuthenticated()) {
     if (!server.hasArg("id")) {
       if (server.method() == HTTP_GET) {
-        getHostList();
+        if (!isNotModified()) {
+          getHostList();
+        }
       } else if (server.method() == HTTP_POST) {
         addHost();
       } else {
@@ -199,44 +352,211 @@ void handleHosts() {
 }
 
 // API: POST '/wake?id={index}'
+static void wakeHost(const String &id) {
+  int index = id.toInt();
+  if (hosts.count(index)) {
+    Host &host = hosts[index];
+    bool sent;
+    {
+      TRACE_SPAN("udp send");
+      sent = sendMagicPacket(host.macBytes, host.wake);
+    }
+    recordMagicPacket(sent);
+    if (sent) {
+      sendJsonResponse(200, "WOL packet sent", true);
+    } else {
+      sendJsonResponse(200, "Failed to send WOL packet", false);
+    }
+  } else {
+    sendJsonResponse(400, "Host not found", false);
+  }
+}
+
+// API: POST '/wake', POST '/wake?tag={tag}' and POST '/wake?id={index}&verify=true'
+static void wakeHosts() {
+  JsonDocument doc;
+  if (server.hasArg("plain") && !parseJsonBody(doc)) {
+    sendJsonResponse(400, "Invalid JSON", false);
+    return;
+  }
+
+  if (!server.hasArg("tag") && !server.hasArg("id") && !doc["ids"].is<JsonArray>()) {
+    sendJsonResponse(400, "Missing required fields", false);
+    return;
+  }
+
+  bool verify = doc["verify"] | (server.arg("verify") == "true" || server.arg("verify") == "1");
+  long timeout = doc["timeout"] | (server.hasArg("timeout") ? server.arg("timeout").toInt() : (long)VERIFY_DEFAULT_TIMEOUT);
+  long repeat = doc["repeat"] | 1L;
+  long spacing = doc["spacing"] | 0L;
+  long maxPps = doc["maxPps"] | (long)WAKE_DEFAULT_MAX_PPS;
+  if (repeat < 1 || repeat > WAKE_MAX_REPEAT || spacing < 0 || spacing > WAKE_MAX_SPACING || maxPps < 1 || maxPps > WAKE_MAX_PPS || timeout < 1 || timeout > VERIFY_MAX_TIMEOUT) {
+    sendJsonResponse(400, "Invalid data format", false);
+    return;
+  }
+
+  std::vector<int> ids;
+  int ignoredCount = 0;
+  if (server.hasArg("tag")) {
+    findHostsByTag(server.arg("tag"), ids);
+  } else if (server.hasArg("id")) {
+    int id = server.arg("id").toInt();
+    if (hosts.find(id) != hosts.end()) {
+      ids.push_back(id);
+    }
+  } else {
+    TRACE_SPAN("validate");
+    for (JsonVariant v : doc["ids"].as<JsonArray>()) {
+      int id = v | -1;
+      if (hosts.find(id) == hosts.end() || std::find(ids.begin(), ids.end(), id) != ids.end()) {
+        ignoredCount++;
+        continue;
+      }
+      ids.push_back(id);
+    }
+  }
+
+  if (ids.empty()) {
+    sendJsonResponse(400, "Host not found", false);
+    return;
+  }
+  if (ids.size() > JOBS_MAX_HOSTS) {
+    sendJsonResponse(400, "Too many hosts", false);
+    return;
+  }
+
+  int jobId = verify ? queueVerifyJob(ids, timeout) : queueWakeJob(ids, repeat, spacing, maxPps);
+  if (jobId < 0) {
+    sendJsonResponse(503, "Too many jobs running", false);
+    return;
+  }
+
+  const Job *job = findJob(jobId);
+  JsonDocument response;
+  response["success"] = true;
+  response["message"] = verify ? "Wake and verify job queued" : "Wake job queued";
+  response["job"] = jobId;
+  response["hosts"] = ids.size();
+  response["ignored"] = ignoredCount;
+  if (verify) {
+    response["timeout"] = timeout;
+  } else {
+    response["packets"] = job->total();
+    response["duration"] = (job->total() - 1) * job->interval;
+  }
+  sendJsonResponse(200, response);
+}
+
 void handleWakeHost() {
+  TRACE_REQUEST("/wake");
   if (isAuthenticated()) {
-    if (server.hasArg("id")) {
-      int index = server.arg("id").toInt();
-      if (index >= 0 && index < hosts.size()) {
-        Host &host = hosts[index];
-        if (wol.sendMagicPacket(host.mac.c_str())) {
-          sendJsonResponse(200, "WOL packet sent", true);
-        } else {
-          sendJsonResponse(200, "Failed to send WOL packet", false);
+    if (server.hasArg("id") && !server.hasArg("verify")) {
+      wakeHost(server.arg("id"));
+    } else if (server.hasArg("id")) {
+      wakeHosts();
+    } else if (server.hasArg("plain") || server.hasArg("tag")) {
+      wakeHosts();
+    } else {
+      sendJsonResponse(405, "HTTP Method Not Allowed", false);
+    }
+  }
+}
+
+// API: GET '/jobs/{id}'
+void handleGetJob() {
+  TRACE_REQUEST("/jobs/{}");
+  if (isAuthenticated()) {
+    const Job *job = findJob(server.pathArg(0).toInt());
+    if (!job) {
+      sendJsonResponse(404, "Job not found", false);
+      return;
+    }
+
+    JsonDocument doc;
+    doc["id"] = server.pathArg(0).toInt();
+    doc["type"] = job->type == JobType::Wake ? "wake" : (job->type == JobType::Ping ? "ping" : "verify");
+    doc["state"] = job->done ? "done" : (job->next ? "running" : "queued");
+    doc["hosts"] = job->macs.size();
+    if (job->type == JobType::Wake) {
+      doc["repeat"] = job->repeat;
+      doc["interval"] = job->interval;
+      doc["packets"] = job->total();
+      doc["sent"] = job->sent;
+      doc["failed"] = job->failed;
+    } else if (job->type == JobType::Ping) {
+      doc["up"] = job->sent;
+      doc["down"] = job->failed;
+      JsonArray results = doc.createNestedArray("results");
+      for (size_t i = 0; i < job->macs.size(); i++) {
+        if (job->results[i] >= 0) {
+          JsonObject result = results.createNestedObject();
+          result["id"] = findJobHost(*job, i);
+          result["up"] = job->results[i] == 1;
         }
-      } else {
-        sendJsonResponse(400, "Host not found", false);
       }
     } else {
-      sendJsonResponse(405, "HTTP Method Not Allowed", false);
+      doc["up"] = job->sent;
+      doc["down"] = job->failed;
+      doc["timeout"] = (job->deadline - job->createdAt) / 1000;
+      JsonArray results = doc.createNestedArray("results");
+      for (size_t i = 0; i < job->macs.size(); i++) {
+        JsonObject result = results.createNestedObject();
+        result["id"] = findJobHost(*job, i);
+        result["state"] = job->results[i] < 0 ? "waiting" : (job->results[i] ? "up" : "timeout");
+        result["packets"] = job->verify[i].packets;
+        if (job->results[i] == 1) {
+          result["timeToUp"] = job->verify[i].upAfter;
+        }
+      }
+    }
+    doc["age"] = (millis() - job->createdAt) / 1000;
+    if (job->done) {
+      doc["duration"] = job->finishedAt - job->createdAt;
     }
+    sendJsonResponse(200, doc);
   }
 }
 
+// Queues a ping job and responds with its ID
+static void sendPingJob(const std::vector<int> &ids, uint8_t attempts) {
+  int jobId = queuePingJob(ids, attempts);
+  if (jobId < 0) {
+    sendJsonResponse(503, "Too many jobs running", false);
+    return;
+  }
+
+  JsonDocument response;
+  response["success"] = true;
+  response["message"] = "Ping job queued";
+  response["job"] = jobId;
+  response["hosts"] = ids.size();
+  sendJsonResponse(200, response);
+}
+
+// API: POST '/ping?tag={tag}'
+static void pingHosts(const String &tag) {
+  std::vector<int> ids;
+  if (!findHostsByTag(tag, ids)) {
+    sendJsonResponse(400, "Host not found", false);
+    return;
+  }
+  sendPingJob(ids, 1);
+}
 
 // API: POST '/ping?id={index}'
 void handlePingHost() {
+  TRACE_REQUEST("/ping");
   if (isAuthenticated()) {
     if (server.hasArg("id")) {
       int index = server.arg("id").toInt();
-      if (index >= 0 && index < hosts.size()) {
-        Host &host = hosts[index];
-        IPAddress ip;
-        ip.fromString(host.ip);
-        if (Ping.ping(ip, 3)) {
-          sendJsonResponse(200, "Pinging", true);
-        } else {
-          sendJsonResponse(200, "Failed ping", false);
-        }
+      if (hosts.count(index)) {
+        // Probed from loop(), the response never waits for the host or for DNS
+        sendPingJob({ index }, PING_HOST_ATTEMPTS);
       } else {
         sendJsonResponse(400, "Host not found", false);
       }
+    } else if (server.hasArg("tag")) {
+      pingHosts(server.arg("tag"));
     } else {
       sendJsonResponse(405, "HTTP Method Not Allowed", false);
     }
@@ -251,7 +571,7 @@ static void updateNetworkSettings() {
   }
 
   JsonDocument doc;
-  if (deserializeJson(doc, server.arg("plain"))) {
+  if (!parseJsonBody(doc)) {
     sendJsonResponse(400, "Invalid JSON", false);
     return;
   }
@@ -269,30 +589,30 @@ static void updateNetworkSettings() {
     sendJsonResponse(400, "Invalid data format", false);
     return;
   }
-  networkConfig.enable = doc["enable"];
-  if (networkConfig.enable) {
+  NetworkConfig config = networkConfig;
+  config.enable = doc["enable"];
+  if (config.enable) {
     if (!isValidIPAddress(ip_str) || !isValidIPAddress(networkMask_str) || !isValidIPAddress(gateway_str) || !isValidIPAddress(dns_str)) {
       sendJsonResponse(400, "Invalid data format", false);
       return;
     }
-    IPAddress ip;
-    IPAddress networkMask;
-    IPAddress gateway;
-    IPAddress dns;
-    ip.fromString(ip_str);
-    networkMask.fromString(networkMask_str);
-    gateway.fromString(gateway_str);
-    dns.fromString(dns_str);
-    networkConfig.ip = ip;
-    networkConfig.networkMask = networkMask;
-    networkConfig.gateway = gateway;
-    networkConfig.dns = dns;
-  }
-  saveNetworkConfig();
-  updateIPWifiSettings();
-  sendJsonResponse(200, "Network settings updated", true);
-  delay(300);
-  ESP.restart();
+    config.ip.fromString(ip_str);
+    config.networkMask.fromString(networkMask_str);
+    config.gateway.fromString(gateway_str);
+    config.dns.fromString(dns_str);
+  }
+  changeNetworkSettings(config);
+
+  // Address to reconnect to, where the first request confirms the settings: a DHCP lease is only known once applied
+  JsonDocument response;
+  response["success"] = true;
+  response["message"] = "Network settings updated";
+#if ENABLE_mDNS == 1
+  response["address"] = config.enable ? config.ip.toString() : String(hostname) + ".local";
+#else
+  response["address"] = config.enable ? config.ip.toString() : String(hostname);  // Name sent in the DHCP request
+#endif
+  sendJsonResponse(200, response);
 }
 
 // API: PUT '/authenticationSettings'
@@ -303,7 +623,7 @@ static void updateAuthenticationSettings() {
   }
 
   JsonDocument doc;
-  if (deserializeJson(doc, server.arg("plain"))) {
+  if (!parseJsonBody(doc)) {
     sendJsonResponse(400, "Invalid JSON", false);
     return;
   }
@@ -358,9 +678,18 @@ static void getAuthenticationSettings() {
 }
 
 void handleNetworkSettings() {
+  TRACE_REQUEST("/networkSettings");
   if (isAuthenticated()) {
     if (server.method() == HTTP_GET) {
-      getNetworkSettings();
+      // With DHCP the response has the lease, which changes without the database
+      char lease[36];
+      if (!networkConfig.enable) {
+        snprintf_P(lease, sizeof(lease), PSTR("%08lx%08lx%08lx%08lx"), (unsigned long)(uint32_t)WiFi.localIP(), (unsigned long)(uint32_t)WiFi.subnetMask(),
+                   (unsigned long)(uint32_t)WiFi.gatewayIP(), (unsigned long)(uint32_t)WiFi.dnsIP());
+      }
+      if (!isNotModified(networkConfig.enable ? nullptr : lease)) {
+        getNetworkSettings();
+      }
     } else if (server.method() == HTTP_PUT) {
       updateNetworkSettings();
     } else {
@@ -370,9 +699,12 @@ void handleNetworkSettings() {
 }
 
 void handleAuthenticationSettings() {
+  TRACE_REQUEST("/authenticationSettings");
   if (isAuthenticated()) {
     if (server.method() == HTTP_GET) {
-      getAuthenticationSettings();
+      if (!isNotModified()) {
+        getAuthenticationSettings();
+      }
     } else if (server.method() == HTTP_PUT) {
       updateAuthenticationSettings();
     } else {
@@ -381,6 +713,526 @@ void handleAuthenticationSettings() {
   }
 }
 
+static bool validateScheduleData(const JsonDocument &doc, Schedule &schedule) {
+  TRACE_SPAN("validate");
+  if (!doc.containsKey("cron") || doc.containsKey("host") == doc.containsKey("tag")) {
+    sendJsonResponse(400, "Missing required fields", false);
+    return false;
+  }
+
+  schedule.cron = doc["cron"].as<String>();
+  schedule.tag = doc["tag"] | "";
+  schedule.enabled = doc["enabled"] | true;
+
+  bool validTarget;
+  if (doc.containsKey("host")) {
+    auto host = hosts.find(doc["host"] | -1);
+    validTarget = host != hosts.end();
+    if (validTarget) {
+      schedule.mac = host->second.mac;
+      memcpy(schedule.macBytes, host->second.macBytes, 6);
+      schedule.tag = "";
+    }
+  } else {
+    validTarget = isValidTag(schedule.tag);
+  }
+  if (!validTarget || !compileSchedule(schedule)) {
+    sendJsonResponse(400, "Invalid data format", false);
+    return false;
+  }
+  return true;
+}
+
+// API: GET '/schedules'
+static void getSchedules() {
+  JsonDocument doc;
+  doc["timezone"] = scheduleConfig.timezone;
+  doc["synced"] = isClockSynced();
+  doc["time"] = isClockSynced() ? time(nullptr) : 0;
+  JsonArray rules = doc.createNestedArray("rules");
+  for (const auto &[id, schedule] : scheduleConfig.rules) {
+    JsonObject obj = rules.createNestedObject();
+    obj["id"] = id;
+    obj["cron"] = schedule.cron;
+    if (schedule.mac.length()) {
+      obj["host"] = findScheduleHost(schedule);
+    } else {
+      obj["tag"] = schedule.tag;
+    }
+    obj["enabled"] = schedule.enabled;
+    obj["nextFire"] = schedule.nextFireAt;
+    obj["lastFired"] = schedule.lastFiredAt;
+  }
+  sendJsonResponse(200, doc);
+}
+
+// API: POST '/schedules'
+static void addSchedule() {
+  if (!server.hasArg("plain")) {
+    sendJsonResponse(400, "Missing body", false);
+    return;
+  }
+
+  JsonDocument doc;
+  if (!parseJsonBody(doc)) {
+    sendJsonResponse(400, "Invalid JSON", false);
+    return;
+  }
+
+  if (scheduleConfig.rules.size() >= SCHEDULES_MAX) {
+    sendJsonResponse(400, "Too many schedules", false);
+    return;
+  }
+
+  Schedule schedule;
+  if (!validateScheduleData(doc, schedule)) return;
+
+  int id = scheduleConfig.rules.empty() ? 0 : scheduleConfig.rules.rbegin()->first + 1;
+  scheduleConfig.rules[id] = schedule;
+  rescheduleAll();
+
+  saveSchedules();
+  sendJsonResponse(200, "Schedule added", true);
+}
+
+// API: PUT '/schedules?id={index}'
+static void editSchedule(const String &id) {
+  if (!server.hasArg("plain")) {
+    sendJsonResponse(400, "Missing body", false);
+    return;
+  }
+
+  auto it = scheduleConfig.rules.find(id.toInt());
+  if (it == scheduleConfig.rules.end()) {
+    sendJsonResponse(400, "Schedule not found", false);
+    return;
+  }
+
+  JsonDocument doc;
+  if (!parseJsonBody(doc)) {
+    sendJsonResponse(400, "Invalid JSON", false);
+    return;
+  }
+
+  Schedule schedule;
+  if (!validateScheduleData(doc, schedule)) return;
+
+  schedule.lastFiredAt = it->second.lastFiredAt;
+  it->second = schedule;
+  rescheduleAll();
+
+  saveSchedules();
+  sendJsonResponse(200, "Schedule updated", true);
+}
+
+// API: DELETE '/schedules?id={index}'
+static void deleteSchedule(const String &id) {
+  if (!scheduleConfig.rules.erase(id.toInt())) {
+    sendJsonResponse(400, "Schedule not found", false);
+    return;
+  }
+  rescheduleAll();
+
+  saveSchedules();
+  sendJsonResponse(200, "Schedule deleted", true);
+}
+
+// API: PUT '/schedules'
+static void updateTimezone() {
+  if (!server.hasArg("plain")) {
+    sendJsonResponse(400, "Missing body", false);
+    return;
+  }
+
+  JsonDocument doc;
+  if (!parseJsonBody(doc)) {
+    sendJsonResponse(400, "Invalid JSON", false);
+    return;
+  }
+
+  if (!doc.containsKey("timezone")) {
+    sendJsonResponse(400, "Missing required fields", false);
+    return;
+  }
+  String timezone = doc["timezone"].as<String>();
+  if (timezone.isEmpty() || timezone.length() > SCHEDULE_MAX_TIMEZONE_LENGTH) {
+    sendJsonResponse(400, "Invalid data format", false);
+    return;
+  }
+
+  scheduleConfig.timezone = timezone;
+  setupSchedules();
+  rescheduleAll();
+
+  saveSchedules();
+  sendJsonResponse(200, "Time zone updated", true);
+}
+
+void handleSchedules() {
+  TRACE_REQUEST("/schedules");
+  if (isAuthenticated()) {
+    if (!server.hasArg("id")) {
+      if (server.method() == HTTP_GET) {
+        getSchedules();
+      } else if (server.method() == HTTP_POST) {
+        addSchedule();
+      } else if (server.method() == HTTP_PUT) {
+        updateTimezone();
+      } else {
+        sendJsonResponse(405, "HTTP Method Not Allowed", false);
+      }
+    } else {
+      if (server.method() == HTTP_PUT) {
+        editSchedule(server.arg("id"));
+      } else if (server.method() == HTTP_DELETE) {
+        deleteSchedule(server.arg("id"));
+      } else {
+        sendJsonResponse(405, "HTTP Method Not Allowed", false);
+      }
+    }
+  }
+}
+
+#if ENABLE_WOL_RELAY == 1
+// API: GET '/relaySettings'
+static void getRelaySettings() {
+  JsonDocument doc;
+  doc["enable"] = relayConfig.enable;
+  doc["knownHostsOnly"] = relayConfig.knownHostsOnly;
+  doc["maxPps"] = relayConfig.maxPps;
+  const RelayStats &relayStats = getRelayStats();
+  JsonObject stats = doc.createNestedObject("stats");
+  stats["relayed"] = relayStats.relayed;
+  stats["invalid"] = relayStats.invalid;
+  stats["unknown"] = relayStats.unknown;
+  stats["local"] = relayStats.local;
+  stats["limited"] = relayStats.limited;
+  stats["failed"] = relayStats.failed;
+  sendJsonResponse(200, doc);
+}
+
+// API: PUT '/relaySettings'
+static void updateRelaySettings() {
+  if (!server.hasArg("plain")) {
+    sendJsonResponse(400, "Missing body", false);
+    return;
+  }
+
+  JsonDocument doc;
+  if (!parseJsonBody(doc)) {
+    sendJsonResponse(400, "Invalid JSON", false);
+    return;
+  }
+
+  if (!doc.containsKey("enable")) {
+    sendJsonResponse(400, "Missing required fields", false);
+    return;
+  }
+  long maxPps = doc["maxPps"] | (long)relayConfig.maxPps;
+  if (!doc["enable"].is<bool>() || (doc.containsKey("knownHostsOnly") && !doc["knownHostsOnly"].is<bool>()) || maxPps < 1 || maxPps > RELAY_MAX_PPS) {
+    sendJsonResponse(400, "Invalid data format", false);
+    return;
+  }
+
+  relayConfig.enable = doc["enable"];
+  relayConfig.knownHostsOnly = doc["knownHostsOnly"] | relayConfig.knownHostsOnly;
+  relayConfig.maxPps = maxPps;
+  setupRelay();
+
+  saveRelayConfig();
+  sendJsonResponse(200, "Relay settings updated", true);
+}
+
+void handleRelaySettings() {
+  TRACE_REQUEST("/relaySettings");
+  if (isAuthenticated()) {
+    if (server.method() == HTTP_GET) {
+      getRelaySettings();
+    } else if (server.method() == HTTP_PUT) {
+      updateRelaySettings();
+    } else {
+      sendJsonResponse(405, "HTTP Method Not Allowed", false);
+    }
+  }
+}
+#endif
+
+#if ENABLE_UDP_CONTROL == 1
+// API: GET '/controlSettings'
+static void getControlSettings() {
+  JsonDocument doc;
+  doc["enable"] = controlConfig.enable;
+  doc["port"] = controlConfig.port;
+  doc["keySet"] = !controlConfig.key.isEmpty();
+  const ControlStats &controlStats = getControlStats();
+  JsonObject stats = doc.createNestedObject("stats");
+  stats["handled"] = controlStats.handled;
+  stats["invalid"] = controlStats.invalid;
+  stats["unauthenticated"] = controlStats.unauthenticated;
+  stats["stale"] = controlStats.stale;
+  stats["replayed"] = controlStats.replayed;
+  sendJsonResponse(200, doc);
+}
+
+// API: PUT '/controlSettings'
+static void updateControlSettings() {
+  if (!server.hasArg("plain")) {
+    sendJsonResponse(400, "Missing body", false);
+    return;
+  }
+
+  JsonDocument doc;
+  if (!parseJsonBody(doc)) {
+    sendJsonResponse(400, "Invalid JSON", false);
+    return;
+  }
+
+  if (!doc.containsKey("enable")) {
+    sendJsonResponse(400, "Missing required fields", false);
+    return;
+  }
+  long port = doc["port"] | (long)controlConfig.port;
+  String key = doc["key"] | controlConfig.key;
+  if (!doc["enable"].is<bool>() || port < 1 || port > 65535 || (doc.containsKey("key") && !isValidControlKey(key))) {
+    sendJsonResponse(400, "Invalid data format", false);
+    return;
+  }
+  if (doc["enable"].as<bool>() && key.isEmpty()) {
+    sendJsonResponse(400, "Missing key", false);
+    return;
+  }
+
+  controlConfig.enable = doc["enable"];
+  controlConfig.port = port;
+  controlConfig.key = key;
+  setupControl();
+
+  saveControlConfig();
+  sendJsonResponse(200, "Control settings updated", true);
+}
+
+void handleControlSettings() {
+  TRACE_REQUEST("/controlSettings");
+  if (isAuthenticated()) {
+    if (server.method() == HTTP_GET) {
+      getControlSettings();
+    } else if (server.method() == HTTP_PUT) {
+      updateControlSettings();
+    } else {
+      sendJsonResponse(405, "HTTP Method Not Allowed", false);
+    }
+  }
+}
+#endif
+
+#if ENABLE_MQTT == 1
+// API: GET '/mqttSettings'
+static void getMqttSettings() {
+  static const char *const STATES[] = { "disabled", "waiting", "resolving", "connecting", "connected" };
+  JsonDocument doc;
+  doc["enable"] = mqttConfig.enable;
+  doc["host"] = mqttConfig.host;
+  doc["port"] = mqttConfig.port;
+  doc["username"] = mqttConfig.username;
+  doc["passwordSet"] = !mqttConfig.password.isEmpty();
+  doc["prefix"] = mqttConfig.prefix;
+  doc["keepAlive"] = mqttConfig.keepAlive;
+  doc["state"] = STATES[(uint8_t)getMqttState()];
+  const MqttStats &mqttStats = getMqttStats();
+  JsonObject stats = doc.createNestedObject("stats");
+  stats["connects"] = mqttStats.connects;
+  stats["failures"] = mqttStats.failures;
+  stats["published"] = mqttStats.published;
+  stats["commands"] = mqttStats.commands;
+  stats["retained"] = mqttStats.retained;
+  stats["dropped"] = mqttStats.dropped;
+  sendJsonResponse(200, doc);
+}
+
+// API: PUT '/mqttSettings'
+static void updateMqttSettings() {
+  if (!server.hasArg("plain")) {
+    sendJsonResponse(400, "Missing body", false);
+    return;
+  }
+
+  JsonDocument doc;
+  if (!parseJsonBody(doc)) {
+    sendJsonResponse(400, "Invalid JSON", false);
+    return;
+  }
+
+  if (!doc.containsKey("enable")) {
+    sendJsonResponse(400, "Missing required fields", false);
+    return;
+  }
+  String host = doc["host"] | mqttConfig.host;
+  long port = doc["port"] | (long)mqttConfig.port;
+  String username = doc["username"] | mqttConfig.username;
+  String password = doc["password"] | mqttConfig.password;
+  String prefix = doc["prefix"] | mqttConfig.prefix;
+  long keepAlive = doc["keepAlive"] | (long)mqttConfig.keepAlive;
+  if (!doc["enable"].is<bool>() || (!host.isEmpty() && !isValidHostAddress(host)) || port < 1 || port > 65535
+      || username.length() > MQTT_MAX_CREDENTIAL || password.length() > MQTT_MAX_CREDENTIAL || !isValidTopicPrefix(prefix)
+      || keepAlive < MQTT_MIN_KEEP_ALIVE || keepAlive > MQTT_MAX_KEEP_ALIVE) {
+    sendJsonResponse(400, "Invalid data format", false);
+    return;
+  }
+  if (doc["enable"].as<bool>() && host.isEmpty()) {
+    sendJsonResponse(400, "Missing host", false);
+    return;
+  }
+
+  mqttConfig.enable = doc["enable"];
+  mqttConfig.host = host;
+  mqttConfig.port = port;
+  mqttConfig.username = username;
+  mqttConfig.password = password;
+  mqttConfig.prefix = prefix;
+  mqttConfig.keepAlive = keepAlive;
+  setupMqtt();
+
+  saveMqttConfig();
+  sendJsonResponse(200, "MQTT settings updated", true);
+}
+
+void handleMqttSettings() {
+  TRACE_REQUEST("/mqttSettings");
+  if (isAuthenticated()) {
+    if (server.method() == HTTP_GET) {
+      getMqttSettings();
+    } else if (server.method() == HTTP_PUT) {
+      updateMqttSettings();
+    } else {
+      sendJsonResponse(405, "HTTP Method Not Allowed", false);
+    }
+  }
+}
+#endif
+
+// API: GET '/powerSettings'
+static void getPowerSettings() {
+  JsonDocument doc;
+  doc["sleep"] = getSleepModeName(powerConfig.sleep);
+  const IdleStats &idleStats = getIdleStats();
+  JsonObject stats = doc.createNestedObject("stats");
+  stats["dutyCycle"] = idleStats.dutyCycle;
+  stats["wakeupsPerSecond"] = idleStats.wakeupsPerSecond;
+  stats["sleeps"] = idleStats.sleeps;
+  stats["earlyWakeups"] = idleStats.earlyWakeups;
+  sendJsonResponse(200, doc);
+}
+
+// API: PUT '/powerSettings'
+static void updatePowerSettings() {
+  if (!server.hasArg("plain")) {
+    sendJsonResponse(400, "Missing body", false);
+    return;
+  }
+
+  JsonDocument doc;
+  if (!parseJsonBody(doc)) {
+    sendJsonResponse(400, "Invalid JSON", false);
+    return;
+  }
+
+  if (!doc.containsKey("sleep")) {
+    sendJsonResponse(400, "Missing required fields", false);
+    return;
+  }
+  SleepMode sleep;
+  if (!doc["sleep"].is<const char *>() || !parseSleepMode(doc["sleep"].as<String>(), sleep)) {
+    sendJsonResponse(400, "Invalid data format", false);
+    return;
+  }
+
+  powerConfig.sleep = sleep;
+  setupIdle();
+
+  savePowerConfig();
+  sendJsonResponse(200, "Power settings updated", true);
+}
+
+void handlePowerSettings() {
+  TRACE_REQUEST("/powerSettings");
+  if (isAuthenticated()) {
+    if (server.method() == HTTP_GET) {
+      getPowerSettings();
+    } else if (server.method() == HTTP_PUT) {
+      updatePowerSettings();
+    } else {
+      sendJsonResponse(405, "HTTP Method Not Allowed", false);
+    }
+  }
+}
+
+// API: POST '/discover'
+static void startDiscover() {
+  JsonDocument doc;
+  if (server.hasArg("plain") && !parseJsonBody(doc)) {
+    sendJsonResponse(400, "Invalid JSON", false);
+    return;
+  }
+  if (doc.containsKey("icmp") && !doc["icmp"].is<bool>()) {
+    sendJsonResponse(400, "Invalid data format", false);
+    return;
+  }
+
+  if (!startDiscovery(doc["icmp"] | false)) {
+    sendJsonResponse(503, "Discovery already running", false);
+    return;
+  }
+  sendJsonResponse(200, "Discovery started", true);
+}
+
+// API: GET '/discover'
+static void getDiscover() {
+  static const char *const states[] = { "idle", "arp", "names", "done" };
+  uint16_t total;
+  uint16_t progress = getDiscoveryProgress(total);
+  const std::vector<DiscoveredHost> &found = getDiscoveredHosts();
+
+  JsonDocument doc;
+  doc["state"] = states[(uint8_t)getDiscoveryState()];
+  doc["progress"] = progress;
+  doc["total"] = total;
+  doc["found"] = found.size();
+  uint16_t known = 0;
+  JsonArray candidates = doc.createNestedArray("hosts");
+  for (const DiscoveredHost &host : found) {
+    if (macIndex.find(macKey(host.mac)) != macIndex.end()) {
+      known++;
+      continue;
+    }
+    char mac[18];
+    snprintf_P(mac, sizeof(mac), PSTR("%02X:%02X:%02X:%02X:%02X:%02X"), host.mac[0], host.mac[1], host.mac[2], host.mac[3], host.mac[4], host.mac[5]);
+    JsonObject candidate = candidates.createNestedObject();
+    candidate["ip"] = host.ip.toString();
+    candidate["mac"] = mac;
+    if (!host.name.isEmpty()) {
+      candidate["name"] = host.name;
+    }
+    if (host.icmp >= 0) {
+      candidate["icmp"] = host.icmp == 1;
+    }
+  }
+  doc["known"] = known;
+  sendJsonResponse(200, doc);
+}
+
+void handleDiscover() {
+  TRACE_REQUEST("/discover");
+  if (isAuthenticated()) {
+    if (server.method() == HTTP_GET) {
+      getDiscover();
+    } else if (server.method() == HTTP_POST) {
+      startDiscover();
+    } else {
+      sendJsonResponse(405, "HTTP Method Not Allowed", false);
+    }
+  }
+}
+
 static const char *errorToString(AutoOTA::Error error) {
   switch (error) {
     case AutoOTA::Error::None: return "No error";
@@ -400,27 +1252,33 @@ static const char *errorToString(AutoOTA::Error error) {
   }
 }
 
-static bool checkUpdate(String *version = nullptr, String *notes = nullptr, String *bin = nullptr) {
-  ota.checkUpdate(version, notes, bin);
-  if (ota.hasError() && ota.getError() != AutoOTA::Error::NoUpdates) {
-    sendJsonResponse(400, String("Check update error: ") + errorToString(ota.getError()), false);
-    return false;
+static void addUpdateStatus(JsonDocument &doc) {
+  const UpdateInfo &info = getUpdateInfo();
+  if (server.hasArg("refresh")) {
+    requestUpdateCheck();
+  }
+  doc["checkedAge"] = info.checked ? (long)((millis() - info.checkedAt) / 1000) : -1;
+  doc["stale"] = isUpdateInfoStale();
+  doc["checking"] = isUpdateCheckPending();
+  if (info.error != AutoOTA::Error::None) {
+    doc["error"] = errorToString(info.error);
   }
-  return true;
 }
 
 // API: GET '/about'
 void handleGetAbout() {
+  TRACE_REQUEST("/about");
   if (isAuthenticated()) {
     JsonDocument doc;
 
-    if (!checkUpdate()) {
-      return;
-    }
-
     doc["version"] = ota.version();
-    doc["lastVersion"] = !ota.hasUpdate();
+    if (getUpdateInfo().checked) {
+      doc["lastVersion"] = !getUpdateInfo().available;
+    } else {
+      doc["lastVersion"] = nullptr;  // Unknown until a check succeeds
+    }
     doc["hostname"] = wifiManager.getWiFiHostname();
+    addUpdateStatus(doc);
 
     sendJsonResponse(200, doc);
   }
@@ -429,35 +1287,42 @@ void handleGetAbout() {
 // API: GET '/updateVersion'
 static void getInformationToUpdate() {
   JsonDocument doc;
-
-  String lastVersion, notesLastVersion;
-  if (!checkUpdate(&lastVersion, &notesLastVersion)) {
-    return;
-  }
+  const UpdateInfo &info = getUpdateInfo();
 
   doc["version"] = ota.version();
-  doc["lastVersion"] = lastVersion;
-  if (!ota.version().equalsIgnoreCase(lastVersion)) {
-    doc["notesLastVersion"] = notesLastVersion;
+  doc["lastVersion"] = info.lastVersion;
+  if (info.available) {
+    doc["notesLastVersion"] = info.notes;
   }
+  addUpdateStatus(doc);
   sendJsonResponse(200, doc);
 }
 
 // API: POST '/updateVersion'
 static void updateToLastVersion() {
-  if (!checkUpdate()) {
+  const UpdateInfo &info = getUpdateInfo();
+  if (!info.checked) {
+    requestUpdateCheck();
+    String message = "No update check has succeeded yet";
+    if (info.error != AutoOTA::Error::None) {
+      message += String(". Check update error: ") + errorToString(info.error);
+    }
+    sendJsonResponse(503, message, false);
     return;
   }
-  if (ota.hasUpdate()) {
-    sendJsonResponse(200, "Update process will start in 1 second. Please wait for the update to complete.", true);
-    delay(500);
-    ota.updateNow();
+  if (info.available) {
+    if (startUpdateDownload(info.bin)) {
+      sendJsonResponse(200, "Update started. Follow its progress in '/updateVersion/progress'.", true);
+    } else {
+      sendJsonResponse(409, "An update is already running", false);
+    }
   } else {
     sendJsonResponse(200, "Nothing to upgrade. You are up to date!", false);
   }
 }
 
 void handleUpdateVersion() {
+  TRACE_REQUEST("/updateVersion");
   if (isAuthenticated()) {
     if (server.method() == HTTP_GET) {
       getInformationToUpdate();
@@ -469,8 +1334,26 @@ void handleUpdateVersion() {
   }
 }
 
+// API: GET '/updateVersion/progress'
+void handleUpdateProgress() {
+  TRACE_REQUEST("/updateVersion/progress");
+  if (isAuthenticated()) {
+    const UpdateProgress &progress = getUpdateProgress();
+    JsonDocument doc;
+    doc["stage"] = updateStageToString(progress.stage);
+    doc["written"] = progress.written;
+    doc["size"] = progress.size;
+    doc["progress"] = progress.size ? (int)(progress.written * 100 / progress.size) : 0;
+    if (progress.stage == UpdateStage::Failed) {
+      doc["error"] = progress.error;
+    }
+    sendJsonResponse(200, doc);
+  }
+}
+
 // API: POST '/import'
 void handleImportDatabase() {
+  TRACE_REQUEST("/import");
   if (isAuthenticated()) {
     if (!server.hasArg("plain")) {
       sendJsonResponse(400, "Missing body", false);
@@ -478,7 +1361,7 @@ void handleImportDatabase() {
     }
 
     JsonDocument doc;
-    if (deserializeJson(doc, server.arg("plain"))) {
+    if (!parseJsonBody(doc)) {
       sendJsonResponse(400, "Invalid JSON", false);
       return;
     }
@@ -493,47 +1376,81 @@ void handleImportDatabase() {
     int ignoredCount = 0;
     int id;
 
-    for (JsonVariant v : arr) {
-      if (!v.containsKey("name") || !v.containsKey("mac") || !v.containsKey("ip")) {
-        ignoredCount++;
-        continue;
-      }
+    {
+      TRACE_SPAN("import");
+      for (JsonVariant v : arr) {
+        if (!v.containsKey("name") || !v.containsKey("mac") || !v.containsKey("ip")) {
+          ignoredCount++;
+          continue;
+        }
 
-      String name = v["name"].as<String>();
-      String mac = v["mac"].as<String>();
-      String ip = v["ip"].as<String>();
+        String name = v["name"].as<String>();
+        String mac = v["mac"].as<String>();
+        String ip = v["ip"].as<String>();
 
-      if (name.isEmpty() || !isValidMACAddress(mac) || !isValidIPAddress(ip)) {
-        ignoredCount++;
-        continue;
-      }
+        if (name.isEmpty() || !isValidMACAddress(mac) || !isValidHostAddress(ip)) {
+          ignoredCount++;
+          continue;
+        }
 
-      long periodicPing = v.containsKey("periodicPing") ? v["periodicPing"].as<long>() : 0;
-      if (!isValidPeriodicPing(periodicPing)) periodicPing = 0;
+        long periodicPing = v.containsKey("periodicPing") ? v["periodicPing"].as<long>() : 0;
+        if (!isValidPeriodicPing(periodicPing)) periodicPing = 0;
 
-      Host host = { name, mac, ip, periodicPing * 1000 };
-      if (isHostDuplicate(host)) {
-        ignoredCount++;
-        continue;
-      }
+        std::vector<String> tags;
+        WakeTarget wake;
+        WakePolicy policy;
+        ProbeTarget probe;
+        if (!readTags(v["tags"], tags) || !readWakeTarget(v["wake"], wake) || !readWakePolicy(v["policy"], policy) || !readProbeTarget(v["probe"], probe)) {
+          ignoredCount++;
+          continue;
+        }
 
-      id = hosts.size();
-      hosts[id] = host;
-      if (host.periodicPing) {
-        timers[id] = GTimer<millis>(host.periodicPing, true);
-      }
+        Host host = { name, mac, {}, ip, (unsigned long)periodicPing * 1000, tags, wake, policy, probe, v["followIp"] | false };
+        parseMACAddress(host.mac, host.macBytes);
+        if (isHostDuplicate(host)) {
+          ignoredCount++;
+          continue;
+        }
+
+        id = hosts.empty() ? 0 : hosts.rbegin()->first + 1;
+        hosts[id] = host;
+        if (host.periodicPing) {
+          timers[id] = GTimer<millis>(host.periodicPing, true);
+        }
+        resolveWakeTarget(id);
 
-      importedCount++;
+        importedCount++;
+      }
     }
 
+    rebuildHostIndexes();
     saveHostsData();
 
     sendJsonResponse(200, String("Imported ") + importedCount + " hosts from " + arr.size() + ". " + ignoredCount + " hosts ignored. Hosts in database after import: " + hosts.size() + ".", true);
   }
 }
 
+// API: GET '/metrics'
+void handleMetrics() {
+  TRACE_REQUEST("/metrics");
+  if (isAuthenticated()) {
+    TRACE_SPAN("respond");
+    streamMetrics();
+  }
+}
+
+#if ENABLE_TRACE == 1
+// API: GET '/debug/trace'
+void handleDebugTrace() {
+  if (isAuthenticated()) {
+    streamTrace();
+  }
+}
+#endif
+
 // API: POST '/resetWifi'
 void handleResetWiFiSettings() {
+  TRACE_REQUEST("/resetWifi");
   sendJsonResponse(200, "WiFi settings have been reset successfully.", true);
   wifiManager.resetSettings();
   ESP.restart();
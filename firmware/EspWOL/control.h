@@ -0,0 +1,59 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#define CONTROL_DEFAULT_PORT 9009
+#define CONTROL_MIN_KEY 16          // Bytes of the pre-shared key, given as hex
+#define CONTROL_MAX_KEY 64
+#define CONTROL_WINDOW 30           // Seconds a request timestamp may differ from the device clock
+#define CONTROL_NONCES 64           // Requests remembered to reject replays within the window
+#define CONTROL_REQUEST_SIZE 52
+#define CONTROL_REPLY_SIZE 32
+#define CONTROL_ARGUMENT_SIZE 24    // MAC address or tag of a request
+#define CONTROL_TAG_SIZE 16         // Truncated HMAC-SHA256 of a frame
+#define CONTROL_VERSION 1
+
+// Commands of a control request
+enum class ControlCommand : uint8_t {
+  Wake = 1,      // Argument: MAC address of a host
+  Status = 2,    // Argument: MAC address of a host
+  BulkWake = 3   // Argument: tag, NUL padded
+};
+
+// Status of a control reply
+enum class ControlStatus : uint8_t {
+  Ok = 0,
+  Stale = 1,     // Timestamp outside of the window, the reply carries the device clock
+  Replayed = 2,  // Timestamp and nonce already used, or older than the remembered ones
+  NotFound = 3,  // No host with the MAC address or tag
+  Failed = 4,    // The magic packet could not be sent, or the job queue is full
+  Unsupported = 5
+};
+
+#if ENABLE_UDP_CONTROL == 1
+
+// Counters of the datagrams received on the control port, by outcome
+struct ControlStats {
+  uint32_t handled = 0;          // Authenticated and answered, whatever the status
+  uint32_t invalid = 0;          // Wrong size, magic or version
+  uint32_t unauthenticated = 0;  // Wrong HMAC, dropped without a reply
+  uint32_t stale = 0;
+  uint32_t replayed = 0;
+};
+
+/**
+ * @brief Opens, moves or closes the control port as configured, and loads the key.
+ *
+ * Requests are handled in the receive callback: the wake is sent and the reply
+ * goes out before `loop()` runs again, without HTTP, JSON or allocation
+ * besides the reply buffer.
+ */
+void setupControl();
+
+/**
+ * @brief Returns the counters of the control port since boot.
+ */
+const ControlStats &getControlStats();
+
+#endif
+
+#endif
@@ -0,0 +1,225 @@
+#include "control.h"
+
+#if ENABLE_UDP_CONTROL == 1
+
+#include <lwip/udp.h>
+#include <bearssl/bearssl_hmac.h>
+
+#define CONTROL_SIGNED_SIZE (CONTROL_REQUEST_SIZE - CONTROL_TAG_SIZE)
+#define CONTROL_REPLY_SIGNED_SIZE (CONTROL_REPLY_SIZE - CONTROL_TAG_SIZE)
+
+static struct udp_pcb *controlPcb = nullptr;
+static uint16_t controlPort = 0;
+static br_hmac_key_context controlKey;  // Inner and outer key states, so a frame costs two SHA-256 blocks
+static bool controlKeyReady = false;
+static ControlStats controlStats;
+static uint64_t controlNonces[CONTROL_NONCES] = {};  // Timestamp << 32 | nonce of the last accepted requests
+static uint8_t controlNonceNext = 0;
+static uint64_t controlNonceFloor = 0;               // Highest one dropped from the ring, older ones are rejected
+static uint32_t controlClockBase = 0;
+static bool controlClockSynced = false;
+
+const ControlStats &getControlStats() {
+  return controlStats;
+}
+
+static bool parseControlKey(const String &hex, uint8_t *key, size_t &length) {
+  length = hex.length() / 2;
+  if (hex.length() % 2 || length < CONTROL_MIN_KEY || length > CONTROL_MAX_KEY) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    char byte[3] = { hex[i * 2], hex[i * 2 + 1], '\0' };
+    char *end;
+    key[i] = strtoul(byte, &end, 16);
+    if (*end) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Seconds requests are checked against: NTP time once synced, before that a random origin plus the uptime,
+// so requests captured before a reboot do not fall in the window again
+static uint32_t controlTime() {
+  bool synced = isClockSynced();
+  if (synced != controlClockSynced) {
+    // The clock jumped, the remembered requests would block the new timestamps
+    controlClockSynced = synced;
+    memset(controlNonces, 0, sizeof(controlNonces));
+    controlNonceFloor = 0;
+  }
+  return (uint32_t)time(nullptr) + (synced ? 0 : controlClockBase);
+}
+
+// Requests must be new: within the window, a client increases its nonce for each request of the same second
+static bool isReplayed(uint64_t key) {
+  if (key <= controlNonceFloor) {
+    return true;
+  }
+  for (uint64_t used : controlNonces) {
+    if (used == key) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void rememberNonce(uint64_t key) {
+  controlNonceFloor = std::max(controlNonceFloor, controlNonces[controlNonceNext]);
+  controlNonces[controlNonceNext] = key;
+  controlNonceNext = (controlNonceNext + 1) % CONTROL_NONCES;
+}
+
+static void signControlFrame(const uint8_t *frame, size_t length, uint8_t *tag) {
+  br_hmac_context context;
+  br_hmac_init(&context, &controlKey, CONTROL_TAG_SIZE);
+  br_hmac_update(&context, frame, length);
+  br_hmac_out(&context, tag);
+}
+
+// Constant time, so the tag cannot be guessed byte by byte
+static bool equalTags(const uint8_t *a, const uint8_t *b) {
+  uint8_t difference = 0;
+  for (uint8_t i = 0; i < CONTROL_TAG_SIZE; i++) {
+    difference |= a[i] ^ b[i];
+  }
+  return difference == 0;
+}
+
+static ControlStatus runControlCommand(uint8_t command, const uint8_t *argument, uint8_t *reply) {
+  switch ((ControlCommand)command) {
+    case ControlCommand::Wake:
+      {
+        int id = findHostByMAC(argument);
+        if (id < 0) {
+          return ControlStatus::NotFound;
+        }
+        const Host &host = hosts[id];
+        bool sent = sendMagicPacket(host.macBytes, host.wake);
+        recordMagicPacket(sent);
+        reply[5] = sent;
+        return sent ? ControlStatus::Ok : ControlStatus::Failed;
+      }
+    case ControlCommand::Status:
+      {
+        int id = findHostByMAC(argument);
+        if (id < 0) {
+          return ControlStatus::NotFound;
+        }
+        unsigned long age;
+        int8_t state = getHostState(id, age);
+        uint16_t seconds = state < 0 ? 0xFFFF : std::min<unsigned long>(age / 1000, 0xFFFE);
+        reply[5] = state < 0 ? 0xFF : state;
+        reply[6] = seconds >> 8;
+        reply[7] = seconds & 0xFF;
+        return ControlStatus::Ok;
+      }
+    case ControlCommand::BulkWake:
+      {
+        char tag[CONTROL_ARGUMENT_SIZE + 1] = {};
+        memcpy(tag, argument, CONTROL_ARGUMENT_SIZE);
+        auto it = tagIndex.find(String(tag));
+        if (it == tagIndex.end()) {
+          return ControlStatus::NotFound;
+        }
+        // Paced like the wake of a tag over HTTP, the first packet goes out with the next loop
+        int jobId = queueWakeJob(it->second, 1, 0, WAKE_DEFAULT_MAX_PPS);
+        if (jobId < 0) {
+          return ControlStatus::Failed;
+        }
+        wakeLoop();
+        reply[5] = std::min<size_t>(it->second.size(), 0xFF);
+        reply[6] = jobId >> 8;
+        reply[7] = jobId & 0xFF;
+        return ControlStatus::Ok;
+      }
+    default:
+      return ControlStatus::Unsupported;
+  }
+}
+
+// Runs in the lwIP context, never concurrently with loop(), so hosts and jobs can be used as is
+static void onControlDatagram(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+  uint8_t request[CONTROL_REQUEST_SIZE];
+  bool framed = p->tot_len == CONTROL_REQUEST_SIZE && pbuf_copy_partial(p, request, CONTROL_REQUEST_SIZE, 0) == CONTROL_REQUEST_SIZE;
+  pbuf_free(p);
+  if (!framed || request[0] != 'E' || request[1] != 'W' || request[2] != CONTROL_VERSION) {
+    controlStats.invalid++;
+    return;
+  }
+
+  // Unauthenticated requests get no reply, so the port can neither be probed nor used to amplify
+  uint8_t tag[CONTROL_TAG_SIZE];
+  signControlFrame(request, CONTROL_SIGNED_SIZE, tag);
+  if (!equalTags(tag, request + CONTROL_SIGNED_SIZE)) {
+    controlStats.unauthenticated++;
+    return;
+  }
+
+  uint8_t reply[CONTROL_REPLY_SIZE] = { 'E', 'W', CONTROL_VERSION, request[3] };
+  memcpy(reply + 8, request + 8, 4);  // Nonce, to match the reply to its request
+  uint32_t timestamp = (uint32_t)request[4] << 24 | (uint32_t)request[5] << 16 | request[6] << 8 | request[7];
+  uint32_t nonce = (uint32_t)request[8] << 24 | (uint32_t)request[9] << 16 | request[10] << 8 | request[11];
+  uint64_t key = (uint64_t)timestamp << 32 | nonce;
+  uint32_t now = controlTime();
+  ControlStatus status;
+  if (std::abs((int32_t)(timestamp - now)) > CONTROL_WINDOW) {
+    controlStats.stale++;
+    status = ControlStatus::Stale;
+  } else if (isReplayed(key)) {
+    controlStats.replayed++;
+    status = ControlStatus::Replayed;
+  } else {
+    rememberNonce(key);
+    status = runControlCommand(request[3], request + 12, reply);
+  }
+  reply[4] = (uint8_t)status;
+  reply[12] = now >> 24;
+  reply[13] = now >> 16;
+  reply[14] = now >> 8;
+  reply[15] = now;
+  signControlFrame(reply, CONTROL_REPLY_SIGNED_SIZE, reply + CONTROL_REPLY_SIGNED_SIZE);
+  controlStats.handled++;
+
+  struct pbuf *out = pbuf_alloc(PBUF_TRANSPORT, CONTROL_REPLY_SIZE, PBUF_RAM);
+  if (out) {
+    memcpy(out->payload, reply, CONTROL_REPLY_SIZE);
+    udp_sendto(pcb, out, addr, port);
+    pbuf_free(out);
+  }
+}
+
+void setupControl() {
+  uint8_t key[CONTROL_MAX_KEY];
+  size_t length;
+  controlKeyReady = parseControlKey(controlConfig.key, key, length);
+  if (controlKeyReady) {
+    br_hmac_key_init(&controlKey, &br_sha256_vtable, key, length);
+  }
+  memset(key, 0, sizeof(key));
+  while (!controlClockBase) {
+    controlClockBase = ESP.random();
+  }
+
+  bool open = controlConfig.enable && controlKeyReady;
+  if (controlPcb && (!open || controlPort != controlConfig.port)) {
+    udp_remove(controlPcb);
+    controlPcb = nullptr;
+  }
+  if (open && !controlPcb) {
+    struct udp_pcb *pcb = udp_new();
+    if (!pcb) {
+      return;
+    }
+    if (udp_bind(pcb, IP_ANY_TYPE, controlConfig.port) != ERR_OK) {
+      udp_remove(pcb);
+      return;
+    }
+    udp_recv(pcb, onControlDatagram, nullptr);
+    controlPcb = pcb;
+    controlPort = controlConfig.port;
+  }
+}
+
+#endif
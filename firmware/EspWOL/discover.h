@@ -0,0 +1,61 @@
+#ifndef DISCOVER_H
+#define DISCOVER_H
+
+#define DISCOVER_MAX_ADDRESSES 1024  // Larger networks are only swept around the device, in its /24
+#define DISCOVER_MAX_RESULTS 128     // Devices kept by a sweep
+#define DISCOVER_NAME_LENGTH 32      // Longest name kept for a device
+
+// Phases of a discovery sweep
+enum class DiscoverState : uint8_t {
+  Idle,   // No sweep since boot
+  Arp,    // Sending ARP requests to every address
+  Names,  // Asking the devices found for their name, and pinging them
+  Done
+};
+
+// Structure for a device found by a sweep
+struct DiscoveredHost {
+  IPAddress ip;
+  uint8_t mac[6];
+  String name;               // mDNS or NetBIOS name, empty if the device did not tell
+  int8_t probe = -1;         // Running echo request
+  int8_t icmp = -1;          // -1 not pinged, 0 no echo reply, 1 echo reply
+};
+
+/**
+ * @brief Starts a sweep of the device network.
+ *
+ * Sends an ARP request to every address of the network, paced by
+ * `handleDiscovery()` so the web server stays responsive, then asks every
+ * device that answered for its mDNS and NetBIOS name. A /24 takes about
+ * two seconds. The results of the previous sweep are dropped.
+ *
+ * @param icmp Whether to also send an echo request to every device found.
+ * @return true if the sweep started, false if one is running or WiFi is not connected.
+ */
+bool startDiscovery(bool icmp);
+
+/**
+ * @brief Runs the next step of the sweep, if any. Called from `loop()`.
+ */
+void handleDiscovery();
+
+/**
+ * @brief Returns the phase of the current or last sweep.
+ */
+DiscoverState getDiscoveryState();
+
+/**
+ * @brief Returns the number of addresses swept so far and in total.
+ *
+ * @param total The number of addresses of the sweep.
+ * @return The number of addresses an ARP request was sent to.
+ */
+uint16_t getDiscoveryProgress(uint16_t &total);
+
+/**
+ * @brief Returns the devices found by the current or last sweep, by address.
+ */
+const std::vector<DiscoveredHost> &getDiscoveredHosts();
+
+#endif
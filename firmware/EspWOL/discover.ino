@@ -0,0 +1,290 @@
+#include "discover.h"
+
+#include <lwip/etharp.h>
+
+#define DISCOVER_ARP_INTERVAL 4     // Milliseconds between two ARP requests
+#define DISCOVER_ARP_SETTLE 500     // Milliseconds replies are awaited after the last request
+#define DISCOVER_NAME_INTERVAL 10   // Milliseconds between the name queries of two devices
+#define DISCOVER_NAME_TIMEOUT 1000  // Milliseconds answers are awaited after the last query
+#define DISCOVER_PINGS 2            // Probes used at the same time, the others are left to the ping scheduler
+#define DISCOVER_DATAGRAMS 4        // Answers read per step
+#define NETBIOS_NAME_PORT 137
+
+static DiscoverState discoverState = DiscoverState::Idle;
+static std::vector<DiscoveredHost> discovered;
+static WiFiUDP discoverUdp;
+static uint32_t sweepFirst = 0;   // First address of the sweep, in host byte order
+static uint16_t sweepTotal = 0;
+static uint16_t sweepNext = 0;    // Arp: addresses requested, Names: devices queried
+static uint16_t pingNext = 0;     // Devices pinged
+static bool sweepIcmp = false;
+static unsigned long stepAt = 0;  // millis() of the last request or query
+
+static uint32_t toHostOrder(const IPAddress &ip) {
+  return (uint32_t)ip[0] << 24 | (uint32_t)ip[1] << 16 | (uint32_t)ip[2] << 8 | ip[3];
+}
+
+static IPAddress fromHostOrder(uint32_t address) {
+  return IPAddress(address >> 24, (address >> 16) & 0xFF, (address >> 8) & 0xFF, address & 0xFF);
+}
+
+static DiscoveredHost *findDiscovered(const IPAddress &ip) {
+  for (DiscoveredHost &host : discovered) {
+    if (host.ip == ip) {
+      return &host;
+    }
+  }
+  return nullptr;
+}
+
+DiscoverState getDiscoveryState() {
+  return discoverState;
+}
+
+uint16_t getDiscoveryProgress(uint16_t &total) {
+  total = sweepTotal;
+  return discoverState == DiscoverState::Arp ? sweepNext : sweepTotal;
+}
+
+const std::vector<DiscoveredHost> &getDiscoveredHosts() {
+  return discovered;
+}
+
+bool startDiscovery(bool icmp) {
+  if (discoverState == DiscoverState::Arp || discoverState == DiscoverState::Names || WiFi.status() != WL_CONNECTED) {
+    return false;
+  }
+
+  uint32_t address = toHostOrder(WiFi.localIP());
+  uint32_t mask = toHostOrder(WiFi.subnetMask());
+  if (~mask + 1ULL > DISCOVER_MAX_ADDRESSES) {
+    mask = 0xFFFFFF00;
+  }
+  if (~mask < 2) {
+    return false;  // No other address on the network
+  }
+
+  discovered.clear();
+  discovered.shrink_to_fit();
+  sweepFirst = (address & mask) + 1;
+  sweepTotal = ~mask - 1;  // Neither the network nor the broadcast address
+  sweepNext = 0;
+  pingNext = 0;
+  sweepIcmp = icmp;
+  stepAt = millis();
+  discoverState = DiscoverState::Arp;
+  return true;
+}
+
+// Copies the ARP table entries of the swept network. The table only holds a few entries and replies
+// evict each other, so it is read at every step rather than once at the end
+static void collectArpTable() {
+  for (size_t i = 0; i < ARP_TABLE_SIZE; i++) {
+    ip4_addr_t *address;
+    struct netif *netif;
+    struct eth_addr *eth;
+    if (!etharp_get_entry(i, &address, &netif, &eth)) {
+      continue;
+    }
+    IPAddress ip(address->addr);
+    if (toHostOrder(ip) - sweepFirst >= sweepTotal) {
+      continue;
+    }
+    DiscoveredHost *host = findDiscovered(ip);
+    if (!host) {
+      if (discovered.size() >= DISCOVER_MAX_RESULTS) {
+        continue;
+      }
+      discovered.emplace_back();
+      host = &discovered.back();
+      host->ip = ip;
+    }
+    memcpy(host->mac, eth->addr, 6);
+  }
+}
+
+static void sweepArp() {
+  collectArpTable();
+
+  unsigned long now = millis();
+  if (sweepNext < sweepTotal) {
+    if (now - stepAt < DISCOVER_ARP_INTERVAL) {
+      return;
+    }
+    IPAddress ip = fromHostOrder(sweepFirst + sweepNext++);
+    if (ip != WiFi.localIP()) {
+      ip4_addr_t address;
+      address.addr = (uint32_t)ip;
+      struct netif *netif = ip4_route(&address);
+      if (netif) {
+        etharp_request(netif, &address);
+      }
+    }
+    stepAt = now;
+    return;
+  }
+  if (now - stepAt < DISCOVER_ARP_SETTLE) {
+    return;
+  }
+
+  std::sort(discovered.begin(), discovered.end(), [](const DiscoveredHost &a, const DiscoveredHost &b) {
+    return toHostOrder(a.ip) < toHostOrder(b.ip);
+  });
+  sweepNext = 0;
+  stepAt = now;
+  discoverState = discovered.empty() || !discoverUdp.begin(0) ? DiscoverState::Done : DiscoverState::Names;
+}
+
+// Asks a device for its NetBIOS names and for the mDNS name of its address
+static void sendNameQueries(const IPAddress &ip) {
+  uint8_t query[64] = {};
+
+  // NetBIOS node status request of the wildcard name "*", encoded as one label of 32 letters
+  char name[33] = "CK";
+  memset(name + 2, 'A', 30);
+  name[32] = '\0';
+  query[5] = 1;  // One question
+  size_t length = writeDnsName(query, 12, name);
+  query[length + 1] = 0x21;  // NBSTAT
+  query[length + 3] = 0x01;  // IN
+  discoverUdp.beginPacket(ip, NETBIOS_NAME_PORT);
+  discoverUdp.write(query, length + 4);
+  discoverUdp.endPacket();
+
+  // Reverse lookup sent to the device itself; not coming from port 5353, it is answered by unicast
+  memset(query, 0, sizeof(query));
+  query[5] = 1;
+  snprintf(name, sizeof(name), "%u.%u.%u.%u.in-addr.arpa", ip[3], ip[2], ip[1], ip[0]);
+  length = writeDnsName(query, 12, name);
+  query[length + 1] = 12;    // PTR
+  query[length + 2] = 0x80;  // Unicast response requested
+  query[length + 3] = 0x01;  // IN
+  discoverUdp.beginPacket(ip, MULTICAST_DNS_PORT);
+  discoverUdp.write(query, length + 4);
+  discoverUdp.endPacket();
+}
+
+// Returns the first unique workstation name of a NetBIOS node status response
+static bool parseNetbiosName(const uint8_t *message, size_t length, char *name) {
+  size_t offset = readDnsName(message, length, 12);
+  if (!offset || offset + 11 > length || message[offset + 1] != 0x21) {
+    return false;
+  }
+  uint8_t count = message[offset + 10];
+  offset += 11;
+  for (uint8_t i = 0; i < count && offset + 18 <= length; i++, offset += 18) {
+    const uint8_t *entry = message + offset;
+    if (entry[15] == 0x00 && !(entry[16] & 0x80)) {
+      uint8_t size = 15;
+      while (size > 0 && entry[size - 1] == ' ') {
+        size--;
+      }
+      memcpy(name, entry, size);
+      name[size] = '\0';
+      return size > 0;
+    }
+  }
+  return false;
+}
+
+// Returns the host name of the first PTR record of an mDNS response
+static bool parseMdnsName(const uint8_t *message, size_t length, char *name) {
+  if (length < 12 || !(message[2] & 0x80)) {
+    return false;
+  }
+  uint16_t questions = message[4] << 8 | message[5];
+  uint16_t answers = message[6] << 8 | message[7];
+  size_t offset = 12;
+  for (uint16_t i = 0; i < questions && offset; i++) {
+    offset = readDnsName(message, length, offset);
+    offset = offset && offset + 4 <= length ? offset + 4 : 0;
+  }
+  for (uint16_t i = 0; i < answers && offset; i++) {
+    offset = readDnsName(message, length, offset);
+    if (!offset || offset + 10 > length) {
+      return false;
+    }
+    uint16_t type = message[offset] << 8 | message[offset + 1];
+    uint16_t size = message[offset + 8] << 8 | message[offset + 9];
+    offset += 10;
+    if (type == 12) {
+      name[0] = '\0';
+      return readDnsName(message, length, offset, name, DISCOVER_NAME_LENGTH + 1) && name[0];
+    }
+    offset += size;
+  }
+  return false;
+}
+
+static void readNameAnswers() {
+  static uint8_t message[512];
+  for (uint8_t i = 0; i < DISCOVER_DATAGRAMS && discoverUdp.parsePacket(); i++) {
+    DiscoveredHost *host = findDiscovered(discoverUdp.remoteIP());
+    size_t length = discoverUdp.read(message, sizeof(message));
+    char name[DISCOVER_NAME_LENGTH + 1] = {};
+    if (!host) {
+      continue;
+    }
+    // The mDNS name is kept over the NetBIOS one, which is upper case and at most 15 characters
+    if (discoverUdp.remotePort() == MULTICAST_DNS_PORT && parseMdnsName(message, length, name)) {
+      host->name = name;
+    } else if (discoverUdp.remotePort() == NETBIOS_NAME_PORT && host->name.isEmpty() && parseNetbiosName(message, length, name)) {
+      host->name = name;
+    }
+  }
+}
+
+// Pings the devices found, a few at a time. Returns true once all answered or timed out
+static bool pingDiscovered() {
+  uint8_t running = 0;
+  for (DiscoveredHost &host : discovered) {
+    if (host.probe < 0) {
+      continue;
+    }
+    ProbeState state = getProbeState(host.probe);
+    if (state == ProbeState::Pending) {
+      running++;
+      continue;
+    }
+    host.icmp = state == ProbeState::Up;
+    clearProbe(host.probe);
+    host.probe = -1;
+  }
+
+  if (running < DISCOVER_PINGS && pingNext < discovered.size()) {
+    DiscoveredHost &host = discovered[pingNext];
+    host.probe = startProbe(host.ip);
+    if (host.probe >= 0) {
+      pingNext++;
+      running++;
+    }
+  }
+  return running == 0 && pingNext == discovered.size();
+}
+
+static void queryNames() {
+  readNameAnswers();
+  bool pinged = !sweepIcmp || pingDiscovered();
+
+  unsigned long now = millis();
+  if (sweepNext < discovered.size()) {
+    if (now - stepAt >= DISCOVER_NAME_INTERVAL) {
+      sendNameQueries(discovered[sweepNext++].ip);
+      stepAt = now;
+    }
+  } else if (pinged && now - stepAt >= DISCOVER_NAME_TIMEOUT) {
+    discoverUdp.stop();
+    discoverState = DiscoverState::Done;
+  }
+}
+
+void handleDiscovery() {
+  if (discoverState == DiscoverState::Arp || discoverState == DiscoverState::Names) {
+    limitSleep(0);
+  }
+  if (discoverState == DiscoverState::Arp) {
+    sweepArp();
+  } else if (discoverState == DiscoverState::Names) {
+    queryNames();
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+#define IDLE_MAX_SLEEP 500         // Milliseconds, bound for the work without a deadline: mDNS, OTA and WiFi events
+#define IDLE_POLL_INTERVAL 100     // Milliseconds between two checks for HTTP clients while sleeping, one beacon interval
+#define IDLE_REQUEST_WINDOW 1000   // Milliseconds polled without sleeping after an HTTP request, for the next ones of the page
+#define IDLE_STATS_WINDOW 10000    // Milliseconds the duty cycle and wake-ups are averaged over
+
+// Sleep of the device while the loop has nothing to do
+enum class SleepMode : uint8_t {
+  None,   // Polls every millisecond
+  Modem,  // Sleeps until the next deadline, the radio sleeps between beacons
+  Light   // Same, and the CPU is suspended too; the radio wakes it up for the traffic of the device
+};
+
+// Load of the loop, averaged over the last `IDLE_STATS_WINDOW`
+struct IdleStats {
+  float dutyCycle = 1;        // Share of the time spent running the loop
+  float wakeupsPerSecond = 0; // Loop iterations per second
+  unsigned long sleeps = 0;   // Sleeps of more than a millisecond since boot
+  unsigned long earlyWakeups = 0;  // Sleeps cut short by network traffic since boot
+};
+
+/**
+ * @brief Returns the name of a sleep mode: "none", "modem" or "light".
+ */
+const char *getSleepModeName(SleepMode mode);
+
+/**
+ * @brief Parses the name of a sleep mode.
+ *
+ * @param name The name, as returned by `getSleepModeName()`.
+ * @param mode Set to the mode when the name is valid.
+ * @return true if the name is valid, false otherwise.
+ */
+bool parseSleepMode(const String &name, SleepMode &mode);
+
+/**
+ * @brief Applies the sleep mode of `powerConfig` to the WiFi radio.
+ */
+void setupIdle();
+
+/**
+ * @brief Keeps the current loop iteration from sleeping longer than `duration` milliseconds.
+ *
+ * Called from `loop()` by the modules with something to do at a known time.
+ * Work in progress polled by the loop, like a probe or a sweep, passes 0.
+ */
+void limitSleep(unsigned long duration);
+
+/**
+ * @brief Polls without sleeping for `duration` milliseconds.
+ */
+void keepAwake(unsigned long duration);
+
+/**
+ * @brief Ends the current sleep. Called from lwIP callbacks that leave work to `loop()`.
+ */
+void wakeLoop();
+
+/**
+ * @brief Sleeps until the earliest deadline given to `limitSleep()` since the last call. Called at the end of `loop()`.
+ *
+ * The sleep ends early when an HTTP client connects or `wakeLoop()` is called,
+ * and never exceeds `IDLE_MAX_SLEEP`.
+ */
+void idleSleep();
+
+/**
+ * @brief Returns the load of the loop.
+ */
+const IdleStats &getIdleStats();
+
+#endif
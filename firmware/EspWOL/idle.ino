@@ -0,0 +1,92 @@
+#include "idle.h"
+
+#include <coredecls.h>
+
+static unsigned long sleepLimit = IDLE_MAX_SLEEP;  // Shortest deadline of the current loop iteration
+static unsigned long awakeUntil = 0;
+static bool loopWoken = false;
+static IdleStats idleStats;
+static unsigned long idleWindowStart = 0;  // Microseconds, like the fields below
+static unsigned long idleBusy = 0;
+static unsigned long idleWokeAt = 0;
+static uint32_t idleWakeups = 0;
+
+static const char *const SLEEP_MODES[] = { "none", "modem", "light" };
+
+const IdleStats &getIdleStats() {
+  return idleStats;
+}
+
+const char *getSleepModeName(SleepMode mode) {
+  return SLEEP_MODES[(uint8_t)mode];
+}
+
+bool parseSleepMode(const String &name, SleepMode &mode) {
+  for (uint8_t i = 0; i < sizeof(SLEEP_MODES) / sizeof(SLEEP_MODES[0]); i++) {
+    if (name == SLEEP_MODES[i]) {
+      mode = (SleepMode)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+void setupIdle() {
+  WiFi.setSleepMode(powerConfig.sleep == SleepMode::Light ? WIFI_LIGHT_SLEEP : WIFI_MODEM_SLEEP);
+}
+
+void limitSleep(unsigned long duration) {
+  sleepLimit = std::min(sleepLimit, duration);
+}
+
+void keepAwake(unsigned long duration) {
+  unsigned long until = millis() + duration;
+  if ((long)(until - awakeUntil) > 0) {
+    awakeUntil = until;
+  }
+}
+
+// lwIP callbacks never run concurrently with loop(): a wake-up requested while it runs is seen by idleSleep()
+void wakeLoop() {
+  loopWoken = true;
+  esp_schedule();
+}
+
+static void updateIdleStats(unsigned long now) {
+  idleWakeups++;
+  unsigned long elapsed = now - idleWindowStart;
+  if (elapsed < IDLE_STATS_WINDOW * 1000UL) {
+    return;
+  }
+  idleStats.dutyCycle = (float)idleBusy / elapsed;
+  idleStats.wakeupsPerSecond = idleWakeups * 1000000.0f / elapsed;
+  idleWindowStart = now;
+  idleBusy = 0;
+  idleWakeups = 0;
+}
+
+void idleSleep() {
+  unsigned long start = micros();
+  idleBusy += start - idleWokeAt;
+  updateIdleStats(start);
+
+  unsigned long duration = sleepLimit;
+  sleepLimit = IDLE_MAX_SLEEP;
+  bool pending = loopWoken || server.getServer().hasClient();
+  loopWoken = false;
+  if (powerConfig.sleep == SleepMode::None || pending || duration <= 1 || (long)(millis() - awakeUntil) < 0) {
+    delay(1);  // Reduce power consumption by 60% with a delay https://hackaday.com/2022/10/28/esp8266-web-server-saves-60-power-with-a-1-ms-delay/
+  } else {
+    // The SDK sleeps while the loop waits; lwIP callbacks still run and end the wait with wakeLoop()
+    unsigned long sleptAt = millis();
+    idleStats.sleeps++;
+    esp_delay(duration, []() {
+      return !loopWoken && !server.getServer().hasClient();
+    }, IDLE_POLL_INTERVAL);
+    loopWoken = false;
+    if (millis() - sleptAt < duration) {
+      idleStats.earlyWakeups++;
+    }
+  }
+  idleWokeAt = micros();
+}
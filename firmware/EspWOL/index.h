@@ -202,6 +202,113 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
         return username.length >= 3;
       }
 
+      let selectedTag = '';
+
+      function readWakeTarget(prefix) {
+        const wake = {
+          mode: document.getElementById(`${prefix}-wake-mode`).value
+        };
+        const subnetPrefix = document.getElementById(`${prefix}-wake-prefix`).value;
+        const port = document.getElementById(`${prefix}-wake-port`).value;
+        const password = document.getElementById(`${prefix}-wake-password`).value;
+        if (subnetPrefix) wake.prefix = parseInt(subnetPrefix, 10);
+        if (port) wake.port = parseInt(port, 10);
+        if (password) wake.password = password;
+        return wake;
+      }
+
+      function fillWakeTarget(prefix, wake = {}) {
+        document.getElementById(`${prefix}-wake-mode`).value =
+          wake.mode || 'broadcast';
+        document.getElementById(`${prefix}-wake-prefix`).value =
+          wake.prefix || '';
+        document.getElementById(`${prefix}-wake-port`).value =
+          wake.port && wake.port !== 9 ? wake.port : '';
+        document.getElementById(`${prefix}-wake-password`).value =
+          wake.password || '';
+      }
+
+      function readWakePolicy(prefix) {
+        const policy = {
+          backoff: document.getElementById(`${prefix}-policy-backoff`).checked
+        };
+        const retries = document.getElementById(`${prefix}-policy-retries`).value;
+        const timeout = document.getElementById(`${prefix}-policy-timeout`).value;
+        const maxWakes = document.getElementById(
+          `${prefix}-policy-max-wakes`
+        ).value;
+        const quietHours = document
+          .getElementById(`${prefix}-policy-quiet-hours`)
+          .value.replace(/\s/g, '');
+        if (retries) policy.retries = parseInt(retries, 10);
+        if (timeout) policy.timeout = parseInt(timeout, 10);
+        if (maxWakes) policy.maxWakesPerDay = parseInt(maxWakes, 10);
+        if (quietHours) policy.quietHours = quietHours;
+        return policy;
+      }
+
+      function fillWakePolicy(prefix, policy = {}) {
+        document.getElementById(`${prefix}-policy-retries`).value =
+          policy.retries || '';
+        document.getElementById(`${prefix}-policy-timeout`).value =
+          policy.timeout && policy.timeout !== 1000 ? policy.timeout : '';
+        document.getElementById(`${prefix}-policy-max-wakes`).value =
+          policy.maxWakesPerDay || '';
+        document.getElementById(`${prefix}-policy-quiet-hours`).value =
+          policy.quietHours || '';
+        document.getElementById(`${prefix}-policy-backoff`).checked =
+          policy.backoff !== false;
+      }
+
+      function readProbeTarget(prefix) {
+        const probe = {
+          type: document.getElementById(`${prefix}-probe-type`).value
+        };
+        const port = document.getElementById(`${prefix}-probe-port`).value;
+        if (probe.type === 'tcp' && port) probe.port = parseInt(port, 10);
+        return probe;
+      }
+
+      function fillProbeTarget(prefix, probe = {}) {
+        document.getElementById(`${prefix}-probe-type`).value =
+          probe.type || 'icmp';
+        document.getElementById(`${prefix}-probe-port`).value =
+          probe.port || '';
+      }
+
+      function parseTags(value) {
+        return value
+          .split(',')
+          .map((tag) => tag.trim())
+          .filter((tag) => tag);
+      }
+
+      function renderTagFilter(data) {
+        const tags = [...new Set(data.flatMap((host) => host.tags || []))].sort();
+        if (!tags.includes(selectedTag)) selectedTag = '';
+
+        const filter = document.getElementById('tag-filter');
+        filter.innerHTML = '';
+        filter.classList.toggle('d-none', tags.length === 0);
+        ['', ...tags].forEach((tag) => {
+          const chip = document.createElement('button');
+          chip.type = 'button';
+          chip.className = `btn btn-sm rounded-pill me-2 mb-2 ${
+            tag === selectedTag ? 'btn-secondary' : 'btn-outline-secondary'
+          }`;
+          chip.textContent = tag || 'All';
+          chip.onclick = () => {
+            selectedTag = tag;
+            getAllHost();
+          };
+          filter.appendChild(chip);
+        });
+
+        document
+          .getElementById('tag-actions')
+          .classList.toggle('d-none', selectedTag === '');
+      }
+
       async function getAllHost() {
         try {
           const response = await fetch('/hosts', { method: 'GET' });
@@ -210,9 +317,16 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
           const data = await response.json();
           if (!Array.isArray(data)) throw new Error('Expected an array');
 
+          renderTagFilter(data);
+
           const hosts = document.getElementById('host-list');
           hosts.innerHTML = '';
-          data.forEach((host, index) => {
+          data.forEach((host) => {
+            if (selectedTag && !(host.tags || []).includes(selectedTag)) return;
+            const index = host.id;
+            const tags = (host.tags || [])
+              .map((tag) => `<span class="badge text-bg-secondary ms-2">${tag}</span>`)
+              .join('');
             const listItem = document.createElement('li');
             listItem.className =
               'list-group-item d-flex justify-content-between align-items-center';
@@ -220,7 +334,7 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
             listItem.innerHTML = `
         <div class="d-flex align-items-center">
           <div class="status-circle" id="status-${index}"></div>
-          ${host.name} - ${host.ip}
+          ${host.name} - ${host.ip}${tags}
         </div>
         <div>
           <div class="d-none d-sm-inline-block">
@@ -282,12 +396,69 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
         }
       }
 
+      let discoveredHosts = [];
+
+      async function discoverHosts() {
+        const button = document.getElementById('discover-button');
+        const select = document.getElementById('discover-select');
+        enableLoaderButton(button);
+        try {
+          const response = await fetch('/discover', {
+            method: 'POST',
+            headers: { 'Content-Type': 'application/json' },
+            body: JSON.stringify({ icmp: true })
+          });
+          const data = await response.json();
+          if (!data.success) throw new Error(data.message);
+
+          let scan;
+          do {
+            await new Promise((resolve) => setTimeout(resolve, 500));
+            scan = await (await fetch('/discover')).json();
+          } while (scan.state !== 'done');
+
+          discoveredHosts = scan.hosts;
+          select.innerHTML = `<option value="" selected>
+            ${scan.hosts.length} new of ${scan.found} devices found
+          </option>`;
+          scan.hosts.forEach((host, index) => {
+            const option = document.createElement('option');
+            option.value = index;
+            option.textContent = `${host.name || host.ip} (${host.ip}, ${host.mac})`;
+            select.appendChild(option);
+          });
+        } catch (error) {
+          showNotification('Error scanning the network', 'danger', 'Error');
+          console.error('Error scanning the network:', error);
+        }
+        disabledLoaderButton(
+          button,
+          `<i class="fas fa-search"></i> Scan`
+        );
+      }
+
+      function fillDiscoveredHost() {
+        const host =
+          discoveredHosts[document.getElementById('discover-select').value];
+        if (!host) return;
+        document.getElementById('host-name').value = host.name || host.ip;
+        document.getElementById('host-mac').value = host.mac;
+        document.getElementById('host-ip').value = host.ip;
+        // Hosts that do not answer pings are probed with ARP
+        fillProbeTarget('add', host.icmp === false ? { type: 'arp' } : {});
+      }
+
       async function addHost() {
         const button = document.getElementById(`add-button`);
         enableLoaderButton(button);
         const name = document.getElementById('host-name').value;
         const mac = document.getElementById('host-mac').value;
         const ip = document.getElementById('host-ip').value;
+        const tags = parseTags(document.getElementById('host-tags').value);
+        const followIp = document.getElementById('add-follow-ip').checked;
+        const wake = readWakeTarget('add');
+        const policy = readWakePolicy('add');
+        const probe = readProbeTarget('add');
         const periodicPing = document.getElementById(
           'add-select-periodic-ping'
         ).value;
@@ -299,7 +470,17 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
           const response = await fetch('/hosts', {
             method: 'POST',
             headers: { 'Content-Type': 'application/json' },
-            body: JSON.stringify({ name, mac, ip, periodicPing })
+            body: JSON.stringify({
+              name,
+              mac,
+              ip,
+              periodicPing,
+              tags,
+              followIp,
+              wake,
+              policy,
+              probe
+            })
           });
           const data = await response.json();
 
@@ -311,6 +492,12 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
             document.getElementById('host-name').value = '';
             document.getElementById('host-mac').value = '';
             document.getElementById('host-ip').value = '';
+            document.getElementById('host-tags').value = '';
+            document.getElementById('add-follow-ip').checked = false;
+            document.getElementById('discover-select').value = '';
+            fillWakeTarget('add');
+            fillWakePolicy('add');
+            fillProbeTarget('add');
             document.getElementById('add-select-periodic-ping').value = 0;
             resetValidation(modalElement);
           }
@@ -341,6 +528,19 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
           document.getElementById('edit-host-name').value = data.name;
           document.getElementById('edit-host-mac').value = data.mac;
           document.getElementById('edit-host-ip').value = data.ip;
+          document.getElementById('edit-host-resolved').textContent =
+            data.resolved === undefined
+              ? ''
+              : data.resolved
+              ? `Resolves to ${data.resolved}`
+              : 'Not resolved';
+          document.getElementById('edit-host-tags').value = (
+            data.tags || []
+          ).join(', ');
+          document.getElementById('edit-follow-ip').checked = !!data.followIp;
+          fillWakeTarget('edit', data.wake);
+          fillWakePolicy('edit', data.policy);
+          fillProbeTarget('edit', data.probe);
           document.getElementById('edit-select-periodic-ping').value =
             data.periodicPing;
           if (
@@ -374,6 +574,11 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
         const name = document.getElementById('edit-host-name').value;
         const mac = document.getElementById('edit-host-mac').value;
         const ip = document.getElementById('edit-host-ip').value;
+        const tags = parseTags(document.getElementById('edit-host-tags').value);
+        const followIp = document.getElementById('edit-follow-ip').checked;
+        const wake = readWakeTarget('edit');
+        const policy = readWakePolicy('edit');
+        const probe = readProbeTarget('edit');
         const periodicPing = document.getElementById(
           'edit-select-periodic-ping'
         ).value;
@@ -384,7 +589,17 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
           const response = await fetch('/hosts?id=' + index, {
             method: 'PUT',
             headers: { 'Content-Type': 'application/json' },
-            body: JSON.stringify({ name, mac, ip, periodicPing })
+            body: JSON.stringify({
+              name,
+              mac,
+              ip,
+              periodicPing,
+              tags,
+              followIp,
+              wake,
+              policy,
+              probe
+            })
           });
           const data = await response.json();
           if (data.success) {
@@ -439,6 +654,16 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
         }
       }
 
+      // Polls a job until it is done
+      async function waitForJob(id) {
+        let job;
+        do {
+          await new Promise((resolve) => setTimeout(resolve, 500));
+          job = await (await fetch('/jobs/' + id)).json();
+        } while (job.state !== 'done');
+        return job;
+      }
+
       async function pingHost(index) {
         const button = document.getElementById(`ping-button-${index}`);
         enableLoaderButton(button);
@@ -449,15 +674,18 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
           });
 
           const data = await response.json();
+          if (!data.success) throw new Error(data.message);
+
+          const job = await waitForJob(data.job);
           const statusCircle = document.getElementById(`status-${index}`);
           disabledLoaderButton(button, '<i class="fas fa-table-tennis"></i>');
 
-          if (data.success) {
+          if (job.up > 0) {
             statusCircle.classList.remove('red');
             statusCircle.classList.add('green');
             statusCircle.classList.add('blinking');
 
-            showNotification(data.message, 'success');
+            showNotification('Pinging', 'success');
             setTimeout(() => {
               statusCircle.classList.remove('blinking');
               statusCircle.classList.remove('green');
@@ -465,7 +693,7 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
           } else {
             statusCircle.classList.remove('green', 'blinking');
             statusCircle.classList.add('red');
-            showNotification(data.message, 'danger', 'Error');
+            showNotification('Failed ping', 'danger', 'Error');
 
             setTimeout(() => {
               statusCircle.classList.remove('red');
@@ -478,6 +706,61 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
         }
       }
 
+      async function wakeGroup() {
+        const button = document.getElementById('wake-group-button');
+        enableLoaderButton(button);
+        try {
+          const response = await fetch(
+            '/wake?tag=' + encodeURIComponent(selectedTag),
+            { method: 'POST' }
+          );
+          const data = await response.json();
+          showNotification(
+            data.message,
+            data.success ? 'success' : 'danger',
+            data.success ? 'Notification' : 'Error'
+          );
+        } catch (error) {
+          showNotification('Error waking group', 'danger', 'Error');
+          console.error('Error waking group:', error);
+        }
+        disabledLoaderButton(button, `<i class="fas fa-play"></i> Wake group`);
+      }
+
+      async function pingGroup() {
+        const button = document.getElementById('ping-group-button');
+        enableLoaderButton(button);
+        try {
+          const response = await fetch(
+            '/ping?tag=' + encodeURIComponent(selectedTag),
+            { method: 'POST' }
+          );
+          const data = await response.json();
+          if (!data.success) throw new Error(data.message);
+
+          const job = await waitForJob(data.job);
+          job.results.forEach((result) => {
+            const statusCircle = document.getElementById(`status-${result.id}`);
+            if (statusCircle) {
+              statusCircle.classList.remove('green', 'red');
+              statusCircle.classList.add(result.up ? 'green' : 'red');
+            }
+          });
+          showNotification(
+            `${job.up} up, ${job.down} down`,
+            'success',
+            'Notification'
+          );
+        } catch (error) {
+          showNotification('Error pinging group', 'danger', 'Error');
+          console.error('Error pinging group:', error);
+        }
+        disabledLoaderButton(
+          button,
+          `<i class="fas fa-table-tennis"></i> Ping group`
+        );
+      }
+
       async function wakeHost(index) {
         const button = document.getElementById(`wake-button-${index}`);
         enableLoaderButton(button);
@@ -512,7 +795,9 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
         const versionElement = document.getElementById('version');
         const versionContainer = document.getElementById('version-container');
         versionElement.innerText = data.version;
-        if (data.lastVersion) {
+        if (data.lastVersion === null) {
+          versionElement.classList.add('bg-secondary');
+        } else if (data.lastVersion) {
           versionElement.classList.add('bg-success');
           const notificationCircle = versionContainer.querySelector(
             '.notification-circle'
@@ -610,12 +895,9 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
             data.success ? 'Notification' : 'Error'
           );
           if (data.success) {
+            // The settings are only kept once the page loads from the new address
             setTimeout(() => {
-              if (enable) {
-                window.location.replace('http://' + ip);
-              } else {
-                location.reload();
-              }
+              window.location.replace('http://' + data.address);
             }, 500);
           }
         } catch (error) {
@@ -689,10 +971,35 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
 
         let csvContent = 'data:text/csv;charset=utf-8,';
 
-        csvContent += 'Name, MAC Address, IP Address, Periodic ping\n';
+        csvContent +=
+          'Name, MAC Address, IP Address, Periodic ping, Tags, Wake mode, Wake prefix, Wake port, SecureOn password, Ping retries, Ping timeout, Backoff, Quiet hours, Max wakes per day, Probe, Probe port, Follow IP\n';
 
         data.forEach((host) => {
-          let row = `${host.name}, ${host.mac}, ${host.ip}, ${host.periodicPing}`;
+          let row = `${host.name}, ${host.mac}, ${host.ip}, ${
+            host.periodicPing
+          }, ${(host.tags || []).join(';')}`;
+          if (host.wake || host.policy || host.probe || host.followIp) {
+            const wake = host.wake || { mode: 'broadcast', port: 9 };
+            row += `, ${wake.mode}, ${wake.prefix || ''}, ${wake.port}, ${
+              wake.password || ''
+            }`;
+          }
+          if (host.policy || host.probe || host.followIp) {
+            const policy = host.policy || {
+              retries: 0,
+              timeout: 1000,
+              backoff: true,
+              maxWakesPerDay: 0
+            };
+            row += `, ${policy.retries}, ${policy.timeout}, ${
+              policy.backoff
+            }, ${policy.quietHours || ''}, ${policy.maxWakesPerDay}`;
+          }
+          if (host.probe || host.followIp) {
+            const probe = host.probe || { type: 'icmp' };
+            row += `, ${probe.type}, ${probe.port || ''}`;
+          }
+          if (host.followIp) row += ', true';
           csvContent += row + '\n';
         });
 
@@ -744,6 +1051,32 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
               if (values[1]) host.mac = values[1];
               if (values[2]) host.ip = values[2];
               if (values[3]) host.periodicPing = parseInt(values[3], 10);
+              if (values[4])
+                host.tags = values[4]
+                  .split(';')
+                  .map((tag) => tag.trim())
+                  .filter((tag) => tag);
+              if (values[5]) {
+                host.wake = { mode: values[5] };
+                if (values[6]) host.wake.prefix = parseInt(values[6], 10);
+                if (values[7]) host.wake.port = parseInt(values[7], 10);
+                if (values[8]) host.wake.password = values[8];
+              }
+              if (values[9]) {
+                host.policy = {
+                  retries: parseInt(values[9], 10),
+                  backoff: values[11] !== 'false'
+                };
+                if (values[10]) host.policy.timeout = parseInt(values[10], 10);
+                if (values[12]) host.policy.quietHours = values[12];
+                if (values[13])
+                  host.policy.maxWakesPerDay = parseInt(values[13], 10);
+              }
+              if (values[14]) {
+                host.probe = { type: values[14] };
+                if (values[15]) host.probe.port = parseInt(values[15], 10);
+              }
+              if (values[16] === 'true') host.followIp = true;
               return host;
             })
             .filter((host) => host);
@@ -818,6 +1151,15 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
 
           if (response.status === 400) {
             showNotification(data.message, 'danger', 'Error');
+          } else if (!data.lastVersion) {
+            fetch('/updateVersion?refresh=true');
+            showNotification(
+              data.error
+                ? `Check update error: ${data.error}`
+                : 'Update information is not available yet. Try again in a moment.',
+              'warning',
+              'Update'
+            );
           } else {
             const textBody = document.getElementById(
               'update-version-text-body'
@@ -844,6 +1186,14 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
         `;
               updateButton.style.display = 'block';
             }
+            if (data.stale) {
+              const minutes = Math.floor(data.checkedAge / 60);
+              textBody.insertAdjacentHTML(
+                'beforeend',
+                `<p class="text-muted small mb-0">Checked ${minutes} min ago.</p>`
+              );
+              fetch('/updateVersion?refresh=true');
+            }
             modal.show();
           }
         } catch (error) {
@@ -897,22 +1247,23 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
             const updatingBar = document.getElementById('updating-bar');
             document.body.classList.add('blurred');
 
-            let progress = 0;
-            const duration = 30000; // 30 seconds
-            const stepTime = 200; // ms
-            const increment = 100 / (duration / stepTime); // Increase per step
-
-            function updateProgress() {
-              if (progress < 100) {
-                progress += increment;
-                updatingBar.style.width = `${progress}%`;
-              } else {
+            const progressInterval = setInterval(async () => {
+              try {
+                const progressResponse = await fetch('/updateVersion/progress');
+                const progressData = await progressResponse.json();
+                updatingBar.style.width = `${progressData.progress}%`;
+                if (progressData.stage === 'failed') {
+                  clearInterval(progressInterval);
+                  updateContainer.remove();
+                  document.body.classList.remove('blurred');
+                  showNotification(progressData.error, 'danger', 'Updating error');
+                }
+              } catch (error) {
+                // The device is rebooting into the new version
                 clearInterval(progressInterval);
-                location.reload();
+                setTimeout(() => location.reload(), 5000);
               }
-            }
-
-            const progressInterval = setInterval(updateProgress, stepTime);
+            }, 500);
           }
         } catch (error) {
           disabledLoaderButton(button, `Update`);
@@ -1222,6 +1573,26 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
           </div>
         </h2>
         <hr />
+        <!-- Tag filter -->
+        <div class="d-flex flex-wrap align-items-center">
+          <div id="tag-filter" class="d-none"></div>
+          <div id="tag-actions" class="ms-auto mb-2 d-none">
+            <button
+              id="ping-group-button"
+              class="btn btn-info btn-sm me-2"
+              onclick="pingGroup()"
+            >
+              <i class="fas fa-table-tennis"></i> Ping group
+            </button>
+            <button
+              id="wake-group-button"
+              class="btn btn-primary btn-sm"
+              onclick="wakeGroup()"
+            >
+              <i class="fas fa-play"></i> Wake group
+            </button>
+          </div>
+        </div>
         <!-- HOST List -->
         <ul id="host-list" class="list-group mt-3"></ul>
       </main>
@@ -1267,6 +1638,31 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
           </div>
           <div class="modal-body">
             <form class="needs-validation" novalidate id="addHostForm">
+              <div class="mb-3">
+                <label for="discover-select" class="form-label"
+                  >Discovered devices</label
+                >
+                <div class="input-group">
+                  <select
+                    class="form-select"
+                    id="discover-select"
+                    aria-label="Discovered devices"
+                    onchange="fillDiscoveredHost()"
+                  >
+                    <option value="" selected>
+                      Scan the network to list devices
+                    </option>
+                  </select>
+                  <button
+                    id="discover-button"
+                    type="button"
+                    class="btn btn-outline-secondary"
+                    onclick="discoverHosts()"
+                  >
+                    <i class="fas fa-search"></i> Scan
+                  </button>
+                </div>
+              </div>
               <div class="mb-3">
                 <label for="host-name" class="form-label">Name</label>
                 <input
@@ -1290,15 +1686,37 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
                 />
               </div>
               <div class="mb-3">
-                <label for="host-ip" class="form-label">IP Address</label>
+                <label for="host-ip" class="form-label">Address</label>
                 <input
                   type="text"
                   class="form-control"
                   name="ip"
                   id="host-ip"
-                  placeholder="192.168.1.100"
+                  placeholder="192.168.1.100 or nas.local"
+                  title="IPv4 address, hostname or .local name"
                   required
                 />
+                <div class="form-check form-switch mt-2">
+                  <input
+                    class="form-check-input"
+                    type="checkbox"
+                    role="switch"
+                    id="add-follow-ip"
+                  />
+                  <label class="form-check-label" for="add-follow-ip"
+                    >Follow the DHCP address</label
+                  >
+                </div>
+              </div>
+              <div class="mb-3">
+                <label for="host-tags" class="form-label">Tags</label>
+                <input
+                  type="text"
+                  class="form-control"
+                  name="tags"
+                  id="host-tags"
+                  placeholder="office, servers"
+                />
               </div>
               <div class="mb-3">
                 <label for="add-select-periodic-ping" class="form-label"
@@ -1323,6 +1741,134 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
                   <option value="86400">24 hours</option>
                 </select>
               </div>
+              <div class="mb-3">
+                <label for="add-wake-mode" class="form-label"
+                  >Wake target</label
+                >
+                <div class="input-group">
+                  <select
+                    class="form-select"
+                    id="add-wake-mode"
+                    aria-label="Wake target"
+                  >
+                    <option value="broadcast" selected>Broadcast</option>
+                    <option value="subnet">Subnet broadcast</option>
+                    <option value="unicast">Unicast</option>
+                  </select>
+                  <input
+                    type="number"
+                    class="form-control"
+                    id="add-wake-prefix"
+                    min="0"
+                    max="32"
+                    placeholder="Prefix"
+                    title="Prefix length of the host network, empty for the device network"
+                  />
+                  <input
+                    type="number"
+                    class="form-control"
+                    id="add-wake-port"
+                    min="1"
+                    max="65535"
+                    placeholder="Port 9"
+                    title="UDP port"
+                  />
+                </div>
+              </div>
+              <div class="mb-3">
+                <label for="add-wake-password" class="form-label"
+                  >SecureOn password</label
+                >
+                <input
+                  type="text"
+                  class="form-control"
+                  id="add-wake-password"
+                  placeholder="Optional, AA:BB:CC:DD:EE:FF"
+                />
+              </div>
+              <div class="mb-3">
+                <label for="add-probe-type" class="form-label"
+                  >Liveness probe</label
+                >
+                <div class="input-group">
+                  <select
+                    class="form-select"
+                    id="add-probe-type"
+                    aria-label="Liveness probe"
+                  >
+                    <option value="icmp" selected>Ping (ICMP)</option>
+                    <option value="tcp">TCP connect</option>
+                    <option value="arp">ARP (same network)</option>
+                  </select>
+                  <input
+                    type="number"
+                    class="form-control"
+                    id="add-probe-port"
+                    min="1"
+                    max="65535"
+                    placeholder="TCP port"
+                    title="Port to connect to, for hosts dropping ICMP"
+                  />
+                </div>
+              </div>
+              <div class="mb-3">
+                <label for="add-policy-retries" class="form-label"
+                  >Wake policy</label
+                >
+                <div class="input-group">
+                  <input
+                    type="number"
+                    class="form-control"
+                    id="add-policy-retries"
+                    min="0"
+                    max="5"
+                    placeholder="Retries 0"
+                    title="Pings after the first before the host counts as down"
+                  />
+                  <input
+                    type="number"
+                    class="form-control"
+                    id="add-policy-timeout"
+                    min="100"
+                    max="5000"
+                    placeholder="Timeout 1000 ms"
+                    title="Milliseconds to wait for each ping"
+                  />
+                  <input
+                    type="number"
+                    class="form-control"
+                    id="add-policy-max-wakes"
+                    min="0"
+                    max="255"
+                    placeholder="Wakes/day"
+                    title="Automatic wakes per day, empty for no limit"
+                  />
+                </div>
+              </div>
+              <div class="mb-3">
+                <label for="add-policy-quiet-hours" class="form-label"
+                  >Quiet hours</label
+                >
+                <input
+                  type="text"
+                  class="form-control"
+                  id="add-policy-quiet-hours"
+                  placeholder="Optional, 22:00-07:00"
+                  title="No automatic wakes during these hours"
+                />
+                <div class="form-check form-switch mt-2">
+                  <input
+                    class="form-check-input"
+                    type="checkbox"
+                    role="switch"
+                    id="add-policy-backoff"
+                    checked
+                  />
+                  <label class="form-check-label" for="add-policy-backoff"
+                    >Back off while the host stays down</label
+                  >
+                </div>
+              </div>
             </form>
           </div>
           <div class="modal-footer">
@@ -1392,15 +1938,38 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
                 />
               </div>
               <div class="mb-3">
-                <label for="edit-host-ip" class="form-label">IP Address</label>
+                <label for="edit-host-ip" class="form-label">Address</label>
                 <input
                   type="text"
                   class="form-control"
                   name="ip"
                   id="edit-host-ip"
-                  placeholder="192.168.1.100"
+                  placeholder="192.168.1.100 or nas.local"
+                  title="IPv4 address, hostname or .local name"
                   required
                 />
+                <div class="form-text" id="edit-host-resolved"></div>
+                <div class="form-check form-switch mt-2">
+                  <input
+                    class="form-check-input"
+                    type="checkbox"
+                    role="switch"
+                    id="edit-follow-ip"
+                  />
+                  <label class="form-check-label" for="edit-follow-ip"
+                    >Follow the DHCP address</label
+                  >
+                </div>
+              </div>
+              <div class="mb-3">
+                <label for="edit-host-tags" class="form-label">Tags</label>
+                <input
+                  type="text"
+                  class="form-control"
+                  name="tags"
+                  id="edit-host-tags"
+                  placeholder="office, servers"
+                />
               </div>
               <div class="mb-3">
                 <label for="edit-select-periodic-ping" class="form-label"
@@ -1431,6 +2000,134 @@ const char indexHtmlPage[] PROGMEM = R"rawliteral(
                   Last ping: _ min ago
                 </small>
               </div>
+              <div class="mb-3">
+                <label for="edit-wake-mode" class="form-label"
+                  >Wake target</label
+                >
+                <div class="input-group">
+                  <select
+                    class="form-select"
+                    id="edit-wake-mode"
+                    aria-label="Wake target"
+                  >
+                    <option value="broadcast" selected>Broadcast</option>
+                    <option value="subnet">Subnet broadcast</option>
+                    <option value="unicast">Unicast</option>
+                  </select>
+                  <input
+                    type="number"
+                    class="form-control"
+                    id="edit-wake-prefix"
+                    min="0"
+                    max="32"
+                    placeholder="Prefix"
+                    title="Prefix length of the host network, empty for the device network"
+                  />
+                  <input
+                    type="number"
+                    class="form-control"
+                    id="edit-wake-port"
+                    min="1"
+                    max="65535"
+                    placeholder="Port 9"
+                    title="UDP port"
+                  />
+                </div>
+              </div>
+              <div class="mb-3">
+                <label for="edit-wake-password" class="form-label"
+                  >SecureOn password</label
+                >
+                <input
+                  type="text"
+                  class="form-control"
+                  id="edit-wake-password"
+                  placeholder="Optional, AA:BB:CC:DD:EE:FF"
+                />
+              </div>
+              <div class="mb-3">
+                <label for="edit-probe-type" class="form-label"
+                  >Liveness probe</label
+                >
+                <div class="input-group">
+                  <select
+                    class="form-select"
+                    id="edit-probe-type"
+                    aria-label="Liveness probe"
+                  >
+                    <option value="icmp" selected>Ping (ICMP)</option>
+                    <option value="tcp">TCP connect</option>
+                    <option value="arp">ARP (same network)</option>
+                  </select>
+                  <input
+                    type="number"
+                    class="form-control"
+                    id="edit-probe-port"
+                    min="1"
+                    max="65535"
+                    placeholder="TCP port"
+                    title="Port to connect to, for hosts dropping ICMP"
+                  />
+                </div>
+              </div>
+              <div class="mb-3">
+                <label for="edit-policy-retries" class="form-label"
+                  >Wake policy</label
+                >
+                <div class="input-group">
+                  <input
+                    type="number"
+                    class="form-control"
+                    id="edit-policy-retries"
+                    min="0"
+                    max="5"
+                    placeholder="Retries 0"
+                    title="Pings after the first before the host counts as down"
+                  />
+                  <input
+                    type="number"
+                    class="form-control"
+                    id="edit-policy-timeout"
+                    min="100"
+                    max="5000"
+                    placeholder="Timeout 1000 ms"
+                    title="Milliseconds to wait for each ping"
+                  />
+                  <input
+                    type="number"
+                    class="form-control"
+                    id="edit-policy-max-wakes"
+                    min="0"
+                    max="255"
+                    placeholder="Wakes/day"
+                    title="Automatic wakes per day, empty for no limit"
+                  />
+                </div>
+              </div>
+              <div class="mb-3">
+                <label for="edit-policy-quiet-hours" class="form-label"
+                  >Quiet hours</label
+                >
+                <input
+                  type="text"
+                  class="form-control"
+                  id="edit-policy-quiet-hours"
+                  placeholder="Optional, 22:00-07:00"
+                  title="No automatic wakes during these hours"
+                />
+                <div class="form-check form-switch mt-2">
+                  <input
+                    class="form-check-input"
+                    type="checkbox"
+                    role="switch"
+                    id="edit-policy-backoff"
+                    checked
+                  />
+                  <label class="form-check-label" for="edit-policy-backoff"
+                    >Back off while the host stays down</label
+                  >
+                </div>
+              </div>
             </form>
           </div>
           <div class="modal-footer">
@@ -0,0 +1,122 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#define JOBS_MAX 8                 // Jobs kept in memory, finished ones are dropped first
+#define JOBS_MAX_HOSTS 256         // Hosts per job
+#define WAKE_MAX_REPEAT 10         // Magic packets per host
+#define WAKE_MAX_SPACING 10000     // Milliseconds between two packets
+#define WAKE_DEFAULT_MAX_PPS 20    // Packets per second when not specified
+#define WAKE_MAX_PPS 100           // Upper bound accepted for packets per second
+#define VERIFY_DEFAULT_TIMEOUT 120 // Seconds a verified wake waits for the hosts
+#define VERIFY_MAX_TIMEOUT 900     // Upper bound accepted for the timeout in seconds
+#define VERIFY_FIRST_RESEND 2000   // Milliseconds before the first resend, doubled after each one
+#define VERIFY_MAX_RESEND 30000    // Upper bound for the time between two resends
+#define VERIFY_PROBES (PROBE_SLOTS - 1)  // Probes of the verify jobs running at once, one slot is left to the periodic ping
+#define PING_HOST_ATTEMPTS 3       // Probes of a host pinged alone before it counts as down
+
+// Types of background jobs acting on a list of hosts
+enum class JobType : uint8_t {
+  Wake,
+  Ping,
+  Verify
+};
+
+// Structure for the wake-and-verify progress of one host
+struct VerifyState {
+  uint8_t packets = 0;             // Magic packets sent
+  unsigned long nextWakeAt = 0;    // millis() when the next packet is due
+  unsigned long upAfter = 0;       // Milliseconds from queueing until the host answered
+};
+
+// Structure for a background job
+struct Job {
+  JobType type = JobType::Wake;
+  std::vector<uint64_t> macs;      // MAC addresses of the hosts (see `macKey()`), in processing order: host indexes change when hosts are deleted
+  std::vector<int8_t> results;     // Ping and Verify: per host, -1 pending, 0 down, 1 up
+  std::vector<VerifyState> verify; // Verify: per host
+  uint8_t repeat = 1;              // Wake: packets per host
+  uint8_t attempts = 1;            // Ping: probes of a host before it counts as down
+  uint8_t attempt = 0;             // Ping: probes of the current host that went unanswered
+  unsigned long interval = 0;      // Wake: milliseconds between two packets
+  size_t next = 0;                 // Index of the next step (round * hosts + host)
+  uint16_t sent = 0;               // Packets sent or hosts up
+  uint16_t failed = 0;             // Packets that failed or hosts down (including deleted hosts)
+  unsigned long createdAt = 0;     // millis() when queued
+  unsigned long deadline = 0;      // Verify: millis() when the hosts still down count as failed
+  unsigned long nextRunAt = 0;     // millis() when the next step may run
+  unsigned long finishedAt = 0;    // millis() when the last step ran
+  bool done = false;
+
+  size_t total() const {
+    return macs.size() * repeat;
+  }
+};
+
+/**
+ * @brief Queues magic packets for several hosts.
+ *
+ * Packets are sent by `handleJobs()` in rounds: one packet to every
+ * host, `repeat` times. Two packets are at least `spacing` milliseconds and
+ * `1000 / maxPps` milliseconds apart.
+ *
+ * @param hosts The host indexes, kept by the job as their MAC addresses.
+ * @param repeat The number of packets per host.
+ * @param spacing The minimum time between two packets in milliseconds.
+ * @param maxPps The maximum packets per second.
+ * @return The job ID, -1 if `JOBS_MAX` jobs are still running.
+ */
+int queueWakeJob(const std::vector<int> &hosts, uint8_t repeat, uint16_t spacing, uint16_t maxPps);
+
+/**
+ * @brief Queues a ping to several hosts.
+ *
+ * Hosts are probed one after the other with their probe type (ICMP, TCP or
+ * ARP), without blocking `loop()`; the results are stored in the job.
+ *
+ * @param hosts The host indexes, kept by the job as their MAC addresses.
+ * @param attempts The probes of a host before it counts as down.
+ * @return The job ID, -1 if `JOBS_MAX` jobs are still running.
+ */
+int queuePingJob(const std::vector<int> &hosts, uint8_t attempts = 1);
+
+/**
+ * @brief Queues a wake-and-verify of several hosts.
+ *
+ * Unlike the other jobs, verify jobs run alongside the queue: each host gets
+ * a magic packet right away, then again after 2, 4, 8... seconds (at most
+ * `VERIFY_MAX_RESEND` apart) until it answers its asynchronous probe or the
+ * timeout expires. Up to `VERIFY_PROBES` hosts are probed at the same time,
+ * so a round over the hosts still down takes about their count times the
+ * probe timeout divided by `VERIFY_PROBES`: with many hosts that do not
+ * answer, raise the timeout. The time until each host answered is stored in
+ * the job and in the host metrics.
+ *
+ * @param hosts The host indexes, kept by the job as their MAC addresses.
+ * @param timeout The time given to the hosts to come up in seconds.
+ * @return The job ID, -1 if `JOBS_MAX` jobs are still running.
+ */
+int queueVerifyJob(const std::vector<int> &hosts, uint16_t timeout);
+
+/**
+ * @brief Returns a queued, running or recently finished job, nullptr if unknown.
+ */
+const Job *findJob(int id);
+
+/**
+ * @brief Returns the current index of a host of a job, -1 if it was deleted.
+ *
+ * @param job The job.
+ * @param slot The position of the host in the job.
+ */
+int findJobHost(const Job &job, size_t slot);
+
+/**
+ * @brief Runs the next step of the queued jobs when it is due.
+ *
+ * Called from `loop()`. Wake and ping jobs run one after the other and each
+ * call runs at most one step of them: one magic packet, or starting or collecting one probe. Each
+ * verify job also collects the answers of its probes and runs one step: a magic packet or a probe.
+ */
+void handleJobs();
+
+#endif
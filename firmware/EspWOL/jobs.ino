@@ -0,0 +1,303 @@
+#include "jobs.h"
+
+// Map for storing jobs by ID, in creation order
+static std::map<int, Job> jobs;
+static int lastJob = 0;
+static unsigned long lastWakePacket = 0;
+// Probe of the active ping job
+static int8_t pingProbe = -1;
+
+// Structure for a probe of a verify job: the job owning it and the position of the probed host
+struct VerifyProbe {
+  int8_t probe = -1;
+  int job = 0;
+  size_t slot = 0;
+};
+
+static VerifyProbe verifyProbes[VERIFY_PROBES];
+
+// Drops finished jobs, oldest first, to make room for a new one
+static void dropFinishedJobs() {
+  for (auto it = jobs.begin(); it != jobs.end() && jobs.size() >= JOBS_MAX;) {
+    if (it->second.done) {
+      it = jobs.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+static Job *createJob(JobType type, const std::vector<int> &ids) {
+  dropFinishedJobs();
+  if (jobs.size() >= JOBS_MAX) {
+    return nullptr;
+  }
+
+  Job &job = jobs[++lastJob];
+  job.type = type;
+  for (int id : ids) {
+    job.macs.push_back(macKey(hosts[id].macBytes));
+  }
+  job.createdAt = millis();
+  job.nextRunAt = job.createdAt;
+  return &job;
+}
+
+int queueWakeJob(const std::vector<int> &hosts, uint8_t repeat, uint16_t spacing, uint16_t maxPps) {
+  Job *job = createJob(JobType::Wake, hosts);
+  if (!job) {
+    return -1;
+  }
+  job->repeat = repeat;
+  job->interval = max((unsigned long)spacing, 1000UL / maxPps);
+  return lastJob;
+}
+
+int queuePingJob(const std::vector<int> &hosts, uint8_t attempts) {
+  Job *job = createJob(JobType::Ping, hosts);
+  if (!job) {
+    return -1;
+  }
+  job->attempts = max(attempts, (uint8_t)1);
+  job->results.assign(hosts.size(), -1);
+  return lastJob;
+}
+
+int queueVerifyJob(const std::vector<int> &hosts, uint16_t timeout) {
+  Job *job = createJob(JobType::Verify, hosts);
+  if (!job) {
+    return -1;
+  }
+  job->results.assign(hosts.size(), -1);
+  job->verify.assign(hosts.size(), VerifyState());
+  for (VerifyState &state : job->verify) {
+    state.nextWakeAt = job->createdAt;
+  }
+  job->deadline = job->createdAt + timeout * 1000UL;
+  return lastJob;
+}
+
+const Job *findJob(int id) {
+  auto it = jobs.find(id);
+  return it != jobs.end() ? &it->second : nullptr;
+}
+
+int findJobHost(const Job &job, size_t slot) {
+  uint64_t key = job.macs[slot];
+  uint8_t mac[6];
+  for (int i = 5; i >= 0; i--) {
+    mac[i] = key & 0xff;
+    key >>= 8;
+  }
+  return findHostByMAC(mac);
+}
+
+// Sends one magic packet, returns false while the pacing delays it
+static bool runWakeStep(Job &job, unsigned long now) {
+  if (now - lastWakePacket < job.interval) {
+    return false;
+  }
+
+  auto host = hosts.find(findJobHost(job, job.next % job.macs.size()));
+  bool sent = host != hosts.end() && sendMagicPacket(host->second.macBytes, host->second.wake);
+  recordMagicPacket(sent);
+  if (sent) {
+    job.sent++;
+  } else {
+    job.failed++;
+  }
+
+  lastWakePacket = now;
+  job.nextRunAt = now + job.interval;
+  return true;
+}
+
+// Probes one host, returns false while the answer is pending
+static bool runPingStep(Job &job) {
+  int id = findJobHost(job, job.next);
+  auto host = hosts.find(id);
+  if (host == hosts.end()) {
+    clearProbe(pingProbe);  // Started before the host was deleted, its answer belongs to no one
+    pingProbe = -1;
+    job.attempt = 0;
+    job.results[job.next] = 0;
+    job.failed++;
+    return true;
+  }
+
+  bool alive = false;
+  if (pingProbe < 0) {
+    IPAddress ip;
+    ResolveState resolved = resolveHost(host->second.ip, ip);
+    if (resolved == ResolveState::Pending) {
+      return false;
+    }
+    lastPings[id] = millis();
+    if (resolved == ResolveState::Resolved) {
+      pingProbe = startProbe(ip, host->second.probe, host->second.policy.timeout);
+      return false;
+    }
+    recordPing(id, false, 0);  // The name does not resolve
+  } else {
+    ProbeState state = getProbeState(pingProbe);
+    if (state == ProbeState::Pending) {
+      return false;
+    }
+
+    alive = state == ProbeState::Up;
+    recordPing(id, alive, getProbeTime(pingProbe));
+    clearProbe(pingProbe);
+    pingProbe = -1;
+    if (!alive && ++job.attempt < job.attempts) {
+      return false;  // Probed again on the next call
+    }
+  }
+  job.attempt = 0;
+  job.results[job.next] = alive;
+  if (alive) {
+    job.sent++;
+  } else {
+    job.failed++;
+  }
+  return true;
+}
+
+static void finishJob(Job &job) {
+  job.done = true;
+  job.finishedAt = millis();
+}
+
+// Stores the answer of a probe started by a verify job
+static void collectProbe(Job &job, VerifyProbe &probe, unsigned long now) {
+  int id = findJobHost(job, probe.slot);
+  if (id < 0) {  // Deleted while probed, counted as failed by the next step
+    clearProbe(probe.probe);
+    probe = VerifyProbe();
+    return;
+  }
+  bool up = getProbeState(probe.probe) == ProbeState::Up;
+  recordPing(id, up, getProbeTime(probe.probe));
+  lastPings[id] = now;
+  if (up && job.results[probe.slot] < 0) {
+    job.results[probe.slot] = 1;
+    job.verify[probe.slot].upAfter = now - job.createdAt;
+    job.sent++;
+    recordWakeVerify(id, true, job.verify[probe.slot].upAfter);
+  }
+  clearProbe(probe.probe);
+  probe = VerifyProbe();
+}
+
+// Returns the probe of a verify job for the host at a position, nullptr if none is running
+static VerifyProbe *findVerifyProbe(int jobId, size_t slot) {
+  for (VerifyProbe &probe : verifyProbes) {
+    if (probe.job == jobId && probe.slot == slot) {
+      return &probe;
+    }
+  }
+  return nullptr;
+}
+
+// Collects the answers of a verify job, sends the packet due for one pending host or probes it
+static void runVerifyStep(int jobId, Job &job, unsigned long now) {
+  for (VerifyProbe &probe : verifyProbes) {
+    if (probe.job == jobId && getProbeState(probe.probe) != ProbeState::Pending) {
+      collectProbe(job, probe, now);
+    }
+  }
+
+  if (job.sent + job.failed >= job.macs.size() || (long)(now - job.deadline) >= 0) {
+    for (VerifyProbe &probe : verifyProbes) {
+      if (probe.job == jobId) {
+        clearProbe(probe.probe);
+        probe = VerifyProbe();
+      }
+    }
+    for (size_t i = 0; i < job.macs.size(); i++) {
+      if (job.results[i] < 0) {
+        job.results[i] = 0;
+        job.failed++;
+        int id = findJobHost(job, i);
+        if (id >= 0) {
+          recordWakeVerify(id, false, 0);
+        }
+      }
+    }
+    finishJob(job);
+    return;
+  }
+
+  // Hosts are handled in turn, skipping those already up
+  size_t slot = job.next % job.macs.size();
+  while (job.results[slot] >= 0) {
+    slot = (slot + 1) % job.macs.size();
+  }
+  job.next = slot + 1;
+
+  auto host = hosts.find(findJobHost(job, slot));
+  if (host == hosts.end()) {
+    job.results[slot] = 0;
+    job.failed++;
+    return;
+  }
+
+  VerifyState &state = job.verify[slot];
+  if ((long)(now - state.nextWakeAt) >= 0) {
+    if (now - lastWakePacket < 1000 / WAKE_DEFAULT_MAX_PPS) {
+      return;
+    }
+    recordMagicPacket(sendMagicPacket(host->second.macBytes, host->second.wake));
+    lastWakePacket = now;
+    state.nextWakeAt = now + min((unsigned long)VERIFY_FIRST_RESEND << min(state.packets, (uint8_t)8), (unsigned long)VERIFY_MAX_RESEND);
+    state.packets++;
+    return;
+  }
+
+  // Up to VERIFY_PROBES hosts of all verify jobs are probed at the same time
+  VerifyProbe *probe = findVerifyProbe(0, 0);  // A free entry
+  IPAddress ip;
+  if (probe && !findVerifyProbe(jobId, slot) && resolveHost(host->second.ip, ip) == ResolveState::Resolved && (probe->probe = startProbe(ip, host->second.probe, host->second.policy.timeout)) >= 0) {
+    probe->job = jobId;
+    probe->slot = slot;
+  }
+}
+
+void handleJobs() {
+  unsigned long now = millis();
+
+  // Verify jobs wait for hosts to boot, so they run alongside the queue
+  for (auto &[id, job] : jobs) {
+    if (!job.done && job.type == JobType::Verify) {
+      limitSleep(0);  // Probes its hosts until they are up
+      runVerifyStep(id, job, now);
+    }
+  }
+
+  // Wake and ping jobs run one after the other: the first unfinished one is active
+  auto it = jobs.begin();
+  while (it != jobs.end() && (it->second.done || it->second.type == JobType::Verify)) {
+    ++it;
+  }
+  if (it == jobs.end()) {
+    return;
+  }
+
+  Job &job = it->second;
+  if ((long)(now - job.nextRunAt) < 0) {
+    limitSleep(job.nextRunAt - now);
+    return;
+  }
+  limitSleep(0);
+
+  if (job.type == JobType::Wake) {
+    if (!runWakeStep(job, now)) {
+      return;
+    }
+  } else if (!runPingStep(job)) {
+    return;
+  }
+
+  if (++job.next >= job.total()) {
+    finishJob(job);
+  }
+}
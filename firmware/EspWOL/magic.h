@@ -0,0 +1,134 @@
+#ifndef MAGIC_H
+#define MAGIC_H
+
+#define MAGIC_PACKET_SIZE 102  // 6 x 0xFF followed by 16 x MAC
+#define MAGIC_PACKET_PORT 9
+#define SECUREON_SIZE 6        // SecureOn password appended to the payload
+
+// Ways to reach a host with a magic packet
+enum class WakeMode : uint8_t {
+  Broadcast,  // Limited broadcast (255.255.255.255), same network only
+  Subnet,     // Directed broadcast to the host network, routed to other VLANs
+  Unicast     // Host address, with a static ARP entry as a sleeping host does not answer ARP
+};
+
+// Structure for the wake target of a host
+struct WakeTarget {
+  WakeMode mode = WakeMode::Broadcast;
+  uint8_t prefix = 0;                      // Subnet: prefix length of the host network, 0 for the device network
+  uint16_t port = MAGIC_PACKET_PORT;
+  bool secureOn = false;
+  uint8_t password[SECUREON_SIZE] = {};
+  IPAddress address = IPAddress(255, 255, 255, 255);  // Destination, computed by `resolveWakeTarget()`
+
+  bool isDefault() const {
+    return mode == WakeMode::Broadcast && port == MAGIC_PACKET_PORT && !secureOn;
+  }
+};
+
+/**
+ * @brief Parses a MAC address into its 6 bytes.
+ *
+ * Accepts `:` or `-` as separator.
+ *
+ * @param mac The MAC address string.
+ * @param bytes The parsed bytes.
+ * @return true if the MAC address was parsed, false otherwise.
+ */
+bool parseMACAddress(const String &mac, uint8_t bytes[6]);
+
+/**
+ * @brief Packs the 6 bytes of a MAC address into an integer key.
+ *
+ * @param mac The parsed MAC address.
+ * @return The key, used to look hosts up by MAC address.
+ */
+uint64_t macKey(const uint8_t mac[6]);
+
+/**
+ * @brief Checks that a payload is a magic packet.
+ *
+ * The payload must be 6 x 0xFF followed by the same MAC address 16 times,
+ * optionally followed by a 4 or 6 byte SecureOn password.
+ *
+ * @param payload The first `MAGIC_PACKET_SIZE` bytes of the payload.
+ * @param length The full length of the payload.
+ * @return true if the payload is a magic packet, false otherwise.
+ */
+bool isMagicPacket(const uint8_t *payload, size_t length);
+
+/**
+ * @brief Reads a wake target from JSON.
+ *
+ * Expects an object with the optional fields `mode` ("broadcast", "subnet" or
+ * "unicast"), `prefix` (0-32), `port` (1-65535) and `password` (SecureOn,
+ * formatted as a MAC address). A null value gives the default target.
+ *
+ * @param value The JSON value.
+ * @param target The wake target read.
+ * @return true if the value is valid, false otherwise.
+ */
+bool readWakeTarget(JsonVariantConst value, WakeTarget &target);
+
+/**
+ * @brief Writes a wake target as a JSON object.
+ *
+ * @param obj The JSON object to fill.
+ * @param target The wake target.
+ */
+void writeWakeTarget(JsonObject obj, const WakeTarget &target);
+
+/**
+ * @brief Computes and caches the destination address of a host.
+ *
+ * Called when a host is loaded, added, edited or imported, and for all hosts
+ * by `handleWakeTargets()` after WiFi (re)connects, and when the hostname of
+ * a host resolves to a new address. For unicast targets, also adds the static
+ * ARP entry of the host, or falls back to the broadcast address of the device
+ * network when lwIP is built without `ETHARP_SUPPORT_STATIC_ENTRIES`. Until
+ * its hostname resolves, a host is woken with a limited broadcast.
+ *
+ * @param id The index of the host.
+ */
+void resolveWakeTarget(int id);
+
+/**
+ * @brief Removes what `resolveWakeTarget()` set up for a host.
+ *
+ * Called before a host is edited or deleted.
+ *
+ * @param id The index of the host.
+ */
+void releaseWakeTarget(int id);
+
+/**
+ * @brief Registers the WiFi event handler refreshing the wake targets.
+ */
+void setupWakeTargets();
+
+/**
+ * @brief Resolves the wake targets of all hosts again on the next `handleWakeTargets()`, e.g. after the network settings changed.
+ */
+void refreshWakeTargets();
+
+/**
+ * @brief Resolves the wake targets of all hosts again after WiFi got an address.
+ *
+ * Called from `loop()`.
+ */
+void handleWakeTargets();
+
+/**
+ * @brief Sends a magic packet as one UDP datagram.
+ *
+ * The payload is kept in a static buffer and only rewritten when the MAC
+ * differs from the previous packet, so repeated packets to a host go out
+ * without any parsing or allocation.
+ *
+ * @param mac The parsed MAC address of the host.
+ * @param target The resolved wake target of the host.
+ * @return true if the datagram was sent, false otherwise.
+ */
+bool sendMagicPacket(const uint8_t mac[6], const WakeTarget &target);
+
+#endif
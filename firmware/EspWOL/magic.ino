@@ -0,0 +1,216 @@
+#include "magic.h"
+#include "validation.h"
+
+#include <lwip/etharp.h>
+
+static uint8_t magicPacket[MAGIC_PACKET_SIZE + SECUREON_SIZE] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+static bool magicPacketReady = false;
+static volatile bool wakeTargetsStale = false;
+static WiFiEventHandler wakeTargetsGotIPHandler;
+
+static const char *const WAKE_MODES[] = { "broadcast", "subnet", "unicast" };
+
+static int8_t hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool parseMACAddress(const String &mac, uint8_t bytes[6]) {
+  if (mac.length() != 17) {
+    return false;
+  }
+  for (int i = 0; i < 6; i++) {
+    int8_t high = hexValue(mac[i * 3]);
+    int8_t low = hexValue(mac[i * 3 + 1]);
+    if (high < 0 || low < 0 || (i < 5 && mac[i * 3 + 2] != ':' && mac[i * 3 + 2] != '-')) {
+      return false;
+    }
+    bytes[i] = (high << 4) | low;
+  }
+  return true;
+}
+
+uint64_t macKey(const uint8_t mac[6]) {
+  uint64_t key = 0;
+  for (int i = 0; i < 6; i++) {
+    key = (key << 8) | mac[i];
+  }
+  return key;
+}
+
+bool isMagicPacket(const uint8_t *payload, size_t length) {
+  if (length != MAGIC_PACKET_SIZE && length != MAGIC_PACKET_SIZE + 4 && length != MAGIC_PACKET_SIZE + SECUREON_SIZE) {
+    return false;
+  }
+  for (int i = 0; i < 6; i++) {
+    if (payload[i] != 0xFF) {
+      return false;
+    }
+  }
+  for (int i = 1; i < 16; i++) {
+    if (memcmp(payload + 6, payload + 6 + i * 6, 6)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool readWakeTarget(JsonVariantConst value, WakeTarget &target) {
+  target = WakeTarget();
+  if (value.isNull()) {
+    return true;
+  }
+  if (!value.is<JsonObjectConst>()) {
+    return false;
+  }
+
+  String mode = value["mode"] | "broadcast";
+  long prefix = value["prefix"] | 0L;
+  long port = value["port"] | (long)MAGIC_PACKET_PORT;
+  if (prefix < 0 || prefix > 32 || port < 1 || port > 65535) {
+    return false;
+  }
+
+  uint8_t i = 0;
+  while (i < sizeof(WAKE_MODES) / sizeof(WAKE_MODES[0]) && mode != WAKE_MODES[i]) {
+    i++;
+  }
+  if (i == sizeof(WAKE_MODES) / sizeof(WAKE_MODES[0])) {
+    return false;
+  }
+  target.mode = (WakeMode)i;
+  target.prefix = prefix;
+  target.port = port;
+
+  String password = value["password"] | "";
+  if (!password.isEmpty()) {
+    if (!isValidMACAddress(password)) {
+      return false;
+    }
+    target.secureOn = parseMACAddress(password, target.password);
+  }
+  return true;
+}
+
+void writeWakeTarget(JsonObject obj, const WakeTarget &target) {
+  obj["mode"] = WAKE_MODES[(uint8_t)target.mode];
+  if (target.mode == WakeMode::Subnet) {
+    obj["prefix"] = target.prefix;
+  }
+  obj["port"] = target.port;
+  if (target.secureOn) {
+    char password[18];
+    const uint8_t *p = target.password;
+    snprintf_P(password, sizeof(password), PSTR("%02X:%02X:%02X:%02X:%02X:%02X"), p[0], p[1], p[2], p[3], p[4], p[5]);
+    obj["password"] = password;
+  }
+}
+
+// Returns the mask of the device network, 0 while unknown
+static uint32_t deviceNetworkMask() {
+  uint32_t mask = WiFi.subnetMask();
+  if (!mask && networkConfig.enable) {
+    mask = networkConfig.networkMask;
+  }
+  return mask;
+}
+
+void resolveWakeTarget(int id) {
+  auto it = hosts.find(id);
+  if (it == hosts.end()) {
+    return;
+  }
+  Host &host = it->second;
+  WakeTarget &target = host.wake;
+  IPAddress ip;
+  if (resolveHost(host.ip, ip) != ResolveState::Resolved) {
+    // Until the name resolves, the host can only be reached on the device network
+    target.address = IPAddress(255, 255, 255, 255);
+    return;
+  }
+
+  switch (target.mode) {
+    case WakeMode::Subnet:
+      {
+        // Prefix lengths are in host order, addresses in network order
+        uint32_t mask = target.prefix ? htonl(0xFFFFFFFFUL << (32 - target.prefix)) : deviceNetworkMask();
+        target.address = mask ? IPAddress((uint32_t)ip | ~mask) : IPAddress(255, 255, 255, 255);
+        break;
+      }
+    case WakeMode::Unicast:
+      {
+#if ETHARP_SUPPORT_STATIC_ENTRIES
+        target.address = ip;
+        ip4_addr_t address;
+        address.addr = ip;
+        struct eth_addr mac;
+        memcpy(mac.addr, host.macBytes, sizeof(mac.addr));
+        etharp_add_static_entry(&address, &mac);
+#else
+        // lwIP built without static ARP entries: a sleeping host is only reached by the broadcast of its network
+        uint32_t mask = deviceNetworkMask();
+        target.address = mask ? IPAddress((uint32_t)ip | ~mask) : IPAddress(255, 255, 255, 255);
+#endif
+        break;
+      }
+    default:
+      target.address = IPAddress(255, 255, 255, 255);
+      break;
+  }
+}
+
+void releaseWakeTarget(int id) {
+  auto it = hosts.find(id);
+  if (it == hosts.end() || it->second.wake.mode != WakeMode::Unicast) {
+    return;
+  }
+#if ETHARP_SUPPORT_STATIC_ENTRIES
+  ip4_addr_t address;
+  address.addr = it->second.wake.address;
+  etharp_remove_static_entry(&address);
+#endif
+}
+
+void refreshWakeTargets() {
+  wakeTargetsStale = true;
+}
+
+void setupWakeTargets() {
+  wakeTargetsStale = true;
+  wakeTargetsGotIPHandler = WiFi.onStationModeGotIP([](const WiFiEventStationModeGotIP &) {
+    wakeTargetsStale = true;
+  });
+}
+
+void handleWakeTargets() {
+  if (wakeTargetsStale) {
+    // The network mask may have changed and lwIP drops static ARP entries with the connection
+    wakeTargetsStale = false;
+    for (auto &pair : hosts) {
+      resolveWakeTarget(pair.first);
+    }
+  }
+}
+
+bool sendMagicPacket(const uint8_t mac[6], const WakeTarget &target) {
+  if (!magicPacketReady || memcmp(magicPacket + 6, mac, 6)) {
+    for (int i = 0; i < 16; i++) {
+      memcpy(magicPacket + 6 + i * 6, mac, 6);
+    }
+    magicPacketReady = true;
+  }
+
+  size_t size = MAGIC_PACKET_SIZE;
+  if (target.secureOn) {
+    memcpy(magicPacket + MAGIC_PACKET_SIZE, target.password, SECUREON_SIZE);
+    size += SECUREON_SIZE;
+  }
+
+  if (!UDP.beginPacket(target.address, target.port)) {
+    return false;
+  }
+  UDP.write(magicPacket, size);
+  return UDP.endPacket();
+}
@@ -19,4 +19,49 @@ void saveAuthentication();
 // Function to load authentication configuration from a JSON file
 void loadAuthentication();
 
+// Function to load schedule rules and time zone from a JSON file
+void loadSchedules();
+
+// Function to save schedule rules and time zone to a JSON file
+void saveSchedules();
+
+// Function to load Wake-on-LAN relay settings from a JSON file
+void loadRelayConfig();
+
+// Function to save Wake-on-LAN relay settings to a JSON file
+void saveRelayConfig();
+
+// Function to load UDP control settings from a JSON file
+void loadControlConfig();
+
+// Function to save UDP control settings to a JSON file
+void saveControlConfig();
+
+// Function to load MQTT settings from a JSON file
+void loadMqttConfig();
+
+// Function to save MQTT settings to a JSON file
+void saveMqttConfig();
+
+// Function to load power settings from a JSON file
+void loadPowerConfig();
+
+// Function to save power settings to a JSON file
+void savePowerConfig();
+
+// Function to load the last access point from a JSON file
+void loadStationCache();
+
+// Function to save the last access point to a JSON file
+void saveStationCache();
+
+// Function to get the database version, increased on every saved change
+uint32_t getDatabaseVersion();
+
+// Function to increase the database version of a change saved later
+void touchDatabase();
+
+// Function to get the ETag of the current database version
+String getDatabaseETag();
+
 #endif
@@ -1,5 +1,25 @@
 #include "memory.h"
 
+static uint32_t databaseVersion = 0;
+static uint32_t databaseEpoch = 0;  // Random per boot, the version restarts from 0
+
+uint32_t getDatabaseVersion() {
+  return databaseVersion;
+}
+
+void touchDatabase() {
+  databaseVersion++;
+}
+
+String getDatabaseETag() {
+  if (!databaseEpoch) {
+    databaseEpoch = ESP.random() | 1;
+  }
+  char etag[24];
+  snprintf_P(etag, sizeof(etag), PSTR("\"%08lx-%lu\""), (unsigned long)databaseEpoch, (unsigned long)databaseVersion);
+  return etag;
+}
+
 // Function to load hosts data from a JSON file
 void loadHostsData() {
   if (LittleFS.begin()) {
@@ -13,8 +33,16 @@ void loadHostsData() {
           Host host;
           host.name = v["name"].as<String>();
           host.mac = v["mac"].as<String>();
+          parseMACAddress(host.mac, host.macBytes);
           host.ip = v["ip"].as<String>();
           host.periodicPing = v["periodicPing"].as<long>();
+          for (JsonVariant tag : v["tags"].as<JsonArray>()) {
+            host.tags.push_back(tag.as<String>());
+          }
+          readWakeTarget(v["wake"], host.wake);
+          readWakePolicy(v["policy"], host.policy);
+          readProbeTarget(v["probe"], host.probe);
+          host.followIp = v["followIp"] | false;
           hosts[hosts.size()] = host;
         }
       }
@@ -26,6 +54,8 @@ void loadHostsData() {
 
 // Function to save hosts data to a JSON file
 void saveHostsData() {
+  TRACE_SPAN("flash write");
+  touchDatabase();
   if (LittleFS.begin()) {
     File file = LittleFS.open(hostsFile, "w");
     if (file) {
@@ -38,9 +68,28 @@ void saveHostsData() {
         obj["mac"] = host.mac;
         obj["ip"] = host.ip;
         obj["periodicPing"] = host.periodicPing;
+        if (!host.tags.empty()) {
+          JsonArray tags = obj.createNestedArray("tags");
+          for (const String& tag : host.tags) {
+            tags.add(tag);
+          }
+        }
+        if (!host.wake.isDefault()) {
+          writeWakeTarget(obj.createNestedObject("wake"), host.wake);
+        }
+        if (!host.policy.isDefault()) {
+          writeWakePolicy(obj.createNestedObject("policy"), host.policy);
+        }
+        if (!host.probe.isDefault()) {
+          writeProbeTarget(obj.createNestedObject("probe"), host.probe);
+        }
+        if (host.followIp) {
+          obj["followIp"] = true;
+        }
       }
       serializeJson(doc, file);
       file.close();
+      recordFlashWrite();
     }
     LittleFS.end();
   }
@@ -48,6 +97,8 @@ void saveHostsData() {
 
 // Function to save network configuration to a JSON file
 void saveNetworkConfig() {
+  TRACE_SPAN("flash write");
+  touchDatabase();
   if (LittleFS.begin()) {
     File file = LittleFS.open(networkConfigFile, "w");
     if (file) {
@@ -59,6 +110,7 @@ void saveNetworkConfig() {
       doc["dns"] = networkConfig.dns.toString();
       serializeJson(doc, file);
       file.close();
+      recordFlashWrite();
     }
     LittleFS.end();
   }
@@ -98,6 +150,8 @@ void loadNetworkConfig() {
 
 // Function to save authentication configuration to a JSON file
 void saveAuthentication() {
+  TRACE_SPAN("flash write");
+  touchDatabase();
   if (LittleFS.begin()) {
     File file = LittleFS.open(authenticationFile, "w");
     if (file) {
@@ -107,6 +161,7 @@ void saveAuthentication() {
       doc["password"] = authentication.password;
       serializeJson(doc, file);
       file.close();
+      recordFlashWrite();
     }
   }
   LittleFS.end();
@@ -133,3 +188,259 @@ void loadAuthentication() {
     LittleFS.end();
   }
 }
+
+// Function to save schedule rules and time zone to a JSON file
+void saveSchedules() {
+  TRACE_SPAN("flash write");
+  touchDatabase();
+  if (LittleFS.begin()) {
+    File file = LittleFS.open(schedulesFile, "w");
+    if (file) {
+      JsonDocument doc;
+      doc["timezone"] = scheduleConfig.timezone;
+      JsonArray rules = doc.createNestedArray("rules");
+      for (const auto& pair : scheduleConfig.rules) {
+        const Schedule& schedule = pair.second;
+        JsonObject obj = rules.createNestedObject();
+        obj["cron"] = schedule.cron;
+        if (schedule.mac.length()) {
+          obj["mac"] = schedule.mac;
+        } else {
+          obj["tag"] = schedule.tag;
+        }
+        obj["enabled"] = schedule.enabled;
+      }
+      serializeJson(doc, file);
+      file.close();
+      recordFlashWrite();
+    }
+    LittleFS.end();
+  }
+}
+
+// Function to load schedule rules and time zone from a JSON file
+void loadSchedules() {
+  if (LittleFS.begin()) {
+    File file = LittleFS.open(schedulesFile, "r");
+    if (file) {
+      JsonDocument doc;
+      DeserializationError error = deserializeJson(doc, file);
+      if (!error) {
+        scheduleConfig.timezone = doc["timezone"] | SCHEDULE_DEFAULT_TIMEZONE;
+        scheduleConfig.rules.clear();
+        for (JsonVariant v : doc["rules"].as<JsonArray>()) {
+          Schedule schedule;
+          schedule.cron = v["cron"].as<String>();
+          schedule.mac = v["mac"] | "";
+          if (v.containsKey("host")) {
+            // Files written before rules referred to hosts by MAC address
+            auto host = hosts.find(v["host"].as<int>());
+            if (host == hosts.end()) {
+              continue;
+            }
+            schedule.mac = host->second.mac;
+          }
+          parseMACAddress(schedule.mac, schedule.macBytes);
+          schedule.tag = v["tag"].as<String>();
+          schedule.enabled = v["enabled"] | true;
+          if (compileSchedule(schedule)) {
+            scheduleConfig.rules[scheduleConfig.rules.size()] = schedule;
+          }
+        }
+      }
+      file.close();
+    }
+    LittleFS.end();
+  }
+}
+
+// Function to save Wake-on-LAN relay settings to a JSON file
+void saveRelayConfig() {
+  TRACE_SPAN("flash write");
+  touchDatabase();
+  if (LittleFS.begin()) {
+    File file = LittleFS.open(relayConfigFile, "w");
+    if (file) {
+      JsonDocument doc;
+      doc["enable"] = relayConfig.enable;
+      doc["knownHostsOnly"] = relayConfig.knownHostsOnly;
+      doc["maxPps"] = relayConfig.maxPps;
+      serializeJson(doc, file);
+      file.close();
+      recordFlashWrite();
+    }
+    LittleFS.end();
+  }
+}
+
+// Function to load Wake-on-LAN relay settings from a JSON file
+void loadRelayConfig() {
+  if (LittleFS.begin()) {
+    File file = LittleFS.open(relayConfigFile, "r");
+    if (file) {
+      JsonDocument doc;
+      DeserializationError error = deserializeJson(doc, file);
+      if (!error) {
+        relayConfig.enable = doc["enable"] | false;
+        relayConfig.knownHostsOnly = doc["knownHostsOnly"] | true;
+        relayConfig.maxPps = doc["maxPps"] | RELAY_DEFAULT_MAX_PPS;
+      }
+      file.close();
+    }
+    LittleFS.end();
+  }
+}
+
+// Function to save UDP control settings to a JSON file
+void saveControlConfig() {
+  TRACE_SPAN("flash write");
+  touchDatabase();
+  if (LittleFS.begin()) {
+    File file = LittleFS.open(controlConfigFile, "w");
+    if (file) {
+      JsonDocument doc;
+      doc["enable"] = controlConfig.enable;
+      doc["port"] = controlConfig.port;
+      doc["key"] = controlConfig.key;
+      serializeJson(doc, file);
+      file.close();
+      recordFlashWrite();
+    }
+    LittleFS.end();
+  }
+}
+
+// Function to load UDP control settings from a JSON file
+void loadControlConfig() {
+  if (LittleFS.begin()) {
+    File file = LittleFS.open(controlConfigFile, "r");
+    if (file) {
+      JsonDocument doc;
+      DeserializationError error = deserializeJson(doc, file);
+      if (!error) {
+        controlConfig.enable = doc["enable"] | false;
+        controlConfig.port = doc["port"] | CONTROL_DEFAULT_PORT;
+        controlConfig.key = doc["key"] | "";
+      }
+      file.close();
+    }
+    LittleFS.end();
+  }
+}
+
+// Function to save MQTT settings to a JSON file
+void saveMqttConfig() {
+  TRACE_SPAN("flash write");
+  touchDatabase();
+  if (LittleFS.begin()) {
+    File file = LittleFS.open(mqttConfigFile, "w");
+    if (file) {
+      JsonDocument doc;
+      doc["enable"] = mqttConfig.enable;
+      doc["host"] = mqttConfig.host;
+      doc["port"] = mqttConfig.port;
+      doc["username"] = mqttConfig.username;
+      doc["password"] = mqttConfig.password;
+      doc["prefix"] = mqttConfig.prefix;
+      doc["keepAlive"] = mqttConfig.keepAlive;
+      serializeJson(doc, file);
+      file.close();
+      recordFlashWrite();
+    }
+    LittleFS.end();
+  }
+}
+
+// Function to load MQTT settings from a JSON file
+void loadMqttConfig() {
+  if (LittleFS.begin()) {
+    File file = LittleFS.open(mqttConfigFile, "r");
+    if (file) {
+      JsonDocument doc;
+      DeserializationError error = deserializeJson(doc, file);
+      if (!error) {
+        mqttConfig.enable = doc["enable"] | false;
+        mqttConfig.host = doc["host"] | "";
+        mqttConfig.port = doc["port"] | MQTT_DEFAULT_PORT;
+        mqttConfig.username = doc["username"] | "";
+        mqttConfig.password = doc["password"] | "";
+        mqttConfig.prefix = doc["prefix"] | MQTT_DEFAULT_PREFIX;
+        mqttConfig.keepAlive = doc["keepAlive"] | MQTT_DEFAULT_KEEP_ALIVE;
+      }
+      file.close();
+    }
+    LittleFS.end();
+  }
+}
+
+// Function to save power settings to a JSON file
+void savePowerConfig() {
+  TRACE_SPAN("flash write");
+  touchDatabase();
+  if (LittleFS.begin()) {
+    File file = LittleFS.open(powerConfigFile, "w");
+    if (file) {
+      JsonDocument doc;
+      doc["sleep"] = getSleepModeName(powerConfig.sleep);
+      serializeJson(doc, file);
+      file.close();
+      recordFlashWrite();
+    }
+    LittleFS.end();
+  }
+}
+
+// Function to load power settings from a JSON file
+void loadPowerConfig() {
+  if (LittleFS.begin()) {
+    File file = LittleFS.open(powerConfigFile, "r");
+    if (file) {
+      JsonDocument doc;
+      DeserializationError error = deserializeJson(doc, file);
+      if (!error) {
+        parseSleepMode(doc["sleep"] | "", powerConfig.sleep);
+      }
+      file.close();
+    }
+    LittleFS.end();
+  }
+}
+
+// Function to save the last access point to a JSON file
+void saveStationCache() {
+  TRACE_SPAN("flash write");
+  if (LittleFS.begin()) {
+    File file = LittleFS.open(stationCacheFile, "w");
+    if (file) {
+      JsonDocument doc;
+      char bssid[18];
+      const uint8_t *b = stationCache.bssid;
+      snprintf_P(bssid, sizeof(bssid), PSTR("%02X:%02X:%02X:%02X:%02X:%02X"), b[0], b[1], b[2], b[3], b[4], b[5]);
+      doc["ssid"] = stationCache.ssid;
+      doc["bssid"] = bssid;
+      doc["channel"] = stationCache.channel;
+      serializeJson(doc, file);
+      file.close();
+      recordFlashWrite();
+    }
+    LittleFS.end();
+  }
+}
+
+// Function to load the last access point from a JSON file
+void loadStationCache() {
+  if (LittleFS.begin()) {
+    File file = LittleFS.open(stationCacheFile, "r");
+    if (file) {
+      JsonDocument doc;
+      DeserializationError error = deserializeJson(doc, file);
+      if (!error && parseMACAddress(doc["bssid"] | "", stationCache.bssid)) {
+        String ssid = doc["ssid"] | "";
+        strncpy(stationCache.ssid, ssid.c_str(), sizeof(stationCache.ssid) - 1);
+        stationCache.channel = doc["channel"] | 0;
+      }
+      file.close();
+    }
+    LittleFS.end();
+  }
+}
@@ -0,0 +1,119 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#define METRICS_MAX_ROUTES 24
+#define METRICS_MAX_BUCKETS 12
+#define METRICS_BUFFER_SIZE 512
+
+/**
+ * @brief Buffered writer for chunked responses.
+ *
+ * Formatted text is collected in a small fixed buffer and sent to the current
+ * client as a chunk whenever it fills up, so large responses never need a
+ * String of their full size. The response headers must already be sent with
+ * `CONTENT_LENGTH_UNKNOWN`; the remaining text is flushed on destruction.
+ */
+class ChunkedWriter {
+public:
+  ~ChunkedWriter();
+
+  /**
+   * @brief Appends printf-style formatted text.
+   *
+   * @param format The format string, stored in flash (use `PSTR`).
+   */
+  void append(PGM_P format, ...);
+
+  /**
+   * @brief Sends the buffered text as a chunk.
+   */
+  void flush();
+
+private:
+  char buffer[METRICS_BUFFER_SIZE];
+  size_t length = 0;
+};
+
+/**
+ * @brief Wraps an API handler so its request count and latency are recorded.
+ *
+ * The returned handler runs the original one and observes its duration
+ * in the latency histogram of the given route.
+ *
+ * @param route The route label exposed in the metrics (usually the URI).
+ * @param handler The handler to instrument.
+ * @return The instrumented handler to register with the web server.
+ */
+ESP8266WebServer::THandlerFunction instrumentRoute(const char *route, ESP8266WebServer::THandlerFunction handler);
+
+/**
+ * @brief Registers the WiFi event handlers used by the metrics.
+ */
+void setupMetrics();
+
+/**
+ * @brief Records the duration of one `loop()` iteration.
+ *
+ * @param duration The iteration duration in microseconds.
+ */
+void recordLoopDuration(unsigned long duration);
+
+/**
+ * @brief Records a ping attempt to a host.
+ *
+ * @param id The index of the pinged host.
+ * @param success Whether the host answered.
+ * @param rtt The average round trip time in milliseconds (ignored on failure).
+ */
+void recordPing(int id, bool success, float rtt);
+
+/**
+ * @brief Records a magic packet send attempt.
+ *
+ * @param sent Whether the packet was sent.
+ */
+void recordMagicPacket(bool sent);
+
+/**
+ * @brief Returns the magic packets sent since boot.
+ */
+uint32_t getMagicPacketsSent();
+
+/**
+ * @brief Records the outcome of a verified wake of a host.
+ *
+ * @param id The index of the host.
+ * @param up Whether the host answered before the timeout.
+ * @param timeToUp The time from the wake request until the host answered in milliseconds (ignored if not up).
+ */
+void recordWakeVerify(int id, bool up, unsigned long timeToUp);
+
+/**
+ * @brief Returns the time the host needed to answer after its last verified wake.
+ *
+ * @param id The index of the host.
+ * @return The time in milliseconds, 0 if no verified wake succeeded yet.
+ */
+unsigned long getLastTimeToUp(int id);
+
+/**
+ * @brief Records a configuration or database write to flash.
+ */
+void recordFlashWrite();
+
+/**
+ * @brief Drops the per-host counters of a deleted host.
+ *
+ * @param id The index of the deleted host.
+ */
+void forgetHostMetrics(int id);
+
+/**
+ * @brief Streams all metrics in Prometheus text format to the current client.
+ *
+ * The response is sent with chunked transfer encoding through a small fixed
+ * buffer, so its size does not depend on free heap.
+ */
+void streamMetrics();
+
+#endif
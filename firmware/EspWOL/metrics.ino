@@ -0,0 +1,333 @@
+#include "metrics.h"
+#include <stdarg.h>
+
+// Histogram bucket upper bounds in microseconds
+static const uint32_t LOOP_BUCKETS[] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 50000, 100000, 500000 };
+static const uint32_t REQUEST_BUCKETS[] = { 1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000 };
+
+// Structure for a fixed-bucket histogram
+struct Histogram {
+  const uint32_t *bounds = nullptr;
+  uint8_t size = 0;
+  uint32_t buckets[METRICS_MAX_BUCKETS] = {};
+  uint32_t count = 0;
+  uint64_t sum = 0;
+};
+
+// Structure for per-route request metrics
+struct RouteMetrics {
+  const char *route;
+  uint32_t requests = 0;
+  Histogram latency;
+};
+
+// Structure for per-host ping metrics
+struct PingMetrics {
+  uint32_t attempts = 0;
+  uint32_t failures = 0;
+  float rttSum = 0;
+  float lastRtt = 0;
+};
+
+// Structure for per-host verified wake metrics
+struct WakeMetrics {
+  uint32_t verified = 0;
+  uint32_t timeouts = 0;
+  uint64_t timeToUpSum = 0;
+  uint32_t lastTimeToUp = 0;
+};
+
+static Histogram loopDuration;
+static RouteMetrics routeMetrics[METRICS_MAX_ROUTES];
+static uint8_t routeCount = 0;
+static std::map<int, PingMetrics> pingMetrics;
+static std::map<int, WakeMetrics> wakeMetrics;
+static uint32_t magicPacketsSent = 0;
+static uint32_t magicPacketFailures = 0;
+static uint32_t flashWrites = 0;
+static uint32_t wifiConnects = 0;
+static WiFiEventHandler wifiGotIPHandler;
+
+static void initHistogram(Histogram &histogram, const uint32_t *bounds, uint8_t size) {
+  histogram.bounds = bounds;
+  histogram.size = size;
+}
+
+static void observe(Histogram &histogram, uint32_t value) {
+  for (uint8_t i = 0; i < histogram.size; i++) {
+    if (value <= histogram.bounds[i]) {
+      histogram.buckets[i]++;
+      break;
+    }
+  }
+  histogram.count++;
+  histogram.sum += value;
+}
+
+ESP8266WebServer::THandlerFunction instrumentRoute(const char *route, ESP8266WebServer::THandlerFunction handler) {
+  if (routeCount >= METRICS_MAX_ROUTES) {
+    return handler;
+  }
+  RouteMetrics *metrics = &routeMetrics[routeCount++];
+  metrics->route = route;
+  initHistogram(metrics->latency, REQUEST_BUCKETS, sizeof(REQUEST_BUCKETS) / sizeof(REQUEST_BUCKETS[0]));
+  return [metrics, handler]() {
+    unsigned long start = micros();
+    handler();
+    metrics->requests++;
+    observe(metrics->latency, micros() - start);
+  };
+}
+
+void setupMetrics() {
+  initHistogram(loopDuration, LOOP_BUCKETS, sizeof(LOOP_BUCKETS) / sizeof(LOOP_BUCKETS[0]));
+  wifiGotIPHandler = WiFi.onStationModeGotIP([](const WiFiEventStationModeGotIP &) {
+    wifiConnects++;
+  });
+}
+
+void recordLoopDuration(unsigned long duration) {
+  observe(loopDuration, duration);
+}
+
+void recordPing(int id, bool success, float rtt) {
+  PingMetrics &metrics = pingMetrics[id];
+  metrics.attempts++;
+  if (success) {
+    metrics.rttSum += rtt;
+    metrics.lastRtt = rtt;
+  } else {
+    metrics.failures++;
+  }
+}
+
+void recordMagicPacket(bool sent) {
+  if (sent) {
+    magicPacketsSent++;
+  } else {
+    magicPacketFailures++;
+  }
+}
+
+uint32_t getMagicPacketsSent() {
+  return magicPacketsSent;
+}
+
+void recordWakeVerify(int id, bool up, unsigned long timeToUp) {
+  WakeMetrics &metrics = wakeMetrics[id];
+  if (up) {
+    metrics.verified++;
+    metrics.timeToUpSum += timeToUp;
+    metrics.lastTimeToUp = timeToUp;
+  } else {
+    metrics.timeouts++;
+  }
+}
+
+unsigned long getLastTimeToUp(int id) {
+  auto it = wakeMetrics.find(id);
+  return it != wakeMetrics.end() ? it->second.lastTimeToUp : 0;
+}
+
+void recordFlashWrite() {
+  flashWrites++;
+}
+
+void forgetHostMetrics(int id) {
+  pingMetrics.erase(id);
+  wakeMetrics.erase(id);
+}
+
+ChunkedWriter::~ChunkedWriter() {
+  flush();
+}
+
+void ChunkedWriter::append(PGM_P format, ...) {
+  for (int attempt = 0; attempt < 2; attempt++) {
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf_P(buffer + length, sizeof(buffer) - length, format, args);
+    va_end(args);
+    if (written >= 0 && length + written < sizeof(buffer)) {
+      length += written;
+      return;
+    }
+    // Line does not fit: send what we have and retry with an empty buffer
+    flush();
+  }
+}
+
+void ChunkedWriter::flush() {
+  if (length) {
+    server.sendContent(buffer, length);
+    length = 0;
+  }
+}
+
+// Formats microseconds as seconds, as Prometheus expects
+static const char *formatSeconds(char *out, size_t size, uint64_t value) {
+  snprintf_P(out, size, PSTR("%lu.%06lu"), (unsigned long)(value / 1000000), (unsigned long)(value % 1000000));
+  return out;
+}
+
+// Escapes a label value (backslash, double quote and line feed)
+static const char *escapeLabel(char *out, size_t size, const String &value) {
+  size_t j = 0;
+  for (size_t i = 0; i < value.length() && j + 2 < size; i++) {
+    char c = value[i];
+    if (c == '\\' || c == '"') {
+      out[j++] = '\\';
+      out[j++] = c;
+    } else if (c == '\n') {
+      out[j++] = '\\';
+      out[j++] = 'n';
+    } else {
+      out[j++] = c;
+    }
+  }
+  out[j] = '\0';
+  return out;
+}
+
+// Formats the labels identifying a host
+static const char *hostLabels(char *out, size_t size, int id) {
+  char name[64];
+  auto host = hosts.find(id);
+  escapeLabel(name, sizeof(name), host != hosts.end() ? host->second.name : String());
+  snprintf_P(out, size, PSTR("id=\"%d\",host=\"%s\""), id, name);
+  return out;
+}
+
+static void writeHistogram(ChunkedWriter &writer, const char *name, const char *labels, const Histogram &histogram) {
+  char le[24];
+  char sum[24];
+  const char *separator = labels[0] ? "," : "";
+  const char *openBrace = labels[0] ? "{" : "";
+  const char *closeBrace = labels[0] ? "}" : "";
+  uint32_t cumulative = 0;
+  for (uint8_t i = 0; i < histogram.size; i++) {
+    cumulative += histogram.buckets[i];
+    writer.append(PSTR("%s_bucket{%s%sle=\"%s\"} %lu\n"), name, labels, separator, formatSeconds(le, sizeof(le), histogram.bounds[i]), (unsigned long)cumulative);
+  }
+  writer.append(PSTR("%s_bucket{%s%sle=\"+Inf\"} %lu\n"), name, labels, separator, (unsigned long)histogram.count);
+  writer.append(PSTR("%s_sum%s%s%s %s\n"), name, openBrace, labels, closeBrace, formatSeconds(sum, sizeof(sum), histogram.sum));
+  writer.append(PSTR("%s_count%s%s%s %lu\n"), name, openBrace, labels, closeBrace, (unsigned long)histogram.count);
+}
+
+void streamMetrics() {
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/plain; version=0.0.4; charset=utf-8", "");
+
+  {
+    ChunkedWriter writer;
+    char labels[96];
+
+    writer.append(PSTR("# HELP espwol_build_info Firmware version.\n# TYPE espwol_build_info gauge\nespwol_build_info{version=\"%s\"} 1\n"), VERSION);
+    writer.append(PSTR("# HELP espwol_uptime_seconds Time since boot.\n# TYPE espwol_uptime_seconds gauge\nespwol_uptime_seconds %lu\n"), millis() / 1000);
+
+    writer.append(PSTR("# HELP espwol_loop_duration_seconds Duration of loop() iterations.\n# TYPE espwol_loop_duration_seconds histogram\n"));
+    writeHistogram(writer, "espwol_loop_duration_seconds", "", loopDuration);
+    const IdleStats &idle = getIdleStats();
+    writer.append(PSTR("# HELP espwol_loop_duty_cycle Share of the time spent running loop(), over the last 10 seconds.\n# TYPE espwol_loop_duty_cycle gauge\nespwol_loop_duty_cycle %.4f\n"), idle.dutyCycle);
+    writer.append(PSTR("# HELP espwol_loop_wakeups_per_second Iterations of loop() per second, over the last 10 seconds.\n# TYPE espwol_loop_wakeups_per_second gauge\nespwol_loop_wakeups_per_second %.1f\n"), idle.wakeupsPerSecond);
+
+    writer.append(PSTR("# HELP espwol_http_requests_total Handled API requests.\n# TYPE espwol_http_requests_total counter\n"));
+    for (uint8_t i = 0; i < routeCount; i++) {
+      writer.append(PSTR("espwol_http_requests_total{route=\"%s\"} %lu\n"), routeMetrics[i].route, (unsigned long)routeMetrics[i].requests);
+    }
+    writer.append(PSTR("# HELP espwol_http_request_duration_seconds API request latency.\n# TYPE espwol_http_request_duration_seconds histogram\n"));
+    for (uint8_t i = 0; i < routeCount; i++) {
+      snprintf_P(labels, sizeof(labels), PSTR("route=\"%s\""), routeMetrics[i].route);
+      writeHistogram(writer, "espwol_http_request_duration_seconds", labels, routeMetrics[i].latency);
+    }
+
+    writer.append(PSTR("# HELP espwol_ping_attempts_total Ping attempts per host.\n# TYPE espwol_ping_attempts_total counter\n"));
+    for (const auto &[id, metrics] : pingMetrics) {
+      writer.append(PSTR("espwol_ping_attempts_total{%s} %lu\n"), hostLabels(labels, sizeof(labels), id), (unsigned long)metrics.attempts);
+    }
+    writer.append(PSTR("# HELP espwol_ping_failures_total Failed pings per host.\n# TYPE espwol_ping_failures_total counter\n"));
+    for (const auto &[id, metrics] : pingMetrics) {
+      writer.append(PSTR("espwol_ping_failures_total{%s} %lu\n"), hostLabels(labels, sizeof(labels), id), (unsigned long)metrics.failures);
+    }
+    writer.append(PSTR("# HELP espwol_ping_rtt_seconds Average round trip time of successful pings.\n# TYPE espwol_ping_rtt_seconds summary\n"));
+    for (const auto &[id, metrics] : pingMetrics) {
+      hostLabels(labels, sizeof(labels), id);
+      writer.append(PSTR("espwol_ping_rtt_seconds_sum{%s} %.3f\n"), labels, metrics.rttSum / 1000);
+      writer.append(PSTR("espwol_ping_rtt_seconds_count{%s} %lu\n"), labels, (unsigned long)(metrics.attempts - metrics.failures));
+    }
+    writer.append(PSTR("# HELP espwol_ping_last_rtt_seconds Round trip time of the last successful ping.\n# TYPE espwol_ping_last_rtt_seconds gauge\n"));
+    for (const auto &[id, metrics] : pingMetrics) {
+      writer.append(PSTR("espwol_ping_last_rtt_seconds{%s} %.3f\n"), hostLabels(labels, sizeof(labels), id), metrics.lastRtt / 1000);
+    }
+
+    writer.append(PSTR("# HELP espwol_wake_verified_total Verified wakes where the host came up, per host.\n# TYPE espwol_wake_verified_total counter\n"));
+    for (const auto &[id, metrics] : wakeMetrics) {
+      writer.append(PSTR("espwol_wake_verified_total{%s} %lu\n"), hostLabels(labels, sizeof(labels), id), (unsigned long)metrics.verified);
+    }
+    writer.append(PSTR("# HELP espwol_wake_timeouts_total Verified wakes where the host did not come up in time, per host.\n# TYPE espwol_wake_timeouts_total counter\n"));
+    for (const auto &[id, metrics] : wakeMetrics) {
+      writer.append(PSTR("espwol_wake_timeouts_total{%s} %lu\n"), hostLabels(labels, sizeof(labels), id), (unsigned long)metrics.timeouts);
+    }
+    writer.append(PSTR("# HELP espwol_wake_time_to_up_seconds Time from the wake request until the host answered.\n# TYPE espwol_wake_time_to_up_seconds summary\n"));
+    for (const auto &[id, metrics] : wakeMetrics) {
+      hostLabels(labels, sizeof(labels), id);
+      writer.append(PSTR("espwol_wake_time_to_up_seconds_sum{%s} %.3f\n"), labels, metrics.timeToUpSum / 1000.0);
+      writer.append(PSTR("espwol_wake_time_to_up_seconds_count{%s} %lu\n"), labels, (unsigned long)metrics.verified);
+    }
+    writer.append(PSTR("# HELP espwol_wake_last_time_to_up_seconds Time until the host answered after its last verified wake.\n# TYPE espwol_wake_last_time_to_up_seconds gauge\n"));
+    for (const auto &[id, metrics] : wakeMetrics) {
+      writer.append(PSTR("espwol_wake_last_time_to_up_seconds{%s} %.3f\n"), hostLabels(labels, sizeof(labels), id), metrics.lastTimeToUp / 1000.0);
+    }
+
+    writer.append(PSTR("# HELP espwol_magic_packets_sent_total Magic packets sent.\n# TYPE espwol_magic_packets_sent_total counter\nespwol_magic_packets_sent_total %lu\n"), (unsigned long)magicPacketsSent);
+    writer.append(PSTR("# HELP espwol_magic_packet_failures_total Magic packets that failed to send.\n# TYPE espwol_magic_packet_failures_total counter\nespwol_magic_packet_failures_total %lu\n"), (unsigned long)magicPacketFailures);
+
+#if ENABLE_WOL_RELAY == 1
+    const RelayStats &relay = getRelayStats();
+    writer.append(PSTR("# HELP espwol_relay_packets_total Datagrams received by the Wake-on-LAN relay, by outcome.\n# TYPE espwol_relay_packets_total counter\n"));
+    writer.append(PSTR("espwol_relay_packets_total{result=\"relayed\"} %lu\n"), (unsigned long)relay.relayed);
+    writer.append(PSTR("espwol_relay_packets_total{result=\"invalid\"} %lu\n"), (unsigned long)relay.invalid);
+    writer.append(PSTR("espwol_relay_packets_total{result=\"unknown\"} %lu\n"), (unsigned long)relay.unknown);
+    writer.append(PSTR("espwol_relay_packets_total{result=\"local\"} %lu\n"), (unsigned long)relay.local);
+    writer.append(PSTR("espwol_relay_packets_total{result=\"limited\"} %lu\n"), (unsigned long)relay.limited);
+    writer.append(PSTR("espwol_relay_packets_total{result=\"failed\"} %lu\n"), (unsigned long)relay.failed);
+#endif
+
+#if ENABLE_UDP_CONTROL == 1
+    const ControlStats &control = getControlStats();
+    writer.append(PSTR("# HELP espwol_control_packets_total Datagrams received on the UDP control port, by outcome.\n# TYPE espwol_control_packets_total counter\n"));
+    writer.append(PSTR("espwol_control_packets_total{result=\"handled\"} %lu\n"), (unsigned long)control.handled);
+    writer.append(PSTR("espwol_control_packets_total{result=\"invalid\"} %lu\n"), (unsigned long)control.invalid);
+    writer.append(PSTR("espwol_control_packets_total{result=\"unauthenticated\"} %lu\n"), (unsigned long)control.unauthenticated);
+    writer.append(PSTR("espwol_control_packets_total{result=\"stale\"} %lu\n"), (unsigned long)control.stale);
+    writer.append(PSTR("espwol_control_packets_total{result=\"replayed\"} %lu\n"), (unsigned long)control.replayed);
+#endif
+
+#if ENABLE_MQTT == 1
+    const MqttStats &mqtt = getMqttStats();
+    writer.append(PSTR("# HELP espwol_mqtt_connected Whether the MQTT client is connected to the broker.\n# TYPE espwol_mqtt_connected gauge\nespwol_mqtt_connected %d\n"), getMqttState() == MqttState::Connected);
+    writer.append(PSTR("# HELP espwol_mqtt_events_total MQTT client events, by type.\n# TYPE espwol_mqtt_events_total counter\n"));
+    writer.append(PSTR("espwol_mqtt_events_total{event=\"connect\"} %lu\n"), (unsigned long)mqtt.connects);
+    writer.append(PSTR("espwol_mqtt_events_total{event=\"failure\"} %lu\n"), (unsigned long)mqtt.failures);
+    writer.append(PSTR("espwol_mqtt_events_total{event=\"publish\"} %lu\n"), (unsigned long)mqtt.published);
+    writer.append(PSTR("espwol_mqtt_events_total{event=\"command\"} %lu\n"), (unsigned long)mqtt.commands);
+    writer.append(PSTR("espwol_mqtt_events_total{event=\"dropped\"} %lu\n"), (unsigned long)mqtt.dropped);
+#endif
+
+    writer.append(PSTR("# HELP espwol_heap_free_bytes Free heap.\n# TYPE espwol_heap_free_bytes gauge\nespwol_heap_free_bytes %lu\n"), (unsigned long)ESP.getFreeHeap());
+    writer.append(PSTR("# HELP espwol_heap_fragmentation_ratio Heap fragmentation.\n# TYPE espwol_heap_fragmentation_ratio gauge\nespwol_heap_fragmentation_ratio %.2f\n"), ESP.getHeapFragmentation() / 100.0);
+    writer.append(PSTR("# HELP espwol_heap_max_free_block_bytes Largest allocatable block.\n# TYPE espwol_heap_max_free_block_bytes gauge\nespwol_heap_max_free_block_bytes %lu\n"), (unsigned long)ESP.getMaxFreeBlockSize());
+
+    writer.append(PSTR("# HELP espwol_wifi_rssi_dbm WiFi signal strength.\n# TYPE espwol_wifi_rssi_dbm gauge\nespwol_wifi_rssi_dbm %d\n"), WiFi.RSSI());
+    writer.append(PSTR("# HELP espwol_wifi_reconnects_total WiFi reconnections since boot.\n# TYPE espwol_wifi_reconnects_total counter\nespwol_wifi_reconnects_total %lu\n"), (unsigned long)(wifiConnects ? wifiConnects - 1 : 0));
+    const StationStats &station = getStationStats();
+    writer.append(PSTR("# HELP espwol_wifi_connect_seconds Time from boot to the first WiFi connection.\n# TYPE espwol_wifi_connect_seconds gauge\nespwol_wifi_connect_seconds %.3f\n"), station.connectTime / 1000.0);
+    writer.append(PSTR("# HELP espwol_boot_ready_seconds Time from boot to the end of setup.\n# TYPE espwol_boot_ready_seconds gauge\nespwol_boot_ready_seconds %.3f\n"), station.readyTime / 1000.0);
+    writer.append(PSTR("# HELP espwol_wifi_boots_total Boots since power on, by how the WiFi connected: with the cached access point or with WiFiManager.\n# TYPE espwol_wifi_boots_total counter\n"));
+    writer.append(PSTR("espwol_wifi_boots_total{connect=\"cached\"} %lu\nespwol_wifi_boots_total{connect=\"fallback\"} %lu\n"), (unsigned long)station.fastConnects, (unsigned long)station.fallbacks);
+
+    writer.append(PSTR("# HELP espwol_flash_writes_total Configuration and database writes to flash.\n# TYPE espwol_flash_writes_total counter\nespwol_flash_writes_total %lu\n"), (unsigned long)flashWrites);
+  }
+
+  server.sendContent("");
+}
@@ -0,0 +1,67 @@
+#ifndef MQTT_H
+#define MQTT_H
+
+#define MQTT_DEFAULT_PORT 1883
+#define MQTT_DEFAULT_PREFIX "espwol"
+#define MQTT_DEFAULT_KEEP_ALIVE 60  // Seconds
+#define MQTT_MIN_KEEP_ALIVE 10
+#define MQTT_MAX_KEEP_ALIVE 3600
+#define MQTT_MAX_PREFIX 64
+#define MQTT_MAX_CREDENTIAL 64      // Longest username or password
+#define MQTT_BUFFER_SIZE 512        // Largest packet sent or received
+#define MQTT_CONNECT_TIMEOUT 10000  // Milliseconds from the TCP connection to the CONNACK
+#define MQTT_MIN_BACKOFF 1000       // Milliseconds before the first reconnection, doubled after each failure
+#define MQTT_MAX_BACKOFF 60000
+#define MQTT_SCAN_INTERVAL 1000     // Milliseconds between two comparisons of the host states with the published ones
+#define MQTT_EVENTS_INTERVAL 10000  // Milliseconds between two publications of the event counters
+#define MQTT_MAX_PINGS 8            // Ping commands waiting for a probe
+
+// States of the connection to the broker
+enum class MqttState : uint8_t {
+  Disabled,
+  Waiting,     // Backoff before the next connection
+  Resolving,   // Broker hostname not resolved yet
+  Connecting,  // TCP connection or CONNACK pending
+  Connected
+};
+
+#if ENABLE_MQTT == 1
+
+// Counters of the MQTT client since boot
+struct MqttStats {
+  uint32_t connects = 0;   // Accepted by the broker
+  uint32_t failures = 0;   // Connections refused, lost or timed out
+  uint32_t published = 0;
+  uint32_t commands = 0;   // Wake and ping commands received
+  uint32_t retained = 0;   // Retained commands ignored
+  uint32_t dropped = 0;    // Publications skipped while the send buffer was full
+};
+
+/**
+ * @brief Applies the MQTT settings: drops the connection, which is opened again by `handleMqtt()`.
+ */
+void setupMqtt();
+
+/**
+ * @brief Runs the MQTT client. Called from `loop()`.
+ *
+ * Never blocks: the TCP connection is opened with the raw lwIP API and its
+ * data is buffered by the receive callback, so this only parses what was
+ * received, sends the keepalive when due and publishes the host states that
+ * changed. A lost connection is opened again with an exponential backoff.
+ */
+void handleMqtt();
+
+/**
+ * @brief Returns the state of the connection to the broker.
+ */
+MqttState getMqttState();
+
+/**
+ * @brief Returns the counters of the MQTT client since boot.
+ */
+const MqttStats &getMqttStats();
+
+#endif
+
+#endif
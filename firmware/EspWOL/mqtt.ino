@@ -0,0 +1,530 @@
+#include "mqtt.h"
+
+#if ENABLE_MQTT == 1
+
+#include <lwip/tcp.h>
+
+#define MQTT_CONNECT 0x10
+#define MQTT_CONNACK 0x20
+#define MQTT_PUBLISH 0x30
+#define MQTT_RETAIN 0x01  // Flag of a PUBLISH
+#define MQTT_SUBSCRIBE 0x82
+#define MQTT_PINGREQ 0xC0
+#define MQTT_PINGRESP 0xD0
+#define MQTT_DISCONNECT 0xE0
+#define MQTT_HEADER_SIZE 3  // Fixed header room: type and a remaining length of up to 2 bytes
+#define MQTT_MAX_TOPIC 128  // Longest command topic read
+
+// Structure for a ping command waiting for its probe
+struct MqttPing {
+  uint8_t mac[6];
+  int8_t probe = -1;
+};
+
+static struct tcp_pcb *mqttPcb = nullptr;
+static MqttState mqttState = MqttState::Disabled;
+static MqttStats mqttStats;
+static uint8_t mqttRx[MQTT_BUFFER_SIZE];
+static size_t mqttRxLength = 0;
+static size_t mqttRxSkip = 0;           // Bytes still to drop of a packet larger than the buffer
+static bool mqttRxOverflow = false;
+static bool mqttClosed = false;         // Set by the callbacks, the connection is dropped by handleMqtt()
+static uint8_t mqttTx[MQTT_BUFFER_SIZE];
+static unsigned long mqttStateSince = 0;
+static unsigned long mqttNextConnectAt = 0;
+static unsigned long mqttBackoff = MQTT_MIN_BACKOFF;
+static unsigned long mqttSentAt = 0;
+static unsigned long mqttReceivedAt = 0;
+static unsigned long mqttPingSentAt = 0;
+static bool mqttPingPending = false;
+static unsigned long mqttScannedAt = 0;
+static unsigned long mqttEventsAt = 0;
+static char mqttEvents[128] = "";        // Last published event counters
+static std::map<uint64_t, int8_t> mqttStates;  // Published state of the hosts, by MAC key
+static std::vector<MqttPing> mqttPings;
+static uint32_t mqttUps = 0;
+static uint32_t mqttDowns = 0;
+
+MqttState getMqttState() {
+  return mqttState;
+}
+
+const MqttStats &getMqttStats() {
+  return mqttStats;
+}
+
+static String mqttHostTopic(uint64_t key, const __FlashStringHelper *command) {
+  char mac[13];
+  snprintf_P(mac, sizeof(mac), PSTR("%04X%08lX"), (unsigned)(key >> 32), (unsigned long)(key & 0xFFFFFFFF));
+  return mqttConfig.prefix + F("/hosts/") + mac + command;
+}
+
+static size_t writeMqttString(uint8_t *buffer, size_t offset, const char *text, size_t length) {
+  buffer[offset] = length >> 8;
+  buffer[offset + 1] = length & 0xFF;
+  memcpy(buffer + offset + 2, text, length);
+  return offset + 2 + length;
+}
+
+// Sends the packet whose body was written at mqttTx + MQTT_HEADER_SIZE, false if it does not fit the send buffer
+static bool sendMqttPacket(uint8_t type, size_t length) {
+  if (!mqttPcb) {
+    return false;
+  }
+  uint8_t *start = mqttTx + MQTT_HEADER_SIZE;
+  if (length >= 128) {
+    *--start = length >> 7;
+    *--start = (length & 0x7F) | 0x80;
+  } else {
+    *--start = length;
+  }
+  *--start = type;
+  size_t size = mqttTx + MQTT_HEADER_SIZE + length - start;
+  if (tcp_sndbuf(mqttPcb) < size || tcp_write(mqttPcb, start, size, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+    return false;
+  }
+  tcp_output(mqttPcb);
+  mqttSentAt = millis();
+  return true;
+}
+
+static bool publishMqtt(const String &topic, const char *payload, bool retain) {
+  size_t size = strlen(payload);
+  if (2 + topic.length() + size > MQTT_BUFFER_SIZE - MQTT_HEADER_SIZE) {
+    return false;
+  }
+  uint8_t *body = mqttTx + MQTT_HEADER_SIZE;
+  size_t length = writeMqttString(body, 0, topic.c_str(), topic.length());
+  memcpy(body + length, payload, size);
+  if (!sendMqttPacket(MQTT_PUBLISH | (retain ? MQTT_RETAIN : 0x00), length + size)) {
+    mqttStats.dropped++;
+    return false;
+  }
+  mqttStats.published++;
+  return true;
+}
+
+static void sendMqttConnect() {
+  String clientId = String(F("espwol-")) + String(ESP.getChipId(), HEX);
+  String willTopic = mqttConfig.prefix + F("/status");
+  bool username = !mqttConfig.username.isEmpty();
+  bool password = username && !mqttConfig.password.isEmpty();
+
+  uint8_t *body = mqttTx + MQTT_HEADER_SIZE;
+  size_t length = writeMqttString(body, 0, "MQTT", 4);
+  body[length++] = 4;  // MQTT 3.1.1
+  body[length++] = 0x02 | 0x04 | 0x20 | (username ? 0x80 : 0x00) | (password ? 0x40 : 0x00);  // Clean session, retained will
+  body[length++] = mqttConfig.keepAlive >> 8;
+  body[length++] = mqttConfig.keepAlive & 0xFF;
+  length = writeMqttString(body, length, clientId.c_str(), clientId.length());
+  length = writeMqttString(body, length, willTopic.c_str(), willTopic.length());
+  length = writeMqttString(body, length, "offline", 7);
+  if (username) {
+    length = writeMqttString(body, length, mqttConfig.username.c_str(), mqttConfig.username.length());
+  }
+  if (password) {
+    length = writeMqttString(body, length, mqttConfig.password.c_str(), mqttConfig.password.length());
+  }
+  sendMqttPacket(MQTT_CONNECT, length);
+}
+
+static void sendMqttSubscribe() {
+  static const char *const COMMANDS[] = { "/hosts/+/wake", "/hosts/+/ping", "/tags/+/wake" };
+  uint8_t *body = mqttTx + MQTT_HEADER_SIZE;
+  body[0] = 0;
+  body[1] = 1;  // Packet identifier
+  size_t length = 2;
+  for (const char *command : COMMANDS) {
+    String filter = mqttConfig.prefix + command;
+    length = writeMqttString(body, length, filter.c_str(), filter.length());
+    body[length++] = 0;  // QoS 0
+  }
+  sendMqttPacket(MQTT_SUBSCRIBE, length);
+}
+
+// Runs in the lwIP context: the data is only buffered, it is parsed by handleMqtt()
+static err_t onMqttReceive(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err) {
+  if (!p) {
+    mqttClosed = true;  // Closed by the broker
+    wakeLoop();
+    return ERR_OK;
+  }
+  size_t skipped = std::min<size_t>(mqttRxSkip, p->tot_len);
+  size_t length = p->tot_len - skipped;
+  mqttRxSkip -= skipped;
+  if (mqttRxLength + length > MQTT_BUFFER_SIZE) {
+    mqttRxOverflow = true;
+  } else {
+    pbuf_copy_partial(p, mqttRx + mqttRxLength, length, skipped);
+    mqttRxLength += length;
+  }
+  mqttReceivedAt = millis();
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  wakeLoop();
+  return ERR_OK;
+}
+
+static void onMqttError(void *arg, err_t err) {
+  mqttPcb = nullptr;  // Already freed by lwIP
+  mqttClosed = true;
+  wakeLoop();
+}
+
+static err_t onMqttConnected(void *arg, struct tcp_pcb *pcb, err_t err) {
+  tcp_nagle_disable(pcb);  // Small packets, sent as soon as they are written
+  sendMqttConnect();
+  return ERR_OK;
+}
+
+static void closeMqtt(bool failed) {
+  if (mqttPcb) {
+    tcp_arg(mqttPcb, nullptr);
+    tcp_recv(mqttPcb, nullptr);
+    tcp_err(mqttPcb, nullptr);
+    if (tcp_close(mqttPcb) != ERR_OK) {
+      tcp_abort(mqttPcb);
+    }
+    mqttPcb = nullptr;
+  }
+  mqttRxLength = 0;
+  mqttRxSkip = 0;
+  mqttRxOverflow = false;
+  mqttClosed = false;
+  mqttPingPending = false;
+  if (failed) {
+    mqttStats.failures++;
+    mqttNextConnectAt = millis() + mqttBackoff;
+    mqttBackoff = std::min<unsigned long>(mqttBackoff * 2, MQTT_MAX_BACKOFF);
+  }
+  mqttState = mqttConfig.enable ? MqttState::Waiting : MqttState::Disabled;
+  mqttStateSince = millis();
+}
+
+static void openMqtt(const IPAddress &ip) {
+  struct tcp_pcb *pcb = tcp_new();
+  if (!pcb) {
+    closeMqtt(true);
+    return;
+  }
+  tcp_recv(pcb, onMqttReceive);
+  ip4_addr_t ip4;
+  ip4.addr = ip;
+  ip_addr_t address;
+  ip_addr_copy_from_ip4(address, ip4);
+  if (tcp_connect(pcb, &address, mqttConfig.port, onMqttConnected) != ERR_OK) {
+    tcp_recv(pcb, nullptr);
+    tcp_abort(pcb);
+    closeMqtt(true);
+    return;
+  }
+  tcp_err(pcb, onMqttError);
+  mqttPcb = pcb;
+  mqttState = MqttState::Connecting;
+  mqttStateSince = mqttSentAt = mqttReceivedAt = millis();
+}
+
+static void onMqttConnack(const uint8_t *data, size_t length) {
+  if (mqttState != MqttState::Connecting || length < 2 || data[1] != 0) {
+    mqttClosed = true;  // Refused: protocol, client identifier, credentials...
+    return;
+  }
+  mqttState = MqttState::Connected;
+  mqttStateSince = millis();
+  mqttBackoff = MQTT_MIN_BACKOFF;
+  mqttStats.connects++;
+  mqttStates.clear();  // Everything is published again, the broker may have lost the retained states
+  mqttEvents[0] = '\0';
+  mqttScannedAt = mqttEventsAt = mqttStateSince - MQTT_EVENTS_INTERVAL;
+  sendMqttSubscribe();
+  publishMqtt(mqttConfig.prefix + F("/status"), "online", true);
+}
+
+static bool parseTopicMAC(const String &text, uint8_t mac[6]) {
+  if (text.length() != 12) {
+    return false;
+  }
+  for (uint8_t i = 0; i < 6; i++) {
+    char byte[3] = { text[i * 2], text[i * 2 + 1], '\0' };
+    char *end;
+    mac[i] = strtoul(byte, &end, 16);
+    if (*end) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Topics: {prefix}/hosts/{MAC}/wake, {prefix}/hosts/{MAC}/ping and {prefix}/tags/{tag}/wake, any payload
+static void onMqttCommand(const String &topic) {
+  int slash = topic.lastIndexOf('/');
+  int start = topic.lastIndexOf('/', slash - 1);
+  if (start <= 0 || !topic.startsWith(mqttConfig.prefix + '/')) {
+    return;
+  }
+  String kind = topic.substring(mqttConfig.prefix.length() + 1, start);
+  String target = topic.substring(start + 1, slash);
+  String command = topic.substring(slash + 1);
+  mqttStats.commands++;
+
+  uint8_t mac[6];
+  if (kind == F("hosts") && parseTopicMAC(target, mac)) {
+    int id = findHostByMAC(mac);
+    if (id < 0) {
+      return;
+    }
+    if (command == F("wake")) {
+      recordMagicPacket(sendMagicPacket(hosts[id].macBytes, hosts[id].wake));
+    } else if (command == F("ping") && mqttPings.size() < MQTT_MAX_PINGS) {
+      for (const MqttPing &ping : mqttPings) {
+        if (!memcmp(ping.mac, mac, 6)) {
+          return;
+        }
+      }
+      MqttPing ping;
+      memcpy(ping.mac, mac, 6);
+      mqttPings.push_back(ping);
+    }
+  } else if (kind == F("tags") && command == F("wake")) {
+    auto it = tagIndex.find(target);
+    if (it != tagIndex.end()) {
+      queueWakeJob(it->second, 1, 0, WAKE_DEFAULT_MAX_PPS);
+    }
+  }
+}
+
+static void onMqttPublish(uint8_t flags, const uint8_t *data, size_t length) {
+  if (length < 2) {
+    return;
+  }
+  size_t size = data[0] << 8 | data[1];
+  if (2 + size > length || size > MQTT_MAX_TOPIC) {
+    return;
+  }
+  // The broker sends retained messages again with each subscription, so they would repeat the command on every reconnect
+  if (flags & MQTT_RETAIN) {
+    mqttStats.retained++;
+    return;
+  }
+  // The payload is not used; commands are only subscribed at QoS 0, so there is nothing to acknowledge
+  char topic[MQTT_MAX_TOPIC + 1];
+  memcpy(topic, data + 2, size);
+  topic[size] = '\0';
+  onMqttCommand(String(topic));
+}
+
+static void readMqttPackets() {
+  size_t offset = 0;
+  while (offset + 2 <= mqttRxLength) {
+    // Remaining length: up to 4 bytes of 7 bits
+    size_t length = 0;
+    size_t header = 1;
+    bool complete = false;
+    for (uint8_t shift = 0; header < 5 && offset + header < mqttRxLength; header++, shift += 7) {
+      uint8_t byte = mqttRx[offset + header];
+      length |= (size_t)(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) {
+        header++;
+        complete = true;
+        break;
+      }
+    }
+    if (!complete) {
+      mqttRxOverflow = header >= 5;
+      break;
+    }
+    if (header + length > MQTT_BUFFER_SIZE) {
+      // Too large to be a command, dropped as it arrives
+      mqttRxSkip = offset + header + length - mqttRxLength;
+      offset = mqttRxLength;
+      break;
+    }
+    if (offset + header + length > mqttRxLength) {
+      break;
+    }
+
+    uint8_t type = mqttRx[offset];
+    const uint8_t *data = mqttRx + offset + header;
+    if ((type & 0xF0) == MQTT_CONNACK) {
+      onMqttConnack(data, length);
+    } else if ((type & 0xF0) == MQTT_PUBLISH) {
+      onMqttPublish(type & 0x0F, data, length);
+    } else if (type == MQTT_PINGRESP) {
+      mqttPingPending = false;
+    }
+    offset += header + length;
+  }
+  memmove(mqttRx, mqttRx + offset, mqttRxLength - offset);
+  mqttRxLength -= offset;
+}
+
+static void setPingedState(int id, bool up) {
+  checks[id].up = up;
+  lastPings[id] = millis();
+  mqttStates.erase(macKey(hosts[id].macBytes));  // Published again, even if unchanged, as the answer to the command
+}
+
+static void runMqttPings() {
+  if (!mqttPings.empty()) {
+    limitSleep(0);
+  }
+  for (auto it = mqttPings.begin(); it != mqttPings.end();) {
+    int id = findHostByMAC(it->mac);
+    if (id < 0) {
+      clearProbe(it->probe);
+      it = mqttPings.erase(it);
+      continue;
+    }
+    const Host &host = hosts[id];
+    if (it->probe < 0) {
+      IPAddress ip;
+      ResolveState resolved = resolveHost(host.ip, ip);
+      if (resolved == ResolveState::Resolved) {
+        it->probe = startProbe(ip, host.probe, host.policy.timeout);  // -1 while all probes are in use, tried again next loop
+      }
+      if (resolved != ResolveState::Failed) {
+        ++it;
+        continue;
+      }
+      recordPing(id, false, 0);
+      setPingedState(id, false);
+    } else {
+      ProbeState state = getProbeState(it->probe);
+      if (state == ProbeState::Pending) {
+        ++it;
+        continue;
+      }
+      bool alive = state == ProbeState::Up;
+      recordPing(id, alive, getProbeTime(it->probe));
+      clearProbe(it->probe);
+      setPingedState(id, alive);
+    }
+    it = mqttPings.erase(it);
+  }
+}
+
+// Publishes the states that changed since the last scan, as retained messages
+static void publishHostStates() {
+  for (auto it = mqttStates.begin(); it != mqttStates.end();) {
+    if (macIndex.count(it->first)) {
+      ++it;
+      continue;
+    }
+    // Deleted host: an empty retained message clears its state on the broker
+    if (!publishMqtt(mqttHostTopic(it->first, F("/state")), "", true)) {
+      return;
+    }
+    it = mqttStates.erase(it);
+  }
+
+  for (const auto &[id, host] : hosts) {
+    unsigned long age;
+    int8_t state = getHostState(id, age);
+    uint64_t key = macKey(host.macBytes);
+    auto it = mqttStates.find(key);
+    if (state < 0 || (it != mqttStates.end() && it->second == state)) {
+      continue;
+    }
+    if (!publishMqtt(mqttHostTopic(key, F("/state")), state ? "up" : "down", true)) {
+      return;  // Send buffer full, the remaining ones go with the next scan
+    }
+    if (it != mqttStates.end() && state) {
+      mqttUps++;
+    } else if (it != mqttStates.end()) {
+      mqttDowns++;
+    }
+    mqttStates[key] = state;
+  }
+}
+
+static void publishEvents() {
+  char events[sizeof(mqttEvents)];
+  snprintf_P(events, sizeof(events), PSTR("{\"wakes\":%lu,\"up\":%lu,\"down\":%lu,\"commands\":%lu,\"reconnects\":%lu}"),
+             (unsigned long)getMagicPacketsSent(), (unsigned long)mqttUps, (unsigned long)mqttDowns, (unsigned long)mqttStats.commands,
+             (unsigned long)(mqttStats.connects - 1));
+  if (strcmp(events, mqttEvents) && publishMqtt(mqttConfig.prefix + F("/events"), events, true)) {
+    strcpy(mqttEvents, events);
+  }
+}
+
+void setupMqtt() {
+  if (mqttState == MqttState::Connected) {
+    publishMqtt(mqttConfig.prefix + F("/status"), "offline", true);  // A clean disconnect does not send the will
+    sendMqttPacket(MQTT_DISCONNECT, 0);
+  }
+  closeMqtt(false);
+  mqttBackoff = MQTT_MIN_BACKOFF;
+  mqttNextConnectAt = millis();
+}
+
+void handleMqtt() {
+  runMqttPings();
+  if (mqttState == MqttState::Disabled) {
+    return;
+  }
+  if (mqttClosed || mqttRxOverflow) {
+    closeMqtt(true);
+    return;
+  }
+
+  unsigned long now = millis();
+  switch (mqttState) {
+    case MqttState::Waiting:
+    case MqttState::Resolving:
+      {
+        if (WiFi.status() != WL_CONNECTED) {
+          return;
+        }
+        if ((long)(now - mqttNextConnectAt) < 0) {
+          limitSleep(mqttNextConnectAt - now);
+          return;
+        }
+        limitSleep(0);
+        IPAddress ip;
+        ResolveState resolved = resolveHost(mqttConfig.host, ip);
+        if (resolved == ResolveState::Pending) {
+          mqttState = MqttState::Resolving;
+        } else if (resolved == ResolveState::Failed) {
+          closeMqtt(true);
+        } else {
+          openMqtt(ip);
+        }
+        return;
+      }
+    case MqttState::Connecting:
+      readMqttPackets();
+      if (mqttState == MqttState::Connecting && now - mqttStateSince > MQTT_CONNECT_TIMEOUT) {
+        closeMqtt(true);
+      } else if (mqttState == MqttState::Connecting) {
+        limitSleep(MQTT_CONNECT_TIMEOUT - (now - mqttStateSince));  // Data and errors end the sleep
+      }
+      return;
+    case MqttState::Connected:
+      {
+        readMqttPackets();
+        unsigned long keepAlive = mqttConfig.keepAlive * 1000UL;
+        if (mqttPingPending && now - mqttPingSentAt > keepAlive / 2) {
+          closeMqtt(true);  // The broker did not answer the keepalive
+          return;
+        }
+        if (!mqttPingPending && (now - mqttSentAt >= keepAlive / 2 || now - mqttReceivedAt >= keepAlive / 2)) {
+          mqttPingPending = sendMqttPacket(MQTT_PINGREQ, 0);
+          mqttPingSentAt = now;
+        }
+        if (now - mqttScannedAt >= MQTT_SCAN_INTERVAL) {
+          mqttScannedAt = now;
+          publishHostStates();
+        }
+        if (now - mqttEventsAt >= MQTT_EVENTS_INTERVAL) {
+          mqttEventsAt = now;
+          publishEvents();
+        }
+        limitSleep(MQTT_SCAN_INTERVAL - (now - mqttScannedAt));  // Also before the keepalive, which is longer
+        return;
+      }
+    default:
+      return;
+  }
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#define POLICY_MAX_RETRIES 5
+#define POLICY_MIN_TIMEOUT 100
+#define POLICY_MAX_TIMEOUT 5000
+#define POLICY_MAX_BACKOFF 86400000UL  // Longest time between two automatic wakes of a host that stays down
+#define POLICY_DAY 86400000UL          // Window of `maxWakesPerDay`
+
+// Structure for the automatic wake policy of a host with a periodic ping
+struct WakePolicy {
+  uint8_t retries = 0;                      // Pings after the first before the host counts as down
+  uint16_t timeout = PROBE_DEFAULT_TIMEOUT;  // Milliseconds to wait for each answer
+  bool backoff = true;                      // Double the time between wakes while the host stays down
+  int16_t quietFrom = -1;                   // Start of the quiet hours in minutes of the day, -1 if none
+  int16_t quietUntil = -1;                  // End of the quiet hours (exclusive), may be before `quietFrom`
+  uint8_t maxWakesPerDay = 0;               // 0 for no limit
+
+  bool isDefault() const {
+    return retries == 0 && timeout == PROBE_DEFAULT_TIMEOUT && backoff && quietFrom < 0 && maxWakesPerDay == 0;
+  }
+};
+
+// Structure for the state of the periodic check of a host
+struct HostCheck {
+  bool due = false;                 // The timer fired and the check is not done
+  int8_t probe = -1;                // Running probe, -1 if none
+  uint8_t attempts = 0;             // Pings sent in the current check
+  uint8_t failedWakes = 0;          // Wakes sent since the host was last up
+  int8_t up = -1;                   // Result of the last check: 1 up, 0 down, -1 none yet
+  unsigned long nextWakeAt = 0;     // Backoff: no automatic wake before, if `failedWakes`
+  uint16_t wakesToday = 0;          // Wakes since `dayStartedAt`, counted without a limit too
+  unsigned long dayStartedAt = 0;
+};
+
+/**
+ * @brief Reads a wake policy from JSON.
+ *
+ * Expects an object with the optional fields `retries` (0-5), `timeout`
+ * (100-5000 ms), `backoff` (boolean), `quietHours` ("HH:MM-HH:MM", local
+ * time) and `maxWakesPerDay` (0-255, 0 for no limit). A null value gives
+ * the default policy.
+ *
+ * @param value The JSON value.
+ * @param policy The wake policy read.
+ * @return true if the value is valid, false otherwise.
+ */
+bool readWakePolicy(JsonVariantConst value, WakePolicy &policy);
+
+/**
+ * @brief Writes a wake policy as a JSON object.
+ *
+ * @param obj The JSON object to fill.
+ * @param policy The wake policy.
+ */
+void writeWakePolicy(JsonObject obj, const WakePolicy &policy);
+
+/**
+ * @brief Decides whether a host found down by its periodic check is woken.
+ *
+ * Applies the quiet hours (only once the clock is synced), the daily limit
+ * and the backoff, and counts the wake if it is allowed. With backoff, the
+ * n-th wake in a row is followed by a pause of 2^(n-1) ping intervals,
+ * capped at one day.
+ *
+ * @param policy The wake policy of the host.
+ * @param check The check state of the host.
+ * @param interval The periodic ping interval in milliseconds.
+ * @return true if a magic packet should be sent, false otherwise.
+ */
+bool takeAutoWake(const WakePolicy &policy, HostCheck &check, unsigned long interval);
+
+#endif
@@ -0,0 +1,109 @@
+#include "policy.h"
+
+// Parses "HH:MM" into minutes of the day, -1 if invalid
+static int16_t parseTimeOfDay(const char *text) {
+  int hours, minutes;
+  char end;
+  if (sscanf(text, "%2d:%2d%c", &hours, &minutes, &end) != 2 || hours < 0 || hours > 23 || minutes < 0 || minutes > 59) {
+    return -1;
+  }
+  return hours * 60 + minutes;
+}
+
+bool readWakePolicy(JsonVariantConst value, WakePolicy &policy) {
+  policy = WakePolicy();
+  if (value.isNull()) {
+    return true;
+  }
+  if (!value.is<JsonObjectConst>()) {
+    return false;
+  }
+
+  long retries = value["retries"] | 0L;
+  long timeout = value["timeout"] | (long)PROBE_DEFAULT_TIMEOUT;
+  long maxWakesPerDay = value["maxWakesPerDay"] | 0L;
+  if (retries < 0 || retries > POLICY_MAX_RETRIES || timeout < POLICY_MIN_TIMEOUT || timeout > POLICY_MAX_TIMEOUT || maxWakesPerDay < 0 || maxWakesPerDay > 255) {
+    return false;
+  }
+  if (!value["backoff"].isNull() && !value["backoff"].is<bool>()) {
+    return false;
+  }
+  policy.retries = retries;
+  policy.timeout = timeout;
+  policy.maxWakesPerDay = maxWakesPerDay;
+  policy.backoff = value["backoff"] | true;
+
+  String quietHours = value["quietHours"] | "";
+  if (!quietHours.isEmpty()) {
+    int dash = quietHours.indexOf('-');
+    if (dash < 0) {
+      return false;
+    }
+    policy.quietFrom = parseTimeOfDay(quietHours.substring(0, dash).c_str());
+    policy.quietUntil = parseTimeOfDay(quietHours.substring(dash + 1).c_str());
+    if (policy.quietFrom < 0 || policy.quietUntil < 0 || policy.quietFrom == policy.quietUntil) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void writeWakePolicy(JsonObject obj, const WakePolicy &policy) {
+  obj["retries"] = policy.retries;
+  obj["timeout"] = policy.timeout;
+  obj["backoff"] = policy.backoff;
+  if (policy.quietFrom >= 0) {
+    char quietHours[18];
+    snprintf_P(quietHours, sizeof(quietHours), PSTR("%02d:%02d-%02d:%02d"), policy.quietFrom / 60, policy.quietFrom % 60, policy.quietUntil / 60, policy.quietUntil % 60);
+    obj["quietHours"] = quietHours;
+  }
+  obj["maxWakesPerDay"] = policy.maxWakesPerDay;
+}
+
+// Quiet hours need the local time, so they only apply once NTP set the clock
+static bool isQuietTime(const WakePolicy &policy) {
+  if (policy.quietFrom < 0 || !isClockSynced()) {
+    return false;
+  }
+  time_t now = time(nullptr);
+  struct tm t;
+  localtime_r(&now, &t);
+  int16_t minute = t.tm_hour * 60 + t.tm_min;
+  if (policy.quietFrom < policy.quietUntil) {
+    return minute >= policy.quietFrom && minute < policy.quietUntil;
+  }
+  return minute >= policy.quietFrom || minute < policy.quietUntil;
+}
+
+bool takeAutoWake(const WakePolicy &policy, HostCheck &check, unsigned long interval) {
+  unsigned long now = millis();
+  if (isQuietTime(policy)) {
+    return false;
+  }
+  if (policy.backoff && check.failedWakes && (long)(now - check.nextWakeAt) < 0) {
+    return false;
+  }
+  if (check.wakesToday && now - check.dayStartedAt >= POLICY_DAY) {
+    check.wakesToday = 0;
+  }
+  if (policy.maxWakesPerDay && check.wakesToday >= policy.maxWakesPerDay) {
+    return false;
+  }
+
+  if (!check.wakesToday) {
+    check.dayStartedAt = now;
+  }
+  if (check.wakesToday < UINT16_MAX) {
+    check.wakesToday++;  // Wrapping to 0 would start a new day
+  }
+  if (check.failedWakes < 255) {
+    check.failedWakes++;
+  }
+  unsigned long pause = interval;
+  for (uint8_t i = 1; i < check.failedWakes && pause < POLICY_MAX_BACKOFF; i++) {
+    pause *= 2;
+  }
+  // Half an interval of slack, as the next check comes exactly `pause` later
+  check.nextWakeAt = now + min(pause, POLICY_MAX_BACKOFF) - interval / 2;
+  return true;
+}
@@ -0,0 +1,111 @@
+#ifndef PROBE_H
+#define PROBE_H
+
+#define PROBE_SLOTS 4              // Probes running at the same time
+#define PROBE_DEFAULT_TIMEOUT 1000  // The SDK reports a lost echo reply after one second, longer timeouts send more requests
+
+// States of an asynchronous probe
+enum class ProbeState : uint8_t {
+  Idle,
+  Pending,
+  Up,
+  Down
+};
+
+// Ways to check that a host is up
+enum class ProbeType : uint8_t {
+  Icmp,  // Echo request
+  Tcp,   // Connection to a port; an accepted or refused connection both mean the host is up
+  Arp    // ARP request, hosts on the device network only
+};
+
+// Structure for the liveness probe of a host
+struct ProbeTarget {
+  ProbeType type = ProbeType::Icmp;
+  uint16_t port = 0;  // Tcp: port to connect to
+
+  bool isDefault() const {
+    return type == ProbeType::Icmp;
+  }
+};
+
+/**
+ * @brief Reads a probe target from JSON.
+ *
+ * Expects an object with `type` ("icmp", "tcp" or "arp") and, for TCP,
+ * `port` (1-65535). A null value gives the default ICMP probe.
+ *
+ * @param value The JSON value.
+ * @param target The probe target read.
+ * @return true if the value is valid, false otherwise.
+ */
+bool readProbeTarget(JsonVariantConst value, ProbeTarget &target);
+
+/**
+ * @brief Writes a probe target as a JSON object.
+ *
+ * @param obj The JSON object to fill.
+ * @param target The probe target.
+ */
+void writeProbeTarget(JsonObject obj, const ProbeTarget &target);
+
+/**
+ * @brief Starts an asynchronous probe of a host.
+ *
+ * Unlike `Ping.ping()`, returns right away: lwIP and the SDK handle the
+ * answer, or the timeout, between two `loop()` iterations. Up to
+ * `PROBE_SLOTS` probes run at the same time; poll `getProbeState()` for the
+ * result and release the probe with `clearProbe()`.
+ *
+ * The SDK awaits each ICMP answer one second, so one echo request is sent
+ * per started second of the timeout. TCP probes send a SYN and reset the
+ * connection once it is accepted. ARP probes are the cheapest but only reach
+ * the device network; a host is up once an ARP packet from it is received
+ * after the probe started, seen by the frame hook of ARP snooping. Built
+ * without `ENABLE_ARP_SNOOPING`, the lwIP ARP table is looked up instead and
+ * a host counts as up for minutes after it left, while its entry is kept.
+ *
+ * @param ip The address of the host.
+ * @param target How to probe the host.
+ * @param timeout Milliseconds after which an unanswered probe is reported down.
+ * @return The probe, or -1 if all probes are in use.
+ */
+int8_t startProbe(const IPAddress &ip, const ProbeTarget &target = ProbeTarget(), uint16_t timeout = PROBE_DEFAULT_TIMEOUT);
+
+/**
+ * @brief Returns the state of a probe.
+ *
+ * @param probe The probe returned by `startProbe()`.
+ */
+ProbeState getProbeState(int8_t probe);
+
+/**
+ * @brief Returns the answer time of a probe in milliseconds, 0 if it was not answered.
+ *
+ * @param probe The probe returned by `startProbe()`.
+ */
+float getProbeTime(int8_t probe);
+
+#if ENABLE_ARP_SNOOPING == 1
+/**
+ * @brief Completes the pending ARP probes of an address.
+ *
+ * Called in the lwIP context by the frame hook of ARP snooping, with the
+ * sender of every ARP packet received.
+ *
+ * @param address The sender protocol address, in network byte order.
+ */
+void recordArpSender(const uint8_t *address);
+#endif
+
+/**
+ * @brief Releases a probe so another one can start.
+ *
+ * A pending probe may be released too: a TCP connection attempt is aborted,
+ * an echo request keeps its slot until the SDK is done with it.
+ *
+ * @param probe The probe returned by `startProbe()`.
+ */
+void clearProbe(int8_t probe);
+
+#endif
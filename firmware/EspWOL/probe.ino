@@ -0,0 +1,253 @@
+#include "probe.h"
+
+#include <lwip/tcp.h>
+#include <lwip/etharp.h>
+
+extern "C" {
+#include <ping.h>
+}
+
+#define ARP_PROBE_RETRY 250  // Milliseconds between two ARP requests of a probe
+
+// Structure for a probe slot
+struct Probe {
+  ProbeType type = ProbeType::Icmp;
+  struct ping_option option;
+  struct tcp_pcb *tcp = nullptr;
+  ip4_addr_t address;
+  volatile ProbeState state = ProbeState::Idle;
+  volatile uint32_t time = 0;
+  volatile bool inFlight = false;  // The SDK still uses `option`
+  volatile uint8_t echoes = 0;     // Icmp: echo requests without a reply or timeout yet
+  bool claimed = false;            // Returned by `startProbe()` and not cleared yet
+  unsigned long startedAt = 0;
+  unsigned long requestedAt = 0;   // Arp: last request
+  uint16_t timeout = PROBE_DEFAULT_TIMEOUT;
+};
+
+static Probe probes[PROBE_SLOTS];
+
+static const char *const PROBE_TYPES[] = { "icmp", "tcp", "arp" };
+
+bool readProbeTarget(JsonVariantConst value, ProbeTarget &target) {
+  target = ProbeTarget();
+  if (value.isNull()) {
+    return true;
+  }
+  if (!value.is<JsonObjectConst>()) {
+    return false;
+  }
+
+  String type = value["type"] | "icmp";
+  uint8_t i = 0;
+  while (i < sizeof(PROBE_TYPES) / sizeof(PROBE_TYPES[0]) && type != PROBE_TYPES[i]) {
+    i++;
+  }
+  if (i == sizeof(PROBE_TYPES) / sizeof(PROBE_TYPES[0])) {
+    return false;
+  }
+  target.type = (ProbeType)i;
+
+  if (target.type == ProbeType::Tcp) {
+    long port = value["port"] | 0L;
+    if (port < 1 || port > 65535) {
+      return false;
+    }
+    target.port = port;
+  }
+  return true;
+}
+
+void writeProbeTarget(JsonObject obj, const ProbeTarget &target) {
+  obj["type"] = PROBE_TYPES[(uint8_t)target.type];
+  if (target.type == ProbeType::Tcp) {
+    obj["port"] = target.port;
+  }
+}
+
+static void finishProbe(Probe &probe, bool up) {
+  probe.time = up ? max(millis() - probe.startedAt, 1UL) : 0;
+  probe.state = up ? ProbeState::Up : ProbeState::Down;
+}
+
+// Called by the SDK with the reply or the timeout of each echo request
+static void onProbeReply(void *arg, void *data) {
+  struct ping_resp *response = (struct ping_resp *)data;
+  for (Probe &probe : probes) {
+    if (&probe.option == arg) {
+      if (probe.echoes) {
+        probe.echoes--;
+      }
+      if (response->ping_err != -1 && probe.state == ProbeState::Pending) {
+        probe.time = response->resp_time;
+        probe.state = ProbeState::Up;
+      } else if (!probe.echoes && probe.state == ProbeState::Pending) {
+        probe.state = ProbeState::Down;
+      }
+      probe.inFlight = probe.echoes > 0;
+    }
+  }
+}
+
+static err_t onProbeConnected(void *arg, struct tcp_pcb *pcb, err_t) {
+  Probe &probe = *(Probe *)arg;
+  probe.tcp = nullptr;
+  finishProbe(probe, true);
+  tcp_arg(pcb, nullptr);
+  tcp_abort(pcb);  // Resets the connection, nothing is sent to the service
+  return ERR_ABRT;
+}
+
+// Called when the connection fails, the pcb is already freed
+static void onProbeError(void *arg, err_t err) {
+  if (!arg) {
+    return;
+  }
+  Probe &probe = *(Probe *)arg;
+  probe.tcp = nullptr;
+  // A refused connection is answered by the host itself
+  finishProbe(probe, err == ERR_RST);
+}
+
+static void abortTcpProbe(Probe &probe) {
+  if (probe.tcp) {
+    tcp_arg(probe.tcp, nullptr);
+    tcp_abort(probe.tcp);
+    probe.tcp = nullptr;
+  }
+}
+
+// Returns the interface an ARP request to the address goes out of, nullptr if the address is not on a local network
+static struct netif *arpInterface(const ip4_addr_t &address) {
+  struct netif *netif = ip4_route(&address);
+  if (!netif || !ip4_addr_netcmp(&address, netif_ip4_addr(netif), netif_ip4_netmask(netif))) {
+    return nullptr;
+  }
+  return netif;
+}
+
+static bool startIcmpProbe(Probe &probe) {
+  memset(&probe.option, 0, sizeof(probe.option));
+  // The SDK waits one second for each reply: longer timeouts send one echo request per second
+  probe.echoes = max((probe.timeout + PROBE_DEFAULT_TIMEOUT - 1) / PROBE_DEFAULT_TIMEOUT, 1);
+  probe.option.count = probe.echoes;
+  probe.option.coarse_time = 1;
+  probe.option.ip = probe.address.addr;
+  ping_regist_recv(&probe.option, onProbeReply);
+  probe.inFlight = true;
+  if (!ping_start(&probe.option)) {
+    probe.inFlight = false;
+    probe.echoes = 0;
+    return false;
+  }
+  return true;
+}
+
+static bool startTcpProbe(Probe &probe, uint16_t port) {
+  probe.tcp = tcp_new();
+  if (!probe.tcp) {
+    return false;
+  }
+  tcp_arg(probe.tcp, &probe);
+  tcp_err(probe.tcp, onProbeError);
+  ip_addr_t address;
+  ip_addr_copy_from_ip4(address, probe.address);
+  if (tcp_connect(probe.tcp, &address, port, onProbeConnected) != ERR_OK) {
+    abortTcpProbe(probe);
+    return false;
+  }
+  return true;
+}
+
+static bool sendArpProbe(Probe &probe) {
+  struct netif *netif = arpInterface(probe.address);
+  probe.requestedAt = millis();
+  return netif && etharp_request(netif, &probe.address) == ERR_OK;
+}
+
+int8_t startProbe(const IPAddress &ip, const ProbeTarget &target, uint16_t timeout) {
+  for (int8_t i = 0; i < PROBE_SLOTS; i++) {
+    Probe &probe = probes[i];
+    if (probe.claimed || probe.inFlight) {
+      continue;
+    }
+
+    probe.type = target.type;
+    probe.address.addr = ip;
+    probe.claimed = true;
+    probe.state = ProbeState::Pending;
+    probe.time = 0;
+    probe.startedAt = millis();
+    probe.timeout = timeout;
+
+    bool started;
+    switch (target.type) {
+      case ProbeType::Tcp:
+        started = startTcpProbe(probe, target.port);
+        break;
+      case ProbeType::Arp:
+        started = sendArpProbe(probe);
+        break;
+      default:
+        started = startIcmpProbe(probe);
+        break;
+    }
+    if (!started) {
+      probe.state = ProbeState::Down;
+    }
+    return i;
+  }
+  return -1;
+}
+
+ProbeState getProbeState(int8_t probe) {
+  if (probe < 0 || probe >= PROBE_SLOTS) {
+    return ProbeState::Idle;
+  }
+  Probe &slot = probes[probe];
+  if (slot.state != ProbeState::Pending) {
+    return slot.state;
+  }
+
+  unsigned long now = millis();
+  if (slot.type == ProbeType::Arp) {
+#if ENABLE_ARP_SNOOPING != 1
+    // Without the frame hook, the table is looked up: a host counts as up as long as lwIP keeps its entry
+    struct netif *netif = arpInterface(slot.address);
+    struct eth_addr *mac;
+    const ip4_addr_t *address;
+    if (netif && etharp_find_addr(netif, &slot.address, &mac, &address) >= 0) {
+      finishProbe(slot, true);
+      return slot.state;
+    }
+#endif
+    if (now - slot.requestedAt >= ARP_PROBE_RETRY) {
+      sendArpProbe(slot);
+    }
+  }
+  if (now - slot.startedAt >= slot.timeout) {
+    return ProbeState::Down;
+  }
+  return slot.state;
+}
+
+float getProbeTime(int8_t probe) {
+  return probe >= 0 && probe < PROBE_SLOTS ? probes[probe].time : 0;
+}
+
+#if ENABLE_ARP_SNOOPING == 1
+void recordArpSender(const uint8_t *address) {
+  for (Probe &probe : probes) {
+    if (probe.type == ProbeType::Arp && probe.state == ProbeState::Pending && !memcmp(&probe.address.addr, address, 4)) {
+      finishProbe(probe, true);
+    }
+  }
+}
+#endif
+
+void clearProbe(int8_t probe) {
+  if (probe >= 0 && probe < PROBE_SLOTS) {
+    abortTcpProbe(probes[probe]);
+    probes[probe].claimed = false;
+  }
+}
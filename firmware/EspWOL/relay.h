@@ -0,0 +1,35 @@
+#ifndef RELAY_H
+#define RELAY_H
+
+#define RELAY_PORT_ECHO 7
+#define RELAY_PORT_DISCARD 9
+#define RELAY_DEFAULT_MAX_PPS 200
+#define RELAY_MAX_PPS 1000
+
+#if ENABLE_WOL_RELAY == 1
+
+// Counters of the datagrams received by the relay, by outcome
+struct RelayStats {
+  uint32_t relayed = 0;  // Broadcast on the local network
+  uint32_t invalid = 0;  // Not a magic packet
+  uint32_t unknown = 0;  // MAC of no host while only known hosts are relayed
+  uint32_t local = 0;    // Sent from the local network or as a broadcast, already on the segment
+  uint32_t limited = 0;  // Dropped by the rate limit
+  uint32_t failed = 0;   // Could not be sent
+};
+
+/**
+ * @brief Opens or closes the relay listeners on UDP ports 7 and 9 as configured.
+ *
+ * Called after WiFi connects and when the relay settings change.
+ */
+void setupRelay();
+
+/**
+ * @brief Returns the counters of the relay since boot.
+ */
+const RelayStats &getRelayStats();
+
+#endif
+
+#endif
@@ -0,0 +1,87 @@
+#include "relay.h"
+
+#if ENABLE_WOL_RELAY == 1
+
+#include <lwip/udp.h>
+
+#define RELAY_TOKEN 1000  // Cost of a packet in the bucket, which refills maxPps tokens per millisecond
+
+static struct udp_pcb *relayPcbs[2] = {};
+static const uint16_t RELAY_PORTS[2] = { RELAY_PORT_ECHO, RELAY_PORT_DISCARD };
+static RelayStats relayStats;
+static uint32_t relayTokens = 0;
+static uint32_t relayRefilledAt = 0;
+
+const RelayStats &getRelayStats() {
+  return relayStats;
+}
+
+// Token bucket holding up to one second of packets, so bursts pass as long as the average rate is kept
+static bool takeRelayToken() {
+  uint32_t now = millis();
+  uint32_t capacity = (uint32_t)relayConfig.maxPps * RELAY_TOKEN;
+  uint32_t elapsed = now - relayRefilledAt;
+  relayRefilledAt = now;
+  relayTokens = elapsed >= 1000 ? capacity : std::min(capacity, relayTokens + elapsed * relayConfig.maxPps);
+  if (relayTokens < RELAY_TOKEN) {
+    return false;
+  }
+  relayTokens -= RELAY_TOKEN;
+  return true;
+}
+
+// Runs in the lwIP context, never concurrently with loop(), so the host table can be read as is
+static void onRelayDatagram(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+  uint16_t dstPort = (uint16_t)(uintptr_t)arg;
+  const struct netif *netif = ip_current_netif();
+
+  // Most packets fit in one pbuf, a chain is only copied to be inspected
+  uint8_t copy[MAGIC_PACKET_SIZE];
+  const uint8_t *payload = (const uint8_t *)p->payload;
+  if (p->len < MAGIC_PACKET_SIZE && p->tot_len >= MAGIC_PACKET_SIZE) {
+    pbuf_copy_partial(p, copy, MAGIC_PACKET_SIZE, 0);
+    payload = copy;
+  }
+
+  if (!isMagicPacket(payload, p->tot_len)) {
+    relayStats.invalid++;
+  } else if (netif && (ip4_addr_netcmp(ip_2_ip4(addr), netif_ip4_addr(netif), netif_ip4_netmask(netif)) || ip_addr_isbroadcast(ip_current_dest_addr(), netif))) {
+    // Relaying would duplicate the packet, or loop it between relays
+    relayStats.local++;
+  } else if (relayConfig.knownHostsOnly && macIndex.find(macKey(payload + 6)) == macIndex.end()) {
+    relayStats.unknown++;
+  } else if (!takeRelayToken()) {
+    relayStats.limited++;
+  } else if (udp_sendto(pcb, p, IP_ADDR_BROADCAST, dstPort) == ERR_OK) {
+    // The received pbuf is sent as is: lwIP prepends the headers in the space the incoming ones used
+    relayStats.relayed++;
+  } else {
+    relayStats.failed++;
+  }
+  pbuf_free(p);
+}
+
+void setupRelay() {
+  for (uint8_t i = 0; i < 2; i++) {
+    if (relayConfig.enable && !relayPcbs[i]) {
+      struct udp_pcb *pcb = udp_new();
+      if (!pcb) {
+        continue;
+      }
+      if (udp_bind(pcb, IP_ANY_TYPE, RELAY_PORTS[i]) != ERR_OK) {
+        udp_remove(pcb);
+        continue;
+      }
+      ip_set_option(pcb, SOF_BROADCAST);
+      udp_recv(pcb, onRelayDatagram, (void *)(uintptr_t)RELAY_PORTS[i]);
+      relayPcbs[i] = pcb;
+    } else if (!relayConfig.enable && relayPcbs[i]) {
+      udp_remove(relayPcbs[i]);
+      relayPcbs[i] = nullptr;
+    }
+  }
+  relayTokens = (uint32_t)relayConfig.maxPps * RELAY_TOKEN;
+  relayRefilledAt = millis();
+}
+
+#endif
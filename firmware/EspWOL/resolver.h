@@ -0,0 +1,72 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#define RESOLVE_MIN_TTL 30      // Seconds an answer is kept at least, whatever its TTL
+#define RESOLVE_MAX_TTL 3600    // Seconds an answer is kept at most before it is refreshed
+#define RESOLVE_TIMEOUT 1000    // Milliseconds a query is awaited
+#define RESOLVE_ATTEMPTS 3      // Queries sent before a name counts as not resolved
+#define RESOLVE_RETRY 30000     // Milliseconds before a name that did not resolve is asked again
+#define MULTICAST_DNS_PORT 5353
+
+// Result of a name lookup
+enum class ResolveState : uint8_t {
+  Pending,   // First query not answered yet
+  Resolved,  // Address known, possibly from an answer past its TTL while the refresh is pending
+  Failed     // No answer, the name is asked again later
+};
+
+/**
+ * @brief Returns the address of a host from the resolution cache.
+ *
+ * Never blocks: a literal IPv4 address is parsed, a name is looked up in the
+ * cache and, if it is not there yet, queued for `handleResolver()`. Names
+ * ending in `.local` are resolved with mDNS, others with the DNS server of
+ * the network.
+ *
+ * @param address The IPv4 address, hostname or `.local` name of the host.
+ * @param ip The address, set when the result is `Resolved`.
+ * @return The state of the lookup.
+ */
+ResolveState resolveHost(const String &address, IPAddress &ip);
+
+/**
+ * @brief Sets the names kept and refreshed in the cache.
+ *
+ * Called with the addresses of all hosts when they change; literal addresses
+ * are ignored and names of deleted hosts are dropped.
+ *
+ * @param names The host addresses.
+ */
+void setResolvedNames(const std::vector<String> &names);
+
+/**
+ * @brief Sends the queries that are due and reads the answers. Called from `loop()`.
+ *
+ * Names are asked again before their TTL runs out, so hosts keep resolving
+ * without waiting for a query.
+ */
+void handleResolver();
+
+/**
+ * @brief Appends a dotted name to a DNS message, as labels.
+ *
+ * @param message The message, with room for the name.
+ * @param length The length of the message so far.
+ * @param name The name.
+ * @return The length of the message with the name.
+ */
+size_t writeDnsName(uint8_t *message, size_t length, const char *name);
+
+/**
+ * @brief Reads the name at an offset of a DNS message, following compression pointers.
+ *
+ * @param message The message.
+ * @param length The length of the message.
+ * @param offset The offset of the name.
+ * @param label If not null and empty, receives the first label, truncated to `size - 1` characters.
+ * @param size The size of `label`.
+ * @return The offset after the name, 0 if it is malformed.
+ */
+size_t readDnsName(const uint8_t *message, size_t length, size_t offset, char *label = nullptr, size_t size = 0);
+
+#endif
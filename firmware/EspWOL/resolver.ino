@@ -0,0 +1,279 @@
+#include "resolver.h"
+
+#define RESOLVE_DATAGRAMS 4  // Answers read per step
+#define DNS_PORT 53
+
+// Structure for a name of the resolution cache
+struct ResolvedName {
+  IPAddress ip;                  // Unset until the first answer
+  unsigned long resolvedAt = 0;  // millis() of the last answer
+  unsigned long ttl = 0;         // Milliseconds the last answer is valid
+  unsigned long nextQueryAt = 0;
+  unsigned long queriedAt = 0;   // millis() of the last query
+  uint16_t queryId = 0;
+  uint8_t attempts = 0;          // Queries sent without an answer
+  bool querying = false;
+  bool failed = false;           // The last queries were not answered
+};
+
+static std::map<String, ResolvedName> resolvedNames;
+static WiFiUDP resolverUdp;
+static bool resolverOpen = false;
+
+size_t writeDnsName(uint8_t *message, size_t length, const char *name) {
+  while (*name) {
+    const char *dot = strchr(name, '.');
+    size_t size = dot ? dot - name : strlen(name);
+    message[length] = size;
+    memcpy(message + length + 1, name, size);
+    length += 1 + size;
+    name += dot ? size + 1 : size;
+  }
+  message[length] = 0;
+  return length + 1;
+}
+
+size_t readDnsName(const uint8_t *message, size_t length, size_t offset, char *label, size_t size) {
+  size_t end = 0;
+  for (uint8_t jumps = 0; offset < length;) {
+    uint8_t count = message[offset];
+    if (count == 0) {
+      return end ? end : offset + 1;
+    }
+    if ((count & 0xC0) == 0xC0) {
+      if (offset + 1 >= length || ++jumps > 8) {
+        return 0;
+      }
+      if (!end) {
+        end = offset + 2;
+      }
+      offset = (count & 0x3F) << 8 | message[offset + 1];
+      continue;
+    }
+    if (count > 63 || offset + 1 + count > length) {
+      return 0;
+    }
+    if (label && !label[0]) {
+      size_t copied = std::min<size_t>(count, size - 1);
+      memcpy(label, message + offset + 1, copied);
+      label[copied] = '\0';
+    }
+    offset += 1 + count;
+  }
+  return 0;
+}
+
+ResolveState resolveHost(const String &address, IPAddress &ip) {
+  if (isValidIPAddress(address)) {
+    return ip.fromString(address) ? ResolveState::Resolved : ResolveState::Failed;
+  }
+
+  // Names outside of the host list are cached too, and dropped with the next host change
+  ResolvedName &name = resolvedNames[address];
+  if (name.ip.isSet()) {
+    ip = name.ip;
+    return ResolveState::Resolved;
+  }
+  return name.failed ? ResolveState::Failed : ResolveState::Pending;
+}
+
+void setResolvedNames(const std::vector<String> &names) {
+  for (auto it = resolvedNames.begin(); it != resolvedNames.end();) {
+    if (std::find(names.begin(), names.end(), it->first) == names.end()) {
+      it = resolvedNames.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (const String &address : names) {
+    if (!isValidIPAddress(address)) {
+      resolvedNames[address];  // Queued by handleResolver() if new
+    }
+  }
+}
+
+static bool isMulticastName(const String &address) {
+  return address.length() > 6 && address.substring(address.length() - 6).equalsIgnoreCase(".local");
+}
+
+static bool sendQuery(const String &address, ResolvedName &name) {
+  if (!resolverOpen) {
+    resolverOpen = resolverUdp.begin(0);
+    if (!resolverOpen) {
+      return false;
+    }
+  }
+
+  bool multicast = isMulticastName(address);
+  uint8_t query[12 + 256 + 4] = {};
+  name.queryId = ESP.random();  // Not guessable, so an answer cannot be forged without seeing the query
+  query[0] = name.queryId >> 8;
+  query[1] = name.queryId & 0xFF;
+  query[2] = multicast ? 0x00 : 0x01;  // Recursion desired from a DNS server
+  query[5] = 1;  // One question
+  size_t length = writeDnsName(query, 12, address.c_str());
+  query[length + 1] = 1;                    // A
+  query[length + 2] = multicast ? 0x80 : 0x00;  // mDNS: unicast response requested
+  query[length + 3] = 1;                    // IN
+  length += 4;
+
+  // mDNS queries not sent from port 5353 are answered by unicast, on the socket they came from
+  bool opened = multicast ? resolverUdp.beginPacketMulticast(IPAddress(224, 0, 0, 251), MULTICAST_DNS_PORT, WiFi.localIP())
+                          : resolverUdp.beginPacket(WiFi.dnsIP(), DNS_PORT);
+  if (!opened) {
+    return false;
+  }
+  resolverUdp.write(query, length);
+  return resolverUdp.endPacket();
+}
+
+// Returns the offset after the name at an offset of a message if it equals `name`, ignoring case, 0 otherwise
+static size_t matchDnsName(const uint8_t *message, size_t length, size_t offset, const char *name) {
+  size_t end = readDnsName(message, length, offset);
+  while (end) {
+    uint8_t count = message[offset];
+    if ((count & 0xC0) == 0xC0) {
+      offset = (count & 0x3F) << 8 | message[offset + 1];  // Checked by readDnsName()
+      continue;
+    }
+    if (count == 0) {
+      return *name ? 0 : end;
+    }
+    if (strncasecmp((const char *)message + offset + 1, name, count) || (name[count] != '.' && name[count] != '\0')) {
+      return 0;
+    }
+    name += name[count] ? count + 1 : count;
+    offset += 1 + count;
+  }
+  return 0;
+}
+
+// Reads the first A record of an answer, with its TTL in seconds
+static bool parseAddressRecord(const uint8_t *message, size_t length, IPAddress &ip, uint32_t &ttl) {
+  uint16_t questions = message[4] << 8 | message[5];
+  uint16_t answers = message[6] << 8 | message[7];
+  size_t offset = 12;
+  for (uint16_t i = 0; i < questions && offset; i++) {
+    offset = readDnsName(message, length, offset);
+    offset = offset && offset + 4 <= length ? offset + 4 : 0;
+  }
+  for (uint16_t i = 0; i < answers && offset; i++) {
+    offset = readDnsName(message, length, offset);
+    if (!offset || offset + 10 > length) {
+      return false;
+    }
+    const uint8_t *record = message + offset;
+    uint16_t type = record[0] << 8 | record[1];
+    uint16_t recordClass = (record[2] << 8 | record[3]) & 0x7FFF;  // Without the mDNS cache flush bit
+    uint16_t size = record[8] << 8 | record[9];
+    offset += 10;
+    if (offset + size > length) {
+      return false;
+    }
+    if (type == 1 && recordClass == 1 && size == 4) {
+      ttl = (uint32_t)record[4] << 24 | (uint32_t)record[5] << 16 | record[6] << 8 | record[7];
+      ip = IPAddress(message[offset], message[offset + 1], message[offset + 2], message[offset + 3]);
+      return true;
+    }
+    offset += size;
+  }
+  return false;
+}
+
+// Points the subnet and unicast wake targets of the hosts with this address to its new IP
+static void updateWakeTargets(const String &address) {
+  for (auto &[id, host] : hosts) {
+    if (host.ip == address) {
+      releaseWakeTarget(id);
+      resolveWakeTarget(id);
+    }
+  }
+}
+
+static void readAnswers() {
+  static uint8_t message[512];
+  for (uint8_t i = 0; i < RESOLVE_DATAGRAMS && resolverUdp.parsePacket(); i++) {
+    size_t length = resolverUdp.read(message, sizeof(message));
+    if (length < 12 || !(message[2] & 0x80)) {
+      continue;  // Not a response
+    }
+    uint16_t id = message[0] << 8 | message[1];
+    auto it = std::find_if(resolvedNames.begin(), resolvedNames.end(), [id](const std::pair<const String, ResolvedName> &pair) {
+      return pair.second.querying && pair.second.queryId == id;
+    });
+    if (it == resolvedNames.end()) {
+      continue;
+    }
+    // Resolvers echo the question; DNS answers come from the server of the network, mDNS ones from the host
+    uint16_t questions = message[4] << 8 | message[5];
+    if (!questions || !matchDnsName(message, length, 12, it->first.c_str())) {
+      continue;
+    }
+    if (!isMulticastName(it->first) && (resolverUdp.remoteIP() != WiFi.dnsIP() || resolverUdp.remotePort() != DNS_PORT)) {
+      continue;
+    }
+
+    ResolvedName &name = it->second;
+    IPAddress ip;
+    uint32_t ttl;
+    if (parseAddressRecord(message, length, ip, ttl)) {
+      ttl = std::min<uint32_t>(std::max<uint32_t>(ttl, RESOLVE_MIN_TTL), RESOLVE_MAX_TTL);
+      bool changed = ip != name.ip;
+      name.ip = ip;
+      name.resolvedAt = millis();
+      name.ttl = ttl * 1000;
+      name.nextQueryAt = name.resolvedAt + name.ttl * 3 / 4;  // Refreshed before it expires
+      name.failed = false;
+      if (changed) {
+        updateWakeTargets(it->first);
+      }
+    } else if ((message[3] & 0x0F) == 3) {
+      // The name does not exist (anymore), unlike a timeout this drops the address
+      name.ip = IPAddress();
+      name.failed = true;
+      name.nextQueryAt = millis() + RESOLVE_RETRY;
+    } else {
+      continue;  // No address in the answer, the query times out
+    }
+    name.querying = false;
+    name.attempts = 0;
+  }
+}
+
+void handleResolver() {
+  if (resolvedNames.empty() || WiFi.status() != WL_CONNECTED) {
+    return;
+  }
+  if (resolverOpen) {
+    readAnswers();
+  }
+
+  // At most one query per step
+  unsigned long now = millis();
+  for (auto &[address, name] : resolvedNames) {
+    if (name.querying) {
+      if (now - name.queriedAt < RESOLVE_TIMEOUT) {
+        limitSleep(0);  // Answers are polled
+        continue;
+      }
+      if (name.attempts >= RESOLVE_ATTEMPTS) {
+        // Unanswered: a name that resolved keeps its last address, a sleeping host has no mDNS responder
+        name.querying = false;
+        name.attempts = 0;
+        name.failed = !name.ip.isSet();
+        name.nextQueryAt = now + RESOLVE_RETRY;
+        continue;
+      }
+    } else if ((long)(now - name.nextQueryAt) < 0) {
+      limitSleep(name.nextQueryAt - now);
+      continue;
+    }
+
+    name.querying = true;
+    name.queriedAt = now;
+    name.attempts++;
+    sendQuery(address, name);
+    limitSleep(0);
+    return;
+  }
+}
@@ -0,0 +1,87 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <time.h>
+
+#define SCHEDULES_MAX 32
+#define SCHEDULE_NTP_SERVER_1 "pool.ntp.org"
+#define SCHEDULE_NTP_SERVER_2 "time.nist.gov"
+#define SCHEDULE_DEFAULT_TIMEZONE "UTC0"
+#define SCHEDULE_MAX_TIMEZONE_LENGTH 64
+
+// Structure for a scheduled wake rule
+struct Schedule {
+  String cron;                 // "minute hour day-of-month month day-of-week"
+  String mac;                  // MAC address of the host, empty if the rule wakes a tag
+  uint8_t macBytes[6] = {};    // Parsed from `mac`, host indexes change when hosts are deleted
+  String tag;
+  bool enabled = true;
+
+  // Compiled from `cron` by `compileSchedule()`
+  uint64_t minutes = 0;        // Bit per minute (0-59)
+  uint32_t hours = 0;          // Bit per hour (0-23)
+  uint32_t monthDays = 0;      // Bit per day of the month (1-31)
+  uint16_t months = 0;         // Bit per month (1-12)
+  uint8_t weekDays = 0;        // Bit per day of the week (0-6, Sunday is 0)
+  bool anyMonthDay = true;     // Day of month is `*`
+  bool anyWeekDay = true;      // Day of week is `*`
+
+  time_t nextFireAt = 0;       // 0 if not scheduled (disabled or clock not synced)
+  time_t lastFiredAt = 0;
+};
+
+/**
+ * @brief Parses the cron expression of a rule into its bit masks.
+ *
+ * Supports five fields (minute, hour, day of month, month, day of week) with
+ * `*`, numbers, ranges (`1-5`), steps (`0-59/15`) and lists (`1,3,5`).
+ * Day of week 7 is Sunday too. Shortcuts: `@daily`, `@weekdays` and
+ * `@weekends` followed by `HH:MM`, e.g. "@weekdays 07:45".
+ *
+ * @param schedule The rule, its `cron` field is read.
+ * @return true if the expression is valid, false otherwise.
+ */
+bool compileSchedule(Schedule &schedule);
+
+/**
+ * @brief Returns the index of the host woken by a rule, -1 if it wakes a tag or the host is gone.
+ */
+int findScheduleHost(const Schedule &schedule);
+
+/**
+ * @brief Points the rules waking a host to its new MAC address, or drops them.
+ *
+ * Called when a host is edited or deleted. Does not save the rules.
+ *
+ * @param from The MAC address the rules refer to.
+ * @param to The new MAC address, nullptr to drop the rules.
+ * @return true if a rule changed, false otherwise.
+ */
+bool moveHostSchedules(const uint8_t from[6], const String *to);
+
+/**
+ * @brief Starts the NTP client with the configured time zone.
+ */
+void setupSchedules();
+
+/**
+ * @brief Computes the next fire time of every rule and of the scheduler.
+ *
+ * Called after the rules or the time zone change and once the clock is synced.
+ */
+void rescheduleAll();
+
+/**
+ * @brief Returns whether the clock was set by NTP.
+ */
+bool isClockSynced();
+
+/**
+ * @brief Wakes the hosts of the rules that are due.
+ *
+ * Called from `loop()`. Compares the clock to the earliest next fire time,
+ * so rules are only looked at when one of them fires.
+ */
+void checkSchedules();
+
+#endif
@@ -0,0 +1,227 @@
+#include "schedule.h"
+
+#define CLOCK_VALID_AFTER 1700000000  // Before NTP sync, time() counts from boot
+#define SCHEDULE_SEARCH_STEPS 2000    // Bounds the next fire search of rules that never match
+
+static bool clockSynced = false;
+static time_t nextScheduleAt = 0;  // Earliest next fire time of all rules, 0 if none
+
+// Parses one cron field into a bit mask
+static bool parseCronField(const char *field, uint8_t low, uint8_t high, uint64_t &mask) {
+  mask = 0;
+  const char *p = field;
+  while (*p) {
+    char *next;
+    long start = low, end = high, step = 1;
+    if (*p == '*') {
+      p++;
+    } else {
+      start = end = strtol(p, &next, 10);
+      if (next == p) return false;
+      p = next;
+      if (*p == '-') {
+        end = strtol(++p, &next, 10);
+        if (next == p) return false;
+        p = next;
+      }
+    }
+    if (*p == '/') {
+      step = strtol(++p, &next, 10);
+      if (next == p || step < 1) return false;
+      p = next;
+    }
+    if (start < low || end > high || start > end) return false;
+    for (long value = start; value <= end; value += step) {
+      mask |= 1ULL << value;
+    }
+    if (*p == ',') {
+      if (!*++p) return false;
+    } else if (*p) {
+      return false;
+    }
+  }
+  return mask != 0;
+}
+
+bool compileSchedule(Schedule &schedule) {
+  String cron = schedule.cron;
+  cron.trim();
+
+  // Shortcuts: "@daily HH:MM", "@weekdays HH:MM" and "@weekends HH:MM"
+  if (cron.startsWith("@")) {
+    int space = cron.indexOf(' ');
+    int colon = cron.indexOf(':');
+    if (space < 0 || colon < space) return false;
+    String days = cron.substring(0, space);
+    String hour = cron.substring(space + 1, colon);
+    String minute = cron.substring(colon + 1);
+    hour.trim();
+    if (days == "@daily") days = "*";
+    else if (days == "@weekdays") days = "1-5";
+    else if (days == "@weekends") days = "0,6";
+    else return false;
+    cron = minute + " " + hour + " * * " + days;
+  }
+
+  char fields[5][32];
+  if (sscanf(cron.c_str(), "%31s %31s %31s %31s %31s", fields[0], fields[1], fields[2], fields[3], fields[4]) != 5) {
+    return false;
+  }
+
+  uint64_t minutes, hours, monthDays, months, weekDays;
+  if (!parseCronField(fields[0], 0, 59, minutes) || !parseCronField(fields[1], 0, 23, hours) || !parseCronField(fields[2], 1, 31, monthDays) || !parseCronField(fields[3], 1, 12, months) || !parseCronField(fields[4], 0, 7, weekDays)) {
+    return false;
+  }
+  if (weekDays & (1 << 7)) {
+    weekDays |= 1;
+  }
+
+  schedule.minutes = minutes;
+  schedule.hours = hours;
+  schedule.monthDays = monthDays;
+  schedule.months = months;
+  schedule.weekDays = weekDays & 0x7F;
+  schedule.anyMonthDay = fields[2][0] == '*';
+  schedule.anyWeekDay = fields[4][0] == '*';
+  return true;
+}
+
+// Like cron, when both day fields are restricted either one may match
+static bool dayMatches(const Schedule &schedule, const struct tm &t) {
+  bool monthDay = schedule.monthDays & (1UL << t.tm_mday);
+  bool weekDay = schedule.weekDays & (1 << t.tm_wday);
+  if (schedule.anyMonthDay || schedule.anyWeekDay) {
+    return monthDay && weekDay;
+  }
+  return monthDay || weekDay;
+}
+
+// Walks the local calendar forward from the minute after `after`, skipping whole months, days and hours
+static time_t computeNextFire(const Schedule &schedule, time_t after) {
+  struct tm t;
+  localtime_r(&after, &t);
+  t.tm_sec = 0;
+  t.tm_min++;
+  for (int i = 0; i < SCHEDULE_SEARCH_STEPS; i++) {
+    t.tm_isdst = -1;
+    time_t candidate = mktime(&t);  // Normalizes the fields and sets the day of the week
+    if (!(schedule.months & (1 << (t.tm_mon + 1)))) {
+      t.tm_mon++;
+      t.tm_mday = 1;
+      t.tm_hour = 0;
+      t.tm_min = 0;
+    } else if (!dayMatches(schedule, t)) {
+      t.tm_mday++;
+      t.tm_hour = 0;
+      t.tm_min = 0;
+    } else if (!(schedule.hours & (1UL << t.tm_hour))) {
+      t.tm_hour++;
+      t.tm_min = 0;
+    } else if (!(schedule.minutes & (1ULL << t.tm_min))) {
+      t.tm_min++;
+    } else {
+      return candidate;
+    }
+  }
+  return 0;
+}
+
+static void updateNextScheduleAt() {
+  nextScheduleAt = 0;
+  for (const auto &pair : scheduleConfig.rules) {
+    time_t fireAt = pair.second.nextFireAt;
+    if (fireAt && (!nextScheduleAt || fireAt < nextScheduleAt)) {
+      nextScheduleAt = fireAt;
+    }
+  }
+}
+
+void setupSchedules() {
+  configTime(scheduleConfig.timezone.c_str(), SCHEDULE_NTP_SERVER_1, SCHEDULE_NTP_SERVER_2);
+}
+
+void rescheduleAll() {
+  time_t now = time(nullptr);
+  for (auto &pair : scheduleConfig.rules) {
+    Schedule &schedule = pair.second;
+    schedule.nextFireAt = clockSynced && schedule.enabled ? computeNextFire(schedule, now) : 0;
+  }
+  updateNextScheduleAt();
+}
+
+bool isClockSynced() {
+  return clockSynced;
+}
+
+int findScheduleHost(const Schedule &schedule) {
+  return schedule.mac.length() ? findHostByMAC(schedule.macBytes) : -1;
+}
+
+bool moveHostSchedules(const uint8_t from[6], const String *to) {
+  bool changed = false;
+  for (auto it = scheduleConfig.rules.begin(); it != scheduleConfig.rules.end();) {
+    Schedule &schedule = it->second;
+    if (!schedule.mac.length() || memcmp(schedule.macBytes, from, 6)) {
+      ++it;
+      continue;
+    }
+    changed = true;
+    if (!to) {
+      it = scheduleConfig.rules.erase(it);
+      continue;
+    }
+    schedule.mac = *to;
+    parseMACAddress(schedule.mac, schedule.macBytes);
+    ++it;
+  }
+  return changed;
+}
+
+// Queues the wake of the hosts of a rule, false if the job queue is full
+static bool fireSchedule(const Schedule &schedule) {
+  std::vector<int> ids;
+  if (schedule.mac.length()) {
+    int id = findScheduleHost(schedule);
+    if (id >= 0) {
+      ids.push_back(id);
+    }
+  } else {
+    auto it = tagIndex.find(schedule.tag);
+    if (it != tagIndex.end()) {
+      ids = it->second;
+    }
+  }
+  return ids.empty() || queueWakeJob(ids, 1, 0, WAKE_DEFAULT_MAX_PPS) >= 0;
+}
+
+void checkSchedules() {
+  time_t now = time(nullptr);
+  if (!clockSynced) {
+    if (now < CLOCK_VALID_AFTER) {
+      return;
+    }
+    clockSynced = true;
+    rescheduleAll();
+    return;
+  }
+
+  if (!nextScheduleAt || now < nextScheduleAt) {
+    if (nextScheduleAt) {
+      limitSleep(std::min<time_t>(nextScheduleAt - now, 3600) * 1000UL);
+    }
+    return;
+  }
+
+  for (auto &pair : scheduleConfig.rules) {
+    Schedule &schedule = pair.second;
+    if (schedule.nextFireAt && schedule.nextFireAt <= now && fireSchedule(schedule)) {
+      schedule.lastFiredAt = now;
+      schedule.nextFireAt = computeNextFire(schedule, now);
+    }
+  }
+  updateNextScheduleAt();
+  if (nextScheduleAt && nextScheduleAt <= now) {
+    // Job queue full: try again in a second
+    nextScheduleAt = now + 1;
+  }
+}
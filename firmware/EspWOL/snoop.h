@@ -0,0 +1,52 @@
+#ifndef SNOOP_H
+#define SNOOP_H
+
+#define SNOOP_UP_WINDOW 120000    // Milliseconds a host seen on the network counts as up without a probe
+#define SNOOP_CHECK_INTERVAL 1000 // Milliseconds between two comparisons of the seen and stored addresses
+#define SNOOP_SAVE_DELAY 60000    // Milliseconds addresses changed by snooping wait to be saved together
+#define SNOOP_CONFIRM_FRAMES 3    // Frames with a new address before a host follows it, unless it was seen in a DHCP ack
+#define SNOOP_CONFIRM_TIME 30000  // Milliseconds these frames span at least
+
+#if ENABLE_ARP_SNOOPING == 1
+
+/**
+ * @brief Starts watching the frames received by the station interface.
+ *
+ * The addresses of hosts are learned from the sender of ARP packets, from the
+ * source of the IPv4 broadcasts of the device network, and from DHCP acks
+ * the device sees. Only the MAC addresses of hosts are tracked. The hook is
+ * installed again after each WiFi connection.
+ */
+void setupSnooping();
+
+/**
+ * @brief Tracks the MAC addresses in `macIndex`, keeping what was seen of the remaining ones.
+ *
+ * Called when the hosts change.
+ */
+void syncSnoopedHosts();
+
+/**
+ * @brief Updates the address of the hosts seen with another one. Called from `loop()`.
+ *
+ * Only hosts with `followIp` set are updated, since any device on the network
+ * can send frames with the MAC address of a host. The new address must be
+ * leased to the host in a DHCP ack, or seen in `SNOOP_CONFIRM_FRAMES` frames
+ * over `SNOOP_CONFIRM_TIME` without the host showing up with another address
+ * in between. Hosts defined by name are left to the resolver. The hosts file
+ * is saved at most once per `SNOOP_SAVE_DELAY`, with all the changes of that time.
+ */
+void handleSnooping();
+
+/**
+ * @brief Returns the milliseconds since a host was seen on the network.
+ *
+ * @param mac The MAC address of the host.
+ * @param age The age of the last frame of the host.
+ * @return true if the host was seen since boot, false otherwise.
+ */
+bool getLastSeen(const uint8_t mac[6], unsigned long &age);
+
+#endif
+
+#endif
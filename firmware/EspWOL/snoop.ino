@@ -0,0 +1,179 @@
+#include "snoop.h"
+
+#if ENABLE_ARP_SNOOPING == 1
+
+#include <lwip/netif.h>
+
+#define ETHERNET_HEADER 14
+#define ETHERTYPE_IPV4 0x0800
+#define ETHERTYPE_ARP 0x0806
+#define DHCP_SERVER_PORT 67
+#define DHCP_CLIENT_PORT 68
+#define DHCP_OPTIONS 240  // Offset of the options, after the magic cookie
+#define DHCP_ACK 5
+
+// Structure for the last address a host was seen with
+struct Sighting {
+  uint32_t ip = 0;               // Network byte order, 0 if never seen
+  unsigned long seenAt = 0;
+  unsigned long firstSeenAt = 0; // millis() of the first frame with this address
+  uint8_t frames = 0;            // Frames with this address, up to SNOOP_CONFIRM_FRAMES
+  bool leased = false;           // This address was leased to the host in a DHCP ack
+};
+
+static std::unordered_map<uint64_t, Sighting> sightings;
+static netif_input_fn forwardInput = nullptr;
+static WiFiEventHandler snoopGotIPHandler;
+static unsigned long snoopCheckedAt = 0;
+static unsigned long snoopChangedAt = 0;
+static bool snoopChanged = false;
+
+static inline uint16_t readUint16(const uint8_t *data) {
+  return data[0] << 8 | data[1];
+}
+
+// Runs in the lwIP context with every frame, so it only looks up the table, never allocates
+static void recordSighting(const uint8_t *mac, const uint8_t *address, const struct netif *netif, bool leased = false) {
+  ip4_addr_t ip;
+  memcpy(&ip.addr, address, 4);
+  if (!ip.addr || !ip4_addr_netcmp(&ip, netif_ip4_addr(netif), netif_ip4_netmask(netif))) {
+    return;  // ARP probes and routed traffic, whose source MAC is the router's
+  }
+  auto it = sightings.find(macKey(mac));
+  if (it == sightings.end()) {
+    return;
+  }
+  Sighting &sighting = it->second;
+  sighting.seenAt = millis();
+  if (sighting.ip != ip.addr) {
+    sighting.ip = ip.addr;
+    sighting.firstSeenAt = sighting.seenAt;
+    sighting.frames = 0;
+    sighting.leased = false;
+  }
+  if (sighting.frames < SNOOP_CONFIRM_FRAMES) {
+    sighting.frames++;
+  }
+  sighting.leased |= leased;
+}
+
+// DHCP acks sent as broadcasts tell the address leased to a client
+static void inspectDhcp(const uint8_t *dhcp, size_t length, const struct netif *netif) {
+  if (length < DHCP_OPTIONS || dhcp[0] != 2 || dhcp[2] != 6) {
+    return;  // Not a reply for an Ethernet address
+  }
+  for (size_t i = DHCP_OPTIONS; i + 2 < length && dhcp[i] != 255; i += dhcp[i] ? 2 + dhcp[i + 1] : 1) {
+    if (dhcp[i] == 53 && dhcp[i + 1] == 1 && dhcp[i + 2] == DHCP_ACK) {
+      recordSighting(dhcp + 28, dhcp + 16, netif, true);  // chaddr, yiaddr
+      return;
+    }
+  }
+}
+
+static err_t snoopInput(struct pbuf *p, struct netif *netif) {
+  const uint8_t *frame = (const uint8_t *)p->payload;
+  size_t length = p->len;  // Headers are always in the first pbuf
+  if (length >= ETHERNET_HEADER + 28 && readUint16(frame + 12) == ETHERTYPE_ARP) {
+    const uint8_t *arp = frame + ETHERNET_HEADER;
+    if (readUint16(arp) == 1 && readUint16(arp + 2) == ETHERTYPE_IPV4) {
+      recordArpSender(arp + 14);
+      recordSighting(arp + 8, arp + 14, netif);  // Sender hardware and protocol addresses
+    }
+  } else if (length >= ETHERNET_HEADER + 20 && readUint16(frame + 12) == ETHERTYPE_IPV4 && (frame[0] & 0x01)) {
+    // Broadcasts and multicasts only: the device is not their sole recipient, so they tell about the others
+    const uint8_t *ip = frame + ETHERNET_HEADER;
+    size_t header = (ip[0] & 0x0F) * 4;
+    recordSighting(frame + 6, ip + 12, netif);
+    if (ip[9] == 17 && header >= 20 && length >= ETHERNET_HEADER + header + 8) {
+      const uint8_t *udp = ip + header;
+      if (readUint16(udp) == DHCP_SERVER_PORT && readUint16(udp + 2) == DHCP_CLIENT_PORT) {
+        inspectDhcp(udp + 8, length - ETHERNET_HEADER - header - 8, netif);
+      }
+    }
+  }
+  return forwardInput(p, netif);
+}
+
+// lwIP sets the input function of the interface when the station connects, so the hook is installed again
+static void hookStationInput() {
+  ip4_addr_t address;
+  address.addr = WiFi.localIP();
+  struct netif *netif = ip4_route(&address);
+  if (!netif || netif->input == snoopInput) {
+    return;
+  }
+  forwardInput = netif->input;
+  netif->input = snoopInput;
+}
+
+void setupSnooping() {
+  if (WiFi.status() == WL_CONNECTED) {
+    hookStationInput();
+  }
+  snoopGotIPHandler = WiFi.onStationModeGotIP([](const WiFiEventStationModeGotIP &) {
+    hookStationInput();
+  });
+}
+
+void syncSnoopedHosts() {
+  for (auto it = sightings.begin(); it != sightings.end();) {
+    it = macIndex.count(it->first) ? std::next(it) : sightings.erase(it);
+  }
+  for (uint64_t key : macIndex) {
+    sightings[key];
+  }
+}
+
+bool getLastSeen(const uint8_t mac[6], unsigned long &age) {
+  auto it = sightings.find(macKey(mac));
+  if (it == sightings.end() || !it->second.ip) {
+    return false;
+  }
+  age = millis() - it->second.seenAt;
+  return true;
+}
+
+void handleSnooping() {
+  unsigned long now = millis();
+  if (now - snoopCheckedAt < SNOOP_CHECK_INTERVAL) {
+    limitSleep(SNOOP_CHECK_INTERVAL - (now - snoopCheckedAt));
+    return;
+  }
+  snoopCheckedAt = now;
+
+  for (auto &[id, host] : hosts) {
+    if (!host.followIp) {
+      continue;
+    }
+    auto it = sightings.find(macKey(host.macBytes));
+    if (it == sightings.end() || !it->second.ip || now - it->second.seenAt > SNOOP_UP_WINDOW || !isValidIPAddress(host.ip)) {
+      continue;
+    }
+    const Sighting &sighting = it->second;
+    String ip = IPAddress(sighting.ip).toString();
+    if (ip == host.ip) {
+      continue;
+    }
+    // A single frame may carry a spoofed MAC address
+    if (!sighting.leased && (sighting.frames < SNOOP_CONFIRM_FRAMES || now - sighting.firstSeenAt < SNOOP_CONFIRM_TIME)) {
+      continue;
+    }
+
+    // A new DHCP lease: the host keeps its MAC, the stored address follows it
+    releaseWakeTarget(id);
+    host.ip = ip;
+    resolveWakeTarget(id);
+    touchDatabase();
+    if (!snoopChanged) {
+      snoopChanged = true;
+      snoopChangedAt = now;
+    }
+  }
+
+  if (snoopChanged && now - snoopChangedAt >= SNOOP_SAVE_DELAY) {
+    snoopChanged = false;
+    saveHostsData();
+  }
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef STATION_H
+#define STATION_H
+
+#define STATION_FAST_TIMEOUT 4000  // Milliseconds for the association with the cached access point, before WiFiManager
+#define STATION_RTC_OFFSET 64      // Block of the cache in the RTC user memory: the OTA boot command of eboot uses the first blocks
+#define STATION_RETRY_INTERVAL 30000  // Milliseconds between two connections of the station while the configuration portal runs
+#define STATION_RETRY_TIMEOUT 10000   // Milliseconds for each of them, before the radio goes back to the channel of the portal
+#define STATION_APPLY_DELAY 300       // Milliseconds for the response to be sent before the network settings change
+#define STATION_ROLLBACK_TIMEOUT 60000  // Milliseconds for a request to reach the device on its new address, before the previous network settings are restored
+
+struct NetworkConfig;
+
+// Last good connection of the station: kept in RTC memory across restarts, and in flash across power cuts
+struct StationCache {
+  uint32_t crc = 0;          // Of the fields below, for the copy in RTC memory
+  char ssid[33] = "";
+  uint8_t channel = 0;       // 0 if nothing is cached
+  uint8_t bssid[6] = {};
+  uint32_t ip = 0;           // DHCP lease, only reused from RTC memory: after a power cut it may be gone
+  uint32_t gateway = 0;
+  uint32_t networkMask = 0;
+  uint32_t dns = 0;
+  uint32_t fastConnects = 0; // Boots connected with the cache, since power on
+  uint32_t fallbacks = 0;    // Boots connected by WiFiManager, since power on
+};
+
+// Connection of the station at boot
+struct StationStats {
+  bool fast = false;              // Connected with the cache
+  unsigned long connectTime = 0;  // Milliseconds from boot to the first connection, 0 if not connected yet
+  unsigned long readyTime = 0;    // Milliseconds from boot to the end of setup()
+  uint32_t fastConnects = 0;      // Boots connected with the cache, since power on
+  uint32_t fallbacks = 0;         // Boots connected by WiFiManager, since power on
+};
+
+/**
+ * @brief Associates with the access point of the last connection, on its channel and BSSID.
+ *
+ * Skips the scan of a full connection, and the DHCP exchange after a restart.
+ * Waits at most `STATION_FAST_TIMEOUT`. The credentials are the ones saved by
+ * WiFiManager; without a cache for them, returns right away.
+ *
+ * @return true if the station is connected, false if WiFiManager has to connect it.
+ */
+bool connectCachedStation();
+
+/**
+ * @brief Starts the WiFiManager configuration portal without blocking.
+ *
+ * Called when `connectCachedStation()` fails. The portal is served by
+ * `handleStation()` while the station keeps connecting in the background with
+ * the saved credentials; the portal is closed by the first connection.
+ */
+void startStationPortal();
+
+/**
+ * @brief Records the end of the boot. Called at the end of `setup()`.
+ */
+void setupStation();
+
+/**
+ * @brief Runs the configuration portal, and saves the connection to the cache after a new one. Called from `loop()`.
+ *
+ * @return true once, when the station connects and the portal is closed.
+ */
+bool handleStation();
+
+/**
+ * @brief Returns true once the station connected, with the configuration portal closed.
+ */
+bool isStationReady();
+
+/**
+ * @brief Changes the network settings without a restart.
+ *
+ * `config` becomes `networkConfig` and is applied by `handleStation()` after
+ * `STATION_APPLY_DELAY`, so the response leaves on the current address. It is
+ * only saved once `confirmNetworkSettings()` sees a request on the new address;
+ * without one within `STATION_ROLLBACK_TIMEOUT`, the saved settings are applied again.
+ *
+ * @param config The new network settings.
+ */
+void changeNetworkSettings(const NetworkConfig &config);
+
+/**
+ * @brief Saves the network settings being tried when the current request reached the device on its new address.
+ *
+ * Called after each HTTP request, see `apiRoute()`.
+ */
+void confirmNetworkSettings();
+
+/**
+ * @brief Returns the connection of the station at boot.
+ */
+const StationStats &getStationStats();
+
+#endif
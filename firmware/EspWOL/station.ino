@@ -0,0 +1,203 @@
+#include "station.h"
+
+#include <coredecls.h>
+
+static StationStats stationStats;
+static bool stationConnected = false;  // Set by the event handler, the cache is written by handleStation()
+static WiFiEventHandler stationGotIPHandler;
+static bool stationReady = false;
+static bool stationRetrying = false;  // Connection in progress while the portal runs
+static unsigned long stationRetryAt = 0;
+static NetworkConfig savedNetworkConfig;  // Restored when the settings being tried are not confirmed
+static bool networkChangePending = false; // Applied after STATION_APPLY_DELAY
+static bool networkTrial = false;         // Applied, waiting for a request on the new address
+static unsigned long networkChangeAt = 0;
+
+const StationStats &getStationStats() {
+  return stationStats;
+}
+
+bool isStationReady() {
+  return stationReady;
+}
+
+static uint32_t stationCacheCrc() {
+  return crc32((const uint8_t *)&stationCache + sizeof(stationCache.crc), sizeof(stationCache) - sizeof(stationCache.crc));
+}
+
+static_assert(STATION_RTC_OFFSET >= 32 && STATION_RTC_OFFSET * 4 + sizeof(StationCache) <= 512, "The station cache must fit in the RTC user memory, after the OTA boot command");
+
+static bool readStationRtc() {
+  return ESP.rtcUserMemoryRead(STATION_RTC_OFFSET, (uint32_t *)&stationCache, sizeof(stationCache)) && stationCache.crc == stationCacheCrc();
+}
+
+static void writeStationRtc() {
+  stationCache.crc = stationCacheCrc();
+  ESP.rtcUserMemoryWrite(STATION_RTC_OFFSET, (uint32_t *)&stationCache, sizeof(stationCache));
+}
+
+bool connectCachedStation() {
+  stationGotIPHandler = WiFi.onStationModeGotIP([](const WiFiEventStationModeGotIP &) {
+    if (!stationStats.connectTime) {
+      stationStats.connectTime = millis();
+    }
+    stationConnected = true;
+  });
+
+  if (!readStationRtc()) {
+    // Power on: the access point from flash, without the counters and the lease
+    stationCache = StationCache();
+    loadStationCache();
+  }
+
+  String ssid = WiFi.SSID();  // Saved by WiFiManager
+  String password = WiFi.psk();
+  if (stationCache.channel && !ssid.isEmpty() && ssid == stationCache.ssid) {
+    bool lease = !networkConfig.enable && stationCache.ip;
+    WiFi.persistent(false);  // The saved configuration keeps no BSSID, so the next full connection can pick another access point
+    WiFi.mode(WIFI_STA);
+    if (networkConfig.enable) {
+      WiFi.config(networkConfig.ip, networkConfig.gateway, networkConfig.networkMask, networkConfig.dns);
+    } else if (lease) {
+      WiFi.config(IPAddress(stationCache.ip), IPAddress(stationCache.gateway), IPAddress(stationCache.networkMask), IPAddress(stationCache.dns));
+    }
+    WiFi.begin(ssid.c_str(), password.c_str(), stationCache.channel, stationCache.bssid);
+    WiFi.persistent(true);
+
+    unsigned long start = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - start < STATION_FAST_TIMEOUT) {
+      delay(10);
+    }
+    stationStats.fast = WiFi.status() == WL_CONNECTED;
+    if (lease) {
+      // Back to DHCP: the lease is renewed in the background while the cached address is used
+      WiFi.config(0u, 0u, 0u);
+    }
+    if (!stationStats.fast) {
+      wifi_station_disconnect();  // Not WiFi.disconnect(), which erases the saved credentials
+    }
+  }
+
+  if (stationStats.fast) {
+    stationCache.fastConnects++;
+  } else {
+    stationCache.fallbacks++;
+  }
+  stationStats.fastConnects = stationCache.fastConnects;
+  stationStats.fallbacks = stationCache.fallbacks;
+  writeStationRtc();
+  return stationStats.fast;
+}
+
+void startStationPortal() {
+  wifiManager.setConfigPortalBlocking(false);
+  wifiManager.autoConnect(SSID);  // Returns at once when the saved credentials fail, with the portal running
+  stationRetryAt = millis() + STATION_RETRY_INTERVAL;
+}
+
+void setupStation() {
+  stationReady = !wifiManager.getConfigPortalActive();
+  stationStats.readyTime = millis();
+  if (!stationStats.connectTime && WiFi.status() == WL_CONNECTED) {
+    stationStats.connectTime = stationStats.readyTime;
+    stationConnected = true;
+  }
+}
+
+void changeNetworkSettings(const NetworkConfig &config) {
+  if (!networkTrial && !networkChangePending) {
+    savedNetworkConfig = networkConfig;
+  }
+  networkConfig = config;
+  touchDatabase();  // Not saved yet, but GET '/networkSettings' must not answer 304
+  networkChangePending = true;
+  networkTrial = false;
+  networkChangeAt = millis() + STATION_APPLY_DELAY;
+}
+
+void confirmNetworkSettings() {
+  if (networkTrial && server.client().localIP() == WiFi.localIP()) {
+    networkTrial = false;
+    saveNetworkConfig();
+  }
+}
+
+static void handleNetworkChange() {
+  long left = networkChangeAt - millis();
+  if (networkChangePending) {
+    if (left > 0) {
+      limitSleep(left);
+      return;
+    }
+    networkChangePending = false;
+    networkTrial = true;
+    networkChangeAt = millis() + STATION_ROLLBACK_TIMEOUT;
+    applyNetworkSettings();
+  } else if (networkTrial) {
+    if (left > 0) {
+      limitSleep(left);
+      return;
+    }
+    // Unreachable on the new address: back to the saved settings
+    networkTrial = false;
+    networkConfig = savedNetworkConfig;
+    touchDatabase();
+    applyNetworkSettings();
+  }
+}
+
+// Returns true when the station connected and the portal is closed
+static bool handleStationPortal() {
+  limitSleep(0);  // The portal answers its DNS queries and pages from the loop
+  wifiManager.process();  // Connects with the credentials entered in the portal
+  if (WiFi.status() == WL_CONNECTED) {
+    if (wifiManager.getConfigPortalActive()) {
+      wifiManager.stopConfigPortal();
+    }
+    stationReady = true;
+    return true;
+  }
+
+  if ((long)(millis() - stationRetryAt) >= 0) {
+    if (stationRetrying) {
+      // The station scans every channel while it connects, which cuts the clients of the portal off
+      wifi_station_disconnect();
+      stationRetryAt = millis() + STATION_RETRY_INTERVAL;
+    } else {
+      WiFi.begin();  // With the saved credentials
+      stationRetryAt = millis() + STATION_RETRY_TIMEOUT;
+    }
+    stationRetrying = !stationRetrying;
+  }
+  return false;
+}
+
+bool handleStation() {
+  bool ready = !stationReady && handleStationPortal();
+  handleNetworkChange();
+  if (!stationConnected || WiFi.status() != WL_CONNECTED) {
+    return ready;
+  }
+  stationConnected = false;
+
+  String ssid = WiFi.SSID();
+  const uint8_t *bssid = WiFi.BSSID();
+  uint8_t channel = WiFi.channel();
+  bool moved = ssid != stationCache.ssid || channel != stationCache.channel || memcmp(bssid, stationCache.bssid, 6);
+  strncpy(stationCache.ssid, ssid.c_str(), sizeof(stationCache.ssid) - 1);
+  stationCache.channel = channel;
+  memcpy(stationCache.bssid, bssid, 6);
+  if (networkConfig.enable) {
+    stationCache.ip = 0;
+  } else {
+    stationCache.ip = WiFi.localIP();
+    stationCache.gateway = WiFi.gatewayIP();
+    stationCache.networkMask = WiFi.subnetMask();
+    stationCache.dns = WiFi.dnsIP();
+  }
+  writeStationRtc();
+  if (moved) {
+    saveStationCache();  // Flash is only written when the access point changes
+  }
+  return ready;
+}
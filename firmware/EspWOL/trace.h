@@ -0,0 +1,58 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#define TRACE_BUFFER_SIZE 128
+
+#if ENABLE_TRACE == 1
+
+// Structure for a recorded span
+struct TraceRecord {
+  uint16_t request;   // Request sequence number, from 1 and wrapping back to 1; 0 outside of a request
+  uint8_t depth;      // Nesting level inside the request
+  const char *name;   // Route or phase name (string literal)
+  uint32_t start;     // Cycles since the request started
+  uint32_t cycles;    // Span duration in CPU cycles
+  uint32_t time;      // millis() when the span ended
+};
+
+/**
+ * @brief Measures the lifetime of a scope in CPU cycles.
+ *
+ * The span is stored in the trace ring buffer when the object is destroyed.
+ * Use the `TRACE_REQUEST` and `TRACE_SPAN` macros instead of this class, so
+ * the instrumentation disappears when `ENABLE_TRACE` is disabled.
+ */
+class TraceSpan {
+public:
+  /**
+   * @param name The span name. Must be a string literal, only the pointer is kept.
+   * @param request True to start a new request, false for a phase of the current one.
+   */
+  TraceSpan(const char *name, bool request);
+  ~TraceSpan();
+
+private:
+  const char *name;
+  uint32_t start;
+  uint16_t request;
+  uint8_t depth;
+};
+
+/**
+ * @brief Streams the trace ring buffer as JSON to the current client, oldest span first.
+ */
+void streamTrace();
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_REQUEST(name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name, true)
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name, false)
+
+#else
+
+#define TRACE_REQUEST(name)
+#define TRACE_SPAN(name)
+
+#endif
+
+#endif
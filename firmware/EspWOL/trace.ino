@@ -0,0 +1,66 @@
+#include "trace.h"
+
+#if ENABLE_TRACE == 1
+
+static TraceRecord traceRecords[TRACE_BUFFER_SIZE];
+static uint16_t traceHead = 0;
+static uint16_t traceCount = 0;
+static uint16_t traceRequest = 0;
+static uint32_t traceRequestStart = 0;
+static uint8_t traceDepth = 0;
+
+TraceSpan::TraceSpan(const char *name, bool request)
+  : name(name), start(ESP.getCycleCount()), depth(traceDepth++) {
+  if (request) {
+    if (++traceRequest == 0) {
+      traceRequest = 1;  // Wrapped: 0 is reserved for the spans outside of a request
+    }
+    traceRequestStart = start;
+  }
+  // Spans outside of a request (e.g. periodic tasks in loop()) are reported as request 0
+  this->request = request || depth ? traceRequest : 0;
+}
+
+TraceSpan::~TraceSpan() {
+  uint32_t end = ESP.getCycleCount();
+  traceDepth--;
+
+  TraceRecord &record = traceRecords[traceHead];
+  record.request = request;
+  record.depth = depth;
+  record.name = name;
+  record.start = request ? start - traceRequestStart : 0;
+  record.cycles = end - start;
+  record.time = millis();
+
+  traceHead = (traceHead + 1) % TRACE_BUFFER_SIZE;
+  if (traceCount < TRACE_BUFFER_SIZE) {
+    traceCount++;
+  }
+}
+
+void streamTrace() {
+  // Snapshot the ring position: spans of this request are recorded while streaming
+  uint16_t count = traceCount;
+  uint16_t first = (traceHead + TRACE_BUFFER_SIZE - count) % TRACE_BUFFER_SIZE;
+  uint32_t cyclesPerMicrosecond = ESP.getCpuFreqMHz();
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+
+  {
+    ChunkedWriter writer;
+    writer.append(PSTR("{\"cpuFreqMHz\":%lu,\"spans\":["), (unsigned long)cyclesPerMicrosecond);
+    for (uint16_t i = 0; i < count; i++) {
+      const TraceRecord &record = traceRecords[(first + i) % TRACE_BUFFER_SIZE];
+      writer.append(PSTR("%s{\"request\":%u,\"depth\":%u,\"name\":\"%s\",\"time\":%lu,\"start\":%lu,\"cycles\":%lu,\"us\":%lu}"),
+                    i ? "," : "", record.request, record.depth, record.name, (unsigned long)record.time,
+                    (unsigned long)record.start, (unsigned long)record.cycles, (unsigned long)(record.cycles / cyclesPerMicrosecond));
+    }
+    writer.append(PSTR("]}"));
+  }
+
+  server.sendContent("");
+}
+
+#endif
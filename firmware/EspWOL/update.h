@@ -0,0 +1,132 @@
+#ifndef UPDATE_H
+#define UPDATE_H
+
+#define UPDATE_CHECK_INTERVAL (6UL * 60 * 60 * 1000)  // Time between background update checks
+#define UPDATE_RETRY_INTERVAL (5UL * 60 * 1000)       // Time before retrying a failed check, doubled with each failure
+#define UPDATE_CHECK_HOST "raw.githubusercontent.com" // Server of the release information, resolved before a check
+#define UPDATE_CHUNK_SIZE 4096                        // Maximum firmware bytes written per loop() iteration
+#define UPDATE_READ_BUFFER_SIZE 512                   // Size of the buffer used to copy the firmware
+#define UPDATE_STALL_TIMEOUT 15000                    // Time without data before the download fails
+#define UPDATE_CONNECT_TIMEOUT 3000                   // Bound of each blocking step of the connection: TCP, TLS and response headers
+#define UPDATE_MAX_REDIRECTS 2                        // GitHub redirects release assets once, to its storage
+#define UPDATE_REBOOT_DELAY 2000                      // Time left to the UI to see the result before rebooting
+
+// Structure for the cached result of the last update check
+struct UpdateInfo {
+  bool checked = false;                           // A check has succeeded since boot
+  bool available = false;                         // A newer version was found
+  String lastVersion;                             // Latest released version
+  String notes;                                   // Release notes of the latest version
+  String bin;                                     // Firmware URL of the latest version
+  unsigned long checkedAt = 0;                    // millis() of the last successful check
+  bool attempted = false;                         // A check has run since boot
+  unsigned long attemptedAt = 0;                  // millis() of the last check
+  AutoOTA::Error error = AutoOTA::Error::None;    // Error of the last check
+  uint8_t failures = 0;                           // Checks failed in a row
+};
+
+// Stages of a firmware update
+enum class UpdateStage {
+  Idle,
+  Connecting,
+  Downloading,
+  Installing,
+  Rebooting,
+  Failed
+};
+
+// Structure for the progress of a firmware update
+struct UpdateProgress {
+  UpdateStage stage = UpdateStage::Idle;
+  size_t written = 0;  // Bytes written to flash
+  size_t size = 0;     // Firmware size, 0 while unknown
+  String error;        // Reason of the failure
+};
+
+/**
+ * @brief Returns the cached result of the last update check.
+ *
+ * Never touches the network, so it can be served immediately by the API.
+ */
+const UpdateInfo &getUpdateInfo();
+
+/**
+ * @brief Tells whether the cached update information is out of date.
+ *
+ * The information is stale when no check has succeeded yet, the last check
+ * failed, a check is pending or the last success is older than
+ * `UPDATE_CHECK_INTERVAL`.
+ */
+bool isUpdateInfoStale();
+
+/**
+ * @brief Tells whether a check has been requested and not run yet.
+ */
+bool isUpdateCheckPending();
+
+/**
+ * @brief Requests an update check on the next `loop()` iteration.
+ */
+void requestUpdateCheck();
+
+/**
+ * @brief Checks for updates now and refreshes the cached information.
+ *
+ * Blocks for an HTTPS round trip to GitHub.
+ *
+ * @return true if the check succeeded (including when there is no update).
+ */
+bool refreshUpdateInfo();
+
+/**
+ * @brief Runs the background update check when it is due.
+ *
+ * Called from `loop()`. A check is due once after boot, when requested and
+ * every `UPDATE_CHECK_INTERVAL`. After a failure it is retried after
+ * `UPDATE_RETRY_INTERVAL`, doubled with each failure in a row up to
+ * `UPDATE_CHECK_INTERVAL`.
+ *
+ * The check itself blocks, so it only runs once the network has a way out:
+ * WiFi connected with a gateway and a DNS server, and `UPDATE_CHECK_HOST`
+ * resolved by the non-blocking resolver. A name that does not resolve counts
+ * as a failed check without any request being made.
+ */
+void handleUpdateCheck();
+
+/**
+ * @brief Starts downloading and installing a firmware image.
+ *
+ * Only prepares the download; the work is done by `handleUpdateDownload()`
+ * so the device keeps serving requests meanwhile.
+ *
+ * @param url The firmware URL (http or https).
+ * @return false if an update is already running.
+ */
+bool startUpdateDownload(const String &url);
+
+/**
+ * @brief Advances the running firmware update by one step.
+ *
+ * Called from `loop()`. Resolves the server with the non-blocking resolver,
+ * connects, then writes at most `UPDATE_CHUNK_SIZE` bytes to flash per call,
+ * and finally installs the image and reboots.
+ *
+ * The connection is the only blocking step: HTTPClient sends the request and
+ * reads the response headers in one call, following redirects. Each TCP
+ * connection, TLS handshake and header read is bounded by
+ * `UPDATE_CONNECT_TIMEOUT`, over at most `1 + UPDATE_MAX_REDIRECTS` servers,
+ * so `loop()` stalls for at most 27 seconds, once per update.
+ */
+void handleUpdateDownload();
+
+/**
+ * @brief Returns the progress of the current firmware update.
+ */
+const UpdateProgress &getUpdateProgress();
+
+/**
+ * @brief Converts an update stage to the name used by the API.
+ */
+const char *updateStageToString(UpdateStage stage);
+
+#endif
@@ -0,0 +1,269 @@
+#include "update.h"
+
+static UpdateInfo updateInfo;
+static bool updateCheckRequested = true;  // Check once after boot
+
+static UpdateProgress updateProgress;
+static String updateUrl;
+static HTTPClient updateHttp;
+static std::unique_ptr<WiFiClient> updateClient;
+static unsigned long updateLastData = 0;
+static unsigned long updateRebootAt = 0;
+
+const UpdateInfo &getUpdateInfo() {
+  return updateInfo;
+}
+
+bool isUpdateInfoStale() {
+  return !updateInfo.checked || updateInfo.error != AutoOTA::Error::None || updateCheckRequested
+         || millis() - updateInfo.checkedAt >= UPDATE_CHECK_INTERVAL;
+}
+
+bool isUpdateCheckPending() {
+  return updateCheckRequested;
+}
+
+void requestUpdateCheck() {
+  updateCheckRequested = true;
+}
+
+// Records a failed check, which is retried later
+static void failUpdateCheck(AutoOTA::Error error) {
+  updateInfo.error = error;
+  if (updateInfo.failures < 255) {
+    updateInfo.failures++;
+  }
+}
+
+bool refreshUpdateInfo() {
+  String version, notes, bin;
+  {
+    TRACE_SPAN("update check");
+    ota.checkUpdate(&version, &notes, &bin);
+  }
+
+  updateCheckRequested = false;
+  updateInfo.attempted = true;
+  updateInfo.attemptedAt = millis();
+
+  if (ota.hasError() && ota.getError() != AutoOTA::Error::NoUpdates) {
+    failUpdateCheck(ota.getError());
+    return false;
+  }
+
+  updateInfo.error = AutoOTA::Error::None;
+  updateInfo.failures = 0;
+  updateInfo.checked = true;
+  updateInfo.checkedAt = updateInfo.attemptedAt;
+  updateInfo.available = ota.hasUpdate();
+  updateInfo.lastVersion = version.isEmpty() ? ota.version() : version;
+  updateInfo.notes = notes;
+  updateInfo.bin = bin;
+  return true;
+}
+
+static bool isUpdateRunning() {
+  return updateProgress.stage != UpdateStage::Idle && updateProgress.stage != UpdateStage::Failed;
+}
+
+// Time after the last check before the next one, backing off after failures
+static unsigned long updateCheckInterval() {
+  unsigned long interval = UPDATE_RETRY_INTERVAL;
+  for (uint8_t i = 1; i < updateInfo.failures && interval < UPDATE_CHECK_INTERVAL; i++) {
+    interval *= 2;
+  }
+  return updateInfo.failures ? std::min(interval, UPDATE_CHECK_INTERVAL) : UPDATE_CHECK_INTERVAL;
+}
+
+void handleUpdateCheck() {
+  if (WiFi.status() != WL_CONNECTED || isUpdateRunning() || !WiFi.gatewayIP().isSet() || !WiFi.dnsIP().isSet()) {
+    return;
+  }
+
+  bool due = updateCheckRequested || (updateInfo.attempted && millis() - updateInfo.attemptedAt >= updateCheckInterval());
+  if (!due) {
+    return;
+  }
+
+  // Without a route out, the HTTPS request would block loop() until its timeout
+  IPAddress ip;
+  switch (resolveHost(UPDATE_CHECK_HOST, ip)) {
+    case ResolveState::Pending:
+      return;
+    case ResolveState::Failed:
+      updateCheckRequested = false;
+      updateInfo.attempted = true;
+      updateInfo.attemptedAt = millis();
+      failUpdateCheck(AutoOTA::Error::Connect);
+      return;
+    case ResolveState::Resolved:
+      refreshUpdateInfo();
+      return;
+  }
+}
+
+const UpdateProgress &getUpdateProgress() {
+  return updateProgress;
+}
+
+const char *updateStageToString(UpdateStage stage) {
+  switch (stage) {
+    case UpdateStage::Idle: return "idle";
+    case UpdateStage::Connecting: return "connecting";
+    case UpdateStage::Downloading: return "downloading";
+    case UpdateStage::Installing: return "installing";
+    case UpdateStage::Rebooting: return "rebooting";
+    case UpdateStage::Failed: return "failed";
+    default: return "unknown";
+  }
+}
+
+static void failUpdate(const String &error) {
+  if (Update.isRunning()) {
+    Update.end();  // Discards the partially written image
+  }
+  updateHttp.end();
+  updateClient.reset();
+  updateProgress.stage = UpdateStage::Failed;
+  updateProgress.error = error;
+}
+
+bool startUpdateDownload(const String &url) {
+  if (isUpdateRunning()) {
+    return false;
+  }
+  updateUrl = url;
+  updateProgress = UpdateProgress();
+  updateProgress.stage = UpdateStage::Connecting;
+  return true;
+}
+
+// Returns the host name of a URL
+static String urlHost(const String &url) {
+  int start = url.indexOf("://");
+  start = start < 0 ? 0 : start + 3;
+  int end = start;
+  while (end < (int)url.length() && url[end] != '/' && url[end] != ':') {
+    end++;
+  }
+  return url.substring(start, end);
+}
+
+// Sends the request and prepares the flash for the image, once the server resolves
+static void connectUpdate() {
+  // HTTPClient looks the name up again, blocking: resolving it first makes sure the DNS server answers it
+  IPAddress ip;
+  String host = urlHost(updateUrl);
+  ResolveState resolved = resolveHost(host, ip);
+  if (resolved == ResolveState::Pending) {
+    return;
+  }
+  if (resolved == ResolveState::Failed) {
+    failUpdate(String("Cannot resolve ") + host);
+    return;
+  }
+
+  if (updateUrl.startsWith("https://")) {
+    BearSSL::WiFiClientSecure *client = new BearSSL::WiFiClientSecure();
+    client->setInsecure();
+    updateClient.reset(client);
+  } else {
+    updateClient.reset(new WiFiClient());
+  }
+  updateClient->setTimeout(UPDATE_CONNECT_TIMEOUT);
+
+  updateHttp.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+  updateHttp.setRedirectLimit(UPDATE_MAX_REDIRECTS);
+  updateHttp.setTimeout(UPDATE_CONNECT_TIMEOUT);
+  if (!updateHttp.begin(*updateClient, updateUrl)) {
+    failUpdate("Invalid firmware URL");
+    return;
+  }
+
+  int code = updateHttp.GET();
+  if (code != HTTP_CODE_OK) {
+    failUpdate(code < 0 ? updateHttp.errorToString(code) : String("HTTP error ") + code);
+    return;
+  }
+
+  int size = updateHttp.getSize();
+  if (size <= 0) {
+    failUpdate("Unknown firmware size");
+    return;
+  }
+  if (!Update.begin(size)) {
+    failUpdate(Update.getErrorString());
+    return;
+  }
+
+  updateProgress.size = size;
+  updateProgress.stage = UpdateStage::Downloading;
+  updateLastData = millis();
+}
+
+// Copies at most UPDATE_CHUNK_SIZE bytes from the connection to flash
+static void downloadUpdate() {
+  static uint8_t buffer[UPDATE_READ_BUFFER_SIZE];
+  WiFiClient *stream = updateHttp.getStreamPtr();
+
+  size_t copied = 0;
+  while (copied < UPDATE_CHUNK_SIZE && updateProgress.written < updateProgress.size) {
+    size_t available = stream->available();
+    if (!available) {
+      break;
+    }
+    size_t length = std::min({ available, sizeof(buffer), updateProgress.size - updateProgress.written });
+    int received = stream->read(buffer, length);
+    if (received <= 0) {
+      break;
+    }
+    if (Update.write(buffer, received) != (size_t)received) {
+      failUpdate(Update.getErrorString());
+      return;
+    }
+    updateProgress.written += received;
+    copied += received;
+  }
+
+  if (copied) {
+    updateLastData = millis();
+  } else if (!stream->connected() || millis() - updateLastData >= UPDATE_STALL_TIMEOUT) {
+    failUpdate("Download interrupted");
+    return;
+  }
+
+  if (updateProgress.written >= updateProgress.size) {
+    updateProgress.stage = UpdateStage::Installing;
+  }
+}
+
+void handleUpdateDownload() {
+  if (isUpdateRunning()) {
+    limitSleep(0);
+  }
+  switch (updateProgress.stage) {
+    case UpdateStage::Connecting:
+      connectUpdate();
+      break;
+    case UpdateStage::Downloading:
+      downloadUpdate();
+      break;
+    case UpdateStage::Installing:
+      updateHttp.end();
+      updateClient.reset();
+      if (!Update.end()) {
+        failUpdate(Update.getErrorString());
+        break;
+      }
+      updateProgress.stage = UpdateStage::Rebooting;
+      updateRebootAt = millis() + UPDATE_REBOOT_DELAY;
+      break;
+    case UpdateStage::Rebooting:
+      if ((long)(millis() - updateRebootAt) >= 0) {
+        ESP.restart();
+      }
+      break;
+    default:
+      break;
+  }
+}
@@ -1,6 +1,9 @@
 #ifndef VALIDATION_H
 #define VALIDATION_H
 
+#define MAX_TAG_LENGTH 24
+#define MAX_TAGS_PER_HOST 8
+
 /**
  * @brief Checks if the given value is a valid periodic ping interval.
  * 
@@ -17,6 +20,26 @@ bool isValidPeriodicPing(long value);
  */
 bool isValidIPAddress(const String &ip);
 
+/**
+ * @brief Validates if the given string is a hostname, such as `nas.example.com` or `nas.local`.
+ * 
+ * The name has at most 253 characters in labels of 1 to 63 letters, digits and `-`,
+ * not starting or ending with `-`. Its last label is not numeric, so it is never
+ * taken for an IP address.
+ * 
+ * @param name The hostname to validate.
+ * @return true if the hostname is valid, false otherwise.
+ */
+bool isValidHostname(const String &name);
+
+/**
+ * @brief Validates if the given string is the address of a host: an IPv4 address or a hostname.
+ * 
+ * @param address The address to validate.
+ * @return true if the address is valid, false otherwise.
+ */
+bool isValidHostAddress(const String &address);
+
 /**
  * @brief Validates if a given password meets security requirements.
  * 
@@ -43,6 +66,37 @@ bool isValidPassword(const String &password);
  */
 bool isValidMACAddress(const String &mac);
 
+/**
+ * @brief Validates if the given string can be used as a host tag.
+ * 
+ * A tag has 1 to `MAX_TAG_LENGTH` characters among letters, digits, `-` and `_`.
+ * 
+ * @param tag The tag to validate.
+ * @return true if the tag is valid, false otherwise.
+ */
+bool isValidTag(const String &tag);
+
+/**
+ * @brief Validates if the given string can be used as the pre-shared key of the UDP control port.
+ * 
+ * The key has `CONTROL_MIN_KEY` to `CONTROL_MAX_KEY` bytes, written as pairs of hexadecimal characters.
+ * 
+ * @param key The key to validate.
+ * @return true if the key is valid, false otherwise.
+ */
+bool isValidControlKey(const String &key);
+
+/**
+ * @brief Validates if the given string can be used as the root of the MQTT topics.
+ * 
+ * The prefix has 1 to `MQTT_MAX_PREFIX` characters, no wildcard (`+`, `#`), and
+ * does not start or end with `/`.
+ * 
+ * @param prefix The prefix to validate.
+ * @return true if the prefix is valid, false otherwise.
+ */
+bool isValidTopicPrefix(const String &prefix);
+
 /**
  * @brief Checks if a new host is not duplicated (unique mac & ip)
  * 
@@ -36,6 +36,37 @@ bool isValidIPAddress(const String &ip) {
   return (sections == 3 && hasDigit);
 }
 
+bool isValidHostname(const String &name) {
+  if (name.isEmpty() || name.length() > 253)
+    return false;
+
+  int labelLength = 0;
+  bool numericLabel = true;
+  for (unsigned int i = 0; i < name.length(); i++) {
+    char c = name[i];
+
+    if (c == '.') {
+      if (labelLength == 0 || name[i - 1] == '-')
+        return false;
+      labelLength = 0;
+      numericLabel = true;
+    } else if (isAlphaNumeric(c) || c == '-') {
+      if ((labelLength == 0 && c == '-') || ++labelLength > 63)
+        return false;
+      if (!isDigit(c))
+        numericLabel = false;
+    } else {
+      return false;
+    }
+  }
+
+  return labelLength > 0 && name[name.length() - 1] != '-' && !numericLabel;
+}
+
+bool isValidHostAddress(const String &address) {
+  return isValidIPAddress(address) || isValidHostname(address);
+}
+
 bool isValidPassword(const String &password) {
   if (password.length() < 8)
     return false;
@@ -58,7 +89,7 @@ bool isValidMACAddress(const String &mac) {
   if (mac.length() != 17)
     return false;
 
-  for (int i = 0; i < mac.length(); i++) {
+  for (unsigned int i = 0; i < mac.length(); i++) {
     if (i % 3 == 2) {
       if (mac[i] != ':')
         return false;
@@ -70,6 +101,39 @@ bool isValidMACAddress(const String &mac) {
   return true;
 }
 
+bool isValidTag(const String &tag) {
+  if (tag.isEmpty() || tag.length() > MAX_TAG_LENGTH)
+    return false;
+
+  for (char c : tag) {
+    if (!isAlphaNumeric(c) && c != '-' && c != '_')
+      return false;
+  }
+  return true;
+}
+
+bool isValidControlKey(const String &key) {
+  if (key.length() % 2 || key.length() < CONTROL_MIN_KEY * 2 || key.length() > CONTROL_MAX_KEY * 2)
+    return false;
+
+  for (char c : key) {
+    if (!isHexadecimalDigit(c))
+      return false;
+  }
+  return true;
+}
+
+bool isValidTopicPrefix(const String &prefix) {
+  if (prefix.isEmpty() || prefix.length() > MQTT_MAX_PREFIX || prefix.startsWith("/") || prefix.endsWith("/"))
+    return false;
+
+  for (char c : prefix) {
+    if (c == '+' || c == '#' || c == '\0')
+      return false;
+  }
+  return true;
+}
+
 bool isHostDuplicate(const Host &newHost) {
   for (const auto &pair : hosts) {
     const Host &existingHost = pair.second;
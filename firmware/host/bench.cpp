@@ -0,0 +1,219 @@
+// Microbenchmarks of the validation, JSON and persistence paths of the sketch.
+//
+// Reports the time per call and `allocs`, the calls to malloc, calloc and
+// realloc per call. Run with --benchmark_format=json, or build the `bench`
+// target which writes benchmark.json.
+#include "sketch.cpp"
+
+#include "HostClock.h"
+
+#include <benchmark/benchmark.h>
+
+#include <stdlib.h>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void __libc_free(void *pointer);
+}
+
+static size_t allocations = 0;
+static bool countAllocations = true;
+
+// operator new and the ArduinoJson allocator both end up here
+extern "C" void *malloc(size_t size) {
+  allocations += countAllocations;
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+  allocations += countAllocations;
+  return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size) {
+  allocations += countAllocations;
+  return __libc_realloc(pointer, size);
+}
+
+extern "C" void free(void *pointer) {
+  __libc_free(pointer);
+}
+
+// Counts the allocations of the timed part of a benchmark
+class AllocationCounter {
+public:
+  explicit AllocationCounter(benchmark::State &state) : state(state), start(allocations) {}
+  ~AllocationCounter() {
+    state.counters["allocs"] = benchmark::Counter(allocations - start, benchmark::Counter::kAvgIterations);
+  }
+
+  void pause() {
+    state.PauseTiming();
+    countAllocations = false;
+  }
+
+  void resume() {
+    countAllocations = true;
+    state.ResumeTiming();
+  }
+
+private:
+  benchmark::State &state;
+  size_t start;
+};
+
+static void setupHost() {
+  static bool done = false;
+  if (done) {
+    return;
+  }
+  done = true;
+  HostClock::setManual(true);
+  char root[] = "/tmp/espwol-bench-XXXXXX";
+  LittleFS.setRoot(mkdtemp(root));
+}
+
+static Host makeHost(int i) {
+  Host host;
+  char text[24];
+  snprintf(text, sizeof(text), "host-%d", i);
+  host.name = text;
+  snprintf(text, sizeof(text), "02:00:00:%02X:%02X:%02X", (i >> 16) & 0xFF, (i >> 8) & 0xFF, i & 0xFF);
+  host.mac = text;
+  parseMACAddress(host.mac, host.macBytes);
+  snprintf(text, sizeof(text), "10.%d.%d.%d", (i >> 16) & 0xFF, (i >> 8) & 0xFF, i & 0xFF);
+  host.ip = text;
+  host.periodicPing = 60000;
+  host.tags.push_back(i % 2 ? "office" : "lab");
+  return host;
+}
+
+static void fillHosts(int count) {
+  setupHost();
+  hosts.clear();
+  timers.clear();
+  for (int i = 0; i < count; i++) {
+    hosts[i] = makeHost(i);
+  }
+  rebuildHostIndexes();
+}
+
+// Same shape as the output of GET '/hosts'
+static String exportHosts(int count) {
+  JsonDocument doc;
+  JsonArray array = doc.to<JsonArray>();
+  for (int i = 0; i < count; i++) {
+    Host host = makeHost(i);
+    JsonObject obj = array.createNestedObject();
+    obj["name"] = host.name;
+    obj["mac"] = host.mac;
+    obj["ip"] = host.ip;
+    obj["periodicPing"] = host.periodicPing / 1000;
+    addTags(obj, host.tags);
+  }
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+static const char *const IP_ADDRESSES[] = { "192.168.1.10", "10.0.0.255", "256.1.1.1", "192.168.1", "not an address" };
+static const char *const MAC_ADDRESSES[] = { "AA:BB:CC:DD:EE:FF", "aa:bb:cc:dd:ee:ff", "AA:BB:CC:DD:EE", "AA-BB-CC-DD-EE-FF", "GG:BB:CC:DD:EE:FF" };
+static const char *const PASSWORDS[] = { "Str0ng#Passw0rd", "weak", "NoDigitsHere!", "nouppercase1!", "Sh0rt!" };
+
+template <size_t N>
+static void benchValidation(benchmark::State &state, const char *const (&inputs)[N], bool (*validate)(const String &)) {
+  std::vector<String> values(inputs, inputs + N);
+  size_t i = 0;
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(validate(values[i]));
+    i = i + 1 < N ? i + 1 : 0;
+  }
+}
+
+static void BM_IsValidIPAddress(benchmark::State &state) {
+  benchValidation(state, IP_ADDRESSES, isValidIPAddress);
+}
+BENCHMARK(BM_IsValidIPAddress);
+
+static void BM_IsValidMACAddress(benchmark::State &state) {
+  benchValidation(state, MAC_ADDRESSES, isValidMACAddress);
+}
+BENCHMARK(BM_IsValidMACAddress);
+
+static void BM_IsValidPassword(benchmark::State &state) {
+  benchValidation(state, PASSWORDS, isValidPassword);
+}
+BENCHMARK(BM_IsValidPassword);
+
+// A new host, compared with all the others
+static void BM_IsHostDuplicate(benchmark::State &state) {
+  fillHosts(state.range(0));
+  Host host = makeHost(state.range(0));
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(isHostDuplicate(host));
+  }
+}
+BENCHMARK(BM_IsHostDuplicate)->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_GetHostList(benchmark::State &state) {
+  fillHosts(state.range(0));
+  server.hostRequest(HTTP_GET, "/hosts");
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    getHostList();
+  }
+}
+BENCHMARK(BM_GetHostList)->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_SaveHostsData(benchmark::State &state) {
+  fillHosts(state.range(0));
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    saveHostsData();
+  }
+}
+BENCHMARK(BM_SaveHostsData)->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_LoadHostsData(benchmark::State &state) {
+  fillHosts(state.range(0));
+  saveHostsData();
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    loadHostsData();
+  }
+}
+BENCHMARK(BM_LoadHostsData)->Arg(10)->Arg(100)->Arg(1000);
+
+// Into an empty database, like a restore
+static void BM_ImportDatabase(benchmark::State &state) {
+  String body = exportHosts(state.range(0));
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    counter.pause();
+    fillHosts(0);
+    server.hostRequest(HTTP_POST, "/import", body);
+    counter.resume();
+    handleImportDatabase();
+  }
+}
+BENCHMARK(BM_ImportDatabase)->Arg(10)->Arg(100)->Arg(1000);
+
+int main(int argc, char **argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  // The allocations and most of the time are in ArduinoJson: results are only comparable with the same version
+#ifdef ARDUINOJSON_VERSION
+  benchmark::AddCustomContext("arduinojson", ARDUINOJSON_VERSION);
+#else
+  benchmark::AddCustomContext("arduinojson", "unknown");
+#endif
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
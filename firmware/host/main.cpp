@@ -0,0 +1,47 @@
+// Runs the sketch as a Linux process: setup() once, then loop() forever.
+//
+// Each argument adds a simulated host to the LAN, see HostLan::addHost():
+//   espwol_host 192.168.1.10,AA:BB:CC:DD:EE:01,down,3000
+//
+// Environment:
+//   PORTOFF        offset added to the ports below 1024, 8000 by default: the API is on localhost:8080
+//   DATA           directory holding the LittleFS files, "data" by default
+//   CLOCK_SCALE    speed of millis() relative to the real time, 1 by default
+//   WIFI_UP_AFTER  milliseconds before the station connects, to exercise the configuration portal
+#include "sketch.cpp"
+
+#include "HostClock.h"
+#include "HostLan.h"
+#include "HostNetwork.h"
+
+#include <sys/stat.h>
+
+int main(int argc, char **argv) {
+  const char *portOffset = getenv("PORTOFF");
+  const char *data = getenv("DATA");
+  const char *wifiUpAfter = getenv("WIFI_UP_AFTER");
+
+  HostNetwork::setPortOffset(portOffset ? atoi(portOffset) : 8000);
+  LittleFS.setRoot(data ? data : "data");
+  mkdir(LittleFS.getRoot().c_str(), 0755);
+  for (int i = 1; i < argc; i++) {
+    if (!HostLan::addHost(argv[i])) {
+      fprintf(stderr, "Invalid host \"%s\", expected ip,mac[,up|down[,bootDelayMs[,icmp|noicmp[,port|nb=NAME|mdns=NAME|dns=NAME...]]]]\n", argv[i]);
+      return 1;
+    }
+  }
+  if (wifiUpAfter) {
+    static unsigned long upAt = strtoul(wifiUpAfter, nullptr, 10);
+    WiFi.hostSetConnected(false);
+    HostClock::addTask([]() {
+      if (millis() >= upAt) {
+        WiFi.hostSetConnected(true);
+      }
+    });
+  }
+
+  setup();
+  for (;;) {
+    loop();
+  }
+}
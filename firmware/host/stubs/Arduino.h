@@ -0,0 +1,121 @@
+// Stand-in for the Arduino core on Linux.
+//
+// Time is read from a controllable clock (see HostClock.h) and the pgmspace
+// helpers map to their RAM counterparts.
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+#include "WString.h"
+#include "Print.h"
+#include "IPAddress.h"
+#include "HostClock.h"
+#include "Esp.h"
+
+#include <time.h>
+
+// Sets the time zone; the host clock is already synchronized
+void configTime(const char *tz, const char *server1, const char *server2 = nullptr, const char *server3 = nullptr);
+
+#define ARDUINO 10819
+#define HOST_BUILD 1
+#define DEC 10
+#define HEX 16
+
+// pgmspace
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper *>(p))
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_float(addr) (*(const float *)(addr))
+#define pgm_read_ptr(addr) (*(const void *const *)(addr))
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define memcpy_P memcpy
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+#define sprintf_P sprintf
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+inline unsigned long millis() {
+  return HostClock::millis();
+}
+
+inline unsigned long micros() {
+  return HostClock::micros();
+}
+
+inline void delay(unsigned long ms) {
+  HostClock::delay(ms);
+}
+
+inline void delayMicroseconds(unsigned int us) {
+  HostClock::delayMicroseconds(us);
+}
+
+inline void yield() {
+  HostClock::yield();
+}
+
+inline long random(long max) {
+  return max > 0 ? rand() % max : 0;
+}
+
+inline long random(long min, long max) {
+  return min < max ? min + rand() % (max - min) : min;
+}
+
+inline void randomSeed(unsigned long seed) {
+  srand(seed);
+}
+
+inline bool isDigit(int c) {
+  return isdigit(c);
+}
+inline bool isHexadecimalDigit(int c) {
+  return isxdigit(c);
+}
+inline bool isUpperCase(int c) {
+  return isupper(c);
+}
+inline bool isLowerCase(int c) {
+  return islower(c);
+}
+inline bool isPunct(int c) {
+  return ispunct(c);
+}
+inline bool isGraph(int c) {
+  return isgraph(c);
+}
+inline bool isAlpha(int c) {
+  return isalpha(c);
+}
+inline bool isAlphaNumeric(int c) {
+  return isalnum(c);
+}
+inline bool isSpace(int c) {
+  return isspace(c);
+}
+
+using std::max;
+using std::min;
+
+#endif
@@ -0,0 +1,18 @@
+// Stand-in for ArduinoOTA; IDE uploads are not emulated.
+#ifndef HOST_ARDUINOOTA_H
+#define HOST_ARDUINOOTA_H
+
+#include <Arduino.h>
+
+class ArduinoOTAClass {
+public:
+  void setHostname(const char *) {}
+  void setPassword(const char *) {}
+  void setPort(uint16_t) {}
+  void begin(bool = true) {}
+  void handle() {}
+};
+
+extern ArduinoOTAClass ArduinoOTA;
+
+#endif
@@ -0,0 +1,70 @@
+// Stand-in for GyverLibs/AutoOTA.
+//
+// The latest release is set by the host (command line or test) instead of
+// being fetched from GitHub, so update checks never leave the machine.
+#ifndef HOST_AUTOOTA_H
+#define HOST_AUTOOTA_H
+
+#include <Arduino.h>
+
+class AutoOTA {
+public:
+  enum class Error {
+    None,
+    Connect,
+    Timeout,
+    HTTP,
+    NoVersion,
+    NoPlatform,
+    NoPath,
+    NoUpdates,
+    NoFile,
+    OtaStart,
+    OtaEnd,
+    PathError,
+    NoPort,
+  };
+
+  AutoOTA(const char *version, const char *path) : current(version), path(path) {}
+
+  bool checkUpdate(String *version = nullptr, String *notes = nullptr, String *bin = nullptr) {
+    checks++;
+    if (HostRelease::failure != Error::None) {
+      error = HostRelease::failure;
+      return false;
+    }
+    if (version) *version = HostRelease::version.isEmpty() ? current : HostRelease::version;
+    if (notes) *notes = HostRelease::notes;
+    if (bin) *bin = HostRelease::bin;
+    update = !HostRelease::version.isEmpty() && !HostRelease::version.equalsIgnoreCase(current);
+    error = update ? Error::None : Error::NoUpdates;
+    return update;
+  }
+  bool hasUpdate() const { return update; }
+  bool hasError() const { return error != Error::None; }
+  Error getError() const { return error; }
+  String version() const { return current; }
+  bool updateNow() {
+    error = Error::NoFile;
+    return false;
+  }
+  void updateAsync() {}
+  bool tick() { return false; }
+
+  // Host helpers: the release the next check will find
+  struct HostRelease {
+    static String version;
+    static String notes;
+    static String bin;
+    static Error failure;
+  };
+  unsigned long checks = 0;
+
+private:
+  String current;
+  String path;
+  bool update = false;
+  Error error = Error::None;
+};
+
+#endif
@@ -0,0 +1,50 @@
+// Stand-in for the ESP8266HTTPClient library (plain HTTP/1.1 only).
+#ifndef HOST_ESP8266HTTPCLIENT_H
+#define HOST_ESP8266HTTPCLIENT_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_FAILED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+#define HTTPC_ERROR_TOO_MANY_REDIRECTS (-12)
+
+enum followRedirects_t {
+  HTTPC_DISABLE_FOLLOW_REDIRECTS,
+  HTTPC_STRICT_FOLLOW_REDIRECTS,
+  HTTPC_FORCE_FOLLOW_REDIRECTS
+};
+
+class HTTPClient {
+public:
+  bool begin(WiFiClient &client, const String &url);
+  void end();
+  void setFollowRedirects(followRedirects_t follow) { this->follow = follow; }
+  void setTimeout(uint16_t timeout) { this->timeout = timeout; }
+  void setRedirectLimit(uint16_t limit) { redirectLimit = limit; }
+  int GET();
+  int getSize() const { return size; }
+  WiFiClient *getStreamPtr() { return client; }
+  WiFiClient &getStream() { return *client; }
+  String getString();
+  static String errorToString(int error);
+
+private:
+  bool parseUrl(const String &url);
+  int sendRequest();
+
+  WiFiClient *client = nullptr;
+  followRedirects_t follow = HTTPC_DISABLE_FOLLOW_REDIRECTS;
+  uint16_t timeout = 5000;
+  uint16_t redirectLimit = 10;
+  String host;
+  uint16_t port = 80;
+  String path;
+  String location;
+  int size = -1;
+};
+
+#endif
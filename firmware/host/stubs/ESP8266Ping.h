@@ -0,0 +1,32 @@
+// Stand-in for ESP8266Ping answering from the simulated LAN (see HostLan.h).
+#ifndef HOST_ESP8266PING_H
+#define HOST_ESP8266PING_H
+
+#include <ESP8266WiFi.h>
+
+#include "HostLan.h"
+
+class PingClass {
+public:
+  bool ping(IPAddress dest, unsigned int count = 5) {
+    lastRtt = 0;
+    HostLan::SimulatedHost *host = HostLan::find(dest);
+    bool alive = HostLan::isUp(dest) && host->answersIcmp;
+    // A real ping waits a second per unanswered request
+    delay(alive ? 1 : 1000 * (count ? count : 1));
+    if (alive) lastRtt = 1.0f;
+    return alive;
+  }
+  bool ping(const char *host, unsigned int count = 5) {
+    IPAddress ip;
+    return WiFi.hostByName(host, ip) && ping(ip, count);
+  }
+  float averageTime() const { return lastRtt; }
+
+private:
+  float lastRtt = 0;
+};
+
+extern PingClass Ping;
+
+#endif
@@ -0,0 +1,124 @@
+// Stand-in for ESP8266WebServer on a POSIX listening socket.
+//
+// Requests are served one at a time from handleClient(), with the same
+// handler, argument and response API as the ESP8266 core.
+#ifndef HOST_ESP8266WEBSERVER_H
+#define HOST_ESP8266WEBSERVER_H
+
+#include <ESP8266WiFi.h>
+
+#include <memory>
+#include <vector>
+
+#include "uri/Uri.h"
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+// Listening socket of the web server, for hasClient()
+class WiFiServer {
+public:
+  int fd = -1;
+  bool hasClient();
+};
+
+class ESP8266WebServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  explicit ESP8266WebServer(int port = 80);
+  ~ESP8266WebServer();
+
+  void begin();
+  void begin(uint16_t port);
+  void handleClient();
+  void close();
+  void stop() { close(); }
+
+  void on(const Uri &uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+  void on(const Uri &uri, HTTPMethod method, THandlerFunction handler);
+  void onNotFound(THandlerFunction handler) { notFoundHandler = handler; }
+
+  const String &uri() const { return currentUri; }
+  HTTPMethod method() const { return currentMethod; }
+  WiFiClient &client() { return currentClient; }
+
+  const String &arg(const String &name) const;
+  const String &arg(int index) const;
+  const String &argName(int index) const;
+  int args() const { return (int)currentArgs.size(); }
+  bool hasArg(const String &name) const;
+  const String &pathArg(unsigned int index) const;
+
+  void collectHeaders(const char *headerKeys[], const size_t headerKeysCount);
+  const String &header(const String &name) const;
+  bool hasHeader(const String &name) const;
+
+  bool authenticate(const char *username, const char *password);
+  void requestAuthentication();
+
+  void setContentLength(size_t length) { contentLength = length; }
+  void sendHeader(const String &name, const String &value, bool first = false);
+  void send(int code, const char *contentType = nullptr, const String &content = emptyString);
+  void send(int code, const String &contentType, const String &content) { send(code, contentType.c_str(), content); }
+  void send(int code, const char *contentType, const char *content, size_t length);
+  void send_P(int code, PGM_P contentType, PGM_P content) { send(code, contentType, content, strlen(content)); }
+  void send_P(int code, PGM_P contentType, PGM_P content, size_t length) { send(code, contentType, content, length); }
+  void sendContent(const String &content) { sendContent(content.c_str(), content.length()); }
+  void sendContent(const char *content) { sendContent(content, strlen(content)); }
+  void sendContent(const char *content, size_t size);
+  void sendContent_P(PGM_P content) { sendContent(content); }
+  void sendContent_P(PGM_P content, size_t size) { sendContent(content, size); }
+
+  // Host helpers
+  uint16_t port() const { return boundPort; }
+  int listenFd() const { return listener; }
+  WiFiServer &getServer() { server.fd = listener; return server; }
+  // Sets the current request, to call a handler directly without a socket; the response is discarded.
+  // Query arguments of `uri` are parsed.
+  void hostRequest(HTTPMethod method, const String &uri, const String &body = emptyString);
+  // Adds a header to the current request set by hostRequest()
+  void hostHeader(const String &name, const String &value) { currentHeaders.push_back(Arg{ name, value }); }
+  // Status code of the last response
+  int hostResponseCode() const { return responseCode; }
+
+private:
+  struct Route {
+    std::unique_ptr<Uri> uri;
+    HTTPMethod method;
+    THandlerFunction handler;
+  };
+  struct Arg {
+    String name;
+    String value;
+  };
+
+  bool readRequest();
+  void parseForm(const String &form);
+  void finishResponse();
+  void writeHead(int code, const char *contentType, size_t length);
+
+  int requestedPort;
+  uint16_t boundPort = 0;
+  int listener = -1;
+  WiFiServer server;
+  std::vector<Route> routes;
+  THandlerFunction notFoundHandler;
+  std::vector<String> collected;
+
+  WiFiClient currentClient;
+  String currentUri;
+  HTTPMethod currentMethod = HTTP_ANY;
+  std::vector<Arg> currentArgs;
+  std::vector<Arg> currentHeaders;
+  std::vector<String> pathArgs;
+  String responseHeaders;
+  size_t contentLength = CONTENT_LENGTH_NOT_SET;
+  bool headSent = false;
+  int responseCode = 0;
+  bool chunked = false;
+};
+
+#endif
@@ -0,0 +1,176 @@
+// Stand-in for the ESP8266WiFi library on Linux.
+//
+// The station is always "connected"; its addresses come from HostNetwork
+// and WiFiClient is a plain POSIX TCP socket.
+#ifndef HOST_ESP8266WIFI_H
+#define HOST_ESP8266WIFI_H
+
+#include <Arduino.h>
+
+#include <memory>
+
+#include "Client.h"
+
+enum WiFiMode_t { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 };
+enum WiFiSleepType_t { WIFI_NONE_SLEEP = 0, WIFI_LIGHT_SLEEP = 1, WIFI_MODEM_SLEEP = 2 };
+enum wl_status_t {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_WRONG_PASSWORD = 6,
+  WL_DISCONNECTED = 7
+};
+
+#define STATION_IF 0
+#define SOFTAP_IF 1
+
+struct WiFiEventStationModeConnected {
+  String ssid;
+  uint8_t bssid[6];
+  uint8_t channel;
+};
+
+struct WiFiEventStationModeDisconnected {
+  String ssid;
+  uint8_t bssid[6];
+  int reason;
+};
+
+struct WiFiEventStationModeGotIP {
+  IPAddress ip;
+  IPAddress mask;
+  IPAddress gw;
+};
+
+typedef std::shared_ptr<void> WiFiEventHandler;
+
+class WiFiClient : public Client {
+public:
+  WiFiClient() {}
+  WiFiClient(const WiFiClient &other);
+  WiFiClient &operator=(const WiFiClient &other);
+  virtual ~WiFiClient();
+
+  // Adopts an accepted socket
+  explicit WiFiClient(int fd);
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(const char *host, uint16_t port) override;
+  int connect(const String &host, uint16_t port) { return connect(host.c_str(), port); }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t *buffer, size_t size) override;
+  int peek() override;
+  void flush() override {}
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+
+  IPAddress remoteIP() const;
+  uint16_t remotePort() const;
+  IPAddress localIP() const;
+  uint16_t localPort() const;
+  void setNoDelay(bool) {}
+  void setTimeout(unsigned long timeout) { this->timeout = timeout; }
+  int fd() const { return socket ? socket->fd : -1; }
+
+protected:
+  struct Socket {
+    int fd;
+    ~Socket();
+  };
+  std::shared_ptr<Socket> socket;
+  int peeked = -1;
+  bool closed = false;
+};
+
+namespace BearSSL {
+
+// TLS is not emulated: https URLs are fetched in clear text on the host
+class WiFiClientSecure : public WiFiClient {
+public:
+  void setInsecure() {}
+  void setBufferSizes(int, int) {}
+};
+
+}  // namespace BearSSL
+
+class WiFiClass {
+public:
+  bool mode(WiFiMode_t mode) {
+    currentMode = mode;
+    return true;
+  }
+  WiFiMode_t getMode() const { return currentMode; }
+  bool hostname(const char *name) {
+    currentHostname = name;
+    return true;
+  }
+  String hostname() const { return currentHostname; }
+
+  wl_status_t begin(const char *ssid = nullptr, const char *passphrase = nullptr, int32_t channel = 0, const uint8_t *bssid = nullptr, bool connect = true);
+  wl_status_t begin(const String &ssid, const String &passphrase, int32_t channel = 0, const uint8_t *bssid = nullptr, bool connect = true) {
+    return begin(ssid.c_str(), passphrase.c_str(), channel, bssid, connect);
+  }
+  bool config(IPAddress ip, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+  bool disconnect(bool wifioff = false);
+  bool reconnect();
+  bool setAutoReconnect(bool) { return true; }
+  bool setAutoConnect(bool) { return true; }
+  bool persistent(bool) { return true; }
+  int8_t waitForConnectResult(unsigned long = 60000) { return status(); }
+  bool setSleepMode(WiFiSleepType_t type, uint8_t listenInterval = 0) {
+    sleepMode = type;
+    (void)listenInterval;
+    return true;
+  }
+  WiFiSleepType_t getSleepMode() const { return sleepMode; }
+
+  wl_status_t status() const { return connectedState ? WL_CONNECTED : WL_DISCONNECTED; }
+  bool isConnected() const { return connectedState; }
+  IPAddress localIP() const;
+  IPAddress subnetMask() const;
+  IPAddress gatewayIP() const;
+  IPAddress dnsIP(uint8_t index = 0) const;
+  String macAddress() const { return String("5C:CF:7F:00:00:01"); }
+  uint8_t *macAddress(uint8_t *mac) const;
+  String SSID() const { return ssid; }
+  String psk() const { return passphrase; }
+  uint8_t *BSSID() { return bssid; }
+  String BSSIDstr() const;
+  int32_t channel() const { return currentChannel; }
+  int32_t RSSI() const { return -55; }
+
+  int hostByName(const char *name, IPAddress &result);
+
+  WiFiEventHandler onStationModeConnected(std::function<void(const WiFiEventStationModeConnected &)> handler);
+  WiFiEventHandler onStationModeDisconnected(std::function<void(const WiFiEventStationModeDisconnected &)> handler);
+  WiFiEventHandler onStationModeGotIP(std::function<void(const WiFiEventStationModeGotIP &)> handler);
+
+  // Host helpers: simulate association changes
+  void hostSetConnected(bool connected);
+
+private:
+  WiFiMode_t currentMode = WIFI_STA;
+  WiFiSleepType_t sleepMode = WIFI_NONE_SLEEP;
+  String currentHostname;
+  String ssid = "host";
+  String passphrase;
+  uint8_t bssid[6] = { 0x02, 0, 0, 0, 0, 1 };
+  int32_t currentChannel = 1;
+  bool connectedState = true;
+};
+
+extern WiFiClass WiFi;
+
+// SDK functions used directly by the sketch
+bool wifi_station_dhcpc_start();
+bool wifi_station_dhcpc_stop();
+bool wifi_station_disconnect();
+
+#endif
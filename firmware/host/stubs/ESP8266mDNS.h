@@ -0,0 +1,19 @@
+// Stand-in for the ESP8266 mDNS responder; announcements are not emulated.
+#ifndef HOST_ESP8266MDNS_H
+#define HOST_ESP8266MDNS_H
+
+#include <ESP8266WiFi.h>
+
+class MDNSResponder {
+public:
+  bool begin(const char *) { return true; }
+  bool addService(const char *, const char *, uint16_t) { return true; }
+  bool enableArduino(uint16_t, bool = false) { return true; }
+  bool update() { return true; }
+  bool announce() { return true; }
+  void end() {}
+};
+
+extern MDNSResponder MDNS;
+
+#endif
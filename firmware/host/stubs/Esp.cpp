@@ -0,0 +1,32 @@
+#include "Esp.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "HostClock.h"
+
+EspClass ESP;
+
+static uint32_t rtcMemory[128];
+
+uint32_t EspClass::getCycleCount() {
+  return (uint32_t)((uint64_t)HostClock::micros() * getCpuFreqMHz());
+}
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size) {
+  if (offset * 4 + size > sizeof(rtcMemory)) return false;
+  memcpy(data, rtcMemory + offset, size);
+  return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size) {
+  if (offset * 4 + size > sizeof(rtcMemory)) return false;
+  memcpy(rtcMemory + offset, data, size);
+  return true;
+}
+
+void EspClass::restart() {
+  fprintf(stderr, "ESP.restart()\n");
+  fflush(stderr);
+  exit(3);
+}
@@ -0,0 +1,32 @@
+// Stand-in for the ESP8266 system class.
+#ifndef HOST_ESP_H
+#define HOST_ESP_H
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "WString.h"
+
+class EspClass {
+public:
+  uint32_t getFreeHeap() { return 40000; }
+  uint8_t getHeapFragmentation() { return 0; }
+  uint32_t getMaxFreeBlockSize() { return 32000; }
+  uint32_t getChipId() { return 0x00E5B01; }
+  uint8_t getCpuFreqMHz() { return 80; }
+  uint32_t getCycleCount();
+  uint32_t random() { return (uint32_t)rand() ^ ((uint32_t)rand() << 16); }
+  uint32_t getFreeSketchSpace() { return 1 << 20; }
+  String getResetReason() { return String("External System"); }
+
+  bool rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size);
+  bool rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size);
+
+  // Exits the process; the supervisor (or the test) decides whether to start it again
+  [[noreturn]] void restart();
+  [[noreturn]] void reset() { restart(); }
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,46 @@
+// Stand-in for GyverLibs/GTimer with the interval and timeout modes the sketch uses.
+#ifndef HOST_GTIMER_H
+#define HOST_GTIMER_H
+
+#include <Arduino.h>
+
+#define GTMR_TIMEOUT 0
+#define GTMR_INTERVAL 1
+
+template <unsigned long (*uptime)()>
+class GTimer {
+public:
+  GTimer(uint32_t time = 0, bool start = false, bool mode = GTMR_INTERVAL) : time(time), mode(mode) {
+    if (start) this->start();
+  }
+
+  void setTime(uint32_t time) { this->time = time; }
+  void setMode(bool mode) { this->mode = mode; }
+  void start() {
+    started = uptime();
+    active = true;
+  }
+  void resume() { active = true; }
+  void stop() { active = false; }
+  bool running() const { return active; }
+  uint32_t getLeft() const { return active && uptime() - started < time ? time - (uptime() - started) : 0; }
+
+  bool tick() {
+    if (!active || uptime() - started < time) return false;
+    if (mode == GTMR_INTERVAL) {
+      started = uptime();
+    } else {
+      active = false;
+    }
+    return true;
+  }
+  operator bool() { return tick(); }
+
+private:
+  uint32_t time;
+  unsigned long started = 0;
+  bool mode;
+  bool active = false;
+};
+
+#endif
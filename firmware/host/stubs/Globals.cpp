@@ -0,0 +1,26 @@
+#include <ArduinoOTA.h>
+#include <AutoOTA.h>
+#include <ESP8266Ping.h>
+#include <ESP8266mDNS.h>
+
+PingClass Ping;
+ArduinoOTAClass ArduinoOTA;
+MDNSResponder MDNS;
+
+#include <stdlib.h>
+
+// The release found by update checks can be set from the environment
+static String environment(const char *name) {
+  const char *value = getenv(name);
+  return value ? String(value) : String();
+}
+
+String AutoOTA::HostRelease::version = environment("RELEASE_VERSION");
+String AutoOTA::HostRelease::notes = environment("RELEASE_NOTES");
+String AutoOTA::HostRelease::bin = environment("RELEASE_BIN");
+AutoOTA::Error AutoOTA::HostRelease::failure = AutoOTA::Error::None;
+
+void configTime(const char *tz, const char *, const char *, const char *) {
+  setenv("TZ", tz, 1);
+  tzset();
+}
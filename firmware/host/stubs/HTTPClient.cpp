@@ -0,0 +1,108 @@
+#include "ESP8266HTTPClient.h"
+
+bool HTTPClient::parseUrl(const String &url) {
+  if (!url.startsWith("http://")) return false;
+  String rest = url.substring(7);
+  int slash = rest.indexOf('/');
+  String authority = slash < 0 ? rest : rest.substring(0, slash);
+  path = slash < 0 ? String("/") : rest.substring(slash);
+  int colon = authority.indexOf(':');
+  host = colon < 0 ? authority : authority.substring(0, colon);
+  port = colon < 0 ? 80 : authority.substring(colon + 1).toInt();
+  return host.length() > 0;
+}
+
+bool HTTPClient::begin(WiFiClient &client, const String &url) {
+  this->client = &client;
+  size = -1;
+  return parseUrl(url);
+}
+
+void HTTPClient::end() {
+  if (client) client->stop();
+  client = nullptr;
+}
+
+// Reads one header line, blocking up to the timeout
+static bool readLine(WiFiClient &client, String &line, unsigned long timeout) {
+  line = "";
+  unsigned long start = millis();
+  while (true) {
+    int c = client.read();
+    if (c < 0) {
+      if (!client.connected() || millis() - start > timeout) return false;
+      delay(1);
+      continue;
+    }
+    if (c == '\n') {
+      line.trim();
+      return true;
+    }
+    line += (char)c;
+  }
+}
+
+int HTTPClient::sendRequest() {
+  if (!client->connect(host.c_str(), port)) return HTTPC_ERROR_CONNECTION_FAILED;
+  String request = String("GET ") + path + " HTTP/1.1\r\nHost: " + host + "\r\nUser-Agent: ESP8266HTTPClient\r\nConnection: close\r\n\r\n";
+  if (client->write((const uint8_t *)request.c_str(), request.length()) != request.length()) return HTTPC_ERROR_SEND_HEADER_FAILED;
+
+  String line;
+  if (!readLine(*client, line, timeout)) return HTTPC_ERROR_READ_TIMEOUT;
+  int space = line.indexOf(' ');
+  int code = space < 0 ? 0 : line.substring(space + 1).toInt();
+  location = "";
+  size = -1;
+  while (readLine(*client, line, timeout) && line.length()) {
+    int colon = line.indexOf(':');
+    if (colon < 0) continue;
+    String name = line.substring(0, colon);
+    String value = line.substring(colon + 1);
+    value.trim();
+    if (name.equalsIgnoreCase("Content-Length")) size = value.toInt();
+    if (name.equalsIgnoreCase("Location")) location = value;
+  }
+  return code;
+}
+
+int HTTPClient::GET() {
+  if (!client) return HTTPC_ERROR_NOT_CONNECTED;
+  for (int redirects = 0; redirects <= redirectLimit; redirects++) {
+    int code = sendRequest();
+    bool redirect = code == 301 || code == 302 || code == 303 || code == 307 || code == 308;
+    if (!redirect || follow == HTTPC_DISABLE_FOLLOW_REDIRECTS || location.isEmpty()) return code;
+    client->stop();
+    if (location.startsWith("/")) {
+      path = location;
+    } else if (!parseUrl(location)) {
+      return HTTPC_ERROR_CONNECTION_FAILED;
+    }
+  }
+  return HTTPC_ERROR_TOO_MANY_REDIRECTS;
+}
+
+String HTTPClient::getString() {
+  String body;
+  unsigned long start = millis();
+  while ((size < 0 || (int)body.length() < size) && millis() - start < timeout) {
+    int c = client->read();
+    if (c < 0) {
+      if (!client->connected()) break;
+      delay(1);
+      continue;
+    }
+    body += (char)c;
+  }
+  return body;
+}
+
+String HTTPClient::errorToString(int error) {
+  switch (error) {
+    case HTTPC_ERROR_CONNECTION_FAILED: return "connection failed";
+    case HTTPC_ERROR_SEND_HEADER_FAILED: return "send header failed";
+    case HTTPC_ERROR_NOT_CONNECTED: return "not connected";
+    case HTTPC_ERROR_READ_TIMEOUT: return "read Timeout";
+    case HTTPC_ERROR_TOO_MANY_REDIRECTS: return "too many redirects";
+    default: return String();
+  }
+}
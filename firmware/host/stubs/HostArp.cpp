@@ -0,0 +1,183 @@
+#include "lwip/etharp.h"
+
+#include <map>
+#include <array>
+#include <vector>
+
+static std::map<uint32_t, std::array<uint8_t, 6>> staticEntries;
+
+err_t etharp_add_static_entry(const ip4_addr_t *ipaddr, struct eth_addr *ethaddr) {
+  std::array<uint8_t, 6> mac;
+  for (int i = 0; i < 6; i++) mac[i] = ethaddr->addr[i];
+  staticEntries[ipaddr->addr] = mac;
+  return ERR_OK;
+}
+
+err_t etharp_remove_static_entry(const ip4_addr_t *ipaddr) {
+  return staticEntries.erase(ipaddr->addr) ? ERR_OK : ERR_ARG;
+}
+
+namespace HostArp {
+
+const uint8_t *findStatic(uint32_t ip) {
+  auto it = staticEntries.find(ip);
+  return it != staticEntries.end() ? it->second.data() : nullptr;
+}
+
+size_t staticCount() {
+  return staticEntries.size();
+}
+
+}  // namespace HostArp
+
+#include <Arduino.h>
+
+#include "HostLan.h"
+#include "HostNetwork.h"
+#include "HostClock.h"
+#include "lwip/pbuf.h"
+
+struct DynamicEntry {
+  ip4_addr_t ip;
+  struct eth_addr mac;
+  unsigned long at;
+};
+
+static std::map<uint32_t, DynamicEntry> dynamicEntries;
+static std::vector<DynamicEntry> pendingReplies;  // ARP replies passed to the station input when due
+static size_t requests = 0;
+static err_t dropFrame(struct pbuf *, struct netif *) { return ERR_OK; }
+static struct netif station = { {0}, {0}, dropFrame };
+
+// ARP_CHATTER=ms: every up simulated host broadcasts an ARP request for the gateway at that period.
+// DHCP_ACK=mac,ip: a broadcast DHCP ack leasing ip to mac is seen 3 s after start.
+static void chatter() {
+  for (size_t i = 0; i < pendingReplies.size();) {
+    DynamicEntry reply = pendingReplies[i];
+    if ((long)(millis() - reply.at) < 0) {
+      i++;
+      continue;
+    }
+    pendingReplies.erase(pendingReplies.begin() + i);
+    uint8_t frame[42] = {};
+    memcpy(frame + 6, reply.mac.addr, 6);
+    frame[12] = 0x08; frame[13] = 0x06;
+    const uint8_t arp[] = { 0, 1, 8, 0, 6, 4, 0, 2 };
+    memcpy(frame + 14, arp, 8);
+    memcpy(frame + 22, reply.mac.addr, 6);
+    memcpy(frame + 28, &reply.ip.addr, 4);
+    uint32_t station = (uint32_t)HostNetwork::config().ip;
+    memcpy(frame + 38, &station, 4);
+    HostArp::injectFrame(frame, sizeof(frame));
+  }
+
+  static unsigned long lastChatter = 0;
+  static bool ackSent = false;
+  unsigned long period = getenv("ARP_CHATTER") ? strtoul(getenv("ARP_CHATTER"), nullptr, 10) : 0;
+  if (period && millis() - lastChatter >= period) {
+    lastChatter = millis();
+    for (HostLan::SimulatedHost &host : HostLan::hosts()) {
+      if (!HostLan::isUp(host.ip)) continue;
+      uint8_t frame[42] = {};
+      memset(frame, 0xFF, 6);
+      memcpy(frame + 6, host.mac, 6);
+      frame[12] = 0x08; frame[13] = 0x06;
+      const uint8_t arp[] = { 0, 1, 8, 0, 6, 4, 0, 1 };
+      memcpy(frame + 14, arp, 8);
+      memcpy(frame + 22, host.mac, 6);
+      uint32_t ip = (uint32_t)host.ip;
+      memcpy(frame + 28, &ip, 4);
+      uint32_t gateway = (uint32_t)HostNetwork::config().gateway;
+      memcpy(frame + 38, &gateway, 4);
+      HostArp::injectFrame(frame, sizeof(frame));
+    }
+  }
+  if (getenv("DHCP_ACK") && !ackSent && millis() > 3000) {
+    ackSent = true;
+    unsigned int mac[6];
+    char ipText[32];
+    sscanf(getenv("DHCP_ACK"), "%x:%x:%x:%x:%x:%x,%31s", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5], ipText);
+    IPAddress leased;
+    leased.fromString(ipText);
+    uint8_t frame[14 + 20 + 8 + 300] = {};
+    memset(frame, 0xFF, 6);
+    frame[6] = 0x02; frame[11] = 0x01;  // Server MAC
+    frame[12] = 0x08; frame[13] = 0x00;
+    uint8_t *ipHeader = frame + 14;
+    ipHeader[0] = 0x45; ipHeader[9] = 17;
+    uint32_t server = (uint32_t)HostNetwork::config().gateway;
+    memcpy(ipHeader + 12, &server, 4);
+    memset(ipHeader + 16, 0xFF, 4);
+    uint8_t *udp = ipHeader + 20;
+    udp[1] = 67; udp[3] = 68;
+    uint8_t *dhcp = udp + 8;
+    dhcp[0] = 2; dhcp[1] = 1; dhcp[2] = 6;
+    uint32_t yiaddr = (uint32_t)leased;
+    memcpy(dhcp + 16, &yiaddr, 4);
+    for (int i = 0; i < 6; i++) dhcp[28 + i] = mac[i];
+    dhcp[236] = 99; dhcp[237] = 130; dhcp[238] = 83; dhcp[239] = 99;
+    dhcp[240] = 53; dhcp[241] = 1; dhcp[242] = 5; dhcp[243] = 255;
+    HostArp::injectFrame(frame, sizeof(frame));
+  }
+}
+
+struct netif *ip4_route(const ip4_addr_t *) {
+  static bool registered = false;
+  if (!registered) {
+    registered = true;
+    HostClock::addTask(chatter);
+  }
+  station.ip_addr.addr = (uint32_t)HostNetwork::config().ip;
+  station.netmask.addr = (uint32_t)HostNetwork::config().mask;
+  return &station;
+}
+
+err_t etharp_request(struct netif *, const ip4_addr_t *ipaddr) {
+  requests++;
+  HostLan::SimulatedHost *host = HostLan::find(IPAddress(ipaddr->addr));
+  if (host && HostLan::isUp(host->ip)) {
+    DynamicEntry entry;
+    entry.ip = *ipaddr;
+    memcpy(entry.mac.addr, host->mac, 6);
+    entry.at = millis() + 3;
+    if (!dynamicEntries.count(ipaddr->addr) && dynamicEntries.size() >= ARP_TABLE_SIZE) {
+      auto oldest = dynamicEntries.begin();
+      for (auto it = dynamicEntries.begin(); it != dynamicEntries.end(); ++it) {
+        if (it->second.at < oldest->second.at) oldest = it;
+      }
+      dynamicEntries.erase(oldest);
+    }
+    dynamicEntries[ipaddr->addr] = entry;
+    pendingReplies.push_back(entry);
+  }
+  return ERR_OK;
+}
+
+ssize_t etharp_find_addr(struct netif *, const ip4_addr_t *ipaddr, struct eth_addr **eth_ret, const ip4_addr_t **ip_ret) {
+  auto it = dynamicEntries.find(ipaddr->addr);
+  if (it == dynamicEntries.end() || (long)(millis() - it->second.at) < 0) return -1;
+  *eth_ret = &it->second.mac;
+  *ip_ret = &it->second.ip;
+  return 0;
+}
+
+int etharp_get_entry(size_t i, ip4_addr_t **ipaddr, struct netif **netif, struct eth_addr **eth_ret) {
+  if (i >= dynamicEntries.size()) return 0;
+  auto it = std::next(dynamicEntries.begin(), i);
+  if ((long)(millis() - it->second.at) < 0) return 0;
+  *ipaddr = &it->second.ip;
+  *netif = &station;
+  *eth_ret = &it->second.mac;
+  return 1;
+}
+
+namespace HostArp {
+void injectFrame(const uint8_t *frame, size_t length) {
+  static uint8_t buffer[1600];
+  memcpy(buffer, frame, length);
+  struct pbuf p = { nullptr, buffer, (u16_t)length, (u16_t)length };
+  station.input(&p, &station);
+}
+
+size_t requestCount() { return requests; }
+}  // namespace HostArp
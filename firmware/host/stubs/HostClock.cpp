@@ -0,0 +1,88 @@
+#include "HostClock.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <vector>
+
+namespace HostClock {
+
+bool scheduled = false;
+static bool manualMode = false;
+static uint64_t manualMicros = 0;
+static uint64_t startMicros = 0;
+static std::vector<std::function<void()>> tasks;
+static bool inYield = false;
+
+static uint64_t monotonicMicros() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static uint64_t nowMicros() {
+  if (manualMode) return manualMicros;
+  static const uint64_t scale = getenv("CLOCK_SCALE") ? strtoull(getenv("CLOCK_SCALE"), nullptr, 10) : 1;
+  if (!startMicros) startMicros = monotonicMicros();
+  return (monotonicMicros() - startMicros) * scale;
+}
+
+unsigned long millis() {
+  return (unsigned long)(nowMicros() / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)nowMicros();
+}
+
+void yield() {
+  if (inYield) return;
+  inYield = true;
+  for (auto &task : tasks) task();
+  inYield = false;
+}
+
+void delay(unsigned long ms) {
+  if (manualMode) {
+    manualMicros += (uint64_t)ms * 1000;
+    yield();
+    return;
+  }
+  uint64_t deadline = nowMicros() + (uint64_t)ms * 1000;
+  do {
+    yield();
+    uint64_t now = nowMicros();
+    if (now >= deadline) break;
+    uint64_t wait = deadline - now < 1000 ? deadline - now : 1000;
+    timespec duration = { 0, (long)(wait * 1000) };
+    nanosleep(&duration, nullptr);
+  } while (true);
+}
+
+void delayMicroseconds(unsigned int us) {
+  if (manualMode) {
+    manualMicros += us;
+    return;
+  }
+  timespec duration = { 0, (long)us * 1000 };
+  nanosleep(&duration, nullptr);
+}
+
+void setManual(bool manual) {
+  if (manual && !manualMode) manualMicros = nowMicros();
+  manualMode = manual;
+}
+
+bool isManual() {
+  return manualMode;
+}
+
+void advance(unsigned long ms) {
+  manualMicros += (uint64_t)ms * 1000;
+}
+
+void addTask(std::function<void()> task) {
+  tasks.push_back(std::move(task));
+}
+
+}  // namespace HostClock
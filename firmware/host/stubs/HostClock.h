@@ -0,0 +1,32 @@
+// Controllable clock behind millis(), micros() and delay().
+//
+// By default the clock follows CLOCK_MONOTONIC. In manual mode time only
+// moves when advance() (or delay()) is called, which makes timer driven code
+// deterministic in tests and benchmarks.
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <cstdint>
+#include <functional>
+
+namespace HostClock {
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Runs the registered background tasks (socket polling and simulated lwIP
+// callbacks), as the ESP8266 SDK does whenever the sketch yields.
+void yield();
+
+void setManual(bool manual);
+bool isManual();
+void advance(unsigned long ms);
+
+// Registers a task run on every yield()
+void addTask(std::function<void()> task);
+
+}  // namespace HostClock
+
+#endif
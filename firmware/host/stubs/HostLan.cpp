@@ -0,0 +1,210 @@
+#include "HostLan.h"
+
+#include <Arduino.h>
+
+namespace HostLan {
+
+static std::vector<SimulatedHost> simulated;
+
+std::vector<SimulatedHost> &hosts() {
+  return simulated;
+}
+
+SimulatedHost &addHost(IPAddress ip, const uint8_t mac[6], bool up, unsigned long bootDelay) {
+  SimulatedHost host;
+  host.ip = ip;
+  memcpy(host.mac, mac, 6);
+  host.up = up;
+  host.bootDelay = bootDelay;
+  simulated.push_back(host);
+  return simulated.back();
+}
+
+bool addHost(const char *spec) {
+  String text(spec);
+  std::vector<String> fields;
+  int start = 0;
+  while (true) {
+    int comma = text.indexOf(',', start);
+    fields.push_back(text.substring(start, comma < 0 ? text.length() : comma));
+    if (comma < 0) break;
+    start = comma + 1;
+  }
+  IPAddress ip;
+  unsigned int mac[6];
+  if (fields.size() < 2 || !ip.fromString(fields[0]) || sscanf(fields[1].c_str(), "%x:%x:%x:%x:%x:%x", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]) != 6) {
+    return false;
+  }
+  uint8_t bytes[6];
+  for (int i = 0; i < 6; i++) bytes[i] = (uint8_t)mac[i];
+  bool up = fields.size() < 3 || fields[2] != "down";
+  unsigned long bootDelay = fields.size() > 3 ? strtoul(fields[3].c_str(), nullptr, 10) : 0;
+  SimulatedHost &host = addHost(ip, bytes, up, bootDelay);
+  if (fields.size() > 4) host.answersIcmp = fields[4] != "noicmp";
+  for (size_t i = 5; i < fields.size(); i++) {
+    if (fields[i].startsWith("nb=")) host.netbiosName = fields[i].substring(3);
+    else if (fields[i].startsWith("mdns=")) host.mdnsName = fields[i].substring(5);
+    else if (fields[i].startsWith("dns=")) host.dnsName = fields[i].substring(4);
+    else host.openPorts.push_back((uint16_t)fields[i].toInt());
+  }
+  return true;
+}
+
+SimulatedHost *find(IPAddress ip) {
+  for (SimulatedHost &host : simulated) {
+    if (host.ip == ip) return &host;
+  }
+  return nullptr;
+}
+
+SimulatedHost *findByMac(const uint8_t mac[6]) {
+  for (SimulatedHost &host : simulated) {
+    if (!memcmp(host.mac, mac, 6)) return &host;
+  }
+  return nullptr;
+}
+
+bool isUp(IPAddress ip) {
+  SimulatedHost *host = find(ip);
+  if (!host) return false;
+  if (!host->up && host->upAt && millis() >= host->upAt) host->up = true;
+  return host->up;
+}
+
+bool isPortOpen(IPAddress ip, uint16_t port) {
+  if (!isUp(ip)) return false;
+  SimulatedHost *host = find(ip);
+  for (uint16_t open : host->openPorts) {
+    if (open == port) return true;
+  }
+  return false;
+}
+
+void setUp(IPAddress ip, bool up) {
+  if (SimulatedHost *host = find(ip)) {
+    host->up = up;
+    host->upAt = 0;
+  }
+}
+
+bool parseMagicPacket(const uint8_t *data, size_t length, uint8_t mac[6]) {
+  if (length < 102) return false;
+  for (int i = 0; i < 6; i++) {
+    if (data[i] != 0xFF) return false;
+  }
+  for (int i = 1; i < 16; i++) {
+    if (memcmp(data + 6, data + 6 + i * 6, 6)) return false;
+  }
+  memcpy(mac, data + 6, 6);
+  return true;
+}
+
+void observeDatagram(IPAddress destination, uint16_t port, const uint8_t *data, size_t length) {
+  if (getenv("LANLOG")) fprintf(stderr, "LAN datagram to %s:%u, %zu bytes\n", destination.toString().c_str(), port, length);
+  uint8_t mac[6];
+  if (!parseMagicPacket(data, length, mac)) return;
+  SimulatedHost *host = findByMac(mac);
+  if (!host) return;
+  host->magicPackets++;
+  if (!host->up && !host->upAt) host->upAt = millis() + host->bootDelay;
+}
+
+static String questionName(const uint8_t *data, size_t length, size_t &end) {
+  String name;
+  size_t offset = 12;
+  while (offset < length && data[offset]) {
+    if (name.length()) name += '.';
+    for (size_t i = 1; i <= data[offset]; i++) name += (char)data[offset + i];
+    offset += data[offset] + 1;
+  }
+  end = offset + 5;
+  return name;
+}
+
+static std::vector<uint8_t> addressAnswer(const uint8_t *data, size_t length, size_t end, IPAddress ip, uint32_t ttl) {
+  std::vector<uint8_t> reply(data, data + end);
+  reply[2] = 0x81; reply[3] = 0x80; reply[7] = 1;
+  const uint8_t rr[] = { 0xC0, 12, 0, 1, 0x80, 1, (uint8_t)(ttl >> 24), (uint8_t)(ttl >> 16), (uint8_t)(ttl >> 8), (uint8_t)ttl, 0, 4, ip[0], ip[1], ip[2], ip[3] };
+  reply.insert(reply.end(), rr, rr + sizeof(rr));
+  return reply;
+}
+
+std::vector<uint8_t> answerDatagram(IPAddress destination, uint16_t port, const uint8_t *data, size_t length, IPAddress &from) {
+  std::vector<uint8_t> reply;
+  from = destination;
+  if (length > 12 && port == 53) {
+    size_t end;
+    String name = questionName(data, length, end);
+    for (SimulatedHost &candidate : simulated) {
+      if (candidate.dnsName.equalsIgnoreCase(name)) {
+        return addressAnswer(data, length, end, candidate.ip, getenv("DNS_TTL") ? atoi(getenv("DNS_TTL")) : 60);
+      }
+    }
+    // Servers of the update check and download, unless the LAN has no uplink
+    if (!getenv("NO_UPLINK") && (name.endsWith("github.com") || name.endsWith("githubusercontent.com"))) {
+      return addressAnswer(data, length, end, IPAddress(192, 0, 2, 1), 300);
+    }
+    reply.assign(data, data + end);
+    reply[2] = 0x81; reply[3] = 0x83;  // NXDOMAIN
+    return reply;
+  }
+  if (length > 12 && port == 5353 && destination == IPAddress(224, 0, 0, 251)) {
+    size_t end;
+    String name = questionName(data, length, end);
+    for (SimulatedHost &candidate : simulated) {
+      if (candidate.mdnsName.equalsIgnoreCase(name) && isUp(candidate.ip)) {
+        from = candidate.ip;
+        return addressAnswer(data, length, end, candidate.ip, 120);
+      }
+    }
+    return reply;
+  }
+  SimulatedHost *host = find(destination);
+  if (!host || !isUp(destination) || length < 12) return reply;
+  if (port == 137 && host->netbiosName.length()) {
+    reply.assign(data, data + 12);
+    reply[2] = 0x84; reply[5] = 0; reply[7] = 1;
+    reply.insert(reply.end(), data + 12, data + 46);  // Name
+    const uint8_t rr[] = { 0, 0x21, 0, 1, 0, 0, 0, 0 };
+    reply.insert(reply.end(), rr, rr + 8);
+    std::vector<uint8_t> names;
+    names.push_back(2);
+    auto entry = [&](const char *name, uint8_t suffix, uint8_t flags) {
+      char padded[16];
+      snprintf(padded, sizeof(padded), "%-15s", name);
+      names.insert(names.end(), padded, padded + 15);
+      names.push_back(suffix);
+      names.push_back(flags);
+      names.push_back(0);
+    };
+    entry("WORKGROUP", 0x00, 0x84);  // Group name first
+    entry(host->netbiosName.c_str(), 0x00, 0x04);
+    names.insert(names.end(), 46, 0);  // Statistics
+    reply.push_back(names.size() >> 8);
+    reply.push_back(names.size() & 0xFF);
+    reply.insert(reply.end(), names.begin(), names.end());
+  } else if (port == 5353 && host->mdnsName.length()) {
+    reply.assign(data, data + length);  // Header and question
+    reply[2] = 0x84; reply[7] = 1;
+    reply.push_back(0xC0); reply.push_back(12);  // Pointer to the question name
+    const uint8_t rr[] = { 0, 12, 0, 1, 0, 0, 0, 120 };
+    reply.insert(reply.end(), rr, rr + 8);
+    std::vector<uint8_t> name;
+    String text = host->mdnsName;
+    int start = 0;
+    while (start < (int)text.length()) {
+      int dot = text.indexOf('.', start);
+      if (dot < 0) dot = text.length();
+      name.push_back(dot - start);
+      for (int i = start; i < dot; i++) name.push_back(text[i]);
+      start = dot + 1;
+    }
+    name.push_back(0);
+    reply.push_back(name.size() >> 8);
+    reply.push_back(name.size() & 0xFF);
+    reply.insert(reply.end(), name.begin(), name.end());
+  }
+  return reply;
+}
+
+}  // namespace HostLan
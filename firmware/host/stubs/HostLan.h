@@ -0,0 +1,56 @@
+// Simulated LAN segment for the host build.
+//
+// Hosts are registered with an address, a MAC and a boot delay. A host that
+// is down comes up `bootDelay` ms after it receives a magic packet sent by
+// the sketch, and from then on answers pings, ARP and TCP probes.
+#ifndef HOST_LAN_H
+#define HOST_LAN_H
+
+#include "IPAddress.h"
+#include "WString.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace HostLan {
+
+struct SimulatedHost {
+  IPAddress ip;
+  uint8_t mac[6];
+  bool up = false;
+  unsigned long bootDelay = 0;
+  unsigned long upAt = 0;
+  bool answersIcmp = true;
+  std::vector<uint16_t> openPorts;
+  unsigned long magicPackets = 0;
+  String netbiosName;  // "nb=NAME" in the spec
+  String mdnsName;     // "mdns=name.local" in the spec
+  String dnsName;      // "dns=name" in the spec, answered by the DNS server with DNS_TTL (default 60 s)
+};
+
+SimulatedHost &addHost(IPAddress ip, const uint8_t mac[6], bool up, unsigned long bootDelay = 0);
+
+// Parses "ip,mac[,up|down[,bootDelayMs[,icmp|noicmp[,port...]]]]"
+bool addHost(const char *spec);
+
+SimulatedHost *find(IPAddress ip);
+SimulatedHost *findByMac(const uint8_t mac[6]);
+bool isUp(IPAddress ip);
+bool isPortOpen(IPAddress ip, uint16_t port);
+void setUp(IPAddress ip, bool up);
+std::vector<SimulatedHost> &hosts();
+
+// Called for every datagram the sketch sends; magic packets wake simulated hosts
+void observeDatagram(IPAddress destination, uint16_t port, const uint8_t *data, size_t length);
+
+// Builds the answer to a datagram, empty if none: NBSTAT (port 137) and mDNS PTR (port 5353) of a
+// simulated host, A records from mDNS (224.0.0.251) and the DNS server (port 53)
+std::vector<uint8_t> answerDatagram(IPAddress destination, uint16_t port, const uint8_t *data, size_t length, IPAddress &from);
+
+// Checks a buffer for the 6 x 0xFF + 16 x MAC pattern and extracts the MAC
+bool parseMagicPacket(const uint8_t *data, size_t length, uint8_t mac[6]);
+
+}  // namespace HostLan
+
+#endif
@@ -0,0 +1,24 @@
+// Addresses the emulated station reports, configurable from the command line.
+#ifndef HOST_NETWORK_H
+#define HOST_NETWORK_H
+
+#include "IPAddress.h"
+
+namespace HostNetwork {
+
+struct Config {
+  IPAddress ip = IPAddress(127, 0, 0, 1);
+  IPAddress mask = IPAddress(255, 0, 0, 0);
+  IPAddress gateway = IPAddress(127, 0, 0, 1);
+  IPAddress dns = IPAddress(127, 0, 0, 1);
+};
+
+Config &config();
+
+// Port offset applied to privileged ports (< 1024) so the process can run unprivileged
+uint16_t mapPort(uint16_t port);
+void setPortOffset(uint16_t offset);
+
+}  // namespace HostNetwork
+
+#endif
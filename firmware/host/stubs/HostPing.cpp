@@ -0,0 +1,68 @@
+#include "ping.h"
+
+#include <Arduino.h>
+
+#include "HostClock.h"
+#include "HostLan.h"
+
+#include <vector>
+
+namespace {
+
+struct PendingPing {
+  ping_option *option;
+  unsigned long sentAt;
+  uint32_t seqno;
+};
+
+std::vector<PendingPing> pending;
+bool registered = false;
+
+// Sends `count` echo requests one second apart; each is answered as soon as the simulated host is up, or times out after one second
+void deliver() {
+  unsigned long now = millis();
+  for (size_t i = 0; i < pending.size();) {
+    PendingPing ping = pending[i];
+    IPAddress ip(ping.option->ip);
+    HostLan::SimulatedHost *host = HostLan::find(ip);
+    bool alive = HostLan::isUp(ip) && host->answersIcmp;
+    if ((long)(now - ping.sentAt) < 0 || (!alive && now - ping.sentAt < 1000)) {
+      i++;
+      continue;
+    }
+    pending.erase(pending.begin() + i);
+    ping_resp response = {};
+    response.total_count = ping.option->count;
+    response.seqno = ping.seqno;
+    response.resp_time = alive ? 1 : 0;
+    response.timeout_count = alive ? 0 : 1;
+    response.ping_err = alive ? 0 : -1;
+    if (ping.option->recv_function) ping.option->recv_function(ping.option, &response);
+    if (ping.seqno < ping.option->count) {
+      pending.push_back({ ping.option, ping.sentAt + 1000, ping.seqno + 1 });
+    } else if (ping.option->sent_function) {
+      ping.option->sent_function(ping.option, &response);
+    }
+  }
+}
+
+}  // namespace
+
+bool ping_start(struct ping_option *ping_opt) {
+  if (!registered) {
+    HostClock::addTask(deliver);
+    registered = true;
+  }
+  pending.push_back({ ping_opt, millis(), 1 });
+  return true;
+}
+
+bool ping_regist_recv(struct ping_option *ping_opt, ping_recv_function ping_recv) {
+  ping_opt->recv_function = ping_recv;
+  return true;
+}
+
+bool ping_regist_sent(struct ping_option *ping_opt, ping_sent_function ping_sent) {
+  ping_opt->sent_function = ping_sent;
+  return true;
+}
@@ -0,0 +1,209 @@
+#include "lwip/tcp.h"
+
+#include <Arduino.h>
+
+#include "HostClock.h"
+#include "HostLan.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vector>
+
+#define HOST_TCP_SNDBUF 2920  // 2 x TCP_MSS, as on the ESP8266
+
+struct tcp_pcb {
+  void *arg = nullptr;
+  tcp_err_fn err = nullptr;
+  tcp_connected_fn connected = nullptr;
+  tcp_recv_fn recv = nullptr;
+  IPAddress ip;
+  u16_t port = 0;
+  unsigned long answerAt = 0;
+  bool connecting = false;
+  int fd = -1;                  // Real socket for loopback addresses
+  std::vector<uint8_t> unsent;  // Written but not output yet
+};
+
+namespace {
+
+std::vector<tcp_pcb *> openPcbs;
+bool registered = false;
+
+void remove(tcp_pcb *pcb) {
+  for (size_t i = 0; i < openPcbs.size(); i++) {
+    if (openPcbs[i] == pcb) {
+      openPcbs.erase(openPcbs.begin() + i);
+      break;
+    }
+  }
+  if (pcb->fd >= 0) close(pcb->fd);
+  delete pcb;
+}
+
+bool isOpen(tcp_pcb *pcb) {
+  for (tcp_pcb *candidate : openPcbs) {
+    if (candidate == pcb) return true;
+  }
+  return false;
+}
+
+void fail(tcp_pcb *pcb, err_t error) {
+  tcp_err_fn err = pcb->err;
+  void *arg = pcb->arg;
+  remove(pcb);
+  if (err) err(arg, error);
+}
+
+void deliverSocket(tcp_pcb *pcb) {
+  if (pcb->connecting) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    sockaddr_in peer = {};
+    socklen_t peerLength = sizeof(peer);
+    if (getpeername(pcb->fd, (sockaddr *)&peer, &peerLength) < 0) {
+      getsockopt(pcb->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+      if (error && error != EINPROGRESS) fail(pcb, ERR_RST);
+      return;
+    }
+    pcb->connecting = false;
+    if (pcb->connected(pcb->arg, pcb, ERR_OK) == ERR_ABRT || !isOpen(pcb)) return;
+  }
+  while (isOpen(pcb)) {
+    pbuf *p = pbuf_alloc(PBUF_TRANSPORT, 1460, PBUF_RAM);
+    ssize_t n = ::recv(pcb->fd, p->payload, 1460, 0);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      pbuf_free(p);
+      return;
+    }
+    if (n < 0) {
+      pbuf_free(p);
+      fail(pcb, ERR_RST);
+      return;
+    }
+    if (n == 0) {
+      pbuf_free(p);
+      if (pcb->recv) pcb->recv(pcb->arg, pcb, nullptr, ERR_OK);  // Closed by the peer
+      return;
+    }
+    p->tot_len = p->len = (u16_t)n;
+    if (pcb->recv) {
+      pcb->recv(pcb->arg, pcb, p, ERR_OK);
+    } else {
+      pbuf_free(p);
+    }
+  }
+}
+
+void deliver() {
+  std::vector<tcp_pcb *> pending = openPcbs;
+  for (tcp_pcb *pcb : pending) {
+    if (!isOpen(pcb)) continue;
+    if (pcb->fd >= 0) {
+      deliverSocket(pcb);
+      continue;
+    }
+    if (!pcb->connecting || (long)(millis() - pcb->answerAt) < 0 || !HostLan::isUp(pcb->ip)) continue;
+    pcb->connecting = false;
+    if (HostLan::isPortOpen(pcb->ip, pcb->port)) {
+      if (pcb->connected(pcb->arg, pcb, ERR_OK) != ERR_ABRT) remove(pcb);  // Real lwIP keeps it, the sketch always aborts
+    } else {
+      fail(pcb, ERR_RST);
+    }
+  }
+}
+
+}  // namespace
+
+struct tcp_pcb *tcp_new() {
+  tcp_pcb *pcb = new tcp_pcb();
+  openPcbs.push_back(pcb);
+  if (!registered) {
+    HostClock::addTask(deliver);
+    registered = true;
+  }
+  return pcb;
+}
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg) {
+  pcb->arg = arg;
+}
+
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err) {
+  pcb->err = err;
+}
+
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv) {
+  pcb->recv = recv;
+}
+
+void tcp_recved(struct tcp_pcb *, u16_t) {}
+
+err_t tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port, tcp_connected_fn connected) {
+  pcb->ip = IPAddress(ipaddr->addr);
+  pcb->port = port;
+  pcb->connected = connected;
+  pcb->connecting = true;
+  pcb->answerAt = millis() + 2;
+  if ((ntohl(ipaddr->addr) >> 24) == 127) {
+    pcb->fd = socket(AF_INET, SOCK_STREAM, 0);
+    fcntl(pcb->fd, F_SETFL, O_NONBLOCK);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = ipaddr->addr;
+    address.sin_port = htons(port);
+    if (::connect(pcb->fd, (sockaddr *)&address, sizeof(address)) < 0 && errno != EINPROGRESS) {
+      close(pcb->fd);
+      pcb->fd = -1;
+      return ERR_CONN;
+    }
+  }
+  return ERR_OK;
+}
+
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t) {
+  if (pcb->connecting || pcb->unsent.size() + len > HOST_TCP_SNDBUF) return ERR_MEM;
+  const uint8_t *data = (const uint8_t *)dataptr;
+  pcb->unsent.insert(pcb->unsent.end(), data, data + len);
+  return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb *pcb) {
+  if (pcb->fd < 0 || pcb->unsent.empty()) {
+    pcb->unsent.clear();
+    return ERR_OK;
+  }
+  ssize_t n = ::send(pcb->fd, pcb->unsent.data(), pcb->unsent.size(), MSG_NOSIGNAL);
+  if (n > 0) pcb->unsent.erase(pcb->unsent.begin(), pcb->unsent.begin() + n);
+  return ERR_OK;
+}
+
+u16_t tcp_sndbuf(struct tcp_pcb *pcb) {
+  return HOST_TCP_SNDBUF - pcb->unsent.size();
+}
+
+void tcp_nagle_disable(struct tcp_pcb *pcb) {
+  if (pcb->fd >= 0) {
+    int one = 1;
+    setsockopt(pcb->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  }
+}
+
+err_t tcp_close(struct tcp_pcb *pcb) {
+  if (pcb->fd >= 0) tcp_output(pcb);
+  remove(pcb);
+  return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb *pcb) {
+  fail(pcb, ERR_ABRT);
+}
+
+namespace HostTcp {
+size_t openCount() { return openPcbs.size(); }
+}  // namespace HostTcp
@@ -0,0 +1,186 @@
+#include "lwip/udp.h"
+
+#include <Arduino.h>
+
+#include "HostClock.h"
+#include "HostLan.h"
+#include "HostNetwork.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vector>
+
+const ip_addr_t ip_addr_any = { 0 };
+const ip_addr_t ip_addr_broadcast = { 0xFFFFFFFFUL };
+
+struct udp_pcb {
+  int fd = -1;
+  udp_recv_fn recv = nullptr;
+  void *arg = nullptr;
+  bool broadcast = false;
+};
+
+namespace {
+
+std::vector<udp_pcb *> pcbs;
+bool registered = false;
+size_t live = 0;
+struct netif currentNetif;
+ip_addr_t currentDest;
+
+struct HostPbuf {
+  pbuf head;
+  pbuf tail;
+  uint8_t data[2048];
+};
+
+void poll() {
+  for (size_t i = 0; i < pcbs.size(); i++) {
+    udp_pcb *pcb = pcbs[i];
+    for (;;) {
+      HostPbuf *buffer = new HostPbuf();
+      sockaddr_in from = {};
+      socklen_t fromLength = sizeof(from);
+      ssize_t n = recvfrom(pcb->fd, buffer->data, sizeof(buffer->data), 0, (sockaddr *)&from, &fromLength);
+      if (n < 0) {
+        delete buffer;
+        break;
+      }
+      live++;
+      pbuf *p = &buffer->head;
+      p->payload = buffer->data;
+      p->tot_len = p->len = (u16_t)n;
+      p->next = nullptr;
+      if (getenv("RELAY_CHAIN") && n > 40) {
+        p->len = 40;
+        buffer->tail.payload = buffer->data + 40;
+        buffer->tail.tot_len = buffer->tail.len = (u16_t)(n - 40);
+        buffer->tail.next = nullptr;
+        p->next = &buffer->tail;
+      }
+      ip_addr_t source = { from.sin_addr.s_addr };
+      IPAddress simulated;
+      if (getenv("RELAY_SRC") && simulated.fromString(getenv("RELAY_SRC"))) {
+        source.addr = (uint32_t)simulated;
+      }
+      currentNetif.ip_addr.addr = (uint32_t)HostNetwork::config().ip;
+      currentNetif.netmask.addr = (uint32_t)HostNetwork::config().mask;
+      currentDest.addr = currentNetif.ip_addr.addr;
+      if (pcb->recv) {
+        pcb->recv(pcb->arg, pcb, p, &source, ntohs(from.sin_port));
+      } else {
+        pbuf_free(p);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+struct pbuf *pbuf_alloc(pbuf_layer, u16_t length, pbuf_type) {
+  HostPbuf *buffer = new HostPbuf();
+  live++;
+  buffer->head.payload = buffer->data;
+  buffer->head.tot_len = buffer->head.len = length;
+  buffer->head.next = nullptr;
+  return &buffer->head;
+}
+
+void pbuf_free(struct pbuf *p) {
+  live--;
+  delete reinterpret_cast<HostPbuf *>(p);
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *p, void *data, u16_t len, u16_t offset) {
+  u16_t copied = 0;
+  for (; p && copied < len; p = p->next) {
+    if (offset >= p->len) {
+      offset -= p->len;
+      continue;
+    }
+    u16_t n = std::min<u16_t>(p->len - offset, len - copied);
+    memcpy((uint8_t *)data + copied, (uint8_t *)p->payload + offset, n);
+    copied += n;
+    offset = 0;
+  }
+  return copied;
+}
+
+const struct netif *ip_current_netif() {
+  return &currentNetif;
+}
+
+const ip_addr_t *ip_current_dest_addr() {
+  return &currentDest;
+}
+
+bool ip_addr_isbroadcast(const ip_addr_t *addr, const struct netif *netif) {
+  return addr->addr == 0xFFFFFFFFUL || (addr->addr | netif->netmask.addr) == 0xFFFFFFFFUL;
+}
+
+void ip_set_option(struct udp_pcb *pcb, int option) {
+  if (option & SOF_BROADCAST) pcb->broadcast = true;
+}
+
+struct udp_pcb *udp_new() {
+  return new udp_pcb();
+}
+
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *, u16_t port) {
+  pcb->fd = socket(AF_INET, SOCK_DGRAM, 0);
+  int one = 1;
+  setsockopt(pcb->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(HostNetwork::mapPort(port));
+  if (bind(pcb->fd, (sockaddr *)&address, sizeof(address)) < 0) {
+    close(pcb->fd);
+    pcb->fd = -1;
+    return ERR_USE;
+  }
+  fcntl(pcb->fd, F_SETFL, O_NONBLOCK);
+  pcbs.push_back(pcb);
+  if (!registered) {
+    HostClock::addTask(poll);
+    registered = true;
+  }
+  return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *arg) {
+  pcb->recv = recv;
+  pcb->arg = arg;
+}
+
+void udp_remove(struct udp_pcb *pcb) {
+  for (size_t i = 0; i < pcbs.size(); i++) {
+    if (pcbs[i] == pcb) pcbs.erase(pcbs.begin() + i);
+  }
+  if (pcb->fd >= 0) close(pcb->fd);
+  delete pcb;
+}
+
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst, u16_t port) {
+  if (dst->addr == 0xFFFFFFFFUL && !pcb->broadcast) return ERR_ARG;
+  uint8_t flat[2048];
+  u16_t n = pbuf_copy_partial(p, flat, p->tot_len, 0);
+  if ((ntohl(dst->addr) >> 24) == 127) {
+    // Replies to clients on the host
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = dst->addr;
+    address.sin_port = htons(port);
+    return sendto(pcb->fd, flat, n, 0, (sockaddr *)&address, sizeof(address)) == n ? ERR_OK : ERR_ARG;
+  }
+  HostLan::observeDatagram(IPAddress(dst->addr), port, flat, n);
+  return ERR_OK;
+}
+
+namespace HostUdp {
+size_t openCount() { return pcbs.size(); }
+size_t livePbufs() { return live; }
+}  // namespace HostUdp
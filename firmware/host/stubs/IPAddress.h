@@ -0,0 +1,51 @@
+// Stand-in for the Arduino IPAddress class (IPv4 only).
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include <cstdint>
+#include <cstdio>
+
+#include "WString.h"
+
+class IPAddress {
+public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+  IPAddress(uint32_t address) : address(address) {}
+
+  // Network byte order, as lwIP stores it
+  operator uint32_t() const { return address; }
+  uint32_t v4() const { return address; }
+  uint8_t operator[](int index) const { return (address >> (index * 8)) & 0xFF; }
+  bool isSet() const { return address != 0; }
+  bool operator==(const IPAddress &other) const { return address == other.address; }
+  bool operator!=(const IPAddress &other) const { return address != other.address; }
+
+  bool fromString(const char *text) {
+    unsigned int parts[4];
+    char tail;
+    if (sscanf(text, "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &tail) != 4) return false;
+    for (unsigned int part : parts) {
+      if (part > 255) return false;
+    }
+    *this = IPAddress(parts[0], parts[1], parts[2], parts[3]);
+    return true;
+  }
+  bool fromString(const String &text) { return fromString(text.c_str()); }
+
+  String toString() const {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(buffer);
+  }
+
+  static bool isValid(const String &text) {
+    IPAddress ip;
+    return ip.fromString(text);
+  }
+
+private:
+  uint32_t address = 0;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include <LittleFS.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+fs::FS LittleFS;
+
+namespace fs {
+
+int File::available() {
+  if (!handle) return 0;
+  long position = ftell(handle.get());
+  fseek(handle.get(), 0, SEEK_END);
+  long end = ftell(handle.get());
+  fseek(handle.get(), position, SEEK_SET);
+  return (int)(end - position);
+}
+
+int File::peek() {
+  if (!handle) return -1;
+  int c = fgetc(handle.get());
+  if (c >= 0) ungetc(c, handle.get());
+  return c;
+}
+
+size_t File::size() const {
+  if (!handle) return 0;
+  struct stat info;
+  return fstat(fileno(handle.get()), &info) == 0 ? info.st_size : 0;
+}
+
+bool FS::begin() {
+  mkdir(root.c_str(), 0755);
+  struct stat info;
+  return stat(root.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+bool FS::format() {
+  String command = String("rm -rf '") + root + "'/*";
+  return system(command.c_str()) == 0;
+}
+
+File FS::open(const char *path, const char *mode) {
+  String fullPath = resolve(path);
+  String fopenMode = String(mode) + "b";
+  FILE *handle = fopen(fullPath.c_str(), fopenMode.c_str());
+  if (!handle) return File();
+  if (mode[0] == 'w' || mode[0] == 'a') openedForWrite++;
+  return File(handle, path);
+}
+
+bool FS::exists(const char *path) {
+  return access(resolve(path).c_str(), F_OK) == 0;
+}
+
+bool FS::remove(const char *path) {
+  return ::remove(resolve(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to) {
+  return ::rename(resolve(from).c_str(), resolve(to).c_str()) == 0;
+}
+
+}  // namespace fs
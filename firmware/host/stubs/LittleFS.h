@@ -0,0 +1,74 @@
+// Stand-in for LittleFS mapped onto a host directory.
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include <Arduino.h>
+
+#include <cstdio>
+#include <memory>
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File : public Stream {
+public:
+  File() {}
+  File(FILE *handle, const String &name) : handle(std::shared_ptr<FILE>(handle, fclose)), fileName(name) {}
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override { return handle ? fwrite(buffer, 1, size, handle.get()) : 0; }
+  using Print::write;
+  int available() override;
+  int read() override { return handle ? fgetc(handle.get()) : -1; }
+  size_t read(uint8_t *buffer, size_t size) { return handle ? fread(buffer, 1, size, handle.get()) : 0; }
+  size_t readBytes(uint8_t *buffer, size_t length) override { return read(buffer, length); }
+  int peek() override;
+  void flush() override {
+    if (handle) fflush(handle.get());
+  }
+  bool seek(uint32_t position, SeekMode mode = SeekSet) { return handle && fseek(handle.get(), position, mode) == 0; }
+  size_t position() const { return handle ? ftell(handle.get()) : 0; }
+  size_t size() const;
+  void close() { handle.reset(); }
+  const char *name() const { return fileName.c_str(); }
+  operator bool() const { return (bool)handle; }
+
+private:
+  std::shared_ptr<FILE> handle;
+  String fileName;
+};
+
+class FS {
+public:
+  bool begin();
+  void end() {}
+  bool format();
+  File open(const char *path, const char *mode);
+  File open(const String &path, const char *mode) { return open(path.c_str(), mode); }
+  bool exists(const char *path);
+  bool exists(const String &path) { return exists(path.c_str()); }
+  bool remove(const char *path);
+  bool remove(const String &path) { return remove(path.c_str()); }
+  bool rename(const char *from, const char *to);
+
+  // Host helpers
+  void setRoot(const String &root) { this->root = root; }
+  const String &getRoot() const { return root; }
+  unsigned long writes() const { return openedForWrite; }
+
+private:
+  String resolve(const char *path) const { return root + (path[0] == '/' ? "" : "/") + path; }
+
+  String root = "data";
+  unsigned long openedForWrite = 0;
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+
+extern fs::FS LittleFS;
+
+#endif
@@ -0,0 +1,51 @@
+#include "Updater.h"
+#include <stdlib.h>
+
+UpdaterClass Update;
+const char *UpdaterClass::path = getenv("FIRMWARE") ? getenv("FIRMWARE") : "firmware.bin";
+bool UpdaterClass::installed = false;
+
+void UpdaterClass::reset() {
+  if (file) fclose(file);
+  file = nullptr;
+  size = 0;
+  written = 0;
+}
+
+bool UpdaterClass::begin(size_t size) {
+  if (this->size) {
+    error = "Update already running";
+    return false;
+  }
+  error = "";
+  file = fopen(path, "wb");
+  if (!file) {
+    error = "Cannot open firmware file";
+    return false;
+  }
+  this->size = size;
+  written = 0;
+  return true;
+}
+
+size_t UpdaterClass::write(uint8_t *data, size_t length) {
+  if (!file || written + length > size) {
+    error = "Write outside of image";
+    return 0;
+  }
+  size_t n = fwrite(data, 1, length, file);
+  written += n;
+  return n;
+}
+
+bool UpdaterClass::end(bool evenIfRemaining) {
+  if (!size) return false;
+  if (written < size && !evenIfRemaining) {
+    error = "Premature end";
+    reset();
+    return false;
+  }
+  installed = true;
+  reset();
+  return true;
+}
@@ -0,0 +1,34 @@
+// Stand-in for the ESP8266 Updater: the image is written to a file.
+#ifndef HOST_UPDATER_H
+#define HOST_UPDATER_H
+
+#include <Arduino.h>
+#include <stdio.h>
+
+class UpdaterClass {
+public:
+  bool begin(size_t size);
+  size_t write(uint8_t *data, size_t length);
+  bool end(bool evenIfRemaining = false);
+  bool isRunning() const { return size > 0; }
+  bool isFinished() const { return size > 0 && written == size; }
+  bool hasError() const { return !error.isEmpty(); }
+  String getErrorString() const { return error; }
+  size_t progress() const { return written; }
+
+  // Host helpers
+  static const char *path;  // File receiving the image
+  static bool installed;    // An image was completely written
+
+private:
+  void reset();
+
+  FILE *file = nullptr;
+  size_t size = 0;
+  size_t written = 0;
+  String error;
+};
+
+extern UpdaterClass Update;
+
+#endif
@@ -0,0 +1,96 @@
+#include "WString.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+const String emptyString;
+
+static std::string formatInteger(unsigned long long value, bool negative, unsigned char base) {
+  if (base < 2 || base > 36) base = 10;
+  std::string digits;
+  do {
+    int digit = value % base;
+    digits += (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+    value /= base;
+  } while (value);
+  if (negative) digits += '-';
+  std::reverse(digits.begin(), digits.end());
+  return digits;
+}
+
+String::String(int value, unsigned char base) : String((long long)value, base) {}
+String::String(unsigned int value, unsigned char base) : String((unsigned long long)value, base) {}
+String::String(long value, unsigned char base) : String((long long)value, base) {}
+String::String(unsigned long value, unsigned char base) : String((unsigned long long)value, base) {}
+String::String(long long value, unsigned char base)
+  : data(base == 10 && value < 0 ? formatInteger(-(unsigned long long)value, true, base) : formatInteger((unsigned long long)value, false, base)) {}
+String::String(unsigned long long value, unsigned char base) : data(formatInteger(value, false, base)) {}
+String::String(float value, unsigned char decimals) : String((double)value, decimals) {}
+String::String(double value, unsigned char decimals) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+  data = buffer;
+}
+
+bool String::equalsIgnoreCase(const String &other) const {
+  if (data.size() != other.data.size()) return false;
+  for (size_t i = 0; i < data.size(); i++) {
+    if (tolower((unsigned char)data[i]) != tolower((unsigned char)other.data[i])) return false;
+  }
+  return true;
+}
+
+int String::indexOf(char c, size_t from) const {
+  size_t position = data.find(c, from);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+int String::indexOf(const String &value, size_t from) const {
+  size_t position = data.find(value.data, from);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+int String::lastIndexOf(char c) const {
+  size_t position = data.rfind(c);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+int String::lastIndexOf(char c, unsigned int from) const {
+  if (from >= data.size()) return -1;
+  size_t position = data.rfind(c, from);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+String String::substring(size_t from, size_t to) const {
+  if (from > to) std::swap(from, to);
+  if (from >= data.size()) return String();
+  return String(data.substr(from, std::min(to, data.size()) - from));
+}
+
+void String::replace(const String &find, const String &replacement) {
+  if (find.data.empty()) return;
+  size_t position = 0;
+  while ((position = data.find(find.data, position)) != std::string::npos) {
+    data.replace(position, find.data.size(), replacement.data);
+    position += replacement.data.size();
+  }
+}
+
+void String::toLowerCase() {
+  for (char &c : data) c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+  for (char &c : data) c = toupper((unsigned char)c);
+}
+
+void String::trim() {
+  size_t first = data.find_first_not_of(" \t\r\n");
+  if (first == std::string::npos) {
+    data.clear();
+    return;
+  }
+  size_t last = data.find_last_not_of(" \t\r\n");
+  data = data.substr(first, last - first + 1);
+}
@@ -0,0 +1,155 @@
+// Stand-in for the Arduino String class, backed by std::string.
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+class __FlashStringHelper;
+
+class String {
+public:
+  String() {}
+  String(const char *value) : data(value ? value : "") {}
+  String(const char *value, size_t length) : data(value, length) {}
+  String(const std::string &value) : data(value) {}
+  String(const __FlashStringHelper *value) : data(reinterpret_cast<const char *>(value)) {}
+  explicit String(char value) : data(1, value) {}
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(float value, unsigned char decimals = 2);
+  explicit String(double value, unsigned char decimals = 2);
+
+  size_t length() const { return data.size(); }
+  bool isEmpty() const { return data.empty(); }
+  const char *c_str() const { return data.c_str(); }
+  char *begin() { return &data[0]; }
+  char *end() { return &data[0] + data.size(); }
+  const char *begin() const { return data.c_str(); }
+  const char *end() const { return data.c_str() + data.size(); }
+  bool reserve(size_t size) {
+    data.reserve(size);
+    return true;
+  }
+  void clear() { data.clear(); }
+
+  char charAt(size_t index) const { return index < data.size() ? data[index] : 0; }
+  void setCharAt(size_t index, char c) {
+    if (index < data.size()) data[index] = c;
+  }
+  char operator[](size_t index) const { return charAt(index); }
+  char &operator[](size_t index) { return data[index]; }
+
+  String &operator=(const char *value) {
+    data = value ? value : "";
+    return *this;
+  }
+  template <typename T>
+  String &operator+=(const T &value) {
+    concat(value);
+    return *this;
+  }
+
+  // Return whether the string grew like the core does, ArduinoJson writes to a String with them
+  bool concat(const String &value) {
+    data += value.data;
+    return true;
+  }
+  bool concat(const char *value) {
+    if (!value) return false;
+    data += value;
+    return true;
+  }
+  bool concat(const char *value, size_t length) {
+    data.append(value, length);
+    return true;
+  }
+  bool concat(char value) {
+    data += value;
+    return true;
+  }
+  template <typename T>
+  bool concat(T value) {
+    return concat(String(value));
+  }
+
+  bool equals(const String &other) const { return data == other.data; }
+  bool equals(const char *other) const { return data == (other ? other : ""); }
+  bool equalsIgnoreCase(const String &other) const;
+  int compareTo(const String &other) const { return data.compare(other.data); }
+  bool startsWith(const String &prefix) const { return data.compare(0, prefix.data.size(), prefix.data) == 0; }
+  bool endsWith(const String &suffix) const {
+    return data.size() >= suffix.data.size() && data.compare(data.size() - suffix.data.size(), suffix.data.size(), suffix.data) == 0;
+  }
+
+  int indexOf(char c, size_t from = 0) const;
+  int indexOf(const String &value, size_t from = 0) const;
+  int lastIndexOf(char c) const;
+  int lastIndexOf(char c, unsigned int from) const;
+  String substring(size_t from) const { return from < data.size() ? String(data.substr(from)) : String(); }
+  String substring(size_t from, size_t to) const;
+  void replace(const String &find, const String &replacement);
+  void remove(size_t index, size_t count = (size_t)-1) {
+    if (index < data.size()) data.erase(index, count);
+  }
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const { return strtol(data.c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(data.c_str(), nullptr); }
+  double toDouble() const { return strtod(data.c_str(), nullptr); }
+
+  const std::string &str() const { return data; }
+
+  friend bool operator==(const String &a, const String &b) { return a.data == b.data; }
+  friend bool operator==(const String &a, const char *b) { return a.equals(b); }
+  friend bool operator!=(const String &a, const String &b) { return a.data != b.data; }
+  friend bool operator!=(const String &a, const char *b) { return !a.equals(b); }
+  friend bool operator<(const String &a, const String &b) { return a.data < b.data; }
+
+private:
+  std::string data;
+};
+
+inline String operator+(const String &a, const String &b) {
+  String result(a);
+  result += b;
+  return result;
+}
+inline String operator+(const String &a, const char *b) {
+  String result(a);
+  result += b;
+  return result;
+}
+inline String operator+(const char *a, const String &b) {
+  String result(a);
+  result += b;
+  return result;
+}
+inline String operator+(const String &a, char b) {
+  String result(a);
+  result += b;
+  return result;
+}
+template <typename T, typename = decltype(String(T()))>
+inline String operator+(const String &a, T b) {
+  String result(a);
+  result += String(b);
+  return result;
+}
+
+// Named by ArduinoJson, which adapts it like String
+class StringSumHelper : public String {
+public:
+  using String::String;
+};
+
+extern const String emptyString;
+
+#endif
@@ -0,0 +1,51 @@
+// Stand-in for the WakeOnLan library (a7md0/WakeOnLan), sending through WiFiUDP.
+#ifndef HOST_WAKEONLAN_H
+#define HOST_WAKEONLAN_H
+
+#include <WiFiUdp.h>
+
+class WakeOnLan {
+public:
+  explicit WakeOnLan(WiFiUDP &udp) : udp(udp) {}
+
+  void setRepeat(uint8_t repeatPacket, unsigned long delayPacket) {
+    repeat = repeatPacket;
+    delayBetween = delayPacket;
+  }
+  IPAddress calculateBroadcastAddress(IPAddress ip, IPAddress mask) {
+    broadcast = IPAddress((uint32_t)ip | ~(uint32_t)mask);
+    return broadcast;
+  }
+  void setBroadcastAddress(IPAddress address) { broadcast = address; }
+
+  bool sendMagicPacket(const String &mac, uint16_t port = 9) { return sendMagicPacket(mac.c_str(), port); }
+  bool sendMagicPacket(const char *mac, uint16_t port = 9) {
+    uint8_t bytes[6];
+    if (!parse(mac, bytes)) return false;
+    uint8_t packet[102];
+    memset(packet, 0xFF, 6);
+    for (int i = 0; i < 16; i++) memcpy(packet + 6 + i * 6, bytes, 6);
+    for (uint8_t i = 0; i < repeat; i++) {
+      if (i) delay(delayBetween);
+      if (!udp.beginPacket(broadcast, port)) return false;
+      udp.write(packet, sizeof(packet));
+      if (!udp.endPacket()) return false;
+    }
+    return true;
+  }
+
+private:
+  static bool parse(const char *mac, uint8_t bytes[6]) {
+    unsigned int parts[6];
+    if (sscanf(mac, "%x%*[:-]%x%*[:-]%x%*[:-]%x%*[:-]%x%*[:-]%x", &parts[0], &parts[1], &parts[2], &parts[3], &parts[4], &parts[5]) != 6) return false;
+    for (int i = 0; i < 6; i++) bytes[i] = (uint8_t)parts[i];
+    return true;
+  }
+
+  WiFiUDP &udp;
+  IPAddress broadcast = IPAddress(255, 255, 255, 255);
+  uint8_t repeat = 1;
+  unsigned long delayBetween = 0;
+};
+
+#endif
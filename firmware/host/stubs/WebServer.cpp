@@ -0,0 +1,362 @@
+#include <ESP8266WebServer.h>
+
+#include "HostNetwork.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+static const char *statusText(int code) {
+  switch (code) {
+    case 200: return "OK";
+    case 202: return "Accepted";
+    case 204: return "No Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "";
+  }
+}
+
+static String urlDecode(const String &text) {
+  String decoded;
+  for (size_t i = 0; i < text.length(); i++) {
+    char c = text[i];
+    if (c == '+') {
+      decoded += ' ';
+    } else if (c == '%' && i + 2 < text.length()) {
+      char hex[3] = { text[i + 1], text[i + 2], 0 };
+      decoded += (char)strtol(hex, nullptr, 16);
+      i += 2;
+    } else {
+      decoded += c;
+    }
+  }
+  return decoded;
+}
+
+static String base64Decode(const String &text) {
+  static const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  String decoded;
+  uint32_t buffer = 0;
+  int bits = 0;
+  for (char c : text) {
+    const char *position = strchr(alphabet, c);
+    if (!position || !c) continue;
+    buffer = (buffer << 6) | (position - alphabet);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      decoded += (char)((buffer >> bits) & 0xFF);
+    }
+  }
+  return decoded;
+}
+
+ESP8266WebServer::ESP8266WebServer(int port) : requestedPort(port) {}
+
+ESP8266WebServer::~ESP8266WebServer() {
+  close();
+}
+
+void ESP8266WebServer::begin() {
+  begin(requestedPort);
+}
+
+void ESP8266WebServer::begin(uint16_t port) {
+  close();
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(HostNetwork::mapPort(port));
+  if (bind(listener, (sockaddr *)&address, sizeof(address)) < 0 || listen(listener, 16) < 0) {
+    fprintf(stderr, "ESP8266WebServer: cannot listen on port %u: %s\n", HostNetwork::mapPort(port), strerror(errno));
+    ::close(listener);
+    listener = -1;
+    return;
+  }
+  socklen_t length = sizeof(address);
+  getsockname(listener, (sockaddr *)&address, &length);
+  boundPort = ntohs(address.sin_port);
+  fcntl(listener, F_SETFL, fcntl(listener, F_GETFL, 0) | O_NONBLOCK);
+}
+
+void ESP8266WebServer::close() {
+  if (listener >= 0) ::close(listener);
+  listener = -1;
+}
+
+void ESP8266WebServer::on(const Uri &uri, HTTPMethod method, THandlerFunction handler) {
+  routes.push_back(Route{ std::unique_ptr<Uri>(uri.clone()), method, handler });
+}
+
+void ESP8266WebServer::collectHeaders(const char *headerKeys[], const size_t headerKeysCount) {
+  collected.clear();
+  for (size_t i = 0; i < headerKeysCount; i++) collected.push_back(headerKeys[i]);
+}
+
+const String &ESP8266WebServer::arg(const String &name) const {
+  for (const Arg &a : currentArgs) {
+    if (a.name == name) return a.value;
+  }
+  return emptyString;
+}
+
+const String &ESP8266WebServer::arg(int index) const {
+  return index >= 0 && index < (int)currentArgs.size() ? currentArgs[index].value : emptyString;
+}
+
+const String &ESP8266WebServer::argName(int index) const {
+  return index >= 0 && index < (int)currentArgs.size() ? currentArgs[index].name : emptyString;
+}
+
+bool ESP8266WebServer::hasArg(const String &name) const {
+  for (const Arg &a : currentArgs) {
+    if (a.name == name) return true;
+  }
+  return false;
+}
+
+const String &ESP8266WebServer::pathArg(unsigned int index) const {
+  return index < pathArgs.size() ? pathArgs[index] : emptyString;
+}
+
+const String &ESP8266WebServer::header(const String &name) const {
+  for (const Arg &h : currentHeaders) {
+    if (h.name.equalsIgnoreCase(name)) return h.value;
+  }
+  return emptyString;
+}
+
+bool ESP8266WebServer::hasHeader(const String &name) const {
+  for (const Arg &h : currentHeaders) {
+    if (h.name.equalsIgnoreCase(name)) return true;
+  }
+  return false;
+}
+
+bool ESP8266WebServer::authenticate(const char *username, const char *password) {
+  String authorization = header("Authorization");
+  if (!authorization.startsWith("Basic ")) return false;
+  String credentials = base64Decode(authorization.substring(6));
+  return credentials == String(username) + ":" + password;
+}
+
+void ESP8266WebServer::requestAuthentication() {
+  sendHeader("WWW-Authenticate", "Basic realm=\"Login Required\"");
+  send(401, "text/html", "401 Unauthorized");
+}
+
+void ESP8266WebServer::sendHeader(const String &name, const String &value, bool first) {
+  String line = name + ": " + value + "\r\n";
+  responseHeaders = first ? line + responseHeaders : responseHeaders + line;
+}
+
+void ESP8266WebServer::writeHead(int code, const char *contentType, size_t length) {
+  responseCode = code;
+  String head = String("HTTP/1.1 ") + code + " " + statusText(code) + "\r\n";
+  if (contentType && *contentType) head += String("Content-Type: ") + contentType + "\r\n";
+  if (length == CONTENT_LENGTH_UNKNOWN) {
+    head += "Transfer-Encoding: chunked\r\n";
+    chunked = true;
+  } else {
+    head += String("Content-Length: ") + length + "\r\n";
+  }
+  head += responseHeaders;
+  head += "Connection: close\r\n\r\n";
+  responseHeaders = "";
+  currentClient.write((const uint8_t *)head.c_str(), head.length());
+  headSent = true;
+}
+
+void ESP8266WebServer::send(int code, const char *contentType, const String &content) {
+  send(code, contentType, content.c_str(), content.length());
+}
+
+void ESP8266WebServer::send(int code, const char *contentType, const char *content, size_t length) {
+  size_t declared = contentLength == CONTENT_LENGTH_NOT_SET ? length : contentLength;
+  contentLength = CONTENT_LENGTH_NOT_SET;
+  writeHead(code, contentType, declared);
+  if (length && currentMethod != HTTP_HEAD) sendContent(content, length);
+}
+
+void ESP8266WebServer::sendContent(const char *content, size_t size) {
+  if (!chunked) {
+    currentClient.write((const uint8_t *)content, size);
+    return;
+  }
+  char prefix[16];
+  snprintf(prefix, sizeof(prefix), "%zx\r\n", size);
+  currentClient.write((const uint8_t *)prefix, strlen(prefix));
+  if (size) currentClient.write((const uint8_t *)content, size);
+  currentClient.write((const uint8_t *)"\r\n", 2);
+  if (!size) chunked = false;
+}
+
+void ESP8266WebServer::parseForm(const String &form) {
+  size_t position = 0;
+  while (position < form.length()) {
+    int end = form.indexOf('&', position);
+    String pair = form.substring(position, end < 0 ? form.length() : end);
+    int equals = pair.indexOf('=');
+    if (pair.length()) {
+      currentArgs.push_back(Arg{ urlDecode(equals < 0 ? pair : pair.substring(0, equals)), urlDecode(equals < 0 ? String() : pair.substring(equals + 1)) });
+    }
+    if (end < 0) break;
+    position = end + 1;
+  }
+}
+
+bool ESP8266WebServer::readRequest() {
+  std::string request;
+  size_t headerEnd = std::string::npos;
+  unsigned long start = millis();
+  int fd = currentClient.fd();
+  size_t bodyLength = 0;
+
+  while (true) {
+    char buffer[2048];
+    ssize_t n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (n > 0) {
+      request.append(buffer, n);
+    } else if (n == 0) {
+      break;
+    } else {
+      pollfd pending = { fd, POLLIN, 0 };
+      if (poll(&pending, 1, 50) < 0) return false;
+    }
+    if (headerEnd == std::string::npos) {
+      headerEnd = request.find("\r\n\r\n");
+      if (headerEnd != std::string::npos) {
+        String headers(request.substr(0, headerEnd));
+        String lower = headers;
+        lower.toLowerCase();
+        int position = lower.indexOf("content-length:");
+        if (position >= 0) bodyLength = strtoul(headers.c_str() + position + 15, nullptr, 10);
+      }
+    }
+    if (headerEnd != std::string::npos && request.size() >= headerEnd + 4 + bodyLength) break;
+    if (millis() - start > 2000) return false;
+  }
+  if (headerEnd == std::string::npos) return false;
+
+  currentArgs.clear();
+  currentHeaders.clear();
+  pathArgs.clear();
+  String head(request.substr(0, headerEnd));
+  String body(request.substr(headerEnd + 4, bodyLength));
+
+  int lineEnd = head.indexOf("\r\n");
+  String requestLine = lineEnd < 0 ? head : head.substring(0, lineEnd);
+  int firstSpace = requestLine.indexOf(' ');
+  int secondSpace = requestLine.indexOf(' ', firstSpace + 1);
+  if (firstSpace < 0 || secondSpace < 0) return false;
+  String methodName = requestLine.substring(0, firstSpace);
+  String target = requestLine.substring(firstSpace + 1, secondSpace);
+
+  currentMethod = HTTP_ANY;
+  if (methodName == "GET") currentMethod = HTTP_GET;
+  else if (methodName == "HEAD") currentMethod = HTTP_HEAD;
+  else if (methodName == "POST") currentMethod = HTTP_POST;
+  else if (methodName == "PUT") currentMethod = HTTP_PUT;
+  else if (methodName == "PATCH") currentMethod = HTTP_PATCH;
+  else if (methodName == "DELETE") currentMethod = HTTP_DELETE;
+  else if (methodName == "OPTIONS") currentMethod = HTTP_OPTIONS;
+
+  int query = target.indexOf('?');
+  currentUri = urlDecode(query < 0 ? target : target.substring(0, query));
+  String queryString = query < 0 ? String() : target.substring(query + 1);
+
+  parseForm(queryString);
+
+  size_t position = lineEnd < 0 ? head.length() : lineEnd + 2;
+  while (position < head.length()) {
+    int end = head.indexOf("\r\n", position);
+    String line = head.substring(position, end < 0 ? head.length() : end);
+    int colon = line.indexOf(':');
+    if (colon > 0) {
+      String value = line.substring(colon + 1);
+      value.trim();
+      currentHeaders.push_back(Arg{ line.substring(0, colon), value });
+    }
+    if (end < 0) break;
+    position = end + 2;
+  }
+
+  if (body.length()) {
+    if (header("Content-Type").startsWith("application/x-www-form-urlencoded")) parseForm(body);
+    currentArgs.push_back(Arg{ "plain", body });
+  }
+  return true;
+}
+
+void ESP8266WebServer::finishResponse() {
+  if (chunked) sendContent("", 0);
+  currentClient.stop();
+  headSent = false;
+  chunked = false;
+  responseHeaders = "";
+  contentLength = CONTENT_LENGTH_NOT_SET;
+}
+
+void ESP8266WebServer::hostRequest(HTTPMethod method, const String &uri, const String &body) {
+  finishResponse();
+  currentClient = WiFiClient();
+  currentMethod = method;
+  responseCode = 0;
+  int query = uri.indexOf('?');
+  currentUri = query < 0 ? uri : uri.substring(0, query);
+  currentArgs.clear();
+  currentHeaders.clear();
+  pathArgs.clear();
+  if (query >= 0) parseForm(uri.substring(query + 1));
+  if (body.length()) currentArgs.push_back(Arg{ "plain", body });
+}
+
+bool WiFiServer::hasClient() {
+  if (fd < 0) return false;
+  pollfd p = { fd, POLLIN, 0 };
+  return poll(&p, 1, 0) > 0;
+}
+
+void ESP8266WebServer::handleClient() {
+  if (listener < 0) return;
+  int fd = accept(listener, nullptr, nullptr);
+  if (fd < 0) return;
+  currentClient = WiFiClient(fd);
+  if (!readRequest()) {
+    currentClient.stop();
+    return;
+  }
+
+  bool handled = false;
+  for (Route &route : routes) {
+    if ((route.method == HTTP_ANY || route.method == currentMethod) && route.uri->canHandle(currentUri, pathArgs)) {
+      route.handler();
+      handled = true;
+      break;
+    }
+  }
+  if (!handled) {
+    if (notFoundHandler) {
+      notFoundHandler();
+    } else {
+      send(404, "text/plain", String("Not found: ") + currentUri);
+    }
+  }
+  if (!headSent) send(500, "text/plain", "Handler sent no response");
+  finishResponse();
+}
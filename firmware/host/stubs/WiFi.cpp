@@ -0,0 +1,333 @@
+#include <ESP8266WiFi.h>
+
+#include "HostNetwork.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <vector>
+
+WiFiClass WiFi;
+
+namespace HostNetwork {
+
+static Config current;
+static uint16_t portOffset = 8000;
+
+Config &config() {
+  return current;
+}
+
+uint16_t mapPort(uint16_t port) {
+  return port && port < 1024 ? port + portOffset : port;
+}
+
+void setPortOffset(uint16_t offset) {
+  portOffset = offset;
+}
+
+}  // namespace HostNetwork
+
+WiFiClient::Socket::~Socket() {
+  if (fd >= 0) close(fd);
+}
+
+WiFiClient::WiFiClient(int fd) : socket(new Socket{ fd }) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+WiFiClient::WiFiClient(const WiFiClient &other) : Client(), socket(other.socket), peeked(other.peeked), closed(other.closed) {}
+
+WiFiClient &WiFiClient::operator=(const WiFiClient &other) {
+  socket = other.socket;
+  peeked = other.peeked;
+  closed = other.closed;
+  return *this;
+}
+
+WiFiClient::~WiFiClient() {}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+  stop();
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return 0;
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = (uint32_t)ip;
+
+  int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  int result = ::connect(fd, (sockaddr *)&address, sizeof(address));
+  if (result < 0 && errno == EINPROGRESS) {
+    pollfd pending = { fd, POLLOUT, 0 };
+    if (poll(&pending, 1, (int)timeout) == 1) {
+      int error = 0;
+      socklen_t length = sizeof(error);
+      getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+      result = error ? -1 : 0;
+    }
+  }
+  if (result < 0) {
+    close(fd);
+    return 0;
+  }
+  *this = WiFiClient(fd);
+  return 1;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port) {
+  IPAddress ip;
+  if (!WiFi.hostByName(host, ip)) return 0;
+  return connect(ip, port);
+}
+
+size_t WiFiClient::write(const uint8_t *buffer, size_t size) {
+  if (!socket) return 0;
+  size_t sent = 0;
+  while (sent < size) {
+    ssize_t n = send(socket->fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+    if (n > 0) {
+      sent += n;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      pollfd pending = { socket->fd, POLLOUT, 0 };
+      if (poll(&pending, 1, (int)timeout) <= 0) break;
+    } else {
+      closed = true;
+      break;
+    }
+  }
+  return sent;
+}
+
+int WiFiClient::available() {
+  if (!socket) return 0;
+  int pending = 0;
+  if (ioctl(socket->fd, FIONREAD, &pending) < 0) return 0;
+  if (pending == 0 && !closed) {
+    // Detect an orderly shutdown from the peer
+    char probe;
+    ssize_t n = recv(socket->fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0) closed = true;
+  }
+  return pending + (peeked >= 0 ? 1 : 0);
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t *buffer, size_t size) {
+  if (!socket || !size) return 0;
+  size_t n = 0;
+  if (peeked >= 0) {
+    buffer[n++] = (uint8_t)peeked;
+    peeked = -1;
+  }
+  if (n < size) {
+    ssize_t received = recv(socket->fd, buffer + n, size - n, MSG_DONTWAIT);
+    if (received > 0) {
+      n += received;
+    } else if (received == 0) {
+      closed = true;
+    }
+  }
+  return n ? (int)n : -1;
+}
+
+int WiFiClient::peek() {
+  if (peeked < 0) {
+    uint8_t c;
+    if (socket && recv(socket->fd, &c, 1, MSG_DONTWAIT) == 1) peeked = c;
+  }
+  return peeked;
+}
+
+void WiFiClient::stop() {
+  socket.reset();
+  peeked = -1;
+  closed = false;
+}
+
+uint8_t WiFiClient::connected() {
+  if (!socket) return 0;
+  if (peeked >= 0) return 1;
+  available();
+  return closed ? 0 : 1;
+}
+
+static IPAddress socketAddress(int fd, bool peer, uint16_t *port) {
+  sockaddr_in address = {};
+  socklen_t length = sizeof(address);
+  if (fd < 0 || (peer ? getpeername(fd, (sockaddr *)&address, &length) : getsockname(fd, (sockaddr *)&address, &length)) < 0) {
+    return IPAddress();
+  }
+  if (port) *port = ntohs(address.sin_port);
+  return IPAddress(address.sin_addr.s_addr);
+}
+
+IPAddress WiFiClient::remoteIP() const {
+  return socketAddress(fd(), true, nullptr);
+}
+
+uint16_t WiFiClient::remotePort() const {
+  uint16_t port = 0;
+  socketAddress(fd(), true, &port);
+  return port;
+}
+
+IPAddress WiFiClient::localIP() const {
+  return socketAddress(fd(), false, nullptr);
+}
+
+uint16_t WiFiClient::localPort() const {
+  uint16_t port = 0;
+  socketAddress(fd(), false, &port);
+  return port;
+}
+
+struct EventHandlers {
+  std::vector<std::weak_ptr<std::function<void(const WiFiEventStationModeConnected &)>>> connected;
+  std::vector<std::weak_ptr<std::function<void(const WiFiEventStationModeDisconnected &)>>> disconnected;
+  std::vector<std::weak_ptr<std::function<void(const WiFiEventStationModeGotIP &)>>> gotIP;
+};
+
+static EventHandlers eventHandlers;
+
+template <typename Event>
+static WiFiEventHandler subscribe(std::vector<std::weak_ptr<std::function<void(const Event &)>>> &list, std::function<void(const Event &)> handler) {
+  auto shared = std::make_shared<std::function<void(const Event &)>>(std::move(handler));
+  list.push_back(shared);
+  return shared;
+}
+
+template <typename Event>
+static void dispatch(std::vector<std::weak_ptr<std::function<void(const Event &)>>> &list, const Event &event) {
+  for (auto &weak : list) {
+    if (auto handler = weak.lock()) (*handler)(event);
+  }
+}
+
+wl_status_t WiFiClass::begin(const char *newSsid, const char *newPassphrase, int32_t newChannel, const uint8_t *newBssid, bool connect) {
+  if (newSsid) ssid = newSsid;
+  if (newPassphrase) passphrase = newPassphrase;
+  if (newChannel) currentChannel = newChannel;
+  if (newBssid) memcpy(bssid, newBssid, sizeof(bssid));
+  if (connect) hostSetConnected(true);
+  return status();
+}
+
+bool WiFiClass::config(IPAddress ip, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress) {
+  HostNetwork::Config &config = HostNetwork::config();
+  if (ip.isSet()) {
+    config.ip = ip;
+    config.gateway = gateway;
+    config.mask = subnet;
+    if (dns1.isSet()) config.dns = dns1;
+  } else {
+    config = HostNetwork::Config();  // DHCP: the lease is the loopback address
+  }
+  return true;
+}
+
+bool WiFiClass::disconnect(bool) {
+  hostSetConnected(false);
+  return true;
+}
+
+bool WiFiClass::reconnect() {
+  hostSetConnected(true);
+  return true;
+}
+
+IPAddress WiFiClass::localIP() const {
+  return connectedState ? HostNetwork::config().ip : IPAddress();
+}
+
+IPAddress WiFiClass::subnetMask() const {
+  return HostNetwork::config().mask;
+}
+
+IPAddress WiFiClass::gatewayIP() const {
+  return HostNetwork::config().gateway;
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t) const {
+  return HostNetwork::config().dns;
+}
+
+uint8_t *WiFiClass::macAddress(uint8_t *mac) const {
+  static const uint8_t address[6] = { 0x5C, 0xCF, 0x7F, 0x00, 0x00, 0x01 };
+  memcpy(mac, address, sizeof(address));
+  return mac;
+}
+
+String WiFiClass::BSSIDstr() const {
+  char buffer[18];
+  snprintf(buffer, sizeof(buffer), "%02X:%02X:%02X:%02X:%02X:%02X", bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+  return String(buffer);
+}
+
+int WiFiClass::hostByName(const char *name, IPAddress &result) {
+  if (result.fromString(name)) return 1;
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  addrinfo *info = nullptr;
+  if (getaddrinfo(name, nullptr, &hints, &info) != 0 || !info) return 0;
+  result = IPAddress(((sockaddr_in *)info->ai_addr)->sin_addr.s_addr);
+  freeaddrinfo(info);
+  return 1;
+}
+
+WiFiEventHandler WiFiClass::onStationModeConnected(std::function<void(const WiFiEventStationModeConnected &)> handler) {
+  return subscribe(eventHandlers.connected, std::move(handler));
+}
+
+WiFiEventHandler WiFiClass::onStationModeDisconnected(std::function<void(const WiFiEventStationModeDisconnected &)> handler) {
+  return subscribe(eventHandlers.disconnected, std::move(handler));
+}
+
+WiFiEventHandler WiFiClass::onStationModeGotIP(std::function<void(const WiFiEventStationModeGotIP &)> handler) {
+  return subscribe(eventHandlers.gotIP, std::move(handler));
+}
+
+void WiFiClass::hostSetConnected(bool connected) {
+  if (connected == connectedState) return;
+  connectedState = connected;
+  if (connected) {
+    WiFiEventStationModeConnected event = { ssid, {}, (uint8_t)currentChannel };
+    memcpy(event.bssid, bssid, sizeof(bssid));
+    dispatch(eventHandlers.connected, event);
+    const HostNetwork::Config &config = HostNetwork::config();
+    dispatch(eventHandlers.gotIP, WiFiEventStationModeGotIP{ config.ip, config.mask, config.gateway });
+  } else {
+    WiFiEventStationModeDisconnected event = { ssid, {}, 8 };
+    memcpy(event.bssid, bssid, sizeof(bssid));
+    dispatch(eventHandlers.disconnected, event);
+  }
+}
+
+bool wifi_station_dhcpc_start() {
+  return true;
+}
+
+bool wifi_station_disconnect() {
+  WiFi.hostSetConnected(false);
+  return true;
+}
+
+bool wifi_station_dhcpc_stop() {
+  return true;
+}
@@ -0,0 +1,58 @@
+// Stand-in for tzapu/WiFiManager; the host station is always configured.
+#ifndef HOST_WIFIMANAGER_H
+#define HOST_WIFIMANAGER_H
+
+#include <ESP8266WiFi.h>
+
+class WiFiManager {
+public:
+  bool autoConnect(const char *apName = nullptr, const char *apPassword = nullptr) {
+    (void)apName;
+    (void)apPassword;
+    if (WiFi.isConnected()) return true;
+    portalActive = true;
+    if (blocking) {
+      while (!WiFi.isConnected()) delay(100);
+      portalActive = false;
+      return true;
+    }
+    return false;
+  }
+  bool startConfigPortal(const char *apName = nullptr, const char *apPassword = nullptr) {
+    (void)apName;
+    (void)apPassword;
+    portalActive = true;
+    return !blocking;
+  }
+  bool process() {
+    if (portalActive && WiFi.isConnected()) {
+      portalActive = false;
+      return true;
+    }
+    return false;
+  }
+  bool stopConfigPortal() {
+    portalActive = false;
+    return true;
+  }
+  bool getConfigPortalActive() const { return portalActive; }
+  void setConfigPortalBlocking(bool shouldBlock) { blocking = shouldBlock; }
+  void setConfigPortalTimeout(unsigned long) {}
+  void setConnectTimeout(unsigned long) {}
+  void setConnectRetries(uint8_t) {}
+  void setWiFiAutoReconnect(bool) {}
+  void setHostname(const char *name) { WiFi.hostname(name); }
+  String getWiFiHostname() const { return WiFi.hostname(); }
+  String getWiFiSSID(bool = false) const { return WiFi.SSID(); }
+  String getWiFiPass(bool = false) const { return WiFi.psk(); }
+  void setSTAStaticIPConfig(IPAddress ip, IPAddress gateway, IPAddress mask, IPAddress dns = IPAddress()) { WiFi.config(ip, gateway, mask, dns); }
+  void resetSettings() {}
+  void setSaveConfigCallback(std::function<void()> callback) { saveCallback = callback; }
+
+private:
+  bool blocking = true;
+  bool portalActive = false;
+  std::function<void()> saveCallback;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include <WiFiUdp.h>
+
+#include "HostLan.h"
+#include "HostNetwork.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+bool WiFiUDP::open() {
+  if (fd >= 0) return true;
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) return false;
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(fd, IPPROTO_IP, IP_PKTINFO, &one, sizeof(one));
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  return true;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+  stop();
+  if (!open()) return 0;
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(HostNetwork::mapPort(port));
+  if (bind(fd, (sockaddr *)&address, sizeof(address)) < 0) {
+    stop();
+    return 0;
+  }
+  socklen_t length = sizeof(address);
+  getsockname(fd, (sockaddr *)&address, &length);
+  boundPort = ntohs(address.sin_port);
+  return 1;
+}
+
+uint8_t WiFiUDP::beginMulticast(IPAddress interfaceAddress, IPAddress multicast, uint16_t port) {
+  if (!begin(port)) return 0;
+  ip_mreq membership = {};
+  membership.imr_multiaddr.s_addr = (uint32_t)multicast;
+  membership.imr_interface.s_addr = (uint32_t)interfaceAddress;
+  setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership));
+  return 1;
+}
+
+void WiFiUDP::stop() {
+  injected.clear();
+  if (fd >= 0) close(fd);
+  fd = -1;
+  boundPort = 0;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+  if (!open()) return 0;
+  outgoingAddress = ip;
+  outgoingPort = port;
+  outgoing.clear();
+  return 1;
+}
+
+int WiFiUDP::beginPacket(const char *host, uint16_t port) {
+  IPAddress ip;
+  if (!WiFi.hostByName(host, ip)) return 0;
+  return beginPacket(ip, port);
+}
+
+int WiFiUDP::beginPacketMulticast(IPAddress multicast, uint16_t port, IPAddress, int ttl) {
+  if (!beginPacket(multicast, port)) return 0;
+  setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+  return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *buffer, size_t size) {
+  outgoing.insert(outgoing.end(), buffer, buffer + size);
+  return size;
+}
+
+int WiFiUDP::endPacket() {
+  if (fd < 0) return 0;
+  HostLan::observeDatagram(outgoingAddress, outgoingPort, outgoing.data(), outgoing.size());
+  IPAddress from;
+  std::vector<uint8_t> answer = HostLan::answerDatagram(outgoingAddress, outgoingPort, outgoing.data(), outgoing.size(), from);
+  if (!answer.empty()) injected.push_back({ from, outgoingPort, answer });
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = (uint32_t)outgoingAddress;
+  address.sin_port = htons(HostNetwork::mapPort(outgoingPort));
+  ssize_t sent = sendto(fd, outgoing.data(), outgoing.size(), 0, (sockaddr *)&address, sizeof(address));
+  outgoing.clear();
+  return sent >= 0 ? 1 : 0;
+}
+
+int WiFiUDP::parsePacket() {
+  incoming.clear();
+  readPosition = 0;
+  if (fd < 0) return 0;
+  if (!injected.empty()) {
+    incoming = injected.front().data;
+    remoteAddress = injected.front().from;
+    remotePortNumber = injected.front().port;
+    injected.pop_front();
+    return (int)incoming.size();
+  }
+  uint8_t buffer[2048];
+  sockaddr_in address = {};
+  char control[64];
+  iovec vector = { buffer, sizeof(buffer) };
+  msghdr message = {};
+  message.msg_name = &address;
+  message.msg_namelen = sizeof(address);
+  message.msg_iov = &vector;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  ssize_t n = recvmsg(fd, &message, MSG_DONTWAIT);
+  if (n <= 0) return 0;
+  destinationAddress = IPAddress();
+  for (cmsghdr *header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+    if (header->cmsg_level == IPPROTO_IP && header->cmsg_type == IP_PKTINFO) {
+      destinationAddress = IPAddress(((in_pktinfo *)CMSG_DATA(header))->ipi_addr.s_addr);
+    }
+  }
+  incoming.assign(buffer, buffer + n);
+  remoteAddress = IPAddress(address.sin_addr.s_addr);
+  remotePortNumber = ntohs(address.sin_port);
+  return (int)n;
+}
+
+int WiFiUDP::read(uint8_t *buffer, size_t size) {
+  size_t n = std::min(size, incoming.size() - readPosition);
+  memcpy(buffer, incoming.data() + readPosition, n);
+  readPosition += n;
+  return (int)n;
+}
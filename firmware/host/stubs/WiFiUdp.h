@@ -0,0 +1,61 @@
+// Stand-in for WiFiUDP on a POSIX datagram socket.
+#ifndef HOST_WIFIUDP_H
+#define HOST_WIFIUDP_H
+
+#include <ESP8266WiFi.h>
+
+#include <deque>
+#include <vector>
+
+class WiFiUDP : public Stream {
+public:
+  WiFiUDP() {}
+  WiFiUDP(const WiFiUDP &) = delete;
+  WiFiUDP &operator=(const WiFiUDP &) = delete;
+  ~WiFiUDP() { stop(); }
+
+  uint8_t begin(uint16_t port);
+  uint8_t beginMulticast(IPAddress interfaceAddress, IPAddress multicast, uint16_t port);
+  void stop();
+
+  int beginPacket(IPAddress ip, uint16_t port);
+  int beginPacket(const char *host, uint16_t port);
+  int beginPacketMulticast(IPAddress multicast, uint16_t port, IPAddress interfaceAddress, int ttl = 1);
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  int endPacket();
+
+  int parsePacket();
+  int available() override { return (int)(incoming.size() - readPosition); }
+  int read() override { return readPosition < incoming.size() ? incoming[readPosition++] : -1; }
+  int read(uint8_t *buffer, size_t size);
+  int read(char *buffer, size_t size) { return read((uint8_t *)buffer, size); }
+  int peek() override { return readPosition < incoming.size() ? incoming[readPosition] : -1; }
+  void flush() override {
+    incoming.clear();
+    readPosition = 0;
+  }
+  IPAddress remoteIP() const { return remoteAddress; }
+  uint16_t remotePort() const { return remotePortNumber; }
+  IPAddress destinationIP() const { return destinationAddress; }
+  uint16_t localPort() const { return boundPort; }
+
+private:
+  bool open();
+
+  int fd = -1;
+  uint16_t boundPort = 0;
+  IPAddress outgoingAddress;
+  uint16_t outgoingPort = 0;
+  std::vector<uint8_t> outgoing;
+  std::vector<uint8_t> incoming;
+  size_t readPosition = 0;
+  IPAddress remoteAddress;
+  uint16_t remotePortNumber = 0;
+  IPAddress destinationAddress;
+  struct Injected { IPAddress from; uint16_t port; std::vector<uint8_t> data; };
+  std::deque<Injected> injected;  // Answers of simulated hosts
+};
+
+#endif
@@ -0,0 +1,37 @@
+// Stand-in for the BearSSL HMAC API of the ESP8266 core, SHA-256 only.
+#ifndef HOST_BEARSSL_HMAC_H
+#define HOST_BEARSSL_HMAC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct br_hash_class {
+  size_t output_size;
+} br_hash_class;
+
+extern const br_hash_class br_sha256_vtable;
+
+typedef struct {
+  uint32_t state[8];
+  uint8_t block[64];
+  uint64_t count;
+} br_sha256_context;
+
+typedef struct {
+  const br_hash_class *dig_vtable;
+  br_sha256_context inner;  // After the key XOR ipad block
+  br_sha256_context outer;  // After the key XOR opad block
+} br_hmac_key_context;
+
+typedef struct {
+  br_sha256_context inner;
+  br_sha256_context outer;
+  size_t out_len;
+} br_hmac_context;
+
+void br_hmac_key_init(br_hmac_key_context *kc, const br_hash_class *digest_vtable, const void *key, size_t key_len);
+void br_hmac_init(br_hmac_context *ctx, const br_hmac_key_context *kc, size_t out_len);
+void br_hmac_update(br_hmac_context *ctx, const void *data, size_t len);
+size_t br_hmac_out(const br_hmac_context *ctx, void *out);
+
+#endif
@@ -0,0 +1,49 @@
+// Stand-in for the esp_delay()/esp_schedule() pair of the ESP8266 core.
+#ifndef HOST_COREDECLS_H
+#define HOST_COREDECLS_H
+
+#include <Arduino.h>
+
+namespace HostClock {
+extern bool scheduled;
+}
+
+// CRC-32 (IEEE 802.3, reflected), like the core's
+inline uint32_t crc32(const void *data, size_t length, uint32_t crc = 0xffffffff) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  while (length--) {
+    crc ^= *bytes++;
+    for (int i = 0; i < 8; i++) crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+  }
+  return crc;
+}
+
+// Ends the current esp_delay() early, as lwIP callbacks do on the device
+inline void esp_schedule() {
+  HostClock::scheduled = true;
+}
+
+// Waits up to timeout_ms while blocked() holds, checking it every intvl_ms or when esp_schedule() is called
+template <typename T>
+inline void esp_delay(const uint32_t timeout_ms, T &&blocked, const uint32_t intvl_ms) {
+  unsigned long start = millis();
+  unsigned long checked = start;
+  HostClock::scheduled = false;
+  while (millis() - start < timeout_ms) {
+    delay(1);
+    if (HostClock::scheduled || millis() - checked >= intvl_ms) {
+      HostClock::scheduled = false;
+      checked = millis();
+      if (!blocked()) {
+        return;
+      }
+    }
+  }
+}
+
+template <typename T>
+inline void esp_delay(const uint32_t timeout_ms, T &&blocked) {
+  esp_delay(timeout_ms, blocked, timeout_ms);
+}
+
+#endif
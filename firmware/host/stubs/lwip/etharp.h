@@ -0,0 +1,39 @@
+// Stand-in for the lwIP ARP API, backed by a static entry table on the host.
+#ifndef HOST_LWIP_ETHARP_H
+#define HOST_LWIP_ETHARP_H
+
+#include <stdint.h>
+#include <arpa/inet.h>
+
+// Off like in lwIP and the lwip2 builds of the ESP8266 core; -DETHARP_SUPPORT_STATIC_ENTRIES=1 for a custom build
+#ifndef ETHARP_SUPPORT_STATIC_ENTRIES
+#define ETHARP_SUPPORT_STATIC_ENTRIES 0
+#endif
+
+#include "lwip/ip_addr.h"
+#include "lwip/netif.h"
+
+#include <sys/types.h>
+
+struct eth_addr {
+  uint8_t addr[6];
+};
+
+err_t etharp_add_static_entry(const ip4_addr_t *ipaddr, struct eth_addr *ethaddr);
+err_t etharp_remove_static_entry(const ip4_addr_t *ipaddr);
+
+// Requests are answered by up simulated hosts a few milliseconds later
+#define ARP_TABLE_SIZE 10
+
+err_t etharp_request(struct netif *netif, const ip4_addr_t *ipaddr);
+int etharp_get_entry(size_t i, ip4_addr_t **ipaddr, struct netif **netif, struct eth_addr **eth_ret);
+ssize_t etharp_find_addr(struct netif *netif, const ip4_addr_t *ipaddr, struct eth_addr **eth_ret, const ip4_addr_t **ip_ret);
+
+namespace HostArp {
+// Returns the MAC of a static entry, nullptr if there is none
+const uint8_t *findStatic(uint32_t ip);
+size_t staticCount();
+size_t requestCount();
+}  // namespace HostArp
+
+#endif
@@ -0,0 +1,21 @@
+// Stand-in for the lwIP address types.
+#ifndef HOST_LWIP_IP_ADDR_H
+#define HOST_LWIP_IP_ADDR_H
+
+#include <stdint.h>
+
+typedef int8_t err_t;
+typedef uint16_t u16_t;
+typedef uint8_t u8_t;
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_USE -8
+#define ERR_ARG -16
+
+struct ip4_addr {
+  uint32_t addr;
+};
+typedef struct ip4_addr ip4_addr_t;
+typedef ip4_addr_t ip_addr_t;
+
+#endif
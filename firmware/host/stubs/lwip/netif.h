@@ -0,0 +1,34 @@
+// Stand-in for the lwIP network interface of the station, with the
+// addresses from HostNetwork.
+#ifndef HOST_LWIP_NETIF_H
+#define HOST_LWIP_NETIF_H
+
+#include "lwip/ip_addr.h"
+
+#include <stddef.h>
+
+struct pbuf;
+struct netif;
+typedef err_t (*netif_input_fn)(struct pbuf *p, struct netif *inp);
+
+struct netif {
+  ip4_addr_t ip_addr;
+  ip4_addr_t netmask;
+  netif_input_fn input;
+};
+
+#define netif_ip4_addr(n) (&(n)->ip_addr)
+#define netif_ip4_netmask(n) (&(n)->netmask)
+#define ip_2_ip4(a) (a)
+#define ip4_addr_netcmp(a, n, m) ((((a)->addr ^ (n)->addr) & (m)->addr) == 0)
+#define ip_addr_copy_from_ip4(dest, src) ((dest) = (src))
+
+// Returns the station interface with the current HostNetwork addresses
+struct netif *ip4_route(const ip4_addr_t *dest);
+
+namespace HostArp {
+// Passes an Ethernet frame to the input function of the station interface
+void injectFrame(const uint8_t *frame, size_t length);
+}  // namespace HostArp
+
+#endif
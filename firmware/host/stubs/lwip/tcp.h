@@ -0,0 +1,42 @@
+// Stand-in for the lwIP raw TCP API, connecting to the simulated LAN: a
+// connection to an up host is accepted if the port is open and reset
+// otherwise; a down host never answers. Connections to 127.0.0.0/8 are real
+// non-blocking sockets, to test clients against local servers (e.g. a broker).
+#ifndef HOST_LWIP_TCP_H
+#define HOST_LWIP_TCP_H
+
+#include "lwip/ip_addr.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+
+#include <stddef.h>
+
+#define ERR_ABRT -13
+#define ERR_RST -14
+
+struct tcp_pcb;
+typedef err_t (*tcp_connected_fn)(void *arg, struct tcp_pcb *tpcb, err_t err);
+typedef void (*tcp_err_fn)(void *arg, err_t err);
+typedef err_t (*tcp_recv_fn)(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define ERR_CONN -11
+
+struct tcp_pcb *tcp_new();
+void tcp_arg(struct tcp_pcb *pcb, void *arg);
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err);
+err_t tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port, tcp_connected_fn connected);
+void tcp_abort(struct tcp_pcb *pcb);
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv);
+void tcp_recved(struct tcp_pcb *pcb, u16_t len);
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags);
+err_t tcp_output(struct tcp_pcb *pcb);
+err_t tcp_close(struct tcp_pcb *pcb);
+u16_t tcp_sndbuf(struct tcp_pcb *pcb);
+void tcp_nagle_disable(struct tcp_pcb *pcb);
+
+namespace HostTcp {
+size_t openCount();
+}  // namespace HostTcp
+
+#endif
@@ -0,0 +1,43 @@
+// Stand-in for the lwIP raw UDP API, backed by sockets on 127.0.0.1.
+//
+// Listeners bind to HostNetwork::mapPort(port). RELAY_SRC overrides the
+// source address reported to the receive callback (to simulate a remote
+// subnet) and RELAY_CHAIN splits received datagrams into two pbufs.
+#ifndef HOST_LWIP_UDP_H
+#define HOST_LWIP_UDP_H
+
+#include "lwip/ip_addr.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+
+#include <stddef.h>
+
+
+const struct netif *ip_current_netif();
+const ip_addr_t *ip_current_dest_addr();
+bool ip_addr_isbroadcast(const ip_addr_t *addr, const struct netif *netif);
+
+
+extern const ip_addr_t ip_addr_any;
+extern const ip_addr_t ip_addr_broadcast;
+#define IP_ANY_TYPE (&ip_addr_any)
+#define IP_ADDR_BROADCAST (&ip_addr_broadcast)
+
+struct udp_pcb;
+typedef void (*udp_recv_fn)(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
+
+#define SOF_BROADCAST 0x20
+void ip_set_option(struct udp_pcb *pcb, int option);
+
+struct udp_pcb *udp_new();
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port);
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *arg);
+void udp_remove(struct udp_pcb *pcb);
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst, u16_t port);
+
+namespace HostUdp {
+size_t openCount();
+size_t livePbufs();
+}  // namespace HostUdp
+
+#endif
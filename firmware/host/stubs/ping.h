@@ -0,0 +1,44 @@
+// Stand-in for the SDK asynchronous ping (ping_start) answering from the
+// simulated LAN (see HostLan.h). Replies and timeouts are delivered from
+// yield(), as the SDK delivers them between two loop() iterations.
+#ifndef HOST_PING_H
+#define HOST_PING_H
+
+#include <stdint.h>
+
+typedef void (*ping_recv_function)(void *arg, void *pdata);
+typedef void (*ping_sent_function)(void *arg, void *pdata);
+
+struct ping_option {
+  uint32_t count;
+  uint32_t ip;
+  uint32_t coarse_time;
+  ping_recv_function recv_function;
+  ping_sent_function sent_function;
+  void *reverse;
+};
+
+struct ping_resp {
+  uint32_t total_count;
+  uint32_t resp_time;
+  uint32_t seqno;
+  uint32_t timeout_count;
+  uint32_t bytes;
+  uint32_t total_bytes;
+  uint32_t total_time;
+  int8_t ping_err;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool ping_start(struct ping_option *ping_opt);
+bool ping_regist_recv(struct ping_option *ping_opt, ping_recv_function ping_recv);
+bool ping_regist_sent(struct ping_option *ping_opt, ping_sent_function ping_sent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
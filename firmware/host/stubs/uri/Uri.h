@@ -0,0 +1,25 @@
+// Stand-in for the ESP8266WebServer Uri matcher.
+#ifndef HOST_URI_H
+#define HOST_URI_H
+
+#include <Arduino.h>
+
+#include <memory>
+#include <vector>
+
+class Uri {
+public:
+  Uri(const char *uri) : uri(uri) {}
+  Uri(const String &uri) : uri(uri) {}
+  virtual ~Uri() {}
+  virtual Uri *clone() const { return new Uri(uri); }
+  virtual bool canHandle(const String &requestUri, std::vector<String> &pathArgs) {
+    pathArgs.clear();
+    return requestUri == uri;
+  }
+
+protected:
+  String uri;
+};
+
+#endif
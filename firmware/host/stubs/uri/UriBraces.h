@@ -0,0 +1,33 @@
+// Stand-in for the ESP8266WebServer "{}" path argument matcher.
+#ifndef HOST_URIBRACES_H
+#define HOST_URIBRACES_H
+
+#include "Uri.h"
+
+class UriBraces : public Uri {
+public:
+  explicit UriBraces(const char *uri) : Uri(uri) {}
+  explicit UriBraces(const String &uri) : Uri(uri) {}
+  Uri *clone() const override { return new UriBraces(uri); }
+
+  bool canHandle(const String &requestUri, std::vector<String> &pathArgs) override {
+    pathArgs.clear();
+    size_t i = 0, j = 0;
+    while (i < uri.length()) {
+      if (uri[i] == '{' && i + 1 < uri.length() && uri[i + 1] == '}') {
+        char next = i + 2 < uri.length() ? uri[i + 2] : '\0';
+        String arg;
+        while (j < requestUri.length() && requestUri[j] != '/' && requestUri[j] != next) arg += requestUri[j++];
+        pathArgs.push_back(arg);
+        i += 2;
+      } else {
+        if (j >= requestUri.length() || uri[i] != requestUri[j]) return false;
+        i++;
+        j++;
+      }
+    }
+    return j == requestUri.length();
+  }
+};
+
+#endif
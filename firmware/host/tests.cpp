@@ -0,0 +1,571 @@
+// Tests of the sketch, run by ctest. Each test is a function calling the
+// handlers directly, like bench.cpp, and checking the state they leave.
+#include "sketch.cpp"
+
+#include "HostClock.h"
+#include "HostLan.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+static int failures = 0;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      failures++; \
+    } \
+  } while (0)
+
+static void setupHost() {
+  static bool done = false;
+  if (done) {
+    return;
+  }
+  done = true;
+  HostClock::setManual(true);
+  char root[] = "/tmp/espwol-tests-XXXXXX";
+  LittleFS.setRoot(mkdtemp(root));
+#if ENABLE_ARP_SNOOPING == 1
+  setupSnooping();
+#endif
+}
+
+// Starts from an empty database holding `count` hosts
+static void resetDatabase(int count) {
+  setupHost();
+  hosts.clear();
+  timers.clear();
+  scheduleConfig.rules.clear();
+  for (int i = 0; i < count; i++) {
+    Host host;
+    host.name = "host-" + String(i);
+    char text[24];
+    snprintf(text, sizeof(text), "02:00:00:00:00:%02X", i);
+    host.mac = text;
+    parseMACAddress(host.mac, host.macBytes);
+    host.ip = "10.0.0." + String(i + 1);
+    hosts[i] = host;
+  }
+  rebuildHostIndexes();
+  refreshWakeTargets();
+  handleWakeTargets();
+  saveHostsData();
+  saveSchedules();
+}
+
+static int findRuleFor(const String &mac) {
+  for (const auto &[id, schedule] : scheduleConfig.rules) {
+    if (schedule.mac == mac) {
+      return id;
+    }
+  }
+  return -1;
+}
+
+// Rules follow their host when the hosts are renumbered by a reload
+static void testScheduleAfterDeleteAndReload() {
+  resetDatabase(3);
+  server.hostRequest(HTTP_POST, "/schedules", "{\"cron\":\"@daily 07:00\",\"host\":0}");
+  handleSchedules();
+  server.hostRequest(HTTP_POST, "/schedules", "{\"cron\":\"@daily 08:00\",\"host\":2}");
+  handleSchedules();
+  CHECK(scheduleConfig.rules.size() == 2);
+
+  String mac = hosts[2].mac;
+  server.hostRequest(HTTP_DELETE, "/hosts?id=0");
+  handleHosts();
+  CHECK(hosts.size() == 2);
+  CHECK(scheduleConfig.rules.size() == 1);  // The rule of the deleted host is gone
+
+  loadHostsData();
+  loadSchedules();
+  CHECK(hosts.size() == 2);
+  CHECK(hosts[1].mac == mac);
+  int rule = findRuleFor(mac);
+  CHECK(rule >= 0);
+  CHECK(rule >= 0 && findScheduleHost(scheduleConfig.rules[rule]) == 1);
+}
+
+// A rule follows its host to a new MAC address
+static void testScheduleAfterMacChange() {
+  resetDatabase(2);
+  server.hostRequest(HTTP_POST, "/schedules", "{\"cron\":\"@daily 07:00\",\"host\":1}");
+  handleSchedules();
+  server.hostRequest(HTTP_PUT, "/hosts?id=1", "{\"name\":\"host-1\",\"mac\":\"02:00:00:00:00:AA\",\"ip\":\"10.0.0.2\",\"periodicPing\":0}");
+  handleHosts();
+  CHECK(hosts[1].mac == "02:00:00:00:00:AA");
+
+  loadSchedules();
+  int rule = findRuleFor("02:00:00:00:00:AA");
+  CHECK(rule >= 0 && findScheduleHost(scheduleConfig.rules[rule]) == 1);
+}
+
+// Answers are only taken for the name that was asked
+static void testDnsNameMatch() {
+  uint8_t message[64] = {};
+  size_t end = writeDnsName(message, 12, "Server.lan");
+  message[end] = 0xC0;  // Compression pointer to the first name
+  message[end + 1] = 12;
+  CHECK(matchDnsName(message, end + 2, 12, "server.LAN") == end);
+  CHECK(matchDnsName(message, end + 2, end, "server.lan") == end + 2);
+  CHECK(!matchDnsName(message, end + 2, 12, "server"));
+  CHECK(!matchDnsName(message, end + 2, 12, "server.lan.com"));
+  CHECK(!matchDnsName(message, end + 2, 12, "serve.lan"));
+  CHECK(!matchDnsName(message, end + 2, 12, "other.lan"));
+}
+
+// A host follows a new address only when it opted in and the address is confirmed
+static void testSnoopedAddressConfirmation() {
+  resetDatabase(2);
+  hosts[1].followIp = true;
+  syncSnoopedHosts();
+  struct netif netif = {};
+  netif.ip_addr.addr = IPAddress(10, 0, 0, 100);
+  netif.netmask.addr = IPAddress(255, 255, 255, 0);
+  const uint8_t moved[] = { 10, 0, 0, 50 };
+
+  recordSighting(hosts[0].macBytes, moved, &netif);
+  recordSighting(hosts[1].macBytes, moved, &netif);
+  HostClock::advance(SNOOP_CHECK_INTERVAL);
+  handleSnooping();
+  CHECK(hosts[0].ip == "10.0.0.1");
+  CHECK(hosts[1].ip == "10.0.0.2");  // A single frame
+
+  for (int i = 0; i < SNOOP_CONFIRM_FRAMES; i++) {
+    HostClock::advance(SNOOP_CONFIRM_TIME / SNOOP_CONFIRM_FRAMES);
+    recordSighting(hosts[0].macBytes, moved, &netif);
+    recordSighting(hosts[1].macBytes, moved, &netif);
+  }
+  handleSnooping();
+  CHECK(hosts[0].ip == "10.0.0.1");  // Not opted in
+  CHECK(hosts[1].ip == "10.0.0.50");
+
+  const uint8_t leased[] = { 10, 0, 0, 60 };
+  recordSighting(hosts[1].macBytes, leased, &netif, true);
+  HostClock::advance(SNOOP_CHECK_INTERVAL);
+  handleSnooping();
+  CHECK(hosts[1].ip == "10.0.0.60");  // Seen in a DHCP ack
+}
+
+// Runs the loop for `ms` milliseconds of the manual clock
+static void runLoop(unsigned long ms) {
+  for (unsigned long i = 0; i < ms; i += 10) {
+    HostClock::advance(10);
+    HostClock::yield();
+#if ENABLE_MQTT == 1
+    handleMqtt();
+#endif
+    handleJobs();
+  }
+}
+
+#if ENABLE_MQTT == 1
+// Local broker on loopback, answering the CONNECT of a single client
+class LocalBroker {
+public:
+  LocalBroker() {
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    bind(listener, (sockaddr *)&address, length);
+    listen(listener, 1);
+    getsockname(listener, (sockaddr *)&address, &length);
+    port = ntohs(address.sin_port);
+    fcntl(listener, F_SETFL, O_NONBLOCK);
+  }
+
+  ~LocalBroker() {
+    if (client >= 0) close(client);
+    close(listener);
+  }
+
+  // Accepts the client and answers its CONNECT, true once done
+  bool accept() {
+    if (client < 0) {
+      client = ::accept(listener, nullptr, nullptr);
+      if (client >= 0) {
+        int one = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // The loop runs faster than the delayed ACKs
+        fcntl(client, F_SETFL, O_NONBLOCK);
+      }
+      return false;
+    }
+    uint8_t buffer[512];
+    ssize_t received = recv(client, buffer, sizeof(buffer), 0);
+    if (received > 0 && buffer[0] == 0x10) {
+      const uint8_t connack[] = { 0x20, 2, 0, 0 };
+      send(client, connack, sizeof(connack), MSG_NOSIGNAL);
+      return true;
+    }
+    return false;
+  }
+
+  void publish(const String &topic, bool retain) {
+    uint8_t packet[256] = { (uint8_t)(0x30 | (retain ? 0x01 : 0x00)), (uint8_t)(2 + topic.length()), 0, (uint8_t)topic.length() };
+    memcpy(packet + 4, topic.c_str(), topic.length());
+    send(client, packet, 4 + topic.length(), MSG_NOSIGNAL);
+  }
+
+  uint16_t port;
+
+private:
+  int listener;
+  int client = -1;
+};
+
+// Wake commands replayed as retained messages by the broker are ignored
+static void testMqttRetainedCommand() {
+  resetDatabase(2);
+  LocalBroker broker;
+  mqttConfig.enable = true;
+  mqttConfig.host = "127.0.0.1";
+  mqttConfig.port = broker.port;
+  setupMqtt();
+  bool accepted = false;
+  for (int i = 0; i < 200 && !accepted; i++) {
+    runLoop(10);
+    accepted = broker.accept();
+  }
+  runLoop(100);
+  CHECK(getMqttState() == MqttState::Connected);
+
+  uint32_t sent = getMagicPacketsSent();
+  uint32_t retained = getMqttStats().retained;
+  broker.publish("espwol/hosts/020000000000/wake", true);
+  runLoop(100);
+  CHECK(getMagicPacketsSent() == sent);
+  CHECK(getMqttStats().retained == retained + 1);
+
+  broker.publish("espwol/hosts/020000000001/wake", false);
+  runLoop(100);
+  CHECK(getMagicPacketsSent() > sent);
+
+  mqttConfig.enable = false;
+  setupMqtt();
+}
+#endif
+
+// Runs the loop until a job is done, at most `ms` milliseconds
+static const Job *runJob(int id, unsigned long ms) {
+  for (unsigned long i = 0; i < ms && !findJob(id)->done; i += 10) {
+    runLoop(10);
+  }
+  return findJob(id);
+}
+
+// A verified wake reports the host up once it booted, and the time it took
+static void testVerifyJobBootDelay() {
+  resetDatabase(3);
+  HostLan::addHost(IPAddress(10, 0, 0, 1), hosts[0].macBytes, false, 3000);
+  HostLan::addHost(IPAddress(10, 0, 0, 2), hosts[1].macBytes, true);
+  // hosts[2] is not on the LAN and never answers
+
+  int id = queueVerifyJob({ 0, 1, 2 }, 10);
+  const Job *job = runJob(id, 15000);
+  CHECK(job->done);
+  CHECK(job->results[0] == 1);
+  CHECK(job->verify[0].upAfter >= 3000 && job->verify[0].upAfter < 3000 + 2 * PROBE_DEFAULT_TIMEOUT);
+  CHECK(job->results[1] == 1);
+  CHECK(job->verify[1].upAfter < 2 * PROBE_DEFAULT_TIMEOUT);
+  CHECK(job->results[2] == 0);
+  CHECK(job->sent == 2 && job->failed == 1);
+  CHECK(job->finishedAt - job->createdAt >= 10000);
+}
+
+// A host deleted while a ping job probes it leaves no probe behind for the next host
+static void testPingJobDeletedHost() {
+  resetDatabase(2);
+  HostLan::setUp(IPAddress(10, 0, 0, 1), false);  // Woken by the verify test
+
+  int id = queuePingJob({ 0, 1 });
+  runLoop(20);  // Probe of hosts[0] started
+  hosts.erase(0);
+  rebuildHostIndexes();
+  const Job *job = runJob(id, 5000);
+  CHECK(job->done);
+  CHECK(job->results[0] == 0);
+  CHECK(job->results[1] == 1);
+
+  runLoop(2 * PROBE_DEFAULT_TIMEOUT);  // Echo requests keep their slot until the SDK times them out
+  int8_t started[PROBE_SLOTS];
+  for (int8_t &probe : started) {
+    probe = startProbe(IPAddress(10, 0, 0, 2));
+    CHECK(probe >= 0);
+  }
+  for (int8_t probe : started) {
+    clearProbe(probe);
+  }
+  runLoop(10);  // The echo replies free the slots
+}
+
+// Times of the packets of a wake job, with the clock advanced 1 ms at a time
+static std::vector<unsigned long> runWakeJob(int id) {
+  std::vector<unsigned long> times;
+  const Job *job = findJob(id);
+  for (int i = 0; i < 10000 && !job->done; i++) {
+    HostClock::advance(1);
+    size_t packets = job->sent + job->failed;
+    handleJobs();
+    if (job->sent + job->failed != packets) {
+      times.push_back(millis());
+    }
+  }
+  return times;
+}
+
+// Packets of a wake job are `spacing` and `1000 / maxPps` milliseconds apart, whichever is longer
+static void testWakeJobPacing() {
+  resetDatabase(2);
+
+  std::vector<unsigned long> times = runWakeJob(queueWakeJob({ 0, 1 }, 3, 250, 20));
+  CHECK(times.size() == 6);
+  for (size_t i = 1; i < times.size(); i++) {
+    CHECK(times[i] - times[i - 1] == 250);
+  }
+
+  times = runWakeJob(queueWakeJob({ 0, 1 }, 2, 0, 5));
+  CHECK(times.size() == 4);
+  for (size_t i = 1; i < times.size(); i++) {
+    CHECK(times[i] - times[i - 1] == 200);
+  }
+  CHECK(findJob(queueWakeJob({ 0 }, 1, 0, WAKE_MAX_PPS))->interval == 1000 / WAKE_MAX_PPS);
+  runLoop(10);
+}
+
+// A queued job does not wake the host added with the id of a deleted one
+static void testJobAfterHostIdReuse() {
+  resetDatabase(2);
+  uint8_t mac[6] = { 0x02, 0, 0, 0, 0, 0x77 };
+  HostLan::SimulatedHost &added = HostLan::addHost(IPAddress(10, 0, 0, 77), mac, true);
+
+  int id = queueWakeJob({ 1 }, 1, 0, WAKE_DEFAULT_MAX_PPS);
+  server.hostRequest(HTTP_DELETE, "/hosts?id=1");
+  handleHosts();
+  server.hostRequest(HTTP_POST, "/hosts", "{\"name\":\"host-77\",\"mac\":\"02:00:00:00:00:77\",\"ip\":\"10.0.0.77\",\"periodicPing\":0}");
+  handleHosts();
+  CHECK(hosts.size() == 2 && hosts.count(1) && hosts[1].mac == "02:00:00:00:00:77");
+  handleWakeTargets();
+
+  const Job *job = runJob(id, 1000);
+  CHECK(job->done);
+  CHECK(job->sent == 0 && job->failed == 1);
+  CHECK(added.magicPackets == 0);
+
+  // Adding after a delete never replaces another host
+  server.hostRequest(HTTP_DELETE, "/hosts?id=0");
+  handleHosts();
+  server.hostRequest(HTTP_POST, "/hosts", "{\"name\":\"host-78\",\"mac\":\"02:00:00:00:00:78\",\"ip\":\"10.0.0.78\",\"periodicPing\":0}");
+  handleHosts();
+  CHECK(hosts.size() == 2 && hosts[1].mac == "02:00:00:00:00:77" && hosts[2].mac == "02:00:00:00:00:78");
+}
+
+// GET /hosts answers 304 to the ETag of the database, until the database changes
+static void testHostsETag() {
+  resetDatabase(2);
+  String etag = getDatabaseETag();
+
+  server.hostRequest(HTTP_GET, "/hosts");
+  handleHosts();
+  CHECK(server.hostResponseCode() == 200);
+
+  server.hostRequest(HTTP_GET, "/hosts");
+  server.hostHeader("If-None-Match", etag);
+  handleHosts();
+  CHECK(server.hostResponseCode() == 304);
+
+  server.hostRequest(HTTP_DELETE, "/hosts?id=0");
+  handleHosts();
+  server.hostRequest(HTTP_GET, "/hosts");
+  server.hostHeader("If-None-Match", etag);
+  handleHosts();
+  CHECK(server.hostResponseCode() == 200);
+  CHECK(getDatabaseETag() != etag);
+}
+
+// HTTP server on loopback sending one firmware image, in two parts, then closing the connection after `length` bytes
+class LocalFirmwareServer {
+public:
+  LocalFirmwareServer(const std::string &image, size_t length) {
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t size = sizeof(address);
+    bind(listener, (sockaddr *)&address, size);
+    listen(listener, 1);
+    getsockname(listener, (sockaddr *)&address, &size);
+    url = "http://127.0.0.1:" + String(ntohs(address.sin_port)) + "/firmware.bin";
+    thread = std::thread([this, image, length]() {
+      int client = accept(listener, nullptr, nullptr);
+      std::string request;
+      char buffer[512];
+      ssize_t received;
+      while (request.find("\r\n\r\n") == std::string::npos && (received = recv(client, buffer, sizeof(buffer), 0)) > 0) {
+        request.append(buffer, received);
+      }
+      std::string headers = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(image.size()) + "\r\n\r\n";
+      send(client, headers.data(), headers.size(), MSG_NOSIGNAL);
+      size_t half = length / 2;
+      send(client, image.data(), half, MSG_NOSIGNAL);
+      usleep(50000);  // The download goes on over several steps
+      send(client, image.data() + half, length - half, MSG_NOSIGNAL);
+      close(client);
+    });
+  }
+
+  ~LocalFirmwareServer() {
+    thread.join();
+    close(listener);
+  }
+
+  String url;
+
+private:
+  int listener;
+  std::thread thread;
+};
+
+// Runs a firmware update until it fails or is about to reboot, returns the largest write of a step
+static size_t runUpdate(const String &url) {
+  startUpdateDownload(url);
+  size_t largest = 0;
+  for (int i = 0; i < 5000; i++) {
+    size_t written = getUpdateProgress().written;
+    handleUpdateDownload();
+    largest = std::max(largest, getUpdateProgress().written - written);
+    UpdateStage stage = getUpdateProgress().stage;
+    if (stage == UpdateStage::Failed || stage == UpdateStage::Rebooting) {
+      break;  // Rebooting ends the process after UPDATE_REBOOT_DELAY
+    }
+    delay(1);
+  }
+  return largest;
+}
+
+// A download cut short is discarded, the next one is written in chunks and installed
+static void testUpdateDownload() {
+  HostClock::setManual(false);  // The server runs on its own thread
+  char path[] = "/tmp/espwol-firmware-XXXXXX";
+  close(mkstemp(path));
+  UpdaterClass::path = path;
+  std::string image(3 * UPDATE_CHUNK_SIZE + 100, '\0');
+  for (size_t i = 0; i < image.size(); i++) {
+    image[i] = (char)(i * 7);
+  }
+
+  {
+    LocalFirmwareServer server(image, image.size() / 2);
+    runUpdate(server.url);
+  }
+  CHECK(getUpdateProgress().stage == UpdateStage::Failed);
+  CHECK(getUpdateProgress().error == "Download interrupted");
+  CHECK(getUpdateProgress().written == image.size() / 2);
+  CHECK(!Update.isRunning());
+  CHECK(!UpdaterClass::installed);
+
+  size_t largest;
+  {
+    LocalFirmwareServer server(image, image.size());
+    largest = runUpdate(server.url);
+  }
+  CHECK(getUpdateProgress().stage == UpdateStage::Rebooting);
+  CHECK(getUpdateProgress().written == image.size());
+  CHECK(largest > 0 && largest <= UPDATE_CHUNK_SIZE);
+  CHECK(UpdaterClass::installed);
+  FILE *file = fopen(path, "rb");
+  std::string written(image.size() + 1, '\0');
+  written.resize(file ? fread(&written[0], 1, written.size(), file) : 0);
+  if (file) {
+    fclose(file);
+  }
+  CHECK(written == image);
+  unlink(path);
+  HostClock::setManual(true);
+}
+
+// Polls a probe until it has a result, at most `ms` milliseconds
+static ProbeState waitProbe(int8_t probe, unsigned long ms) {
+  for (unsigned long i = 0; i < ms && getProbeState(probe) == ProbeState::Pending; i += 10) {
+    runLoop(10);
+  }
+  return getProbeState(probe);
+}
+
+// Probes use their whole timeout, and only count answers received after they started
+static void testProbeTimeouts() {
+  setupHost();
+  const uint8_t booting[6] = { 0x02, 0, 0, 0, 0, 0x51 };
+  HostLan::addHost(IPAddress(10, 0, 0, 51), booting, false);
+  int8_t probe = startProbe(IPAddress(10, 0, 0, 51), ProbeTarget(), 3000);
+  runLoop(1500);
+  HostLan::setUp(IPAddress(10, 0, 0, 51), true);  // Past the one second the SDK awaits an echo reply
+  CHECK(waitProbe(probe, 3000) == ProbeState::Up);
+  clearProbe(probe);
+
+#if ENABLE_ARP_SNOOPING == 1
+  const uint8_t neighbor[6] = { 0x02, 0, 0, 0, 0, 0x50 };
+  HostLan::addHost(IPAddress(127, 0, 0, 50), neighbor, true);  // On the device network of the host build
+  ProbeTarget arp;
+  arp.type = ProbeType::Arp;
+  probe = startProbe(IPAddress(127, 0, 0, 50), arp);
+  CHECK(waitProbe(probe, 2000) == ProbeState::Up);
+  clearProbe(probe);
+
+  HostLan::setUp(IPAddress(127, 0, 0, 50), false);  // Its ARP entry is still cached
+  probe = startProbe(IPAddress(127, 0, 0, 50), arp);
+  CHECK(waitProbe(probe, 2000) == ProbeState::Down);
+  clearProbe(probe);
+#endif
+  runLoop(3000);  // Echo requests still in flight
+}
+
+#if ENABLE_TRACE == 1
+// Request numbers skip 0, the number of the spans outside of a request, when they wrap
+static void testTraceRequestWrap() {
+  traceRequest = UINT16_MAX;
+  {
+    TRACE_REQUEST("/wrap");
+    TRACE_SPAN("phase");
+  }
+  const TraceRecord &phase = traceRecords[(traceHead + TRACE_BUFFER_SIZE - 2) % TRACE_BUFFER_SIZE];
+  const TraceRecord &request = traceRecords[(traceHead + TRACE_BUFFER_SIZE - 1) % TRACE_BUFFER_SIZE];
+  CHECK(request.request == 1 && phase.request == 1);
+}
+#endif
+
+int main() {
+  testScheduleAfterDeleteAndReload();
+  testScheduleAfterMacChange();
+  testDnsNameMatch();
+  testSnoopedAddressConfirmation();
+  testVerifyJobBootDelay();
+  testPingJobDeletedHost();
+  testWakeJobPacing();
+  testJobAfterHostIdReuse();
+  testHostsETag();
+#if ENABLE_TRACE == 1
+  testTraceRequestWrap();
+#endif
+  testProbeTimeouts();
+#if ENABLE_MQTT == 1
+  testMqttRetainedCommand();
+#endif
+  testUpdateDownload();  // Last: the update is left about to reboot
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
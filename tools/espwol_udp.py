@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""Client of the EspWOL UDP control port (see docs/CONTROL.md).
+
+Usage:
+  espwol_udp.py --host wol.local wake AA:BB:CC:DD:EE:FF
+  espwol_udp.py --host wol.local status AA:BB:CC:DD:EE:FF
+  espwol_udp.py --host wol.local bulk office
+
+The key is read from --key or the ESPWOL_KEY environment variable, in hex.
+"""
+
+import argparse
+import hashlib
+import hmac
+import os
+import socket
+import struct
+import sys
+import time
+
+DEFAULT_PORT = 9009
+VERSION = 1
+REQUEST = struct.Struct(">2sBBII24s")  # Magic, version, command, timestamp, nonce, argument
+REPLY = struct.Struct(">2sBBBBHII")    # Magic, version, command, status, result, value, nonce, device time
+TAG_SIZE = 16
+
+WAKE, STATUS, BULK_WAKE = 1, 2, 3
+STATUS_NAMES = {0: "ok", 1: "stale", 2: "replayed", 3: "not found", 4: "failed", 5: "unsupported"}
+OK, STALE = 0, 1
+
+
+class ControlError(Exception):
+    pass
+
+
+class Reply:
+    def __init__(self, command, status, result, value, device_time):
+        self.command = command
+        self.status = status
+        self.result = result
+        self.value = value
+        self.device_time = device_time
+
+    @property
+    def ok(self):
+        return self.status == OK
+
+    def __str__(self):
+        text = STATUS_NAMES.get(self.status, str(self.status))
+        if not self.ok:
+            return text
+        if self.command == WAKE:
+            return "sent"
+        if self.command == STATUS:
+            if self.result == 0xFF:
+                return "unknown"
+            state = "up" if self.result else "down"
+            return state if self.value == 0xFFFF else "%s (%d s ago)" % (state, self.value)
+        return "%d hosts queued (job %d)" % (self.result, self.value)
+
+
+def parse_mac(mac):
+    parts = mac.replace("-", ":").split(":")
+    if len(parts) != 6:
+        raise ValueError("invalid MAC address: %s" % mac)
+    return bytes(int(part, 16) for part in parts)
+
+
+class ControlClient:
+    """Sends requests and waits for their reply, one at a time."""
+
+    def __init__(self, host, key, port=DEFAULT_PORT, timeout=1.0, attempts=3):
+        self.address = (socket.gethostbyname(host), port)
+        self.key = key
+        self.timeout = timeout
+        self.attempts = attempts
+        self.offset = 0  # Seconds from the local clock to the device clock
+        self.counter = 0
+        self.socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.socket.connect(self.address)
+
+    def close(self):
+        self.socket.close()
+
+    def _sign(self, frame):
+        return hmac.new(self.key, frame, hashlib.sha256).digest()[:TAG_SIZE]
+
+    def _nonce(self, now):
+        # Increases within a second, also across runs: microseconds, then a counter
+        self.counter = (self.counter + 1) & 0xFFF
+        return (int((now % 1) * 1000000) << 12 | self.counter) & 0xFFFFFFFF
+
+    def _exchange(self, command, argument):
+        now = time.time()
+        timestamp = (int(now) + self.offset) & 0xFFFFFFFF
+        nonce = self._nonce(now)
+        frame = REQUEST.pack(b"EW", VERSION, command, timestamp, nonce, argument)
+        self.socket.send(frame + self._sign(frame))
+
+        deadline = time.monotonic() + self.timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return None
+            self.socket.settimeout(remaining)
+            try:
+                data = self.socket.recv(64)
+            except socket.timeout:
+                return None
+            if len(data) != REPLY.size + TAG_SIZE or not hmac.compare_digest(self._sign(data[:REPLY.size]), data[REPLY.size:]):
+                continue
+            magic, version, echoed, status, result, value, echoed_nonce, device_time = REPLY.unpack(data[:REPLY.size])
+            if magic == b"EW" and echoed == command and echoed_nonce == nonce:
+                return Reply(command, status, result, value, device_time)
+
+    def request(self, command, argument):
+        """Sends a request, resends it on timeout and adopts the device clock if it was stale."""
+        argument = argument.ljust(24, b"\0")
+        synced = False
+        attempts = 0
+        while attempts < self.attempts:
+            reply = self._exchange(command, argument)
+            if reply is None:
+                attempts += 1
+                continue
+            if reply.status == STALE and not synced:
+                self.offset = reply.device_time - int(time.time())
+                synced = True
+                continue
+            return reply
+        raise ControlError("no reply from %s:%d" % self.address)
+
+    def wake(self, mac):
+        return self.request(WAKE, parse_mac(mac))
+
+    def status(self, mac):
+        return self.request(STATUS, parse_mac(mac))
+
+    def bulk_wake(self, tag):
+        encoded = tag.encode()
+        if not encoded or len(encoded) > 24:
+            raise ValueError("invalid tag: %s" % tag)
+        return self.request(BULK_WAKE, encoded)
+
+
+def read_key(value):
+    key = value or os.environ.get("ESPWOL_KEY", "")
+    try:
+        key = bytes.fromhex(key)
+    except ValueError:
+        key = b""
+    if not 16 <= len(key) <= 64:
+        sys.exit("A key of 16 to 64 bytes in hex is required (--key or ESPWOL_KEY)")
+    return key
+
+
+def main():
+    parser = argparse.ArgumentParser(description="EspWOL UDP control client")
+    parser.add_argument("--host", default="wol.local")
+    parser.add_argument("--port", type=int, default=DEFAULT_PORT)
+    parser.add_argument("--key", help="pre-shared key in hex, default $ESPWOL_KEY")
+    parser.add_argument("--timeout", type=float, default=1.0, help="seconds to wait for each reply")
+    parser.add_argument("command", choices=["wake", "status", "bulk"])
+    parser.add_argument("target", help="MAC address of a host, or tag for bulk")
+    args = parser.parse_args()
+
+    client = ControlClient(args.host, read_key(args.key), args.port, args.timeout)
+    try:
+        if args.command == "wake":
+            reply = client.wake(args.target)
+        elif args.command == "status":
+            reply = client.status(args.target)
+        else:
+            reply = client.bulk_wake(args.target)
+    except (ControlError, ValueError) as error:
+        sys.exit(str(error))
+    finally:
+        client.close()
+    print(reply)
+    sys.exit(0 if reply.ok else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Measures the round trip of EspWOL commands over the UDP control port, and over HTTP.
+
+Usage:
+  udp_latency.py --host wol.local --mac AA:BB:CC:DD:EE:FF [--command status] [--count 200]
+  udp_latency.py --host wol.local --mac AA:BB:CC:DD:EE:FF --command wake --http-id 0 [--user admin --password secret]
+
+Each UDP request waits for its reply before the next one is sent. With
+--http-id, the same number of `POST /wake?id=` requests (a new connection
+each, like most automation clients) are timed for comparison.
+"""
+
+import argparse
+import base64
+import statistics
+import sys
+import time
+import urllib.request
+
+from espwol_udp import ControlClient, ControlError, DEFAULT_PORT, read_key
+
+
+def summarize(name, samples, lost):
+    samples.sort()
+    if not samples:
+        print("%-6s no replies, %d lost" % (name, lost))
+        return
+
+    def percentile(p):
+        return samples[min(len(samples) - 1, int(len(samples) * p))]
+
+    print("%-6s n=%-5d lost=%-3d min=%7.2f  median=%7.2f  p95=%7.2f  p99=%7.2f  max=%7.2f ms" % (
+        name, len(samples), lost, samples[0], statistics.median(samples), percentile(0.95), percentile(0.99), samples[-1]))
+
+
+def bench_udp(client, command, mac, count):
+    run = client.wake if command == "wake" else client.status
+    run(mac)  # Learns the device clock offset outside of the timed requests
+    samples, lost = [], 0
+    for _ in range(count):
+        start = time.perf_counter()
+        try:
+            reply = run(mac)
+        except ControlError:
+            lost += 1
+            continue
+        if not reply.ok:
+            sys.exit("The device answered: %s" % reply)
+        samples.append((time.perf_counter() - start) * 1000)
+    return samples, lost
+
+
+def bench_http(host, port, id, user, password, count):
+    headers = {}
+    if user:
+        headers["Authorization"] = "Basic " + base64.b64encode(("%s:%s" % (user, password)).encode()).decode()
+    samples, lost = [], 0
+    for _ in range(count):
+        request = urllib.request.Request("http://%s:%d/wake?id=%d" % (host, port, id), method="POST", headers=headers)
+        start = time.perf_counter()
+        try:
+            with urllib.request.urlopen(request, timeout=5) as response:
+                response.read()
+        except OSError:
+            lost += 1
+            continue
+        samples.append((time.perf_counter() - start) * 1000)
+    return samples, lost
+
+
+def main():
+    parser = argparse.ArgumentParser(description="EspWOL control latency benchmark")
+    parser.add_argument("--host", default="wol.local")
+    parser.add_argument("--port", type=int, default=DEFAULT_PORT)
+    parser.add_argument("--key", help="pre-shared key in hex, default $ESPWOL_KEY")
+    parser.add_argument("--mac", required=True, help="MAC address of a host")
+    parser.add_argument("--command", choices=["status", "wake"], default="status")
+    parser.add_argument("--count", type=int, default=200)
+    parser.add_argument("--timeout", type=float, default=0.5, help="seconds to wait for each UDP reply")
+    parser.add_argument("--http-id", type=int, help="also time POST /wake?id= for this host index")
+    parser.add_argument("--http-port", type=int, default=80)
+    parser.add_argument("--user")
+    parser.add_argument("--password", default="")
+    args = parser.parse_args()
+
+    client = ControlClient(args.host, read_key(args.key), args.port, args.timeout, attempts=1)
+    try:
+        summarize("udp", *bench_udp(client, args.command, args.mac, args.count))
+    except ControlError as error:
+        sys.exit(str(error))
+    finally:
+        client.close()
+    if args.http_id is not None:
+        summarize("http", *bench_http(args.host, args.http_port, args.http_id, args.user, args.password, args.count))
+
+
+if __name__ == "__main__":
+    main()